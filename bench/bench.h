@@ -0,0 +1,16 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "core/defines.h"
+
+#include <time.h>
+
+static inline u64 bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static inline f64 bench_elapsed_ms(u64 start_ns) { return (f64)(bench_now_ns() - start_ns) / 1e6; }
+
+#endif // BENCH_H
@@ -0,0 +1,129 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "ecs/archetype.h"
+#include "ecs/component_store.h"
+#include "ecs/entity.h"
+#include "ecs/query.h"
+#include "ecs/system.h"
+#include "ecs/world.h"
+
+#include <stdio.h>
+
+#define ENTITY_COUNT 1000000
+// one in MARK_STRIDE components is changed between runs
+#define MARK_STRIDE 100
+#define REPEAT_COUNT 10
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+static f32 sum;
+static u32 visited;
+
+static void read_position(void **components) {
+    const Position *p = components[0];
+    sum += p->x;
+    visited++;
+}
+
+static const char *storage_name(WorldStorage storage) {
+    return storage == WORLD_STORAGE_ARCHETYPE ? "archetype" : "component store";
+}
+
+static void mark_changed(World *world, EntityRange range) {
+    for (u32 i = 0; i < range.count; i += MARK_STRIDE) {
+        world_mark_changed(world, entity_range_get(range, i), Position);
+    }
+}
+
+// What the Changed filter cannot beat: a loop over the changed ticks alone
+static u32 scan_tick_column(const World *world, u32 since) {
+    u32 newer = 0;
+    if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        const ComponentStore *store = &world->component_stores[component_id(Position)];
+        for (u32 i = 0; i < store->component_count; i++) {
+            newer += (i32)(store->changed_ticks[i] - since) > 0;
+        }
+        return newer;
+    }
+
+    for (u32 a = 0; a < darray_length(world->archetypes); a++) {
+        const Archetype *archetype = &world->archetypes[a];
+        u32 column = archetype->column_of[component_id(Position)];
+        for (u32 c = 0; c < darray_length(archetype->chunks); c++) {
+            const ArchetypeChunk *chunk = archetype->chunks[c];
+            const u32 *ticks = archetype_chunk_changed_ticks(archetype, chunk, column);
+            for (u32 slot = 0; slot < chunk->count; slot++) {
+                newer += (i32)(ticks[slot] - since) > 0;
+            }
+        }
+    }
+    return newer;
+}
+
+static void bench_storage(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+    ComponentId ids[] = {component_id(Position)};
+    EntityRange range = world_spawn_batch(&world, ENTITY_COUNT, 1, ids, NULL);
+
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Changed(Position)),
+                         .fn = read_position,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+    // the first run sees every component as added
+    world_run(&world);
+
+    f64 filtered_ms = 0;
+    f64 scan_ms = 0;
+    u32 scanned = 0;
+    visited = 0;
+    for (u32 r = 0; r < REPEAT_COUNT; r++) {
+        u32 since = world.systems[0].last_run_tick;
+        mark_changed(&world, range);
+
+        u64 start = bench_now_ns();
+        scanned += scan_tick_column(&world, since);
+        scan_ms += bench_elapsed_ms(start);
+
+        start = bench_now_ns();
+        world_run(&world);
+        filtered_ms += bench_elapsed_ms(start);
+    }
+
+    // the same walk without the filter
+    world.systems[0].query.filters[0] = QUERY_FILTER_NONE;
+    f64 unfiltered_ms = 0;
+    for (u32 r = 0; r < REPEAT_COUNT; r++) {
+        u64 start = bench_now_ns();
+        world_run(&world);
+        unfiltered_ms += bench_elapsed_ms(start);
+    }
+
+    u32 expected = REPEAT_COUNT * ((ENTITY_COUNT + MARK_STRIDE - 1) / MARK_STRIDE);
+    if (scanned != expected || visited != expected + REPEAT_COUNT * ENTITY_COUNT) {
+        printf("changed filter visited the wrong entities\n");
+    }
+
+    printf("%-16s tick scan %8.3f ms   Changed(T) %8.3f ms   unfiltered %8.3f ms\n",
+           storage_name(storage),
+           scan_ms / REPEAT_COUNT,
+           filtered_ms / REPEAT_COUNT,
+           unfiltered_ms / REPEAT_COUNT);
+
+    world_destroy(&world);
+}
+
+int main(void) {
+    printf("%u entities, 1 in %u changed per run\n", ENTITY_COUNT, MARK_STRIDE);
+    bench_storage(WORLD_STORAGE_COMPONENT_STORE);
+    bench_storage(WORLD_STORAGE_ARCHETYPE);
+
+    if (sum < 0) {
+        printf("%f\n", sum);
+    }
+    return 0;
+}
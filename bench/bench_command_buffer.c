@@ -0,0 +1,174 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "ecs/command_buffer.h"
+#include "ecs/component_store.h"
+#include "ecs/entity.h"
+#include "ecs/world.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ENTITY_COUNT 1000000
+#define ROUNDS 3
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+typedef struct {
+    i32 health;
+} Health;
+
+static const char *backend_name(ComponentStoreBackend backend) {
+    return backend == COMPONENT_STORE_SPARSE_SET ? "sparse set" : "b+tree";
+}
+
+// A world whose entities exist but have no components yet, and a buffer
+// attaching two components to each of them
+static World make_world(ComponentStoreBackend backend, EcsCommandBuffer *buffer) {
+    World world = world_new_with_storage(WORLD_STORAGE_COMPONENT_STORE);
+    world_register_component_with_backend(&world, Position, backend);
+    world_register_component_with_backend(&world, Health, backend);
+
+    *buffer = ecs_command_buffer_new();
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        entity_id entity = world_create_entity(&world);
+        ecs_command_attach(buffer, entity, Position, ((Position){(f32)i, 0, 0}));
+        ecs_command_attach(buffer, entity, Health, ((Health){(i32)i}));
+    }
+    return world;
+}
+
+typedef struct {
+    EcsCommand command;
+    u64 sequence;
+} SortedCommand;
+
+static i32 compare_u64(u64 a, u64 b) { return (a > b) - (a < b); }
+
+static int compare_by_component(const void *a, const void *b) {
+    const SortedCommand *x = a;
+    const SortedCommand *y = b;
+    i32 order = compare_u64(x->command.component, y->command.component);
+    if (order == 0) {
+        order = compare_u64(entity_get_index(x->command.entity), entity_get_index(y->command.entity));
+    }
+    return order != 0 ? order : compare_u64(x->sequence, y->sequence);
+}
+
+// The flush before attaches were batched: the same component major sort, then
+// one store insert and so one B+tree descent per command
+static f64 flush_per_command(ComponentStoreBackend backend) {
+    EcsCommandBuffer buffer;
+    World world = make_world(backend, &buffer);
+
+    u64 start = bench_now_ns();
+    u32 count = darray_length(buffer.commands);
+    SortedCommand *sorted = malloc(sizeof(SortedCommand) * count);
+    for (u32 i = 0; i < count; i++) {
+        sorted[i] = (SortedCommand){.command = buffer.commands[i], .sequence = i};
+    }
+    qsort(sorted, count, sizeof(SortedCommand), compare_by_component);
+    for (u32 i = 0; i < count; i++) {
+        const EcsCommand *command = &sorted[i].command;
+        world_attach_component_by_id(&world, command->entity, command->component, command->payload);
+    }
+    free(sorted);
+    ecs_command_buffer_clear(&buffer);
+    f64 ms = bench_elapsed_ms(start);
+
+    ecs_command_buffer_destroy(&buffer);
+    world_destroy(&world);
+    return ms;
+}
+
+static f64 flush_batched(ComponentStoreBackend backend) {
+    EcsCommandBuffer buffer;
+    World world = make_world(backend, &buffer);
+
+    u64 start = bench_now_ns();
+    world_apply_command_buffer(&world, &buffer);
+    f64 ms = bench_elapsed_ms(start);
+
+    Health *last = world_get_component(&world, entity_make(ENTITY_COUNT - 1, 0), Health);
+    if (last == NULL || last->health != ENTITY_COUNT - 1) {
+        printf("flush lost components\n");
+    }
+
+    ecs_command_buffer_destroy(&buffer);
+    world_destroy(&world);
+    return ms;
+}
+
+static Health *healths;
+static entity_index *keys;
+static const void **values;
+
+// What the flush does per component, without the command sort around it
+static f64 store_per_key(ComponentStoreBackend backend) {
+    ComponentStore store = component_store_new_with_backend("Health", sizeof(Health), backend);
+    u64 start = bench_now_ns();
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        component_store_insert(&store, keys[i], values[i]);
+    }
+    f64 ms = bench_elapsed_ms(start);
+    component_store_destroy(&store);
+    return ms;
+}
+
+static f64 store_sorted(ComponentStoreBackend backend) {
+    ComponentStore store = component_store_new_with_backend("Health", sizeof(Health), backend);
+    u64 start = bench_now_ns();
+    component_store_insert_sorted(&store, keys, values, ENTITY_COUNT);
+    f64 ms = bench_elapsed_ms(start);
+    component_store_destroy(&store);
+    return ms;
+}
+
+static f64 best(f64 (*run)(ComponentStoreBackend), ComponentStoreBackend backend) {
+    f64 ms = run(backend);
+    for (u32 i = 1; i < ROUNDS; i++) {
+        f64 round = run(backend);
+        ms = round < ms ? round : ms;
+    }
+    return ms;
+}
+
+int main(void) {
+    healths = malloc(sizeof(Health) * ENTITY_COUNT);
+    keys = malloc(sizeof(entity_index) * ENTITY_COUNT);
+    values = malloc(sizeof(void *) * ENTITY_COUNT);
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        healths[i] = (Health){(i32)i};
+        keys[i] = i;
+        values[i] = &healths[i];
+    }
+
+    ComponentStoreBackend backends[] = {COMPONENT_STORE_BTREE, COMPONENT_STORE_SPARSE_SET};
+    printf("inserting %u ascending keys into an empty store, best of %d rounds\n", ENTITY_COUNT, ROUNDS);
+    for (u32 i = 0; i < 2; i++) {
+        f64 per_key_ms = best(store_per_key, backends[i]);
+        f64 sorted_ms = best(store_sorted, backends[i]);
+        printf("%-12s per key     %10.3f ms   sorted  %10.3f ms   %6.1fx\n",
+               backend_name(backends[i]),
+               per_key_ms,
+               sorted_ms,
+               per_key_ms / sorted_ms);
+    }
+
+    printf("\nflushing %u entities x 2 attaches onto new entities, sort included\n", ENTITY_COUNT);
+    for (u32 i = 0; i < 2; i++) {
+        f64 per_command_ms = best(flush_per_command, backends[i]);
+        f64 batched_ms = best(flush_batched, backends[i]);
+        printf("%-12s per command %10.3f ms   batched %10.3f ms   %6.1fx\n",
+               backend_name(backends[i]),
+               per_command_ms,
+               batched_ms,
+               per_command_ms / batched_ms);
+    }
+
+    free(healths);
+    free(keys);
+    free(values);
+    return 0;
+}
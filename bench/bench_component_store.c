@@ -0,0 +1,174 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "ecs/component_store.h"
+#include "ecs/entity.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ENTITY_COUNT 1000000
+#define CHURN_COUNT 1000000
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+static const char *backend_name(ComponentStoreBackend backend) {
+    switch (backend) {
+    case COMPONENT_STORE_BTREE:
+        return "btree";
+    case COMPONENT_STORE_SPARSE_SET:
+        return "sparse set";
+    }
+    return "?";
+}
+
+static u32 next_random(u32 *state) {
+    // xorshift32
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void print_result(ComponentStoreBackend backend, const char *name, f64 ms, u64 ops) {
+    printf("%-12s %-24s %10.3f ms %8.2f ns/op\n", backend_name(backend), name, ms, ms * 1e6 / (f64)ops);
+}
+
+static void bench_backend(ComponentStoreBackend backend, const entity_index *shuffled) {
+    ComponentStore store = component_store_new_with_backend("Position", sizeof(Position), backend);
+
+    u64 start = bench_now_ns();
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        Position p = {(f32)i, 0, 0};
+        component_store_insert(&store, i, &p);
+    }
+    print_result(backend, "insert sequential", bench_elapsed_ms(start), ENTITY_COUNT);
+
+    f32 sum = 0;
+    start = bench_now_ns();
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        const Position *p = component_store_find(&store, shuffled[i]);
+        sum += p->x;
+    }
+    print_result(backend, "lookup random", bench_elapsed_ms(start), ENTITY_COUNT);
+
+    start = bench_now_ns();
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        const Position *p = component_store_find(&store, i);
+        sum += p->x;
+    }
+    print_result(backend, "iterate by entity", bench_elapsed_ms(start), ENTITY_COUNT);
+
+    start = bench_now_ns();
+    for (u32 i = 0; i < store.component_count; i++) {
+        const Position *p = component_store_at(&store, i);
+        sum += p->x;
+    }
+    print_result(backend, "iterate dense", bench_elapsed_ms(start), ENTITY_COUNT);
+
+    // detach and reattach random entities, like a short lived status effect
+    start = bench_now_ns();
+    for (u32 i = 0; i < CHURN_COUNT; i++) {
+        entity_index key = shuffled[i % ENTITY_COUNT];
+        Position p = {(f32)key, 1, 0};
+        component_store_remove(&store, key);
+        component_store_insert(&store, key, &p);
+    }
+    print_result(backend, "churn remove+insert", bench_elapsed_ms(start), 2ull * CHURN_COUNT);
+
+    start = bench_now_ns();
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        component_store_remove(&store, shuffled[i]);
+    }
+    print_result(backend, "remove random", bench_elapsed_ms(start), ENTITY_COUNT);
+
+    // keeps the loops above from being optimized away
+    if (sum < 0) {
+        printf("%f\n", sum);
+    }
+
+    component_store_destroy(&store);
+}
+
+// B+tree orders compared by bench_orders, DEFAULT_ORDER in component_store.c
+// is the smallest one the larger orders do not beat
+static const u32 orders[] = {4, 8, 16, 32, 64, 128, 256};
+
+static void bench_orders(const entity_index *shuffled) {
+    printf("\n%-8s %14s %14s %14s %14s\n", "order", "insert ns/op", "lookup ns/op", "churn ns/op", "scan ns/op");
+
+    for (u32 o = 0; o < sizeof(orders) / sizeof(orders[0]); o++) {
+        ComponentStore store = component_store_new("Position", sizeof(Position));
+        component_store_set_order(&store, orders[o]);
+
+        u64 start = bench_now_ns();
+        for (u32 i = 0; i < ENTITY_COUNT; i++) {
+            Position p = {(f32)shuffled[i], 0, 0};
+            component_store_insert(&store, shuffled[i], &p);
+        }
+        f64 insert_ms = bench_elapsed_ms(start);
+
+        f32 sum = 0;
+        start = bench_now_ns();
+        for (u32 i = 0; i < ENTITY_COUNT; i++) {
+            const Position *p = component_store_find(&store, shuffled[i]);
+            sum += p->x;
+        }
+        f64 lookup_ms = bench_elapsed_ms(start);
+
+        start = bench_now_ns();
+        for (u32 i = 0; i < CHURN_COUNT; i++) {
+            entity_index key = shuffled[(i * 7) % ENTITY_COUNT];
+            Position p = {(f32)key, 1, 0};
+            component_store_remove(&store, key);
+            component_store_insert(&store, key, &p);
+        }
+        f64 churn_ms = bench_elapsed_ms(start);
+
+        start = bench_now_ns();
+        ComponentStoreIter iter = component_store_iter_begin(&store);
+        void *component;
+        while (component_store_iter_next(&iter, NULL, &component)) {
+            sum += ((const Position *)component)->x;
+        }
+        f64 scan_ms = bench_elapsed_ms(start);
+
+        if (sum < 0) {
+            printf("%f\n", sum);
+        }
+
+        printf("%-8u %14.2f %14.2f %14.2f %14.2f\n",
+               orders[o],
+               insert_ms * 1e6 / ENTITY_COUNT,
+               lookup_ms * 1e6 / ENTITY_COUNT,
+               churn_ms * 1e6 / (2.0 * CHURN_COUNT),
+               scan_ms * 1e6 / ENTITY_COUNT);
+
+        component_store_destroy(&store);
+    }
+}
+
+int main(void) {
+    entity_index *shuffled = malloc(sizeof(entity_index) * ENTITY_COUNT);
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        shuffled[i] = i;
+    }
+    u32 seed = 0x12345678u;
+    for (u32 i = ENTITY_COUNT - 1; i > 0; i--) {
+        u32 j = next_random(&seed) % (i + 1);
+        entity_index tmp = shuffled[i];
+        shuffled[i] = shuffled[j];
+        shuffled[j] = tmp;
+    }
+
+    printf("%u entities, %u churn iterations\n", ENTITY_COUNT, CHURN_COUNT);
+    bench_backend(COMPONENT_STORE_BTREE, shuffled);
+    bench_backend(COMPONENT_STORE_SPARSE_SET, shuffled);
+    bench_orders(shuffled);
+
+    free(shuffled);
+    return 0;
+}
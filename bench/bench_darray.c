@@ -0,0 +1,260 @@
+#include "bench.h"
+#include "containers/darray.h"
+#include "core/defines.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ELEMENT_COUNT (1u << 20)
+#define CHUNK_LENGTH 1000
+#define SPHERE_COUNT 2000
+#define SPHERE_SLICES 32
+#define SPHERE_STACKS 16
+#define ROUNDS 5
+
+// The layout of assets/vertex.h, without pulling in Vulkan
+typedef struct {
+    f32 position[3];
+    f32 normal[3];
+    f32 tex_coord[2];
+    i32 material_index;
+} Vertex;
+
+// The darray this one replaced, as it was: growing allocates a new array,
+// zeroes it, copies and frees the old one, and every push is a call that
+// memcpys `stride` bytes
+typedef struct {
+    u64 stride;
+    u64 length;
+    u64 capacity;
+} OldHeader;
+
+static void *old_new(u64 stride) {
+    OldHeader *header = malloc(sizeof(OldHeader) + stride);
+    memset(header, 0, sizeof(OldHeader) + stride);
+    *header = (OldHeader){.stride = stride, .length = 0, .capacity = 1};
+    return header + 1;
+}
+
+static void old_destroy(void *array) { free((OldHeader *)array - 1); }
+
+__attribute__((noinline)) static void *old_push(void *array, const void *value) {
+    OldHeader *header = (OldHeader *)array - 1;
+    if (header->length >= header->capacity) {
+        u64 size = sizeof(OldHeader) + 2 * header->capacity * header->stride;
+        OldHeader *grown = malloc(size);
+        memset(grown, 0, size);
+        *grown = (OldHeader){.stride = header->stride, .length = header->length, .capacity = 2 * header->capacity};
+        memcpy(grown + 1, array, header->length * header->stride);
+        free(header);
+        header = grown;
+        array = grown + 1;
+    }
+    memcpy((u8 *)array + header->length * header->stride, value, header->stride);
+    header->length++;
+    return array;
+}
+
+static u64 sink;
+
+static void report(const char *name, f64 ms, u64 elements, f64 baseline_ms) {
+    printf("%-28s %9.3f ms %8.2f ns/element %7.2fx\n", name, ms, ms * 1e6 / (f64)elements, baseline_ms / ms);
+}
+
+static f64 push_old(void) {
+    u64 start = bench_now_ns();
+    u32 *array = old_new(sizeof(u32));
+    for (u32 i = 0; i < ELEMENT_COUNT; i++) {
+        array = old_push(array, &i);
+    }
+    f64 ms = bench_elapsed_ms(start);
+    sink += array[ELEMENT_COUNT - 1];
+    old_destroy(array);
+    return ms;
+}
+
+static f64 push(void) {
+    u64 start = bench_now_ns();
+    darray(u32) array = darray_new(u32);
+    for (u32 i = 0; i < ELEMENT_COUNT; i++) {
+        darray_push(array, i);
+    }
+    f64 ms = bench_elapsed_ms(start);
+    sink += array[ELEMENT_COUNT - 1];
+    darray_destroy(array);
+    return ms;
+}
+
+static f64 push_reserved(void) {
+    u64 start = bench_now_ns();
+    darray(u32) array = darray_new(u32);
+    darray_reserve(array, ELEMENT_COUNT);
+    for (u32 i = 0; i < ELEMENT_COUNT; i++) {
+        darray_push(array, i);
+    }
+    f64 ms = bench_elapsed_ms(start);
+    sink += array[ELEMENT_COUNT - 1];
+    darray_destroy(array);
+    return ms;
+}
+
+static f64 resize_and_write(void) {
+    u64 start = bench_now_ns();
+    darray(u32) array = darray_new(u32);
+    darray_resize_uninit(array, ELEMENT_COUNT);
+    for (u32 i = 0; i < ELEMENT_COUNT; i++) {
+        array[i] = i;
+    }
+    f64 ms = bench_elapsed_ms(start);
+    sink += array[ELEMENT_COUNT - 1];
+    darray_destroy(array);
+    return ms;
+}
+
+static f64 append_chunks_old(const u32 *chunk) {
+    u64 start = bench_now_ns();
+    u32 *array = old_new(sizeof(u32));
+    for (u32 c = 0; c < ELEMENT_COUNT / CHUNK_LENGTH; c++) {
+        for (u32 i = 0; i < CHUNK_LENGTH; i++) {
+            array = old_push(array, &chunk[i]);
+        }
+    }
+    f64 ms = bench_elapsed_ms(start);
+    sink += array[0];
+    old_destroy(array);
+    return ms;
+}
+
+static f64 extend_chunks(const u32 *chunk) {
+    u64 start = bench_now_ns();
+    darray(u32) array = darray_new(u32);
+    for (u32 c = 0; c < ELEMENT_COUNT / CHUNK_LENGTH; c++) {
+        darray_extend_from(array, chunk, CHUNK_LENGTH);
+    }
+    f64 ms = bench_elapsed_ms(start);
+    sink += array[0];
+    darray_destroy(array);
+    return ms;
+}
+
+static Vertex sphere_vertex(u32 i, u32 j) {
+    const f32 pi = 3.14159265f;
+    f32 j0 = pi * (f32)j / SPHERE_STACKS;
+    f32 i0 = 2 * pi * (f32)i / SPHERE_SLICES;
+    return (Vertex){
+        .position = {-sinf(j0) * sinf(i0), cosf(j0), -sinf(j0) * cosf(i0)},
+        .normal = {-sinf(j0) * sinf(i0), cosf(j0), -sinf(j0) * cosf(i0)},
+        .tex_coord = {(f32)i / SPHERE_SLICES, (f32)j / SPHERE_STACKS},
+    };
+}
+
+// create_sphere before: a push per vertex and per index
+static f64 spheres_old(void) {
+    u64 start = bench_now_ns();
+    for (u32 s = 0; s < SPHERE_COUNT; s++) {
+        Vertex *vertices = old_new(sizeof(Vertex));
+        u32 *indices = old_new(sizeof(u32));
+        for (u32 j = 0; j <= SPHERE_STACKS; j++) {
+            for (u32 i = 0; i <= SPHERE_SLICES; i++) {
+                Vertex vertex = sphere_vertex(i, j);
+                vertices = old_push(vertices, &vertex);
+            }
+        }
+        for (u32 j = 0; j < SPHERE_STACKS; j++) {
+            for (u32 i = 0; i < SPHERE_SLICES; i++) {
+                u32 j0 = j * (SPHERE_SLICES + 1);
+                u32 j1 = (j + 1) * (SPHERE_SLICES + 1);
+                u32 quad[] = {j0 + i, j1 + i, j1 + i + 1, j0 + i, j1 + i + 1, j0 + i + 1};
+                for (u32 k = 0; k < 6; k++) {
+                    indices = old_push(indices, &quad[k]);
+                }
+            }
+        }
+        sink += indices[1] + (u64)vertices[1].tex_coord[0];
+        old_destroy(vertices);
+        old_destroy(indices);
+    }
+    return bench_elapsed_ms(start);
+}
+
+// create_sphere now: sized once and written in place
+static f64 spheres(void) {
+    u64 start = bench_now_ns();
+    for (u32 s = 0; s < SPHERE_COUNT; s++) {
+        darray(Vertex) vertices = darray_new(Vertex);
+        darray(u32) indices = darray_new(u32);
+        darray_resize_uninit(vertices, (SPHERE_STACKS + 1) * (SPHERE_SLICES + 1));
+        darray_resize_uninit(indices, SPHERE_STACKS * SPHERE_SLICES * 6);
+        Vertex *vertex = vertices;
+        u32 *index = indices;
+        for (u32 j = 0; j <= SPHERE_STACKS; j++) {
+            for (u32 i = 0; i <= SPHERE_SLICES; i++) {
+                *vertex++ = sphere_vertex(i, j);
+            }
+        }
+        for (u32 j = 0; j < SPHERE_STACKS; j++) {
+            for (u32 i = 0; i < SPHERE_SLICES; i++) {
+                u32 j0 = j * (SPHERE_SLICES + 1);
+                u32 j1 = (j + 1) * (SPHERE_SLICES + 1);
+                *index++ = j0 + i;
+                *index++ = j1 + i;
+                *index++ = j1 + i + 1;
+                *index++ = j0 + i;
+                *index++ = j1 + i + 1;
+                *index++ = j0 + i + 1;
+            }
+        }
+        sink += indices[1] + (u64)vertices[1].tex_coord[0];
+        darray_destroy(vertices);
+        darray_destroy(indices);
+    }
+    return bench_elapsed_ms(start);
+}
+
+// Best of ROUNDS, the first round also pays for faulting the pages in
+static f64 best(f64 (*run)(void)) {
+    f64 ms = run();
+    for (u32 i = 1; i < ROUNDS; i++) {
+        f64 round = run();
+        ms = round < ms ? round : ms;
+    }
+    return ms;
+}
+
+static f64 best_with(f64 (*run)(const u32 *), const u32 *chunk) {
+    f64 ms = run(chunk);
+    for (u32 i = 1; i < ROUNDS; i++) {
+        f64 round = run(chunk);
+        ms = round < ms ? round : ms;
+    }
+    return ms;
+}
+
+int main(void) {
+    printf("%u u32 elements, best of %d rounds, speedup over the old darray\n", ELEMENT_COUNT, ROUNDS);
+    f64 old_ms = best(push_old);
+    report("old push", old_ms, ELEMENT_COUNT, old_ms);
+    report("push", best(push), ELEMENT_COUNT, old_ms);
+    report("reserve + push", best(push_reserved), ELEMENT_COUNT, old_ms);
+    report("resize_uninit + write", best(resize_and_write), ELEMENT_COUNT, old_ms);
+
+    u32 chunk[CHUNK_LENGTH];
+    for (u32 i = 0; i < CHUNK_LENGTH; i++) {
+        chunk[i] = i;
+    }
+    printf("\n%u chunks of %d u32\n", ELEMENT_COUNT / CHUNK_LENGTH, CHUNK_LENGTH);
+    old_ms = best_with(append_chunks_old, chunk);
+    u64 appended = (u64)(ELEMENT_COUNT / CHUNK_LENGTH) * CHUNK_LENGTH;
+    report("old push per element", old_ms, appended, old_ms);
+    report("extend_from", best_with(extend_chunks, chunk), appended, old_ms);
+
+    u32 sphere_elements = (SPHERE_STACKS + 1) * (SPHERE_SLICES + 1) + SPHERE_STACKS * SPHERE_SLICES * 6;
+    printf("\n%d spheres as create_sphere builds them, %u vertices and indices each\n", SPHERE_COUNT, sphere_elements);
+    old_ms = best(spheres_old);
+    report("old push per element", old_ms, (u64)SPHERE_COUNT * sphere_elements, old_ms);
+    report("resize_uninit + write", best(spheres), (u64)SPHERE_COUNT * sphere_elements, old_ms);
+
+    return sink == 0;
+}
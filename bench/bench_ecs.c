@@ -0,0 +1,376 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "ecs/entity.h"
+#include "ecs/query.h"
+#include "ecs/system.h"
+#include "ecs/world.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every case runs its rounds until this much time went by, so small worlds
+// are measured over many rounds and large ones over at least one
+#define MIN_CASE_MS 100.0
+#define FRAME_SYSTEM_COUNT 8
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+typedef struct {
+    f32 x, y, z;
+} Velocity;
+
+typedef struct {
+    i32 health;
+} Health;
+
+typedef struct {
+    f32 value;
+} Mass;
+
+typedef enum {
+    FORMAT_CSV,
+    FORMAT_JSON,
+} Format;
+
+typedef struct {
+    Format format;
+    u32 result_count;
+} Output;
+
+typedef struct {
+    World world;
+    u32 entity_count;
+    // live entities, churn swaps destroyed ones for new ones in place
+    entity_id *entities;
+    // random indices into `entities`
+    u32 *order;
+} Fixture;
+
+static const u32 entity_counts[] = {1000, 100000, 1000000};
+
+static u32 random_state = 0x2545F491;
+static f32 sink;
+static u64 visited;
+
+static u32 random_next(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static const char *storage_name(WorldStorage storage) {
+    return storage == WORLD_STORAGE_ARCHETYPE ? "archetype" : "component_store";
+}
+
+#if defined(SE_LINUX)
+// Resets the high-water mark VmHWM reports, so each world size gets its own
+static void peak_rss_reset(void) {
+    FILE *file = fopen("/proc/self/clear_refs", "w");
+    if (file != NULL) {
+        fputs("5", file);
+        fclose(file);
+    }
+}
+
+static u64 peak_rss_kb(void) {
+    FILE *file = fopen("/proc/self/status", "r");
+    if (file == NULL) {
+        return 0;
+    }
+
+    char line[256];
+    u64 kb = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (strncmp(line, "VmHWM:", 6) == 0) {
+            kb = strtoull(line + 6, NULL, 10);
+            break;
+        }
+    }
+    fclose(file);
+    return kb;
+}
+#else
+static void peak_rss_reset(void) {}
+
+static u64 peak_rss_kb(void) { return 0; }
+#endif
+
+static void report(Output *output,
+                   WorldStorage storage,
+                   const char *name,
+                   u32 entity_count,
+                   u64 ops,
+                   f64 ms,
+                   u64 rss_kb) {
+    f64 ns_per_op = ms * 1e6 / (f64)ops;
+    f64 ops_per_second = (f64)ops / (ms / 1e3);
+    if (output->format == FORMAT_CSV) {
+        printf("%s,%s,%u,%llu,%.3f,%.0f,%llu\n",
+               storage_name(storage),
+               name,
+               entity_count,
+               (unsigned long long)ops,
+               ns_per_op,
+               ops_per_second,
+               (unsigned long long)rss_kb);
+    } else {
+        printf("%s\n    {\"storage\": \"%s\", \"case\": \"%s\", \"entities\": %u, \"ops\": %llu, \"ns_per_op\": %.3f, "
+               "\"ops_per_second\": %.0f, \"peak_rss_kb\": %llu}",
+               output->result_count == 0 ? "" : ",",
+               storage_name(storage),
+               name,
+               entity_count,
+               (unsigned long long)ops,
+               ns_per_op,
+               ops_per_second,
+               (unsigned long long)rss_kb);
+    }
+    output->result_count++;
+}
+
+static void spawn(Fixture *fixture, u32 i) {
+    entity_id e = world_create_entity(&fixture->world);
+    world_attach_component(&fixture->world, e, Position, ((Position){(f32)i, 0.0f, 0.0f}));
+    world_attach_component(&fixture->world, e, Velocity, ((Velocity){1.0f, 0.0f, 0.0f}));
+    if (i % 2 == 0) {
+        world_attach_component(&fixture->world, e, Mass, ((Mass){1.0f}));
+    }
+    fixture->entities[i] = e;
+}
+
+static void fixture_init(Fixture *fixture, WorldStorage storage, u32 entity_count) {
+    fixture->world = world_new_with_storage(storage);
+    world_register_component(&fixture->world, Position);
+    world_register_component(&fixture->world, Velocity);
+    world_register_component(&fixture->world, Health);
+    world_register_component(&fixture->world, Mass);
+
+    fixture->entity_count = entity_count;
+    fixture->entities = malloc(sizeof(entity_id) * entity_count);
+    fixture->order = malloc(sizeof(u32) * entity_count);
+    for (u32 i = 0; i < entity_count; i++) {
+        spawn(fixture, i);
+        fixture->order[i] = random_next() % entity_count;
+    }
+}
+
+static void fixture_destroy(Fixture *fixture) {
+    world_destroy(&fixture->world);
+    free(fixture->entities);
+    free(fixture->order);
+}
+
+// Destroys a random entity and spawns one in its place
+static void round_churn(Fixture *fixture) {
+    for (u32 i = 0; i < fixture->entity_count; i++) {
+        u32 index = fixture->order[i];
+        world_destroy_entity(&fixture->world, fixture->entities[index]);
+        spawn(fixture, index);
+    }
+}
+
+static void round_attach_detach(Fixture *fixture) {
+    for (u32 i = 0; i < fixture->entity_count; i++) {
+        world_attach_component(&fixture->world, fixture->entities[i], Health, ((Health){(i32)i}));
+    }
+    for (u32 i = 0; i < fixture->entity_count; i++) {
+        world_detach_component(&fixture->world, fixture->entities[i], Health);
+    }
+}
+
+static void round_get_random(Fixture *fixture) {
+    f32 sum = 0.0f;
+    for (u32 i = 0; i < fixture->entity_count; i++) {
+        const Position *p = world_get_component(&fixture->world, fixture->entities[fixture->order[i]], Position);
+        sum += p->x;
+    }
+    sink += sum;
+}
+
+static void round_run(Fixture *fixture) { world_run(&fixture->world); }
+
+/**
+ * Runs rounds until MIN_CASE_MS went by.
+ * @return the total time, `rounds` is set to how many ran
+ */
+static f64 measure(Fixture *fixture, void (*round)(Fixture *), u32 *rounds) {
+    f64 ms = 0.0;
+    *rounds = 0;
+    while (ms < MIN_CASE_MS) {
+        u64 start = bench_now_ns();
+        round(fixture);
+        ms += bench_elapsed_ms(start);
+        (*rounds)++;
+    }
+    return ms;
+}
+
+static void read_one(void **components) {
+    const Position *p = components[0];
+    sink += p->x;
+    visited++;
+}
+
+static void read_two(void **components) {
+    const Position *p = components[0];
+    const Velocity *v = components[1];
+    sink += p->x + v->x;
+    visited++;
+}
+
+static void read_three(void **components) {
+    const Position *p = components[0];
+    const Velocity *v = components[1];
+    const Mass *m = components[2];
+    sink += (p->x + v->x) * m->value;
+    visited++;
+}
+
+static void integrate(void **components) {
+    Position *p = components[0];
+    const Velocity *v = components[1];
+    p->x += v->x * 0.016f;
+    p->y += v->y * 0.016f;
+    p->z += v->z * 0.016f;
+    visited++;
+}
+
+static void damp(void **components) {
+    Velocity *v = components[0];
+    const Mass *m = components[1];
+    v->x *= 1.0f - 0.01f / m->value;
+    visited++;
+}
+
+static void add_system(World *world, Query query, system_run fn) {
+    world_add_system(world,
+                     (SystemInfo){
+                         .query = query,
+                         .fn = fn,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+}
+
+// Runs world_run over a fresh world with one system, ops are entity visits
+static void bench_query(Output *output,
+                        WorldStorage storage,
+                        u32 entity_count,
+                        const char *name,
+                        Query query,
+                        system_run fn) {
+    Fixture fixture;
+    fixture_init(&fixture, storage, entity_count);
+    add_system(&fixture.world, query, fn);
+    round_run(&fixture);
+
+    visited = 0;
+    u32 rounds;
+    f64 ms = measure(&fixture, round_run, &rounds);
+    report(output, storage, name, entity_count, visited, ms, peak_rss_kb());
+    fixture_destroy(&fixture);
+}
+
+// A frame of a small game: several systems over overlapping component sets,
+// ops are frames
+static void bench_frame(Output *output, WorldStorage storage, u32 entity_count) {
+    Fixture fixture;
+    fixture_init(&fixture, storage, entity_count);
+    for (u32 i = 0; i < FRAME_SYSTEM_COUNT; i++) {
+        switch (i % 4) {
+        case 0:
+            add_system(&fixture.world, query_new(Write(Position), Read(Velocity)), integrate);
+            break;
+        case 1:
+            add_system(&fixture.world, query_new(Write(Velocity), Read(Mass)), damp);
+            break;
+        case 2:
+            add_system(&fixture.world, query_new(Read(Position)), read_one);
+            break;
+        default:
+            add_system(&fixture.world, query_new(Read(Position), Read(Velocity), Read(Mass)), read_three);
+            break;
+        }
+    }
+    round_run(&fixture);
+
+    u32 rounds;
+    f64 ms = measure(&fixture, round_run, &rounds);
+    report(output, storage, "frame_8_systems", entity_count, rounds, ms, peak_rss_kb());
+    fixture_destroy(&fixture);
+}
+
+static void bench_size(Output *output, WorldStorage storage, u32 entity_count) {
+    peak_rss_reset();
+
+    Fixture fixture;
+    u32 rounds;
+    fixture_init(&fixture, storage, entity_count);
+    f64 ms = measure(&fixture, round_churn, &rounds);
+    report(output, storage, "create_destroy", entity_count, (u64)rounds * entity_count, ms, peak_rss_kb());
+
+    ms = measure(&fixture, round_attach_detach, &rounds);
+    report(output, storage, "attach_detach", entity_count, (u64)rounds * entity_count * 2, ms, peak_rss_kb());
+
+    ms = measure(&fixture, round_get_random, &rounds);
+    report(output, storage, "get_random", entity_count, (u64)rounds * entity_count, ms, peak_rss_kb());
+    fixture_destroy(&fixture);
+
+    bench_query(output, storage, entity_count, "iterate_1", query_new(Read(Position)), read_one);
+    bench_query(output, storage, entity_count, "iterate_2", query_new(Read(Position), Read(Velocity)), read_two);
+    bench_query(output,
+                storage,
+                entity_count,
+                "iterate_3",
+                query_new(Read(Position), Read(Velocity), Read(Mass)),
+                read_three);
+    bench_frame(output, storage, entity_count);
+}
+
+/**
+ * Usage: bench_ecs [--json] [--max-entities N]
+ *
+ * Prints one result per storage, case and world size, as CSV by default.
+ * peak_rss_kb is the process's peak resident set since the world size
+ * started, 0 where it cannot be read.
+ */
+int main(int argc, char **argv) {
+    Output output = {.format = FORMAT_CSV};
+    u32 max_entities = entity_counts[sizeof(entity_counts) / sizeof(entity_counts[0]) - 1];
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            output.format = FORMAT_JSON;
+        } else if (strcmp(argv[i], "--max-entities") == 0 && i + 1 < argc) {
+            max_entities = (u32)strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--json] [--max-entities N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (output.format == FORMAT_CSV) {
+        printf("storage,case,entities,ops,ns_per_op,ops_per_second,peak_rss_kb\n");
+    } else {
+        printf("{\"results\": [");
+    }
+
+    const WorldStorage storages[] = {WORLD_STORAGE_COMPONENT_STORE, WORLD_STORAGE_ARCHETYPE};
+    for (u32 s = 0; s < sizeof(storages) / sizeof(storages[0]); s++) {
+        for (u32 i = 0; i < sizeof(entity_counts) / sizeof(entity_counts[0]); i++) {
+            if (entity_counts[i] <= max_entities) {
+                bench_size(&output, storages[s], entity_counts[i]);
+                fflush(stdout);
+            }
+        }
+    }
+
+    if (output.format == FORMAT_JSON) {
+        printf("\n]}\n");
+    }
+    // keeps the reads from being optimized away
+    fprintf(stderr, "checksum %f\n", (f64)sink);
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "ecs/entity.h"
+#include "ecs/world.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHURN_COUNT 1000000
+
+static void bench_churn_pairs(void) {
+    World world = world_new();
+
+    u64 start = bench_now_ns();
+    for (u32 i = 0; i < CHURN_COUNT; i++) {
+        entity_id e = world_create_entity(&world);
+        world_destroy_entity(&world, e);
+    }
+    f64 ms = bench_elapsed_ms(start);
+
+    printf("%-32s %10.3f ms %8.2f ns/pair\n", "create/destroy pairs", ms, ms * 1e6 / CHURN_COUNT);
+    world_destroy(&world);
+}
+
+static void bench_churn_bulk(void) {
+    World world = world_new();
+    entity_id *entities = malloc(sizeof(entity_id) * CHURN_COUNT);
+
+    u64 start = bench_now_ns();
+    for (u32 i = 0; i < CHURN_COUNT; i++) {
+        entities[i] = world_create_entity(&world);
+    }
+    for (u32 i = 0; i < CHURN_COUNT; i++) {
+        world_destroy_entity(&world, entities[i]);
+    }
+    for (u32 i = 0; i < CHURN_COUNT; i++) {
+        entities[i] = world_create_entity(&world);
+    }
+    f64 ms = bench_elapsed_ms(start);
+
+    u32 stale = 0;
+    for (u32 i = 0; i < CHURN_COUNT; i++) {
+        stale += !world_is_valid_entity(&world, entity_make(entity_get_index(entities[i]), 0));
+    }
+
+    printf("%-32s %10.3f ms %8.2f ns/op (%u stale handles rejected)\n",
+           "create all, destroy all, reuse",
+           ms,
+           ms * 1e6 / (3.0 * CHURN_COUNT),
+           stale);
+
+    free(entities);
+    world_destroy(&world);
+}
+
+int main(void) {
+    printf("%u entities\n", CHURN_COUNT);
+    bench_churn_pairs();
+    bench_churn_bulk();
+    return 0;
+}
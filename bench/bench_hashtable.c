@@ -0,0 +1,125 @@
+#include "bench.h"
+#include "containers/hashtable.h"
+#include "core/defines.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CAPACITY (1u << 20)
+
+// The table HashTable replaced, as it was: the slot is the key modulo the
+// slot count and colliding keys overwrite each other
+typedef struct {
+    u64 element_size;
+    u32 element_count;
+    void *memory;
+} OldTable;
+
+static void old_set(OldTable *table, const u64 *key, const void *value) {
+    u64 hash = *key % table->element_count;
+    memcpy((u8 *)table->memory + table->element_size * hash, value, table->element_size);
+}
+
+static void old_get(const OldTable *table, const u64 *key, void *out_value) {
+    u64 hash = *key % table->element_count;
+    memcpy(out_value, (u8 *)table->memory + table->element_size * hash, table->element_size);
+}
+
+static u64 random_state = 0x9E3779B97F4A7C15ull;
+
+static u64 random_next(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+static u64 sink;
+
+static void bench_load(f64 load, const u64 *keys, const u64 *missing) {
+    u32 count = (u32)(load * CAPACITY);
+
+    HashTable table = hashtable_new(sizeof(u64), sizeof(u64));
+    hashtable_reserve(&table, count);
+    u64 start = bench_now_ns();
+    for (u32 i = 0; i < count; i++) {
+        hashtable_insert(&table, &keys[i], &keys[i]);
+    }
+    f64 insert_ms = bench_elapsed_ms(start);
+
+    // hits in a different order than inserted
+    start = bench_now_ns();
+    for (u32 i = 0; i < count; i++) {
+        const u64 *value = hashtable_get(&table, &keys[(u64)i * 7919 % count]);
+        sink += *value;
+    }
+    f64 hit_ms = bench_elapsed_ms(start);
+
+    start = bench_now_ns();
+    for (u32 i = 0; i < count; i++) {
+        sink += hashtable_get(&table, &missing[i]) != NULL;
+    }
+    f64 miss_ms = bench_elapsed_ms(start);
+
+    // removes and inserts at a steady load, leaving tombstones behind
+    start = bench_now_ns();
+    for (u32 i = 0; i < count; i++) {
+        hashtable_remove(&table, &keys[i]);
+        hashtable_insert(&table, &missing[i], &missing[i]);
+    }
+    f64 churn_ms = bench_elapsed_ms(start);
+    u32 capacity = table.capacity;
+    hashtable_destroy(&table);
+
+    OldTable old = {.element_size = sizeof(u64), .element_count = CAPACITY, .memory = calloc(CAPACITY, sizeof(u64))};
+    start = bench_now_ns();
+    for (u32 i = 0; i < count; i++) {
+        old_set(&old, &keys[i], &keys[i]);
+    }
+    f64 old_insert_ms = bench_elapsed_ms(start);
+
+    u32 lost = 0;
+    start = bench_now_ns();
+    for (u32 i = 0; i < count; i++) {
+        u64 value;
+        old_get(&old, &keys[(u64)i * 7919 % count], &value);
+        lost += value != keys[(u64)i * 7919 % count];
+    }
+    f64 old_hit_ms = bench_elapsed_ms(start);
+    free(old.memory);
+
+    f64 to_ns = 1e6 / count;
+    printf("%5.3f  %8.2f %8.2f %8.2f %8.2f %9u   %8.2f %8.2f %9.1f%%\n",
+           load,
+           insert_ms * to_ns,
+           hit_ms * to_ns,
+           miss_ms * to_ns,
+           churn_ms * to_ns,
+           capacity,
+           old_insert_ms * to_ns,
+           old_hit_ms * to_ns,
+           100.0 * lost / count);
+}
+
+int main(void) {
+    u64 *keys = malloc(sizeof(u64) * CAPACITY);
+    u64 *missing = malloc(sizeof(u64) * CAPACITY);
+    for (u32 i = 0; i < CAPACITY; i++) {
+        keys[i] = random_next();
+        missing[i] = random_next();
+    }
+
+    // 7/8 is the most HashTable fills before growing, the old table is
+    // shown at the same loads
+    printf("u64 keys and values, %u slots, ns per operation\n", CAPACITY);
+    printf("load     insert      hit     miss    churn  capacity     old set  old get  old lost\n");
+    const f64 loads[] = {0.5, 0.6, 0.7, 0.8, 0.875};
+    for (u32 i = 0; i < sizeof(loads) / sizeof(loads[0]); i++) {
+        bench_load(loads[i], keys, missing);
+    }
+
+    free(keys);
+    free(missing);
+    return sink == 0;
+}
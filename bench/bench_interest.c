@@ -0,0 +1,157 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "ecs/component_id.h"
+#include "ecs/entity.h"
+#include "ecs/transform.h"
+#include "ecs/world.h"
+#include "net/replication.h"
+
+#include <stdio.h>
+
+#define ENTITY_COUNT 50000
+#define CLIENT_COUNT 64
+#define TICK_COUNT 20
+#define WORLD_SIZE 1000.0f
+#define RELEVANCE_RADIUS 100.0f
+#define CELL_SIZE 50.0f
+// every update per client, the first full state of the everything case
+// takes several updates
+#define BYTES_PER_UPDATE (256 * 1024)
+
+static u32 random_state = 0x9E3779B9;
+
+static f32 random_unit(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return (f32)(random_state >> 8) / (f32)(1u << 24);
+}
+
+static void make_world(World *world) {
+    *world = world_new();
+    transform_enable(world);
+    world_set_component_flags(world, component_id(LocalTransform), COMPONENT_FLAG_REPLICATED);
+}
+
+// Moves a tenth of the entities a small random step on the xz plane
+static void tick(World *world, EntityRange range, u32 t) {
+    for (u32 i = t % 10; i < range.count; i += 10) {
+        entity_id e = entity_range_get(range, i);
+        LocalTransform *transform = world_get_component(world, e, LocalTransform);
+        transform->translation.x += random_unit() * 2.0f - 1.0f;
+        transform->translation.z += random_unit() * 2.0f - 1.0f;
+        world_mark_changed(world, e, LocalTransform);
+    }
+    world_run(world);
+}
+
+static b8 caught_up(ReplicationServer *server, ReplicationClient **clients) {
+    u32 target = replication_server_sequence(server);
+    for (u32 c = 0; c < CLIENT_COUNT; c++) {
+        if (replication_client_sequence(clients[c]) < target) {
+            return false;
+        }
+    }
+    return replication_server_stats(server).deferred_entities == 0;
+}
+
+static void bench_radius(f32 radius, const char *name) {
+    World server_world;
+    make_world(&server_world);
+    ComponentId ids[] = {component_id(LocalTransform), component_id(GlobalTransform)};
+    EntityRange range = world_spawn_batch(&server_world, ENTITY_COUNT, 2, ids, NULL);
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        LocalTransform *transform = world_get_component(&server_world, entity_range_get(range, i), LocalTransform);
+        *transform = local_transform_identity();
+        transform->translation = (vec3s){{random_unit() * WORLD_SIZE, 0.0f, random_unit() * WORLD_SIZE}};
+    }
+    world_run(&server_world);
+
+    ReplicationServer *server = replication_server_new(&server_world,
+                                                       (ReplicationServerConfig){
+                                                           .bytes_per_update = BYTES_PER_UPDATE,
+                                                           .relevance_radius = radius,
+                                                           .cell_size = CELL_SIZE,
+                                                       });
+    if (server == NULL) {
+        printf("could not open sockets\n");
+        return;
+    }
+
+    static World client_worlds[CLIENT_COUNT];
+    ReplicationClient *clients[CLIENT_COUNT];
+    for (u32 c = 0; c < CLIENT_COUNT; c++) {
+        make_world(&client_worlds[c]);
+        clients[c] = replication_client_new(&client_worlds[c], net_address_loopback(replication_server_port(server)));
+        if (clients[c] == NULL) {
+            printf("could not open sockets\n");
+            return;
+        }
+        replication_client_update(clients[c]);
+    }
+
+    // clients are spread over an 8 by 8 grid of foci
+    replication_server_update(server);
+    for (u32 c = 0; c < CLIENT_COUNT; c++) {
+        f32 spacing = WORLD_SIZE / 8.0f;
+        vec3s focus = {{((f32)(c % 8) + 0.5f) * spacing, 0.0f, ((f32)(c / 8) + 0.5f) * spacing}};
+        replication_server_set_focus(server, net_address_loopback(replication_client_port(clients[c])), focus);
+    }
+
+    // until every client holds its relevant set
+    do {
+        replication_server_update(server);
+        for (u32 c = 0; c < CLIENT_COUNT; c++) {
+            replication_client_update(clients[c]);
+        }
+    } while (!caught_up(server, clients));
+
+    ReplicationServerStats before = replication_server_stats(server);
+    u32 deferred = 0;
+    f64 server_ms = 0;
+    f64 client_ms = 0;
+    for (u32 t = 0; t < TICK_COUNT; t++) {
+        tick(&server_world, range, t);
+
+        u64 start = bench_now_ns();
+        replication_server_update(server);
+        server_ms += bench_elapsed_ms(start);
+        deferred += replication_server_stats(server).deferred_entities;
+
+        start = bench_now_ns();
+        for (u32 c = 0; c < CLIENT_COUNT; c++) {
+            replication_client_update(clients[c]);
+        }
+        client_ms += bench_elapsed_ms(start);
+    }
+    ReplicationServerStats after = replication_server_stats(server);
+
+    f64 bytes = (f64)(after.bytes_sent - before.bytes_sent) / TICK_COUNT;
+    printf("%-12s %10.0f bytes/tick %8.0f bytes/tick/client %7.1f packets/tick   server %8.3f ms/tick   "
+           "clients %8.3f ms/tick   %6.1f deferred/tick\n",
+           name,
+           bytes,
+           bytes / CLIENT_COUNT,
+           (f64)(after.packets_sent - before.packets_sent) / TICK_COUNT,
+           server_ms / TICK_COUNT,
+           client_ms / TICK_COUNT,
+           (f64)deferred / TICK_COUNT);
+
+    for (u32 c = 0; c < CLIENT_COUNT; c++) {
+        replication_client_destroy(clients[c]);
+        world_destroy(&client_worlds[c]);
+    }
+    replication_server_destroy(server);
+    world_destroy(&server_world);
+}
+
+int main(void) {
+    printf("%u entities over %.0f by %.0f, 10%% moving, %u clients over loopback\n",
+           ENTITY_COUNT,
+           WORLD_SIZE,
+           WORLD_SIZE,
+           CLIENT_COUNT);
+    bench_radius(RELEVANCE_RADIUS, "radius 100");
+    bench_radius(0.0f, "everything");
+    return 0;
+}
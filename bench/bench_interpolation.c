@@ -0,0 +1,60 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "ecs/component_id.h"
+#include "ecs/entity.h"
+#include "ecs/interpolation.h"
+#include "ecs/transform.h"
+#include "ecs/world.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define ENTITY_COUNT 100000
+#define REPEAT_COUNT 50
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+static void bench_storage(WorldStorage storage, const char *name) {
+    World world = world_new_with_storage(storage);
+    world_set_component_flags(&world, world_register_component(&world, Position), COMPONENT_FLAG_INTERPOLATE);
+    world_set_component_flags(&world, world_register_component(&world, LocalTransform), COMPONENT_FLAG_INTERPOLATE);
+    interpolation_enable(&world, 0.1);
+    interpolation_add_quaternion(&world, component_id(LocalTransform), offsetof(LocalTransform, rotation));
+
+    ComponentId ids[] = {component_id(Position), component_id(LocalTransform)};
+    EntityRange range = world_spawn_batch(&world, ENTITY_COUNT, 2, ids, NULL);
+    for (u32 sample = 0; sample < 2; sample++) {
+        for (u32 i = 0; i < ENTITY_COUNT; i++) {
+            entity_id e = entity_range_get(range, i);
+            *world_get_component(&world, e, Position) = (Position){(f32)i, (f32)sample, 0.0f};
+            LocalTransform *transform = world_get_component(&world, e, LocalTransform);
+            *transform = local_transform_identity();
+            transform->rotation = quatv((f32)(i % 360) * 0.01f + (f32)sample * 0.5f, (vec3s){{0.0f, 1.0f, 0.0f}});
+        }
+        interpolation_push(&world, sample);
+    }
+
+    f64 total_ms = 0;
+    for (u32 r = 0; r < REPEAT_COUNT; r++) {
+        interpolation_set_time(&world, 0.1 + (f64)r / REPEAT_COUNT);
+        u64 start = bench_now_ns();
+        interpolation_apply(&world);
+        total_ms += bench_elapsed_ms(start);
+    }
+
+    printf("%-16s %8.3f ms per apply, %6.2f ns per entity\n",
+           name,
+           total_ms / REPEAT_COUNT,
+           total_ms * 1e6 / REPEAT_COUNT / ENTITY_COUNT);
+    world_destroy(&world);
+}
+
+int main(void) {
+    printf("%u entities with an interpolated Position (lerp) and LocalTransform (lerp and slerp)\n", ENTITY_COUNT);
+    bench_storage(WORLD_STORAGE_COMPONENT_STORE, "component store");
+    bench_storage(WORLD_STORAGE_ARCHETYPE, "archetype");
+    return 0;
+}
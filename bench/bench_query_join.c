@@ -0,0 +1,135 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "ecs/component_store.h"
+#include "ecs/entity.h"
+#include "ecs/query.h"
+#include "ecs/system.h"
+#include "ecs/world.h"
+
+#include <stdio.h>
+
+#define COMMON_COUNT 1000000
+// one in RARE_STRIDE entities also has the rare component, 1000:1
+#define RARE_STRIDE 1000
+#define REPEAT_COUNT 10
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+typedef struct {
+    u32 target;
+} Homing;
+
+static f32 sum;
+static u32 visited;
+
+static void read_pair(void **components) {
+    const Position *p = components[0];
+    const Homing *h = components[1];
+    sum += p->x + (f32)h->target;
+    visited++;
+}
+
+static void read_position(void **components) {
+    const Position *p = components[0];
+    sum += p->x;
+    visited++;
+}
+
+static const char *storage_name(WorldStorage storage) {
+    return storage == WORLD_STORAGE_ARCHETYPE ? "archetype" : "component store";
+}
+
+static World make_world(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+    world_register_component(&world, Homing);
+
+    ComponentId ids[] = {component_id(Position)};
+    EntityRange range = world_spawn_batch(&world, COMMON_COUNT, 1, ids, NULL);
+    for (u32 i = 0; i < COMMON_COUNT; i += RARE_STRIDE) {
+        world_attach_component(&world, entity_range_get(range, i), Homing, ((Homing){i}));
+    }
+    return world;
+}
+
+static f64 time_runs(World *world) {
+    u64 start = bench_now_ns();
+    for (u32 r = 0; r < REPEAT_COUNT; r++) {
+        world_run(world);
+    }
+    return bench_elapsed_ms(start) / REPEAT_COUNT;
+}
+
+// How the join ran before: walk the first named store, probe the second
+static f64 time_first_term_walk(const World *world) {
+    const ComponentStore *positions = &world->component_stores[component_id(Position)];
+    const ComponentStore *homings = &world->component_stores[component_id(Homing)];
+
+    u64 start = bench_now_ns();
+    for (u32 r = 0; r < REPEAT_COUNT; r++) {
+        for (u32 i = 0; i < positions->component_count; i++) {
+            u32 index = component_store_index_of(homings, positions->entities[i]);
+            if (index == COMPONENT_STORE_INVALID_INDEX) {
+                continue;
+            }
+            void *components[] = {component_store_at(positions, i), component_store_at(homings, index)};
+            read_pair(components);
+        }
+    }
+    return bench_elapsed_ms(start) / REPEAT_COUNT;
+}
+
+static void bench_storage(WorldStorage storage) {
+    World world = make_world(storage);
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Read(Position), Read(Homing)),
+                         .fn = read_pair,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+
+    visited = 0;
+    f64 join_ms = time_runs(&world);
+    u32 join_visited = visited / REPEAT_COUNT;
+
+    if (storage == WORLD_STORAGE_COMPONENT_STORE) {
+        f64 first_term_ms = time_first_term_walk(&world);
+        printf("%-16s %-34s %10.3f ms\n", storage_name(storage), "walk Position, probe Homing", first_term_ms);
+    }
+    printf("%-16s %-34s %10.3f ms   %u matches\n",
+           storage_name(storage),
+           "Read(Position), Read(Homing)",
+           join_ms,
+           join_visited);
+    world_destroy(&world);
+
+    world = make_world(storage);
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Read(Position), Without(Homing)),
+                         .fn = read_position,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+
+    visited = 0;
+    f64 without_ms = time_runs(&world);
+    printf("%-16s %-34s %10.3f ms   %u matches\n",
+           storage_name(storage),
+           "Read(Position), Without(Homing)",
+           without_ms,
+           visited / REPEAT_COUNT);
+    world_destroy(&world);
+}
+
+int main(void) {
+    printf("%u entities with Position, 1 in %u with Homing\n", COMMON_COUNT, RARE_STRIDE);
+    bench_storage(WORLD_STORAGE_COMPONENT_STORE);
+    bench_storage(WORLD_STORAGE_ARCHETYPE);
+
+    if (sum < 0) {
+        printf("%f\n", sum);
+    }
+    return 0;
+}
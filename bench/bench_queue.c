@@ -0,0 +1,262 @@
+#include "bench.h"
+#include "containers/mpmc_queue.h"
+#include "containers/spsc_ring.h"
+#include "core/defines.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ITEM_COUNT (1u << 21)
+#define QUEUE_CAPACITY 1024
+#define MESSAGE_COUNT (1u << 20)
+#define MAX_MESSAGE_SIZE 64
+#define ROUNDS 3
+
+// What a job system would reach for without the lock-free queue: a ring
+// behind a mutex
+typedef struct {
+    pthread_mutex_t mutex;
+    u64 *items;
+    u64 mask;
+    u64 head;
+    u64 tail;
+} MutexQueue;
+
+static MutexQueue mutex_queue_new(u64 capacity) {
+    MutexQueue queue = {.items = malloc(capacity * sizeof(u64)), .mask = capacity - 1};
+    pthread_mutex_init(&queue.mutex, NULL);
+    return queue;
+}
+
+static void mutex_queue_destroy(MutexQueue *queue) {
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue->items);
+}
+
+static b8 mutex_queue_try_push(MutexQueue *queue, const u64 *item) {
+    pthread_mutex_lock(&queue->mutex);
+    b8 pushed = queue->head - queue->tail <= queue->mask;
+    if (pushed) {
+        queue->items[queue->head++ & queue->mask] = *item;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return pushed;
+}
+
+static b8 mutex_queue_try_pop(MutexQueue *queue, u64 *out_item) {
+    pthread_mutex_lock(&queue->mutex);
+    b8 popped = queue->tail != queue->head;
+    if (popped) {
+        *out_item = queue->items[queue->tail++ & queue->mask];
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return popped;
+}
+
+typedef struct {
+    b8 (*try_push)(void *queue, const u64 *item);
+    b8 (*try_pop)(void *queue, u64 *out_item);
+    void *queue;
+    u32 producers;
+    u32 consumers;
+} Run;
+
+typedef struct {
+    const Run *run;
+    u32 index;
+    atomic u64 *consumed;
+    u64 sum;
+} Worker;
+
+static b8 mpmc_push(void *queue, const u64 *item) { return mpmc_queue_try_push(queue, item); }
+
+static b8 mpmc_pop(void *queue, u64 *out_item) { return mpmc_queue_try_pop(queue, out_item); }
+
+static b8 mutex_push(void *queue, const u64 *item) { return mutex_queue_try_push(queue, item); }
+
+static b8 mutex_pop(void *queue, u64 *out_item) { return mutex_queue_try_pop(queue, out_item); }
+
+static void *produce(void *data) {
+    Worker *worker = data;
+    const Run *run = worker->run;
+    // the first producers take the remainder
+    u64 count = ITEM_COUNT / run->producers + (worker->index < ITEM_COUNT % run->producers);
+    for (u64 i = 0; i < count; i++) {
+        while (!run->try_push(run->queue, &i)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *consume(void *data) {
+    Worker *worker = data;
+    const Run *run = worker->run;
+    while (atomic_load_explicit(worker->consumed, memory_order_relaxed) < ITEM_COUNT) {
+        u64 item;
+        if (!run->try_pop(run->queue, &item)) {
+            sched_yield();
+            continue;
+        }
+        atomic_fetch_add_explicit(worker->consumed, 1, memory_order_relaxed);
+        worker->sum += item;
+    }
+    return NULL;
+}
+
+static u64 sink;
+
+static f64 run_once(const Run *run) {
+    atomic u64 consumed = 0;
+    u32 thread_count = run->producers + run->consumers;
+    Worker *workers = malloc(thread_count * sizeof(Worker));
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+
+    u64 start = bench_now_ns();
+    for (u32 i = 0; i < thread_count; i++) {
+        b8 producer = i < run->producers;
+        workers[i] = (Worker){
+            .run = run,
+            .index = producer ? i : i - run->producers,
+            .consumed = &consumed,
+        };
+        pthread_create(&threads[i], NULL, producer ? produce : consume, &workers[i]);
+    }
+    for (u32 i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+        sink += workers[i].sum;
+    }
+    f64 ms = bench_elapsed_ms(start);
+
+    free(threads);
+    free(workers);
+    return ms;
+}
+
+static f64 best(const Run *run) {
+    f64 ms = run_once(run);
+    for (u32 i = 1; i < ROUNDS; i++) {
+        f64 round = run_once(run);
+        ms = round < ms ? round : ms;
+    }
+    return ms;
+}
+
+static void report(const char *name, f64 ms, u64 items, f64 baseline_ms) {
+    printf("%-28s %9.3f ms %8.2f ns/item %8.2f Mitems/s %7.2fx\n",
+           name,
+           ms,
+           ms * 1e6 / (f64)items,
+           (f64)items / (ms * 1e3),
+           baseline_ms / ms);
+}
+
+static void bench_mpmc(u32 producers, u32 consumers) {
+    MutexQueue mutex_queue = mutex_queue_new(QUEUE_CAPACITY);
+    MpmcQueue mpmc_queue = mpmc_queue_new(QUEUE_CAPACITY, sizeof(u64));
+
+    Run mutex_run = {mutex_push, mutex_pop, &mutex_queue, producers, consumers};
+    Run mpmc_run = {mpmc_push, mpmc_pop, &mpmc_queue, producers, consumers};
+    char name[64];
+    f64 mutex_ms = best(&mutex_run);
+    snprintf(name, sizeof(name), "%2up %2uc mutex", producers, consumers);
+    report(name, mutex_ms, ITEM_COUNT, mutex_ms);
+    snprintf(name, sizeof(name), "%2up %2uc mpmc_queue", producers, consumers);
+    report(name, best(&mpmc_run), ITEM_COUNT, mutex_ms);
+
+    mpmc_queue_destroy(&mpmc_queue);
+    mutex_queue_destroy(&mutex_queue);
+}
+
+static void *produce_elements(void *data) {
+    SpscRing *ring = data;
+    for (u64 i = 0; i < ITEM_COUNT; i++) {
+        while (!spsc_ring_try_push(ring, &i)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static f64 spsc_elements(void) {
+    SpscRing ring = spsc_ring_new(QUEUE_CAPACITY, sizeof(u64));
+    u64 start = bench_now_ns();
+    pthread_t producer;
+    pthread_create(&producer, NULL, produce_elements, &ring);
+    for (u64 i = 0; i < ITEM_COUNT; i++) {
+        u64 item;
+        while (!spsc_ring_try_pop(&ring, &item)) {
+            sched_yield();
+        }
+        sink += item;
+    }
+    pthread_join(producer, NULL);
+    f64 ms = bench_elapsed_ms(start);
+    spsc_ring_destroy(&ring);
+    return ms;
+}
+
+static void *produce_messages(void *data) {
+    SpscRing *ring = data;
+    u8 message[MAX_MESSAGE_SIZE] = {0};
+    for (u32 i = 0; i < MESSAGE_COUNT; i++) {
+        while (!spsc_ring_try_write(ring, message, i % MAX_MESSAGE_SIZE)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static f64 spsc_messages(void) {
+    SpscRing ring = spsc_ring_new_bytes(QUEUE_CAPACITY * sizeof(u64));
+    u64 start = bench_now_ns();
+    pthread_t producer;
+    pthread_create(&producer, NULL, produce_messages, &ring);
+    u8 message[MAX_MESSAGE_SIZE];
+    for (u32 i = 0; i < MESSAGE_COUNT; i++) {
+        u32 size;
+        while (!spsc_ring_try_read(&ring, message, sizeof(message), &size)) {
+            sched_yield();
+        }
+        sink += size;
+    }
+    pthread_join(producer, NULL);
+    f64 ms = bench_elapsed_ms(start);
+    spsc_ring_destroy(&ring);
+    return ms;
+}
+
+static f64 best_of(f64 (*run)(void)) {
+    f64 ms = run();
+    for (u32 i = 1; i < ROUNDS; i++) {
+        f64 round = run();
+        ms = round < ms ? round : ms;
+    }
+    return ms;
+}
+
+int main(void) {
+    printf("%u u64 items through a queue of %d, best of %d rounds, speedup over a mutex queue\n",
+           ITEM_COUNT,
+           QUEUE_CAPACITY,
+           ROUNDS);
+    for (u32 threads = 1; threads <= 16; threads *= 2) {
+        bench_mpmc(threads, threads);
+    }
+    bench_mpmc(1, 16);
+    bench_mpmc(16, 1);
+
+    printf("\none producer, one consumer\n");
+    MutexQueue mutex_queue = mutex_queue_new(QUEUE_CAPACITY);
+    Run mutex_run = {mutex_push, mutex_pop, &mutex_queue, 1, 1};
+    f64 mutex_ms = best(&mutex_run);
+    mutex_queue_destroy(&mutex_queue);
+    report("mutex", mutex_ms, ITEM_COUNT, mutex_ms);
+    report("spsc_ring elements", best_of(spsc_elements), ITEM_COUNT, mutex_ms);
+    report("spsc_ring messages 0-63 B", best_of(spsc_messages), MESSAGE_COUNT, mutex_ms * MESSAGE_COUNT / ITEM_COUNT);
+
+    return sink == 0;
+}
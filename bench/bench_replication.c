@@ -0,0 +1,112 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "ecs/component_id.h"
+#include "ecs/entity.h"
+#include "ecs/world.h"
+#include "net/replication.h"
+
+#include <stdio.h>
+
+#define ENTITY_COUNT 10000
+#define TICK_COUNT 100
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+typedef struct {
+    f32 x, y, z;
+} Velocity;
+
+static void register_components(World *world) {
+    world_set_component_flags(world, world_register_component(world, Position), COMPONENT_FLAG_REPLICATED);
+    world_set_component_flags(world, world_register_component(world, Velocity), COMPONENT_FLAG_REPLICATED);
+}
+
+// Moves every `stride`-th entity, the others stay as they were
+static void tick(World *world, EntityRange range, u32 stride) {
+    for (u32 i = 0; i < range.count; i += stride) {
+        entity_id e = entity_range_get(range, i);
+        Position *p = world_get_component(world, e, Position);
+        const Velocity *v = world_get_component(world, e, Velocity);
+        p->x += v->x;
+        p->y += v->y;
+        p->z += v->z;
+    }
+}
+
+static void bench_moving(u32 stride) {
+    World server_world = world_new();
+    World client_world = world_new();
+    register_components(&server_world);
+    register_components(&client_world);
+
+    ComponentId ids[] = {component_id(Position), component_id(Velocity)};
+    EntityRange range = world_spawn_batch(&server_world, ENTITY_COUNT, 2, ids, NULL);
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        entity_id e = entity_range_get(range, i);
+        *world_get_component(&server_world, e, Position) = (Position){(f32)i, 0.0f, (f32)(i % 100)};
+        *world_get_component(&server_world, e, Velocity) = (Velocity){0.01f * (f32)(i % 7), 0.5f, -0.25f};
+    }
+
+    // 64 KiB per update stays below the socket buffers, the entities take a
+    // few updates to reach the client
+    ReplicationServer *server =
+        replication_server_new(&server_world, (ReplicationServerConfig){.bytes_per_update = 64 * 1024});
+    ReplicationClient *client =
+        replication_client_new(&client_world, net_address_loopback(replication_server_port(server)));
+    if (server == NULL || client == NULL) {
+        printf("could not open sockets\n");
+        return;
+    }
+
+    // until the client holds the full state
+    replication_client_update(client);
+    replication_server_update(server);
+    u32 target = replication_server_sequence(server);
+    while (replication_client_sequence(client) < target || replication_server_stats(server).deferred_entities != 0) {
+        replication_client_update(client);
+        replication_server_update(server);
+    }
+    replication_client_update(client);
+
+    ReplicationServerStats before = replication_server_stats(server);
+    f64 server_ms = 0;
+    f64 client_ms = 0;
+    u32 first_sequence = replication_client_sequence(client);
+    for (u32 t = 0; t < TICK_COUNT; t++) {
+        tick(&server_world, range, stride);
+
+        u64 start = bench_now_ns();
+        replication_server_update(server);
+        server_ms += bench_elapsed_ms(start);
+
+        start = bench_now_ns();
+        replication_client_update(client);
+        client_ms += bench_elapsed_ms(start);
+    }
+    ReplicationServerStats after = replication_server_stats(server);
+
+    printf("%5.1f%% moving   %8.0f bytes/tick %6.1f packets/tick   server %6.3f ms/tick   client %6.3f ms/tick   "
+           "%u/%u snapshots applied\n",
+           100.0 / stride,
+           (f64)(after.bytes_sent - before.bytes_sent) / TICK_COUNT,
+           (f64)(after.packets_sent - before.packets_sent) / TICK_COUNT,
+           server_ms / TICK_COUNT,
+           client_ms / TICK_COUNT,
+           replication_client_sequence(client) - first_sequence,
+           TICK_COUNT);
+
+    replication_client_destroy(client);
+    replication_server_destroy(server);
+    world_destroy(&client_world);
+    world_destroy(&server_world);
+}
+
+int main(void) {
+    printf("%u replicated entities with 2 components, one client over loopback\n", ENTITY_COUNT);
+    bench_moving(1);
+    bench_moving(10);
+    bench_moving(100);
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "core/job_pool.h"
+#include "ecs/query.h"
+#include "ecs/system.h"
+#include "ecs/world.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#define ENTITY_COUNT 1000000
+#define WARMUP_TICKS 2
+#define MEASURED_TICKS 20
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+typedef struct {
+    f32 x, y, z;
+} Velocity;
+
+typedef struct {
+    f32 value;
+} Lifetime;
+
+typedef struct {
+    f32 radius;
+} Bounds;
+
+static void integrate_system(void **components) {
+    Position *p = components[0];
+    const Velocity *v = components[1];
+    p->x += v->x * 0.016f;
+    p->y += v->y * 0.016f;
+    p->z += v->z * 0.016f;
+}
+
+static void damp_system(void **components) {
+    Velocity *v = components[0];
+    v->x *= 0.99f;
+    v->y *= 0.99f;
+    v->z *= 0.99f;
+}
+
+static void age_system(void **components) {
+    Lifetime *l = components[0];
+    l->value = l->value > 0.016f ? l->value - 0.016f : 100.0f;
+}
+
+static void bounds_system(void **components) {
+    const Position *p = components[0];
+    Bounds *b = components[1];
+    b->radius = sqrtf(p->x * p->x + p->y * p->y + p->z * p->z);
+}
+
+static World make_scene(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+    world_register_component(&world, Lifetime);
+    world_register_component(&world, Bounds);
+
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        entity_id e = world_create_entity(&world);
+        world_attach_component(&world, e, Position, ((Position){(f32)i, 0, 0}));
+        world_attach_component(&world, e, Velocity, ((Velocity){1, (f32)(i % 7), 0}));
+        world_attach_component(&world, e, Lifetime, ((Lifetime){(f32)(i % 100)}));
+        world_attach_component(&world, e, Bounds, ((Bounds){0}));
+    }
+
+    SystemInfo systems[] = {
+        {
+            .name = "integrate",
+            .query = query_new(Write(Position), Read(Velocity)),
+            .fn = integrate_system,
+        },
+        {
+            .name = "damp",
+            .query = query_new(Write(Velocity)),
+            .fn = damp_system,
+        },
+        {
+            .name = "age",
+            .query = query_new(Write(Lifetime)),
+            .fn = age_system,
+        },
+        {
+            .name = "bounds",
+            .query = query_new(Read(Position), Write(Bounds)),
+            .fn = bounds_system,
+        },
+    };
+    for (u32 i = 0; i < ARRAY_SIZE(systems); i++) {
+        systems[i].schedule = SYSTEM_SCHEDULE_UPDATE;
+        systems[i].flags = SYSTEM_FLAG_PARALLEL;
+        world_add_system(&world, systems[i]);
+    }
+
+    return world;
+}
+
+static void bench_storage(WorldStorage storage, const char *storage_name) {
+    const u32 thread_counts[] = {1, 2, 4, 8};
+    World world = make_scene(storage);
+    f64 baseline_ms = 0;
+
+    printf("%s storage, %u entities, 4 systems\n", storage_name, ENTITY_COUNT);
+    printf("%8s %12s %10s\n", "threads", "ms/tick", "speedup");
+
+    for (u32 t = 0; t < ARRAY_SIZE(thread_counts); t++) {
+        JobPool *pool = job_pool_new(thread_counts[t]);
+        world_set_job_pool(&world, pool);
+
+        for (u32 i = 0; i < WARMUP_TICKS; i++) {
+            world_run(&world);
+        }
+
+        u64 start = bench_now_ns();
+        for (u32 i = 0; i < MEASURED_TICKS; i++) {
+            world_run(&world);
+        }
+        f64 tick_ms = bench_elapsed_ms(start) / MEASURED_TICKS;
+        if (t == 0) {
+            baseline_ms = tick_ms;
+        }
+
+        printf("%8u %12.3f %9.2fx\n", thread_counts[t], tick_ms, baseline_ms / tick_ms);
+
+        world_set_job_pool(&world, NULL);
+        job_pool_destroy(pool);
+    }
+
+    world_destroy(&world);
+}
+
+int main(void) {
+    bench_storage(WORLD_STORAGE_COMPONENT_STORE, "component store");
+    bench_storage(WORLD_STORAGE_ARCHETYPE, "archetype");
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "ecs/component_id.h"
+#include "ecs/entity.h"
+#include "ecs/snapshot.h"
+#include "ecs/world.h"
+
+#include <stdio.h>
+
+#define ENTITY_COUNT 100000
+#define REPEAT_COUNT 20
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+typedef struct {
+    f32 x, y, z;
+} Velocity;
+
+typedef struct {
+    u32 value;
+} Health;
+
+static const char *storage_name(WorldStorage storage) {
+    return storage == WORLD_STORAGE_ARCHETYPE ? "archetype" : "component store";
+}
+
+static void move_all(World *world, EntityRange range) {
+    for (u32 i = 0; i < range.count; i++) {
+        world_get_component(world, entity_range_get(range, i), Position)->x += 1.0f;
+    }
+}
+
+static void bench_storage(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+    world_register_component(&world, Health);
+
+    ComponentId ids[] = {component_id(Position), component_id(Velocity), component_id(Health)};
+    EntityRange range = world_spawn_batch(&world, ENTITY_COUNT, 3, ids, NULL);
+
+    WorldSnapshot base = {0};
+    WorldSnapshot snapshot = {0};
+    world_snapshot_capture(&world, NULL, &base);
+
+    // the buffer is reused after the first capture
+    f64 capture_ms = 0;
+    for (u32 r = 0; r < REPEAT_COUNT; r++) {
+        u64 start = bench_now_ns();
+        world_snapshot_capture(&world, NULL, &snapshot);
+        capture_ms += bench_elapsed_ms(start);
+    }
+
+    // only Position differs from the base
+    move_all(&world, range);
+    f64 delta_ms = 0;
+    WorldSnapshot delta = {0};
+    for (u32 r = 0; r < REPEAT_COUNT; r++) {
+        u64 start = bench_now_ns();
+        world_snapshot_capture(&world, &base, &delta);
+        delta_ms += bench_elapsed_ms(start);
+    }
+
+    // a rollback: the same entities with other values
+    f64 restore_ms = 0;
+    for (u32 r = 0; r < REPEAT_COUNT; r++) {
+        move_all(&world, range);
+        u64 start = bench_now_ns();
+        world_snapshot_restore(&world, &base, NULL);
+        restore_ms += bench_elapsed_ms(start);
+    }
+
+    // entities were destroyed since, so the component indices are rebuilt
+    f64 rebuild_ms = 0;
+    for (u32 r = 0; r < REPEAT_COUNT; r++) {
+        for (u32 i = 0; i < ENTITY_COUNT; i += 100) {
+            world_destroy_entity(&world, entity_range_get(range, i));
+        }
+        u64 start = bench_now_ns();
+        world_snapshot_restore(&world, &base, NULL);
+        rebuild_ms += bench_elapsed_ms(start);
+    }
+
+    printf("%-16s full %6.2f MB %8.3f ms   delta %6.2f MB %8.3f ms   restore %8.3f ms   restore+reindex %8.3f ms\n",
+           storage_name(storage),
+           (f64)snapshot.size / (1024 * 1024),
+           capture_ms / REPEAT_COUNT,
+           (f64)delta.size / (1024 * 1024),
+           delta_ms / REPEAT_COUNT,
+           restore_ms / REPEAT_COUNT,
+           rebuild_ms / REPEAT_COUNT);
+
+    world_snapshot_destroy(&delta);
+    world_snapshot_destroy(&snapshot);
+    world_snapshot_destroy(&base);
+    world_destroy(&world);
+}
+
+int main(void) {
+    printf("%u entities with 3 components\n", ENTITY_COUNT);
+    bench_storage(WORLD_STORAGE_COMPONENT_STORE);
+    bench_storage(WORLD_STORAGE_ARCHETYPE);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "ecs/component_store.h"
+#include "ecs/entity.h"
+#include "ecs/world.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SPAWN_COUNT 1000000
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+typedef struct {
+    f32 x, y, z;
+} Velocity;
+
+typedef struct {
+    i32 health;
+} Health;
+
+static Position *positions;
+static Velocity *velocities;
+static Health *healths;
+
+static const char *storage_name(WorldStorage storage) {
+    return storage == WORLD_STORAGE_ARCHETYPE ? "archetype" : "component store";
+}
+
+static World make_world(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+    world_register_component(&world, Health);
+    return world;
+}
+
+static f64 bench_per_entity(WorldStorage storage) {
+    World world = make_world(storage);
+
+    u64 start = bench_now_ns();
+    for (u32 i = 0; i < SPAWN_COUNT; i++) {
+        entity_id e = world_create_entity(&world);
+        world_attach_component(&world, e, Position, positions[i]);
+        world_attach_component(&world, e, Velocity, velocities[i]);
+        world_attach_component(&world, e, Health, healths[i]);
+    }
+    f64 ms = bench_elapsed_ms(start);
+
+    world_destroy(&world);
+    return ms;
+}
+
+static f64 bench_batch(WorldStorage storage) {
+    World world = make_world(storage);
+    ComponentId ids[] = {component_id(Position), component_id(Velocity), component_id(Health)};
+    const void *values[] = {positions, velocities, healths};
+
+    u64 start = bench_now_ns();
+    EntityRange range = world_spawn_batch(&world, SPAWN_COUNT, 3, ids, values);
+    f64 ms = bench_elapsed_ms(start);
+
+    // make sure the batch actually landed
+    Health *last = world_get_component(&world, entity_range_get(range, SPAWN_COUNT - 1), Health);
+    if (last == NULL || last->health != SPAWN_COUNT - 1) {
+        printf("batch spawn lost components\n");
+    }
+
+    world_destroy(&world);
+    return ms;
+}
+
+// A batch that lands in front of the largest key of a B+tree store, which
+// world_spawn_batch never does: new slots always come after every key
+static f64 store_in_front(b8 batch) {
+    ComponentStore store = component_store_new("Health", sizeof(Health));
+    component_store_insert(&store, 0, &healths[0]);
+    component_store_insert(&store, SPAWN_COUNT, &healths[0]);
+
+    u64 start = bench_now_ns();
+    if (batch) {
+        component_store_insert_batch(&store, 1, SPAWN_COUNT - 1, healths + 1);
+    } else {
+        for (u32 i = 1; i < SPAWN_COUNT; i++) {
+            component_store_insert(&store, i, &healths[i]);
+        }
+    }
+    f64 ms = bench_elapsed_ms(start);
+
+    component_store_destroy(&store);
+    return ms;
+}
+
+int main(void) {
+    positions = malloc(sizeof(Position) * SPAWN_COUNT);
+    velocities = malloc(sizeof(Velocity) * SPAWN_COUNT);
+    healths = malloc(sizeof(Health) * SPAWN_COUNT);
+    for (u32 i = 0; i < SPAWN_COUNT; i++) {
+        positions[i] = (Position){(f32)i, 0, 0};
+        velocities[i] = (Velocity){0, 1, 0};
+        healths[i] = (Health){(i32)i};
+    }
+
+    printf("%u entities, 3 components each\n", SPAWN_COUNT);
+    WorldStorage storages[] = {WORLD_STORAGE_COMPONENT_STORE, WORLD_STORAGE_ARCHETYPE};
+    for (u32 i = 0; i < 2; i++) {
+        f64 per_entity_ms = bench_per_entity(storages[i]);
+        f64 batch_ms = bench_batch(storages[i]);
+        printf("%-16s per entity %10.3f ms   batch %10.3f ms   %6.1fx\n",
+               storage_name(storages[i]),
+               per_entity_ms,
+               batch_ms,
+               per_entity_ms / batch_ms);
+    }
+
+    f64 per_key_ms = store_in_front(false);
+    f64 batch_ms = store_in_front(true);
+    printf("\n%u keys between two existing ones, one b+tree store\n", SPAWN_COUNT - 1);
+    printf("%-16s per key    %10.3f ms   batch %10.3f ms   %6.1fx\n",
+           "in front",
+           per_key_ms,
+           batch_ms,
+           per_key_ms / batch_ms);
+
+    free(positions);
+    free(velocities);
+    free(healths);
+    return 0;
+}
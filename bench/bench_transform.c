@@ -0,0 +1,98 @@
+#include "bench.h"
+#include "core/defines.h"
+#include "core/job_pool.h"
+#include "ecs/component_id.h"
+#include "ecs/entity.h"
+#include "ecs/transform.h"
+#include "ecs/world.h"
+
+#include <stdio.h>
+
+#define ROOT_COUNT 1000
+#define TREE_SIZE 500
+#define FANOUT 8
+// one in DIRTY_STRIDE roots is moved in the partial frames
+#define DIRTY_STRIDE 100
+#define REPEAT_COUNT 10
+
+static const u32 thread_counts[] = {1, 2, 4, 8};
+
+static void mark_roots(World *world, EntityRange range, u32 stride) {
+    for (u32 r = 0; r < ROOT_COUNT; r += stride) {
+        entity_id root = entity_range_get(range, r * TREE_SIZE);
+        world_get_component(world, root, LocalTransform)->translation.x += 1.0f;
+        world_mark_changed(world, root, LocalTransform);
+    }
+}
+
+static f64 time_frames(World *world, EntityRange range, u32 stride) {
+    f64 total_ms = 0;
+    for (u32 r = 0; r < REPEAT_COUNT; r++) {
+        if (stride != 0) {
+            mark_roots(world, range, stride);
+        }
+        u64 start = bench_now_ns();
+        transform_propagate(world);
+        total_ms += bench_elapsed_ms(start);
+    }
+    return total_ms / REPEAT_COUNT;
+}
+
+static void bench_threads(u32 thread_count) {
+    JobPool *pool = thread_count > 1 ? job_pool_new(thread_count) : NULL;
+    World world = world_new();
+    world_set_job_pool(&world, pool);
+    transform_enable(&world);
+
+    LocalTransform locals[TREE_SIZE];
+    GlobalTransform globals[TREE_SIZE];
+    for (u32 i = 0; i < TREE_SIZE; i++) {
+        locals[i] = local_transform_identity();
+        locals[i].translation = (vec3s){{1, 0, 0}};
+        locals[i].rotation = quatv(0.01f * (f32)i, (vec3s){{0, 1, 0}});
+        globals[i] = (GlobalTransform){mat4_identity()};
+    }
+
+    // trees are spawned whole, node k's parent is node (k - 1) / FANOUT
+    ComponentId ids[] = {component_id(LocalTransform), component_id(GlobalTransform)};
+    EntityRange range = world_spawn_batch(&world, ROOT_COUNT * TREE_SIZE, 2, ids, NULL);
+    for (u32 r = 0; r < ROOT_COUNT; r++) {
+        for (u32 k = 0; k < TREE_SIZE; k++) {
+            entity_id entity = entity_range_get(range, r * TREE_SIZE + k);
+            *world_get_component(&world, entity, LocalTransform) = locals[k];
+            *world_get_component(&world, entity, GlobalTransform) = globals[k];
+            if (k > 0) {
+                transform_set_parent(&world, entity, entity_range_get(range, r * TREE_SIZE + (k - 1) / FANOUT));
+            }
+        }
+    }
+
+    u64 start = bench_now_ns();
+    transform_propagate(&world);
+    f64 first_ms = bench_elapsed_ms(start);
+
+    f64 full_ms = time_frames(&world, range, 1);
+    f64 partial_ms = time_frames(&world, range, DIRTY_STRIDE);
+    f64 idle_ms = time_frames(&world, range, 0);
+
+    printf("%2u threads   rebuild+full %8.3f ms   full %8.3f ms   1/%u roots %8.3f ms   unchanged %8.3f ms\n",
+           thread_count,
+           first_ms,
+           full_ms,
+           DIRTY_STRIDE,
+           partial_ms,
+           idle_ms);
+
+    world_destroy(&world);
+    if (pool != NULL) {
+        job_pool_destroy(pool);
+    }
+}
+
+int main(void) {
+    printf("%u roots of %u nodes, fanout %u\n", ROOT_COUNT, TREE_SIZE, FANOUT);
+    for (u32 i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        bench_threads(thread_counts[i]);
+    }
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include "assets/material.h"
 #include "assets/parsers/gltf_parser.h"
 #include "core/defines.h"
+#include "ecs/transform.h"
+#include "ecs/world.h"
 #include "renderer/application.h"
 
 #include <fcntl.h>
@@ -30,56 +32,81 @@ static f32 randf(void) { return (f32)rand() / (f32)RAND_MAX; }
 // }
 
 typedef struct {
-    vec3s translation;
-    versors rotation;
-    vec3s scale;
+    mat4s transform;
     u32 mesh_index;
 } MeshData;
 
-void get_meshes(const Gltf *gltf, MeshData *parent, u32 node_index, darray(MeshData) * meshes) {
+// Flattens the node hierarchy of the gltf's scene into one world transform per mesh
+static void get_meshes(const Gltf *gltf, darray(MeshData) * meshes) {
     if (gltf == NULL || meshes == NULL) {
         LOG_ERROR("get_meshes: gltf or meshes is NULL");
         return;
     }
-    if (node_index >= darray_length(gltf->nodes)) {
-        LOG_ERROR("get_meshes: node_index out of bounds");
+    if (gltf->scenes == NULL || gltf->scene >= darray_length(gltf->scenes)) {
+        LOG_ERROR("get_meshes: scene index out of bounds");
         return;
     }
 
-    GltfNode *node = &(gltf->nodes[node_index]);
-    LOG_INFO("Processing node %u", node_index);
-    LOG_INFO("Node name: %s", node->name);
-
-    MeshData *self = NULL;
-    if (node->mesh != -1) {
-        MeshData mesh = {0};
-
-        if (parent != NULL) {
-            mesh = (MeshData){
-                .translation = vec3_add(parent->translation, node->translation),
-                .rotation = quat_add(parent->rotation, node->rotation),
-                .scale = vec3_mul(parent->scale, node->scale),
-                .mesh_index = node->mesh,
-            };
-        } else {
-            mesh = (MeshData){
-                .translation = node->translation,
-                .rotation = node->rotation,
-                .scale = node->scale,
-                .mesh_index = node->mesh,
-            };
+    World world = world_new();
+    transform_enable(&world);
+
+    // node i becomes entities[i]
+    darray(entity_id) entities = darray_new(entity_id);
+    for (u32 i = 0; i < darray_length(gltf->nodes); i++) {
+        const GltfNode *node = &gltf->nodes[i];
+        entity_id entity = world_create_entity(&world);
+        world_attach_component(&world,
+                               entity,
+                               LocalTransform,
+                               ((LocalTransform){
+                                   .translation = node->translation,
+                                   .rotation = node->rotation,
+                                   .scale = node->scale,
+                               }));
+        world_attach_component(&world, entity, GlobalTransform, ((GlobalTransform){mat4_identity()}));
+        darray_push(entities, entity);
+    }
+
+    for (u32 i = 0; i < darray_length(gltf->nodes); i++) {
+        const GltfNode *node = &gltf->nodes[i];
+        for (u32 c = 0; node->children != NULL && c < darray_length(node->children); c++) {
+            if (node->children[c] >= darray_length(gltf->nodes)) {
+                LOG_ERROR("get_meshes: node_index out of bounds");
+                continue;
+            }
+            transform_set_parent(&world, entities[node->children[c]], entities[i]);
         }
+    }
 
-        darray_push(*meshes, mesh);
-        self = &((*meshes)[darray_length(*meshes) - 1]);
+    transform_propagate(&world);
+
+    // only meshes reachable from the scene are drawn
+    darray(u32) stack = darray_new(u32);
+    const GltfScene *scene = &gltf->scenes[gltf->scene];
+    for (u32 i = 0; i < darray_length(scene->nodes); i++) {
+        darray_push(stack, scene->nodes[i]);
     }
+    while (darray_length(stack) > 0) {
+        u32 node_index;
+        darray_pop(stack, &node_index);
+        if (node_index >= darray_length(gltf->nodes)) {
+            LOG_ERROR("get_meshes: node_index out of bounds");
+            continue;
+        }
 
-    if (node->children) {
-        for (u32 i = 0; i < darray_length(node->children); i++) {
-            LOG_INFO("Child node index: %u", node->children[i]);
-            get_meshes(gltf, self, node->children[i], meshes);
+        const GltfNode *node = &gltf->nodes[node_index];
+        if (node->mesh != -1) {
+            const GlobalTransform *global = world_get_component(&world, entities[node_index], GlobalTransform);
+            darray_push(*meshes, ((MeshData){.transform = global->matrix, .mesh_index = (u32)node->mesh}));
+        }
+        for (u32 c = 0; node->children != NULL && c < darray_length(node->children); c++) {
+            darray_push(stack, node->children[c]);
         }
     }
+
+    darray_destroy(stack);
+    darray_destroy(entities);
+    world_destroy(&world);
 }
 
 int main(void) {
@@ -95,11 +122,10 @@ int main(void) {
     Gltf gltf = gltf_parse("assets/models/main_sponza/NewSponza_Main_glTF_003.gltf");
 
     darray(MeshData) meshes = darray_new(MeshData);
+    get_meshes(&gltf, &meshes);
 
     for (u32 i = 0; i < darray_length(meshes); i++) {
-        glms_vec3_print(meshes[i].translation, stdout);
-        glm_vec4_print(meshes[i].rotation.raw, stdout);
-        glms_vec3_print(meshes[i].scale, stdout);
+        glms_mat4_print(meshes[i].transform, stdout);
     }
 
     char *directory = realpath("assets/models/main_sponza/", NULL);
@@ -62,17 +62,13 @@ Model create_box(vec3s p0, vec3s p1, Material material) {
         {(vec3s){{p1.x, p1.y, p1.z}}, (vec3s){{0, 1, 0}}, (vec2s){{0, 0}}, 0},
     };
 
-    for (u32 i = 0; i < ARRAY_SIZE(vertices); i++) {
-        darray_push(self.vertices, vertices[i]);
-    }
+    darray_extend_from(self.vertices, vertices, ARRAY_SIZE(vertices));
 
     u32 indices[] = {0,  1,  2,  0,  2,  3,  4,  5,  6,  4,  6,  7,
                      8,  9,  10, 8,  10, 11, 12, 13, 14, 12, 14, 15,
                      16, 17, 18, 16, 18, 19, 20, 21, 22, 20, 22, 23};
 
-    for (u32 i = 0; i < ARRAY_SIZE(indices); i++) {
-        darray_push(self.indices, indices[i]);
-    }
+    darray_extend_from(self.indices, indices, ARRAY_SIZE(indices));
 
     darray_push(self.materials, material);
 
@@ -91,6 +87,12 @@ Model create_sphere(vec3s center, f32 radius, Material material) {
 
     const f32 pi = GLM_PI;
 
+    // sized up front and written in place, no push per element
+    darray_resize_uninit(self.vertices, (stacks + 1) * (slices + 1));
+    darray_resize_uninit(self.indices, stacks * slices * 6);
+    Vertex *vertices = self.vertices;
+    u32 *indices = self.indices;
+
     for (u32 j = 0; j <= stacks; ++j) {
         const f32 j0 = pi * j / stacks;
 
@@ -113,7 +115,7 @@ Model create_sphere(vec3s center, f32 radius, Material material) {
                 .tex_coord = {{(f32)(i) / slices, (f32)(j) / stacks}},
             };
 
-            darray_push(self.vertices, vertex);
+            *vertices++ = vertex;
         }
     }
 
@@ -124,13 +126,13 @@ Model create_sphere(vec3s center, f32 radius, Material material) {
             const u32 i0 = i + 0;
             const u32 i1 = i + 1;
 
-            darray_push(self.indices, j0 + i0);
-            darray_push(self.indices, j1 + i0);
-            darray_push(self.indices, j1 + i1);
+            *indices++ = j0 + i0;
+            *indices++ = j1 + i0;
+            *indices++ = j1 + i1;
 
-            darray_push(self.indices, j0 + i0);
-            darray_push(self.indices, j1 + i1);
-            darray_push(self.indices, j0 + i1);
+            *indices++ = j0 + i0;
+            *indices++ = j1 + i1;
+            *indices++ = j0 + i1;
         }
     }
 
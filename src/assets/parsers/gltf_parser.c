@@ -1,6 +1,7 @@
 #include "gltf_parser.h"
 
 #include "assets/file.h"
+#include "core/allocator/memory_tracker.h"
 #include "core/assert.h"
 #include "core/logging.h"
 #include "json_parser.h"
@@ -21,7 +22,7 @@ Gltf gltf_parse(const char *filename) {
     char *file_contents = (char *)file_read(filename, &file_size);
 
     JsonElement gltf;
-    if (json_parse(file_contents, &gltf) == false) {
+    if (json_parse_with_allocator(file_contents, memory_tag_allocator(MEMORY_TAG_GLTF), &gltf) == false) {
         LOG_FATAL("failed to parse json in: '%s'", filename);
         exit(EXIT_FAILURE);
     }
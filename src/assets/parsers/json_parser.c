@@ -1,6 +1,7 @@
 #include "json_parser.h"
 
 #include "containers/darray.h"
+#include "core/allocator/memory_tracker.h"
 #include "core/assert.h"
 #include "core/logging.h"
 
@@ -9,19 +10,23 @@
 
 static const char *skip_whitespace(const char *str);
 static const char *assert_character(const char *str, char c);
-static const char *parse_element(const char *string, JsonElement *out_element);
-static const char *parse_object(const char *string, JsonElement *out_element);
-static const char *parse_array(const char *string, JsonElement *out_element);
-static const char *parse_string(const char *string, JsonElement *out_element);
+static const char *parse_element(const char *string, Allocator *allocator, JsonElement *out_element);
+static const char *parse_object(const char *string, Allocator *allocator, JsonElement *out_element);
+static const char *parse_array(const char *string, Allocator *allocator, JsonElement *out_element);
+static const char *parse_string(const char *string, Allocator *allocator, JsonElement *out_element);
 static const char *parse_number(const char *string, JsonElement *out_element);
 static const char *parse_boolean(const char *string, JsonElement *out_element);
 static const char *parse_null(const char *string, JsonElement *out_element);
 
 b8 json_parse(const char *string, JsonElement *out_element) {
+    return json_parse_with_allocator(string, memory_tag_allocator(MEMORY_TAG_JSON), out_element);
+}
+
+b8 json_parse_with_allocator(const char *string, Allocator *allocator, JsonElement *out_element) {
     ASSERT(out_element);
     ASSERT(string);
 
-    return parse_element(string, out_element) != NULL;
+    return parse_element(string, allocator, out_element) != NULL;
 }
 
 void json_destroy(JsonElement *element) {
@@ -34,7 +39,7 @@ void json_destroy(JsonElement *element) {
         break;
     case JSON_OBJECT:
         for (u32 i = 0; i < darray_length(element->object); i++) {
-            free(element->object[i].key);
+            darray_destroy(element->object[i].key);
             json_destroy(&element->object[i].value);
         }
         darray_destroy(element->object);
@@ -63,20 +68,20 @@ static const char *assert_character(const char *str, char c) {
     return str;
 }
 
-static const char *parse_element(const char *string, JsonElement *out_element) {
+static const char *parse_element(const char *string, Allocator *allocator, JsonElement *out_element) {
     string = skip_whitespace(string);
 
     switch (*string) {
     case '{':
-        string = parse_object(string, out_element);
+        string = parse_object(string, allocator, out_element);
         break;
 
     case '[':
-        string = parse_array(string, out_element);
+        string = parse_array(string, allocator, out_element);
         break;
 
     case '"':
-        string = parse_string(string, out_element);
+        string = parse_string(string, allocator, out_element);
         break;
 
     case 't':
@@ -114,13 +119,13 @@ static const char *parse_element(const char *string, JsonElement *out_element) {
     return skip_whitespace(string);
 }
 
-static const char *parse_object(const char *string, JsonElement *out_element) {
+static const char *parse_object(const char *string, Allocator *allocator, JsonElement *out_element) {
     if ((string = assert_character(string, '{')) == NULL) {
         return NULL;
     }
 
     (*out_element).type = JSON_OBJECT;
-    (*out_element).object = darray_new(JsonMember);
+    (*out_element).object = darray_new_with(JsonMember, allocator);
 
     string = skip_whitespace(string);
 
@@ -137,7 +142,7 @@ static const char *parse_object(const char *string, JsonElement *out_element) {
 
         string = skip_whitespace(string);
         JsonElement key_element = {0};
-        if ((string = parse_string(string, &key_element)) == NULL) {
+        if ((string = parse_string(string, allocator, &key_element)) == NULL) {
             return NULL;
         }
         string = skip_whitespace(string);
@@ -147,14 +152,12 @@ static const char *parse_object(const char *string, JsonElement *out_element) {
         }
 
         JsonElement value = {0};
-        if ((string = parse_element(string, &value)) == NULL) {
+        if ((string = parse_element(string, allocator, &value)) == NULL) {
             return NULL;
         }
 
-        char *key = strndup(key_element.string, darray_length(key_element.string));
-        darray_destroy(key_element.string);
-
-        JsonMember member = {key, value};
+        // the terminated string becomes the key, without a copy
+        JsonMember member = {key_element.string, value};
         darray_push((*out_element).object, member);
     }
 
@@ -165,13 +168,13 @@ static const char *parse_object(const char *string, JsonElement *out_element) {
     return string;
 }
 
-static const char *parse_array(const char *string, JsonElement *out_element) {
+static const char *parse_array(const char *string, Allocator *allocator, JsonElement *out_element) {
     if ((string = assert_character(string, '[')) == NULL) {
         return NULL;
     }
 
     (*out_element).type = JSON_ARRAY;
-    (*out_element).array = darray_new(JsonElement);
+    (*out_element).array = darray_new_with(JsonElement, allocator);
 
     string = skip_whitespace(string);
 
@@ -186,7 +189,7 @@ static const char *parse_array(const char *string, JsonElement *out_element) {
         }
 
         JsonElement element = {0};
-        if ((string = parse_element(string, &element)) == NULL) {
+        if ((string = parse_element(string, allocator, &element)) == NULL) {
             return NULL;
         }
 
@@ -200,13 +203,13 @@ static const char *parse_array(const char *string, JsonElement *out_element) {
     return string;
 }
 
-static const char *parse_string(const char *string, JsonElement *out_element) {
+static const char *parse_string(const char *string, Allocator *allocator, JsonElement *out_element) {
     if ((string = assert_character(string, '"')) == NULL) {
         return NULL;
     }
 
     (*out_element).type = JSON_STRING;
-    (*out_element).string = darray_new(char);
+    (*out_element).string = darray_new_with(char, allocator);
 
     while (*string != '\0' && *string != '"') {
         if (*string == '\\') {
@@ -263,6 +266,11 @@ static const char *parse_string(const char *string, JsonElement *out_element) {
         return NULL;
     }
 
+    // grown darrays are not zeroed, so the terminator is stored behind the
+    // last character without counting towards the length
+    darray_push((*out_element).string, '\0');
+    darray_length_set((*out_element).string, darray_length((*out_element).string) - 1);
+
     return string;
 }
 
@@ -2,6 +2,7 @@
 #define JSON_PARSER_H
 
 #include "containers/darray.h"
+#include "core/allocator/allocator.h"
 
 typedef enum {
     JSON_OBJECT,
@@ -19,6 +20,7 @@ typedef struct JsonElement {
     union {
         darray(struct JsonMember) object;
         darray(struct JsonElement) array;
+        // terminated, the terminator is not part of the length
         darray(char) string;
         f64 number;
         b8 boolean;
@@ -26,11 +28,20 @@ typedef struct JsonElement {
 } JsonElement;
 
 typedef struct JsonMember {
+    // a terminated darray(char)
     char *key;
     JsonElement value;
 } JsonMember;
 
 b8 json_parse(const char *string, JsonElement *out_element);
+
+/**
+ * Like json_parse, but takes every array, string and key from `allocator`.
+ * With an arena the whole document is released by resetting it, without a
+ * json_destroy.
+ */
+b8 json_parse_with_allocator(const char *string, Allocator *allocator, JsonElement *out_element);
+
 void json_destroy(JsonElement *element);
 
 #endif // JSON_PARSER_H
@@ -20,6 +20,20 @@ void scene_generate_buffers(Scene *self, CommandPool *command_pool) {
     darray(Material) materials = darray_new(Material);
     darray(ivec2s) offsets = darray_new(ivec2s);
 
+    // one allocation per buffer instead of a doubling per model
+    u64 vertex_count = 0;
+    u64 index_count = 0;
+    u64 material_count = 0;
+    for (u32 m = 0; m < darray_length(self->models); m++) {
+        vertex_count += darray_length(self->models[m].vertices);
+        index_count += darray_length(self->models[m].indices);
+        material_count += darray_length(self->models[m].materials);
+    }
+    darray_reserve(vertices, vertex_count);
+    darray_reserve(indices, index_count);
+    darray_reserve(materials, material_count);
+    darray_reserve(offsets, darray_length(self->models));
+
     for (u32 m = 0; m < darray_length(self->models); m++) {
         const Model *model = &self->models[m];
 
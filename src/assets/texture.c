@@ -1,5 +1,6 @@
 #include "assets/texture.h"
 
+#include "core/allocator/memory_tracker.h"
 #include "core/logging.h"
 #include "renderer/sampler.h"
 
@@ -9,7 +10,7 @@
 Texture texture_new(const char *filename) {
     LOG_INFO("loading '%s'...", filename);
 
-    int width, height, channels;
+    int width = 0, height = 0, channels = 0;
     u8 *pixels =
         stbi_load(filename, &width, &height, &channels, STBI_rgb_alpha);
 
@@ -17,12 +18,18 @@ Texture texture_new(const char *filename) {
         LOG_FATAL("failed to load texture image '%s': %s",
                   filename,
                   stbi_failure_reason());
+        return (Texture){sampler_config_default(), 0, 0, 0, NULL};
     }
+    // stb_image allocates the pixels itself, STBI_rgb_alpha makes it 4 bytes a pixel
+    memory_tag_allocate(MEMORY_TAG_TEXTURE, (u64)width * (u64)height * 4);
 
     return (Texture){sampler_config_default(), width, height, channels, pixels};
 }
 
 void texture_destroy(Texture *self) {
+    if (self->pixels != NULL) {
+        memory_tag_free(MEMORY_TAG_TEXTURE, (u64)self->width * (u64)self->height * 4);
+    }
     stbi_image_free(self->pixels);
     self->pixels = NULL;
 }
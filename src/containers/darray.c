@@ -1,4 +1,6 @@
 #include "darray.h"
+#include "core/allocator/allocator.h"
+#include "core/allocator/memory_tracker.h"
 #include "core/assert.h"
 #include "core/defines.h"
 #include "core/logging.h"
@@ -6,17 +8,15 @@
 #include <stdlib.h>
 #include <string.h>
 
-typedef struct {
-    u64 stride;
-    u64 length;
-    u64 capacity;
-} darray_header;
-
 void *_darray_new(u64 length, u64 stride) {
+    return _darray_new_with(length, stride, memory_tag_allocator(MEMORY_TAG_DARRAY));
+}
+
+void *_darray_new_with(u64 length, u64 stride, Allocator *allocator) {
     u64 header_size = sizeof(darray_header);
     u64 array_size = length * stride;
 
-    void *new_array = malloc(header_size + array_size);
+    void *new_array = allocator_allocate(allocator, header_size + array_size, ALLOCATOR_DEFAULT_ALIGNMENT);
     // LOG_DEBUG("new darray at: %p, with { length: %lu, stride: %lu }",
     //           new_array,
     //           length,
@@ -32,6 +32,7 @@ void *_darray_new(u64 length, u64 stride) {
     header->capacity = length;
     header->length = 0;
     header->stride = stride;
+    header->allocator = allocator;
 
     return (void *)((u8 *)new_array + header_size);
 }
@@ -40,10 +41,33 @@ void darray_destroy(void *array) {
     if (array) {
         u64 header_size = sizeof(darray_header);
         darray_header *header = (darray_header *)((u8 *)array - header_size);
-        free(header);
+        allocator_free(header->allocator, header, header_size + header->capacity * header->stride);
     }
 }
 
+/**
+ * Moves the array to `capacity` elements in one reallocation, which the heap
+ * and arenas can often do without copying.
+ */
+static void *reallocate(void *array, u64 capacity) {
+    darray_header *header = _darray_header(array);
+    u64 header_size = sizeof(darray_header);
+    header = allocator_reallocate(header->allocator,
+                                  header,
+                                  header_size + header->capacity * header->stride,
+                                  header_size + capacity * header->stride,
+                                  ALLOCATOR_DEFAULT_ALIGNMENT);
+    header->capacity = capacity;
+    return (u8 *)header + header_size;
+}
+
+// Grows by DARRAY_GROWTH_FACTOR, or further when that is not enough for
+// `capacity` elements
+static void *grow(void *array, u64 capacity) {
+    u64 grown = DARRAY_GROWTH_FACTOR * darray_capacity(array);
+    return reallocate(array, grown > capacity ? grown : capacity);
+}
+
 void *_darray_resize(void *array) {
     if (darray_capacity(array) == 0) {
         LOG_FATAL("_darray_resize called on a darray with 0 capacity. This is "
@@ -51,31 +75,83 @@ void *_darray_resize(void *array) {
         return 0;
     }
 
-    void *new_array = _darray_new((DARRAY_GROWTH_FACTOR * darray_capacity(array)), darray_stride(array));
-
-    darray_length_set(new_array, darray_length(array));
+    return reallocate(array, DARRAY_GROWTH_FACTOR * darray_capacity(array));
+}
 
-    memcpy(new_array, array, darray_size(array));
-    darray_destroy(array);
+void *_darray_reserve(void *array, u64 capacity) {
+    return capacity > darray_capacity(array) ? reallocate(array, capacity) : array;
+}
 
-    return new_array;
+void *_darray_resize_uninit(void *array, u64 length) {
+    if (length > darray_capacity(array)) {
+        array = grow(array, length);
+    }
+    darray_length_set(array, length);
+    return array;
 }
 
 void *_darray_push(void *array, const void *value_ptr) {
     ASSERT_DEBUG(array);
 
-    u64 header_size = sizeof(darray_header);
-    darray_header *header = (darray_header *)((u8 *)array - header_size);
-
+    darray_header *header = _darray_header(array);
     if (header->length >= header->capacity) {
         array = _darray_resize(array);
-        header = (darray_header *)((u8 *)array - header_size);
+        header = _darray_header(array);
+    }
+
+    memcpy((u8 *)array + header->length * header->stride, value_ptr, header->stride);
+    header->length++;
+
+    return array;
+}
+
+void *_darray_push_n(void *array, const void *value_ptr, u64 count) {
+    u64 length = darray_length(array);
+    array = _darray_resize_uninit(array, length + count);
+
+    // the common strides fill with typed stores instead of a memcpy per
+    // element
+    switch (darray_stride(array)) {
+    case 1:
+        memset((u8 *)array + length, *(const u8 *)value_ptr, count);
+        break;
+    case 4: {
+        u32 value;
+        memcpy(&value, value_ptr, sizeof(value));
+        u32 *values = (u32 *)array + length;
+        for (u64 i = 0; i < count; i++) {
+            values[i] = value;
+        }
+        break;
+    }
+    case 8: {
+        u64 value;
+        memcpy(&value, value_ptr, sizeof(value));
+        u64 *values = (u64 *)array + length;
+        for (u64 i = 0; i < count; i++) {
+            values[i] = value;
+        }
+        break;
+    }
+    default: {
+        u64 stride = darray_stride(array);
+        u8 *values = (u8 *)array + length * stride;
+        for (u64 i = 0; i < count; i++) {
+            memcpy(values + i * stride, value_ptr, stride);
+        }
+        break;
+    }
     }
 
-    u64 address = (u64)array + (header->length * header->stride);
-    memcpy((void *)address, value_ptr, header->stride);
-    darray_length_set(array, header->length + 1);
+    return array;
+}
 
+void *_darray_extend_from(void *array, const void *values, u64 count) {
+    u64 length = darray_length(array);
+    array = _darray_resize_uninit(array, length + count);
+    if (count > 0) {
+        memcpy((u8 *)array + length * darray_stride(array), values, count * darray_stride(array));
+    }
     return array;
 }
 
@@ -104,8 +180,9 @@ void darray_pop_front(void *array, void *out_value_ptr) {
 void *_darray_insert_at(void *array, u64 index, const void *value_ptr) {
     ASSERT_DEBUG(array);
 
-    while (index >= darray_capacity(array) || darray_length(array) >= darray_capacity(array)) {
-        array = _darray_resize(array);
+    u64 needed = (index > darray_length(array) ? index : darray_length(array)) + 1;
+    if (needed > darray_capacity(array)) {
+        array = grow(array, needed);
     }
 
     u64 address = (u64)array;
@@ -113,9 +190,9 @@ void *_darray_insert_at(void *array, u64 index, const void *value_ptr) {
     u64 length = darray_length(array);
 
     if (index < length) {
-        memcpy((void *)(address + ((index + 1) * stride)),
-               (void *)(address + (index * stride)),
-               stride * (length - index));
+        memmove((void *)(address + ((index + 1) * stride)),
+                (void *)(address + (index * stride)),
+                stride * (length - index));
         memcpy((void *)(address + (index * stride)), value_ptr, stride);
         darray_length_set(array, length + 1);
     } else {
@@ -132,7 +209,7 @@ void *_darray_duplicate(u64 stride, void *array) {
 
     ASSERT_MSG(stride == source_header->stride, "_darray_duplicate: target and source stride mismatch.");
 
-    void *copy = _darray_new(source_header->capacity, stride);
+    void *copy = _darray_new_with(source_header->capacity, stride, source_header->allocator);
     darray_header *target_header = (darray_header *)((u8 *)copy - header_size);
     ASSERT_MSG(target_header->capacity == source_header->capacity, "capacity mismatch while duplicating darray.");
 
@@ -166,51 +243,16 @@ void darray_remove_at_sorted(void *array, u64 index) {
 
     ASSERT(index < header->length);
 
-    memcpy((void *)((u64)array + (index * header->stride)),
-           (void *)((u64)array + ((index + 1) * header->stride)),
-           (header->length - index - 1) * header->stride);
+    memmove((void *)((u64)array + (index * header->stride)),
+            (void *)((u64)array + ((index + 1) * header->stride)),
+            (header->length - index - 1) * header->stride);
     darray_length_set(array, header->length - 1);
 }
 
 void *_darray_append(void *dst_array, const void *src_array) {
     ASSERT_MSG(darray_stride(src_array) == darray_stride(dst_array), "trying to append array with different stride");
 
-    while (darray_capacity(dst_array) < darray_length(dst_array) + darray_length(src_array)) {
-        dst_array = _darray_resize(dst_array);
-    }
-
-    u64 src_addr = (u64)src_array;
-    u64 dst_addr = (u64)dst_array + darray_length(dst_array) * darray_stride(dst_array);
-    memcpy((void *)dst_addr, (void *)src_addr, darray_size(src_array));
-    darray_length_set(dst_array, darray_length(dst_array) + darray_length(src_array));
-
-    return dst_array;
+    return _darray_extend_from(dst_array, src_array, darray_length(src_array));
 }
 
 void darray_clear(void *array) { darray_length_set(array, 0); }
-
-u64 darray_length(const void *array) {
-    u64 header_size = sizeof(darray_header);
-    darray_header *header = (darray_header *)((u8 *)array - header_size);
-    return header->length;
-}
-
-void darray_length_set(void *array, u64 length) {
-    u64 header_size = sizeof(darray_header);
-    darray_header *header = (darray_header *)((u8 *)array - header_size);
-    header->length = length;
-}
-
-u64 darray_stride(const void *array) {
-    u64 header_size = sizeof(darray_header);
-    darray_header *header = (darray_header *)((u8 *)array - header_size);
-    return header->stride;
-}
-
-u64 darray_size(const void *array) { return darray_length(array) * darray_stride(array); }
-
-u64 darray_capacity(const void *array) {
-    u64 header_size = sizeof(darray_header);
-    darray_header *header = (darray_header *)((u8 *)array - header_size);
-    return header->capacity;
-}
@@ -1,6 +1,7 @@
 #ifndef CORE_DARRAY_H
 #define CORE_DARRAY_H
 
+#include "core/allocator/allocator.h"
 #include "core/defines.h"
 
 #define DARRAY_DEFAULT_CAPACITY 1
@@ -8,23 +9,93 @@
 
 #define darray(...) __VA_ARGS__ *
 
+/**
+ * Sits right in front of the first element. Kept in the header so length
+ * and capacity checks inline into their callers.
+ */
+typedef struct {
+    u64 stride;
+    u64 length;
+    u64 capacity;
+    Allocator *allocator;
+} darray_header;
+
+static inline darray_header *_darray_header(const void *array) {
+    return (darray_header *)((const u8 *)array - sizeof(darray_header));
+}
+
 void *_darray_new(u64 capacity, u64 stride);
 
 #define darray_new(type)                                                       \
     (type *)_darray_new(DARRAY_DEFAULT_CAPACITY, sizeof(type))
 
+/**
+ * Takes the array's memory from `allocator`, NULL for the heap. Growing,
+ * duplicating and destroying the array go through the same allocator.
+ */
+void *_darray_new_with(u64 capacity, u64 stride, Allocator *allocator);
+
+#define darray_new_with(type, allocator)                                       \
+    (type *)_darray_new_with(DARRAY_DEFAULT_CAPACITY, sizeof(type), allocator)
+
 void darray_destroy(void *array);
 
+/**
+ * Grows the capacity by DARRAY_GROWTH_FACTOR, reallocating in place when
+ * the allocator can.
+ */
 void *_darray_resize(void *array);
 
+/**
+ * Grows the capacity to at least `capacity` with a single reallocation,
+ * without changing the length.
+ */
+void *_darray_reserve(void *array, u64 capacity);
+
+#define darray_reserve(array, capacity) array = _darray_reserve(array, capacity)
+
+/**
+ * Sets the length, growing the capacity when needed. Elements past the old
+ * length are left uninitialized.
+ */
+void *_darray_resize_uninit(void *array, u64 length);
+
+#define darray_resize_uninit(array, length)                                    \
+    array = _darray_resize_uninit(array, length)
+
 void *_darray_push(void *array, const void *value_ptr);
 
+// Stores the value with a typed assignment, no call and no memcpy unless the
+// array has to grow
 #define darray_push(array, value)                                              \
     do {                                                                       \
         typeof(*array) __temp_value_copy__ = value;                            \
-        array = _darray_push(array, &__temp_value_copy__);                     \
+        if (UNLIKELY(_darray_header(array)->length >=                          \
+                     _darray_header(array)->capacity)) {                       \
+            array = _darray_resize(array);                                     \
+        }                                                                      \
+        (array)[_darray_header(array)->length++] = __temp_value_copy__;        \
     } while (0)
 
+/**
+ * Appends `count` copies of the value at `value_ptr`.
+ */
+void *_darray_push_n(void *array, const void *value_ptr, u64 count);
+
+#define darray_push_n(array, value, count)                                     \
+    do {                                                                       \
+        typeof(*array) __temp_value_copy__ = value;                            \
+        array = _darray_push_n(array, &__temp_value_copy__, count);            \
+    } while (0)
+
+/**
+ * Appends `count` elements copied from `values`, growing at most once.
+ */
+void *_darray_extend_from(void *array, const void *values, u64 count);
+
+#define darray_extend_from(array, values, count)                               \
+    array = _darray_extend_from(array, values, count)
+
 void darray_pop(void *array, void *out_value_ptr);
 
 void darray_pop_front(void *array, void *out_value_ptr);
@@ -51,14 +122,16 @@ void *_darray_append(void *dst_array, const void *src_array);
 
 void darray_clear(void *array);
 
-u64 darray_length(const void *array);
+static inline u64 darray_length(const void *array) { return _darray_header(array)->length; }
+
+static inline void darray_length_set(void *array, u64 length) { _darray_header(array)->length = length; }
 
-void darray_length_set(void *array, u64 length);
+static inline u64 darray_stride(const void *array) { return _darray_header(array)->stride; }
 
-u64 darray_stride(const void *array);
+static inline u64 darray_size(const void *array) { return darray_length(array) * darray_stride(array); }
 
-u64 darray_size(const void *array);
+static inline u64 darray_capacity(const void *array) { return _darray_header(array)->capacity; }
 
-u64 darray_capacity(const void *array);
+static inline Allocator *darray_allocator(const void *array) { return _darray_header(array)->allocator; }
 
 #endif // CORE_DARRAY_H
@@ -2,85 +2,323 @@
 #include "core/assert.h"
 #include "core/defines.h"
 
+#include <stdlib.h>
 #include <string.h>
 
-u64 hash_string(const void *key, u32 element_count) {
-    static const u64 multiplier = 97;
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
 
-    const char *string = key;
+// Full slots hold the low 7 bits of their key's hash, so their top bit is 0
+#define CONTROL_EMPTY 0x80
+#define CONTROL_DELETED 0xFE
+#define NOT_FOUND ((u32)-1)
 
-    unsigned const char *us;
-    u64 hash = 0;
+#define PRIME64_1 0x9E3779B185EBCA87ull
+#define PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define PRIME64_3 0x165667B19E3779F9ull
+#define PRIME64_4 0x85EBCA77C2B2AE63ull
+#define PRIME64_5 0x27D4EB2F165667C5ull
 
-    for (us = (unsigned const char *)string; *us; us++) {
-        hash = hash * multiplier + *us;
-    }
+static inline u64 rotate_left(u64 value, u32 bits) { return value << bits | value >> (64 - bits); }
+
+static inline u64 read_u64(const void *bytes) {
+    u64 value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static inline u32 read_u32(const void *bytes) {
+    u32 value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+u64 hash_bytes(const void *data, u64 size) {
+    const u8 *bytes = data;
+    u64 hash = PRIME64_5 + size;
 
-    hash %= element_count;
+    for (; size >= 8; size -= 8, bytes += 8) {
+        u64 lane = rotate_left(read_u64(bytes) * PRIME64_2, 31) * PRIME64_1;
+        hash = rotate_left(hash ^ lane, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (size >= 4) {
+        hash = rotate_left(hash ^ (u64)read_u32(bytes) * PRIME64_1, 23) * PRIME64_2 + PRIME64_3;
+        bytes += 4;
+        size -= 4;
+    }
+    for (; size > 0; size--, bytes++) {
+        hash = rotate_left(hash ^ *bytes * PRIME64_5, 11) * PRIME64_1;
+    }
 
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
     return hash;
 }
 
-u64 hash_u64(const void *key, u32 element_count) {
-    const u64 *number = key;
-    return *number % element_count;
+u64 hash_string(const char *string) { return hash_bytes(string, strlen(string)); }
+
+u64 hashtable_hash_string_key(const void *key, u64 key_size) {
+    (void)key_size;
+    return hash_string(*(const char *const *)key);
+}
+
+b8 hashtable_equal_string_key(const void *a, const void *b, u64 key_size) {
+    (void)key_size;
+    return strcmp(*(const char *const *)a, *(const char *const *)b) == 0;
+}
+
+// Bit i is set where control byte i of the group equals `value`
+static inline u32 group_match(const u8 *group, u8 value) {
+#if defined(__SSE2__)
+    __m128i bytes = _mm_loadu_si128((const __m128i *)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)value)));
+#else
+    u32 bits = 0;
+    for (u32 i = 0; i < HASHTABLE_GROUP_WIDTH; i++) {
+        bits |= (u32)(group[i] == value) << i;
+    }
+    return bits;
+#endif
+}
+
+static inline u32 group_match_empty(const u8 *group) { return group_match(group, CONTROL_EMPTY); }
+
+// Empty and deleted control bytes are the ones with the top bit set
+static inline u32 group_match_empty_or_deleted(const u8 *group) {
+#if defined(__SSE2__)
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    u32 bits = 0;
+    for (u32 i = 0; i < HASHTABLE_GROUP_WIDTH; i++) {
+        bits |= (u32)(group[i] >> 7) << i;
+    }
+    return bits;
+#endif
+}
+
+static inline u64 hash_key(const HashTable *table, const void *key) {
+    if (table->hash != NULL) {
+        return table->hash(key, table->key_size);
+    }
+    return table->key_size == sizeof(u64) ? hash_u64(read_u64(key)) : hash_bytes(key, table->key_size);
+}
+
+static inline b8 keys_equal(const HashTable *table, const void *a, const void *b) {
+    if (table->equal != NULL) {
+        return table->equal(a, b, table->key_size);
+    }
+    return table->key_size == sizeof(u64) ? read_u64(a) == read_u64(b) : memcmp(a, b, table->key_size) == 0;
+}
+
+static inline u8 *slot_key(const HashTable *table, u32 slot) { return table->slots + (u64)slot * table->slot_size; }
+
+static inline u8 *slot_value(const HashTable *table, u32 slot) { return slot_key(table, slot) + table->value_offset; }
+
+static inline u32 max_load(u32 capacity) {
+    return (u32)((u64)capacity * HASHTABLE_MAX_LOAD_NUMERATOR / HASHTABLE_MAX_LOAD_DENOMINATOR);
+}
+
+static void set_control(HashTable *table, u32 slot, u8 value) {
+    table->control[slot] = value;
+    // the copy behind the end, for groups loaded near it
+    if (slot < HASHTABLE_GROUP_WIDTH) {
+        table->control[table->capacity + slot] = value;
+    }
 }
 
-void hashtable_new(u64 element_size,
-                   u32 element_count,
-                   void *memory,
-                   b8 is_pointer_type,
-                   hash_function hash_function,
-                   hashtable *out_table) {
-    ASSERT(memory != NULL && out_table != NULL);
-    ASSERT(element_count && element_size);
+static void allocate(HashTable *table, u32 capacity) {
+    table->capacity = capacity;
+    table->control = malloc(capacity + HASHTABLE_GROUP_WIDTH);
+    table->slots = malloc((u64)capacity * table->slot_size);
+    ASSERT(table->control != NULL && table->slots != NULL);
+    memset(table->control, CONTROL_EMPTY, capacity + HASHTABLE_GROUP_WIDTH);
+    table->growth_left = max_load(capacity) - table->count;
+}
 
-    out_table->memory = memory;
-    out_table->element_count = element_count;
-    out_table->element_size = element_size;
-    out_table->is_pointer_type = is_pointer_type;
-    out_table->hash = hash_function;
-    memset(out_table->memory, 0, element_size * element_count);
+/**
+ * Probes groups at growing steps from the hash's home slot. With a power of
+ * two capacity, the steps 1, 2, 3... groups apart visit every group.
+ * @return the slot holding `key`, NOT_FOUND when a group with an empty slot
+ * ended the probe first
+ */
+static u32 find(const HashTable *table, const void *key, u64 hash) {
+    u32 mask = table->capacity - 1;
+    u32 offset = (u32)(hash >> 7) & mask;
+    u8 tag = (u8)(hash & 0x7F);
+    for (u32 step = HASHTABLE_GROUP_WIDTH;; step += HASHTABLE_GROUP_WIDTH) {
+        const u8 *group = table->control + offset;
+        for (u32 bits = group_match(group, tag); bits != 0; bits &= bits - 1) {
+            u32 slot = (offset + (u32)__builtin_ctz(bits)) & mask;
+            if (keys_equal(table, slot_key(table, slot), key)) {
+                return slot;
+            }
+        }
+        if (group_match_empty(group) != 0) {
+            return NOT_FOUND;
+        }
+        offset = (offset + step) & mask;
+    }
 }
 
-void hashtable_destroy(hashtable *table) {
-    if (table) {
-        memset(table, 0, sizeof(hashtable));
+// The first empty or deleted slot on the hash's probe sequence
+static u32 find_free(const HashTable *table, u64 hash) {
+    u32 mask = table->capacity - 1;
+    u32 offset = (u32)(hash >> 7) & mask;
+    for (u32 step = HASHTABLE_GROUP_WIDTH;; step += HASHTABLE_GROUP_WIDTH) {
+        u32 bits = group_match_empty_or_deleted(table->control + offset);
+        if (bits != 0) {
+            return (offset + (u32)__builtin_ctz(bits)) & mask;
+        }
+        offset = (offset + step) & mask;
     }
 }
 
-void hashtable_set(hashtable *table, void *key, void *value) {
-    ASSERT(table != NULL && key != NULL && value != NULL);
-    ASSERT(!table->is_pointer_type);
+// Moves every entry into fresh arrays of `capacity` slots, which drops the
+// tombstones
+static void rehash(HashTable *table, u32 capacity) {
+    HashTable old = *table;
+    allocate(table, capacity);
+
+    for (u32 slot = 0; slot < old.capacity; slot++) {
+        if (old.control[slot] & CONTROL_EMPTY) {
+            continue;
+        }
+
+        const u8 *key = slot_key(&old, slot);
+        u64 hash = hash_key(table, key);
+        u32 target = find_free(table, hash);
+        set_control(table, target, (u8)(hash & 0x7F));
+        memcpy(slot_key(table, target), key, table->slot_size);
+    }
+
+    free(old.control);
+    free(old.slots);
+}
 
-    u64 hash = table->hash(key, table->element_count);
-    memcpy((u8 *)table->memory + (table->element_size * hash),
-           value,
-           table->element_size);
+static u32 capacity_for(u32 count) {
+    u32 capacity = HASHTABLE_MIN_CAPACITY;
+    while (max_load(capacity) < count) {
+        capacity *= 2;
+    }
+    return capacity;
 }
 
-void hashtable_set_ptr(hashtable *table, void *key, void **value) {
-    ASSERT(table != NULL && key != NULL);
-    ASSERT(table->is_pointer_type);
+HashTable hashtable_new(u64 key_size, u64 value_size) { return hashtable_new_with(key_size, value_size, NULL, NULL); }
+
+HashTable hashtable_new_with(u64 key_size, u64 value_size, hash_function hash, key_equal_function equal) {
+    ASSERT(key_size > 0);
+    ASSERT_MSG((hash == NULL) == (equal == NULL), "custom keys need both a hash and an equality function");
 
-    u64 hash = table->hash(key, table->element_count);
-    ((void **)table->memory)[hash] = value ? *value : 0;
+    HashTable table = {
+        .key_size = key_size,
+        .value_size = value_size,
+        .value_offset = (key_size + 7) & ~7ull,
+        .hash = hash,
+        .equal = equal,
+    };
+    table.slot_size = (table.value_offset + value_size + 7) & ~7ull;
+    allocate(&table, HASHTABLE_MIN_CAPACITY);
+    return table;
 }
 
-void hashtable_get(hashtable *table, void *key, void *out_value) {
-    ASSERT(table != NULL && key != NULL && out_value != NULL);
-    ASSERT(!table->is_pointer_type);
+void hashtable_destroy(HashTable *table) {
+    free(table->control);
+    free(table->slots);
+    *table = (HashTable){0};
+}
 
-    u64 hash = table->hash(key, table->element_count);
-    memcpy(out_value,
-           (u8 *)table->memory + (table->element_size * hash),
-           table->element_size);
+void *hashtable_get(const HashTable *table, const void *key) {
+    u32 slot = find(table, key, hash_key(table, key));
+    return slot != NOT_FOUND ? slot_value(table, slot) : NULL;
 }
 
-void hashtable_get_ptr(hashtable *table, void *key, void **out_value) {
-    ASSERT(table != NULL && key != NULL && out_value != NULL);
-    ASSERT(table->is_pointer_type);
+void *hashtable_insert(HashTable *table, const void *key, const void *value) {
+    u64 hash = hash_key(table, key);
+    u32 slot = find(table, key, hash);
+    if (slot != NOT_FOUND) {
+        if (value != NULL) {
+            memcpy(slot_value(table, slot), value, table->value_size);
+        }
+        return slot_value(table, slot);
+    }
+
+    slot = find_free(table, hash);
+    // reusing a tombstone does not take up more of the table
+    if (table->growth_left == 0 && table->control[slot] != CONTROL_DELETED) {
+        // mostly tombstones: clean them up in place of growing
+        u32 capacity = table->count < max_load(table->capacity) / 2 ? table->capacity : table->capacity * 2;
+        rehash(table, capacity);
+        slot = find_free(table, hash);
+    }
+
+    table->growth_left -= table->control[slot] == CONTROL_EMPTY;
+    set_control(table, slot, (u8)(hash & 0x7F));
+    table->count++;
+
+    memcpy(slot_key(table, slot), key, table->key_size);
+    u8 *slot_value_ptr = slot_value(table, slot);
+    if (value != NULL) {
+        memcpy(slot_value_ptr, value, table->value_size);
+    } else {
+        memset(slot_value_ptr, 0, table->value_size);
+    }
+    return slot_value_ptr;
+}
+
+b8 hashtable_remove(HashTable *table, const void *key) {
+    u32 slot = find(table, key, hash_key(table, key));
+    if (slot == NOT_FOUND) {
+        return false;
+    }
+
+    // A probe only moves past a group without empty slots. When no run of
+    // full and deleted slots through this one is a group wide, no probe
+    // went past it and it can be emptied outright.
+    u32 before = (slot - HASHTABLE_GROUP_WIDTH) & (table->capacity - 1);
+    u32 empty_before = group_match_empty(table->control + before);
+    u32 empty_after = group_match_empty(table->control + slot);
+    b8 never_full = empty_before != 0 && empty_after != 0 &&
+                    (u32)__builtin_ctz(empty_after) + (u32)(__builtin_clz(empty_before) - 16) < HASHTABLE_GROUP_WIDTH;
+
+    set_control(table, slot, never_full ? CONTROL_EMPTY : CONTROL_DELETED);
+    table->growth_left += never_full;
+    table->count--;
+    return true;
+}
+
+void hashtable_clear(HashTable *table) {
+    memset(table->control, CONTROL_EMPTY, table->capacity + HASHTABLE_GROUP_WIDTH);
+    table->count = 0;
+    table->growth_left = max_load(table->capacity);
+}
+
+void hashtable_reserve(HashTable *table, u32 count) {
+    u32 capacity = capacity_for(count);
+    if (capacity > table->capacity) {
+        rehash(table, capacity);
+    }
+}
+
+b8 hashtable_next(const HashTable *table, u32 *iterator, void **out_key, void **out_value) {
+    for (u32 slot = *iterator; slot < table->capacity; slot++) {
+        if (table->control[slot] & CONTROL_EMPTY) {
+            continue;
+        }
+
+        *iterator = slot + 1;
+        if (out_key != NULL) {
+            *out_key = slot_key(table, slot);
+        }
+        if (out_value != NULL) {
+            *out_value = slot_value(table, slot);
+        }
+        return true;
+    }
 
-    u64 hash = table->hash(key, table->element_count);
-    out_value = ((void **)table->memory)[hash];
+    *iterator = table->capacity;
+    return false;
 }
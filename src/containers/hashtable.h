@@ -3,31 +3,108 @@
 
 #include "core/defines.h"
 
-typedef u64 (*hash_function)(const void *key, u32 element_count);
+// Slots probed at once, one SSE2 compare
+#define HASHTABLE_GROUP_WIDTH 16
+#define HASHTABLE_MIN_CAPACITY HASHTABLE_GROUP_WIDTH
+// The table grows once 7/8 of its slots hold entries or tombstones
+#define HASHTABLE_MAX_LOAD_NUMERATOR 7
+#define HASHTABLE_MAX_LOAD_DENOMINATOR 8
 
-u64 hash_string(const void *key, u32 element_count);
-u64 hash_u64(const void *key, u32 element_count);
+typedef u64 (*hash_function)(const void *key, u64 key_size);
+typedef b8 (*key_equal_function)(const void *a, const void *b, u64 key_size);
 
+// 64-bit hash of `size` bytes, xxHash64's mixing
+u64 hash_bytes(const void *data, u64 size);
+
+u64 hash_string(const char *string);
+
+// Finalizer of MurmurHash3, for keys that are already well spread integers
+static inline u64 hash_u64(u64 value) {
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDull;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+// hash_function and key_equal_function for `const char *` keys, the table
+// stores the pointers and compares the strings
+u64 hashtable_hash_string_key(const void *key, u64 key_size);
+b8 hashtable_equal_string_key(const void *a, const void *b, u64 key_size);
+
+/**
+ * Open-addressing hash table that stores copies of its keys and values, in
+ * the layout of SwissTable: every slot has a control byte holding 7 bits of
+ * its key's hash, or marking it empty or deleted, and a lookup compares a
+ * group of 16 control bytes at once before touching any key. Removed
+ * entries leave a tombstone only when a probe could have passed over a full
+ * group there.
+ *
+ * Values are 8-byte aligned. Pointers returned by get and insert stay valid
+ * until the next insert or reserve.
+ */
 typedef struct {
-    u64 element_size;
-    u32 element_count;
-    b8 is_pointer_type;
+    u64 key_size;
+    u64 value_size;
+    // a key, padded to 8 bytes, then its value
+    u64 slot_size;
+    u64 value_offset;
+    // power of two, at least HASHTABLE_MIN_CAPACITY
+    u32 capacity;
+    u32 count;
+    // inserts into empty slots left before the table has to grow
+    u32 growth_left;
+    // `capacity` control bytes, then the first HASHTABLE_GROUP_WIDTH again,
+    // so a group can be loaded at any slot
+    u8 *control;
+    u8 *slots;
+    // NULL hashes and compares keys byte-wise
     hash_function hash;
-    void *memory;
-} hashtable;
-
-void hashtable_new(u64 element_size,
-                   u32 element_count,
-                   void *memory,
-                   b8 is_pointer_type,
-                   hash_function hash_function,
-                   hashtable *out_table);
-
-void hashtable_destroy(hashtable *table);
-
-void hashtable_set(hashtable *table, void *key, void *value);
-void hashtable_set_ptr(hashtable *table, void *key, void **value);
-void hashtable_get(hashtable *table, void *key, void *out_value);
-void hashtable_get_ptr(hashtable *table, void *key, void **out_value);
+    key_equal_function equal;
+} HashTable;
+
+/**
+ * Hashes and compares keys byte-wise, so keys must not contain padding.
+ */
+HashTable hashtable_new(u64 key_size, u64 value_size);
+
+HashTable hashtable_new_with(u64 key_size, u64 value_size, hash_function hash, key_equal_function equal);
+
+void hashtable_destroy(HashTable *table);
+
+/**
+ * @return the key's value, NULL when the table does not contain the key
+ */
+void *hashtable_get(const HashTable *table, const void *key);
+
+/**
+ * Copies `value` over the key's value, adding the key when the table does
+ * not contain it. A NULL `value` leaves a new key's value zeroed and an
+ * existing one unchanged.
+ * @return the key's value
+ */
+void *hashtable_insert(HashTable *table, const void *key, const void *value);
+
+/**
+ * @return false when the table did not contain the key
+ */
+b8 hashtable_remove(HashTable *table, const void *key);
+
+void hashtable_clear(HashTable *table);
+
+/**
+ * Grows the table so `count` entries fit without growing again.
+ */
+void hashtable_reserve(HashTable *table, u32 count);
+
+/**
+ * Visits every entry, in no particular order. Start with `*iterator` at 0.
+ * The table must not be changed while iterating.
+ * @return false once every entry was visited
+ */
+b8 hashtable_next(const HashTable *table, u32 *iterator, void **out_key, void **out_value);
+
+static inline u32 hashtable_count(const HashTable *table) { return table->count; }
 
 #endif // HASHTABLE_H
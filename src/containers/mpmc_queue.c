@@ -0,0 +1,108 @@
+#include "mpmc_queue.h"
+#include "core/assert.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+// Each cell is its sequence number followed by the element
+typedef struct {
+    atomic u64 sequence;
+} CellHeader;
+
+static u64 round_up_to_power_of_two(u64 value) {
+    u64 result = 2;
+    while (result < value) {
+        result *= 2;
+    }
+    return result;
+}
+
+static CellHeader *cell_at(const MpmcQueue *queue, u64 position) {
+    return (CellHeader *)(queue->cells + (position & queue->mask) * queue->cell_size);
+}
+
+MpmcQueue mpmc_queue_new(u64 capacity, u64 element_size) { return mpmc_queue_new_with(capacity, element_size, NULL); }
+
+MpmcQueue mpmc_queue_new_with(u64 capacity, u64 element_size, Allocator *allocator) {
+    ASSERT_MSG(element_size > 0, "mpmc_queue elements must not be empty");
+    capacity = round_up_to_power_of_two(capacity);
+    u64 cell_size = (sizeof(CellHeader) + element_size + sizeof(u64) - 1) & ~(sizeof(u64) - 1);
+
+    MpmcQueue queue = {
+        .cells = allocator_allocate(allocator, capacity * cell_size, CACHE_LINE_SIZE),
+        .mask = capacity - 1,
+        .element_size = element_size,
+        .cell_size = cell_size,
+        .allocator = allocator,
+    };
+    // cell i is free for the push at position i
+    for (u64 i = 0; i < capacity; i++) {
+        atomic_init(&cell_at(&queue, i)->sequence, i);
+    }
+    atomic_init(&queue.push_position, 0);
+    atomic_init(&queue.pop_position, 0);
+    return queue;
+}
+
+void mpmc_queue_destroy(MpmcQueue *queue) {
+    allocator_free(queue->allocator, queue->cells, mpmc_queue_capacity(queue) * queue->cell_size);
+    queue->cells = NULL;
+}
+
+b8 mpmc_queue_try_push(MpmcQueue *queue, const void *element) {
+    u64 position = atomic_load_explicit(&queue->push_position, memory_order_relaxed);
+    CellHeader *cell;
+    for (;;) {
+        cell = cell_at(queue, position);
+        u64 sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        i64 difference = (i64)(sequence - position);
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->push_position,
+                                                      &position,
+                                                      position + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // the cell still holds the element pushed a lap ago
+            return false;
+        } else {
+            // another producer took this position
+            position = atomic_load_explicit(&queue->push_position, memory_order_relaxed);
+        }
+    }
+
+    memcpy(cell + 1, element, queue->element_size);
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+b8 mpmc_queue_try_pop(MpmcQueue *queue, void *out_element) {
+    u64 position = atomic_load_explicit(&queue->pop_position, memory_order_relaxed);
+    CellHeader *cell;
+    for (;;) {
+        cell = cell_at(queue, position);
+        u64 sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        i64 difference = (i64)(sequence - (position + 1));
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->pop_position,
+                                                      &position,
+                                                      position + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // nothing has been pushed at this position yet
+            return false;
+        } else {
+            position = atomic_load_explicit(&queue->pop_position, memory_order_relaxed);
+        }
+    }
+
+    memcpy(out_element, cell + 1, queue->element_size);
+    // free for the push one lap later
+    atomic_store_explicit(&cell->sequence, position + queue->mask + 1, memory_order_release);
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef SE_MPMC_QUEUE_H
+#define SE_MPMC_QUEUE_H
+
+#include "core/allocator/allocator.h"
+#include "core/defines.h"
+
+/**
+ * Bounded lock-free queue of fixed-size elements for any number of
+ * producer and consumer threads, after Dmitry Vyukov's bounded MPMC queue.
+ * Every cell carries a sequence number that tells producers and consumers
+ * whether it is free or holds an element for their position, so a push or
+ * pop costs one compare-and-swap on the position and no locks.
+ *
+ * The positions sit on cache lines of their own, producers and consumers
+ * do not invalidate each other's. Must not be moved while threads use it.
+ */
+typedef struct {
+    u8 *cells;
+    u64 mask;
+    u64 element_size;
+    u64 cell_size;
+    Allocator *allocator;
+
+    _Alignas(CACHE_LINE_SIZE) atomic u64 push_position;
+    _Alignas(CACHE_LINE_SIZE) atomic u64 pop_position;
+} MpmcQueue;
+
+/**
+ * @param capacity rounded up to a power of two, at least 2
+ */
+MpmcQueue mpmc_queue_new(u64 capacity, u64 element_size);
+
+MpmcQueue mpmc_queue_new_with(u64 capacity, u64 element_size, Allocator *allocator);
+
+void mpmc_queue_destroy(MpmcQueue *queue);
+
+/**
+ * Copies `element_size` bytes from `element` into the queue.
+ *
+ * @return false when the queue is full
+ */
+b8 mpmc_queue_try_push(MpmcQueue *queue, const void *element);
+
+/**
+ * Copies the oldest element into `out_element`.
+ *
+ * @return false when the queue is empty
+ */
+b8 mpmc_queue_try_pop(MpmcQueue *queue, void *out_element);
+
+static inline u64 mpmc_queue_capacity(const MpmcQueue *queue) { return queue->mask + 1; }
+
+#endif // SE_MPMC_QUEUE_H
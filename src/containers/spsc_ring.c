@@ -0,0 +1,126 @@
+#include "spsc_ring.h"
+#include "core/assert.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+static u64 round_up_to_power_of_two(u64 value) {
+    u64 result = 1;
+    while (result < value) {
+        result *= 2;
+    }
+    return result;
+}
+
+SpscRing spsc_ring_new(u64 capacity, u64 element_size) { return spsc_ring_new_with(capacity, element_size, NULL); }
+
+SpscRing spsc_ring_new_with(u64 capacity, u64 element_size, Allocator *allocator) {
+    ASSERT_MSG(element_size > 0, "spsc_ring elements must not be empty");
+    capacity = round_up_to_power_of_two(capacity);
+
+    SpscRing ring = {
+        .buffer = allocator_allocate(allocator, capacity * element_size, CACHE_LINE_SIZE),
+        .mask = capacity - 1,
+        .element_size = element_size,
+        .allocator = allocator,
+        .cached_read_position = 0,
+        .cached_write_position = 0,
+    };
+    atomic_init(&ring.write_position, 0);
+    atomic_init(&ring.read_position, 0);
+    return ring;
+}
+
+SpscRing spsc_ring_new_bytes(u64 capacity) { return spsc_ring_new_with(capacity, 1, NULL); }
+
+void spsc_ring_destroy(SpscRing *ring) {
+    allocator_free(ring->allocator, ring->buffer, spsc_ring_capacity(ring) * ring->element_size);
+    ring->buffer = NULL;
+}
+
+b8 spsc_ring_try_push(SpscRing *ring, const void *element) {
+    u64 write_position = atomic_load_explicit(&ring->write_position, memory_order_relaxed);
+    if (write_position - ring->cached_read_position > ring->mask) {
+        ring->cached_read_position = atomic_load_explicit(&ring->read_position, memory_order_acquire);
+        if (write_position - ring->cached_read_position > ring->mask) {
+            return false;
+        }
+    }
+
+    memcpy(ring->buffer + (write_position & ring->mask) * ring->element_size, element, ring->element_size);
+    atomic_store_explicit(&ring->write_position, write_position + 1, memory_order_release);
+    return true;
+}
+
+b8 spsc_ring_try_pop(SpscRing *ring, void *out_element) {
+    u64 read_position = atomic_load_explicit(&ring->read_position, memory_order_relaxed);
+    if (read_position == ring->cached_write_position) {
+        ring->cached_write_position = atomic_load_explicit(&ring->write_position, memory_order_acquire);
+        if (read_position == ring->cached_write_position) {
+            return false;
+        }
+    }
+
+    memcpy(out_element, ring->buffer + (read_position & ring->mask) * ring->element_size, ring->element_size);
+    atomic_store_explicit(&ring->read_position, read_position + 1, memory_order_release);
+    return true;
+}
+
+// Messages may wrap around the end of the buffer, they are copied in up to
+// two pieces
+
+static void copy_in(SpscRing *ring, u64 position, const void *data, u64 size) {
+    u64 offset = position & ring->mask;
+    u64 first = MIN(size, spsc_ring_capacity(ring) - offset);
+    memcpy(ring->buffer + offset, data, first);
+    memcpy(ring->buffer, (const u8 *)data + first, size - first);
+}
+
+static void copy_out(const SpscRing *ring, u64 position, void *data, u64 size) {
+    u64 offset = position & ring->mask;
+    u64 first = MIN(size, spsc_ring_capacity(ring) - offset);
+    memcpy(data, ring->buffer + offset, first);
+    memcpy((u8 *)data + first, ring->buffer, size - first);
+}
+
+b8 spsc_ring_try_write(SpscRing *ring, const void *message, u32 size) {
+    ASSERT_DEBUG(ring->element_size == 1);
+    u64 needed = sizeof(u32) + (u64)size;
+    u64 capacity = spsc_ring_capacity(ring);
+    u64 write_position = atomic_load_explicit(&ring->write_position, memory_order_relaxed);
+    if (capacity - (write_position - ring->cached_read_position) < needed) {
+        ring->cached_read_position = atomic_load_explicit(&ring->read_position, memory_order_acquire);
+        if (capacity - (write_position - ring->cached_read_position) < needed) {
+            return false;
+        }
+    }
+
+    copy_in(ring, write_position, &size, sizeof(u32));
+    copy_in(ring, write_position + sizeof(u32), message, size);
+    atomic_store_explicit(&ring->write_position, write_position + needed, memory_order_release);
+    return true;
+}
+
+b8 spsc_ring_try_read(SpscRing *ring, void *out_message, u32 max_size, u32 *out_size) {
+    ASSERT_DEBUG(ring->element_size == 1);
+    u64 read_position = atomic_load_explicit(&ring->read_position, memory_order_relaxed);
+    if (read_position == ring->cached_write_position) {
+        ring->cached_write_position = atomic_load_explicit(&ring->write_position, memory_order_acquire);
+        if (read_position == ring->cached_write_position) {
+            *out_size = 0;
+            return false;
+        }
+    }
+
+    // the producer publishes a message with its length, so a visible length
+    // means the whole message is there
+    u32 size;
+    copy_out(ring, read_position, &size, sizeof(u32));
+    *out_size = size;
+    if (size > max_size) {
+        return false;
+    }
+    copy_out(ring, read_position + sizeof(u32), out_message, size);
+    atomic_store_explicit(&ring->read_position, read_position + sizeof(u32) + size, memory_order_release);
+    return true;
+}
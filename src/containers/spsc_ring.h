@@ -0,0 +1,82 @@
+#ifndef SE_SPSC_RING_H
+#define SE_SPSC_RING_H
+
+#include "core/allocator/allocator.h"
+#include "core/defines.h"
+
+/**
+ * Bounded wait-free ring buffer between exactly one producer thread and one
+ * consumer thread. It holds either fixed-size elements, pushed and popped
+ * one at a time, or variable-length byte messages, each written behind its
+ * u32 length; a ring is used for one or the other, not both.
+ *
+ * Each side keeps its own position and a copy of the other side's on its
+ * own cache line, and only reloads the other side's position when the copy
+ * says the ring is full or empty. Must not be moved while threads use it.
+ */
+typedef struct {
+    u8 *buffer;
+    u64 mask;
+    u64 element_size;
+    Allocator *allocator;
+
+    // written by the producer
+    _Alignas(CACHE_LINE_SIZE) atomic u64 write_position;
+    u64 cached_read_position;
+
+    // written by the consumer
+    _Alignas(CACHE_LINE_SIZE) atomic u64 read_position;
+    u64 cached_write_position;
+} SpscRing;
+
+/**
+ * A ring of `capacity` elements, rounded up to a power of two.
+ */
+SpscRing spsc_ring_new(u64 capacity, u64 element_size);
+
+SpscRing spsc_ring_new_with(u64 capacity, u64 element_size, Allocator *allocator);
+
+/**
+ * A ring for messages, `capacity` bytes rounded up to a power of two. Each
+ * message takes its size plus sizeof(u32).
+ */
+SpscRing spsc_ring_new_bytes(u64 capacity);
+
+void spsc_ring_destroy(SpscRing *ring);
+
+/**
+ * Producer only.
+ *
+ * @return false when the ring is full
+ */
+b8 spsc_ring_try_push(SpscRing *ring, const void *element);
+
+/**
+ * Consumer only.
+ *
+ * @return false when the ring is empty
+ */
+b8 spsc_ring_try_pop(SpscRing *ring, void *out_element);
+
+/**
+ * Producer only, for rings made by spsc_ring_new_bytes.
+ *
+ * @return false when the message does not fit in the free space
+ */
+b8 spsc_ring_try_write(SpscRing *ring, const void *message, u32 size);
+
+/**
+ * Consumer only, for rings made by spsc_ring_new_bytes. Copies the next
+ * message into `out_message`, which holds `max_size` bytes. A message larger
+ * than that stays in the ring and its size is written to `out_size`.
+ *
+ * @return false when the ring is empty or the message does not fit
+ */
+b8 spsc_ring_try_read(SpscRing *ring, void *out_message, u32 max_size, u32 *out_size);
+
+/**
+ * The capacity in elements, or in bytes for message rings.
+ */
+static inline u64 spsc_ring_capacity(const SpscRing *ring) { return ring->mask + 1; }
+
+#endif // SE_SPSC_RING_H
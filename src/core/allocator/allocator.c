@@ -0,0 +1,46 @@
+#include "allocator.h"
+#include "core/assert.h"
+
+#include <stdlib.h>
+
+static u64 round_up(u64 value, u64 alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+static void *heap_allocate(Allocator *allocator, u64 size, u64 alignment) {
+    (void)allocator;
+    // malloc(0) may return NULL, callers expect a pointer they can free
+    size = size == 0 ? 1 : size;
+    void *memory = alignment <= ALLOCATOR_DEFAULT_ALIGNMENT ? malloc(size)
+                                                             : aligned_alloc(alignment, round_up(size, alignment));
+    ASSERT_MSG(memory != NULL, "out of memory");
+    return memory;
+}
+
+static void *heap_reallocate(Allocator *allocator, void *memory, u64 old_size, u64 new_size, u64 alignment) {
+    if (alignment > ALLOCATOR_DEFAULT_ALIGNMENT) {
+        // realloc does not keep larger alignments
+        void *moved = heap_allocate(allocator, new_size, alignment);
+        memcpy(moved, memory, old_size < new_size ? old_size : new_size);
+        free(memory);
+        return moved;
+    }
+
+    void *moved = realloc(memory, new_size == 0 ? 1 : new_size);
+    ASSERT_MSG(moved != NULL, "out of memory");
+    return moved;
+}
+
+static void heap_free(Allocator *allocator, void *memory, u64 size) {
+    (void)allocator;
+    (void)size;
+    free(memory);
+}
+
+static const AllocatorVTable heap_vtable = {
+    .allocate = heap_allocate,
+    .reallocate = heap_reallocate,
+    .free = heap_free,
+};
+
+static Allocator heap = {.vtable = &heap_vtable};
+
+Allocator *allocator_heap(void) { return &heap; }
@@ -0,0 +1,88 @@
+#ifndef SE_ALLOCATOR_H
+#define SE_ALLOCATOR_H
+
+#include "core/defines.h"
+
+#include <string.h>
+
+// What malloc returns on every supported platform, allocators hand out at
+// least this alignment when asked for it
+#define ALLOCATOR_DEFAULT_ALIGNMENT 16
+
+typedef struct Allocator Allocator;
+
+/**
+ * Callers pass the size they allocated or last reallocated the memory with
+ * to `reallocate` and `free`, so allocators do not have to record it.
+ * Alignments are powers of two. `reallocate` may be NULL, the memory is then
+ * moved to a new allocation.
+ */
+typedef struct {
+    void *(*allocate)(Allocator *allocator, u64 size, u64 alignment);
+    void *(*reallocate)(Allocator *allocator, void *memory, u64 old_size, u64 new_size, u64 alignment);
+    void (*free)(Allocator *allocator, void *memory, u64 size);
+} AllocatorVTable;
+
+/**
+ * Every allocator starts with this, so a pointer to the allocator is a
+ * pointer to its Allocator. Functions taking an `Allocator *` treat NULL as
+ * the heap.
+ */
+struct Allocator {
+    const AllocatorVTable *vtable;
+};
+
+/**
+ * malloc, realloc and free, with aligned_alloc for alignments above
+ * ALLOCATOR_DEFAULT_ALIGNMENT.
+ */
+Allocator *allocator_heap(void);
+
+static inline void *allocator_allocate(Allocator *allocator, u64 size, u64 alignment) {
+    if (allocator == NULL) {
+        allocator = allocator_heap();
+    }
+    return allocator->vtable->allocate(allocator, size, alignment);
+}
+
+static inline void allocator_free(Allocator *allocator, void *memory, u64 size) {
+    if (memory == NULL) {
+        return;
+    }
+    if (allocator == NULL) {
+        allocator = allocator_heap();
+    }
+    allocator->vtable->free(allocator, memory, size);
+}
+
+/**
+ * Grows or shrinks the memory, keeping the first min(old_size, new_size)
+ * bytes. A NULL `memory` allocates.
+ */
+static inline void *allocator_reallocate(Allocator *allocator,
+                                         void *memory,
+                                         u64 old_size,
+                                         u64 new_size,
+                                         u64 alignment) {
+    if (allocator == NULL) {
+        allocator = allocator_heap();
+    }
+    if (memory == NULL) {
+        return allocator->vtable->allocate(allocator, new_size, alignment);
+    }
+    if (allocator->vtable->reallocate != NULL) {
+        return allocator->vtable->reallocate(allocator, memory, old_size, new_size, alignment);
+    }
+
+    void *moved = allocator->vtable->allocate(allocator, new_size, alignment);
+    memcpy(moved, memory, old_size < new_size ? old_size : new_size);
+    allocator->vtable->free(allocator, memory, old_size);
+    return moved;
+}
+
+#define allocator_new(allocator, type) (type *)allocator_allocate(allocator, sizeof(type), _Alignof(type))
+
+#define allocator_new_array(allocator, type, count)                                                                    \
+    (type *)allocator_allocate(allocator, sizeof(type) * (count), _Alignof(type))
+
+#endif // SE_ALLOCATOR_H
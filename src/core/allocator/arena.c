@@ -0,0 +1,154 @@
+#include "arena.h"
+#include "core/assert.h"
+
+struct ArenaBlock {
+    ArenaBlock *previous;
+    u64 capacity;
+    u64 used;
+    u64 padding;
+};
+
+STATIC_ASSERT(sizeof(ArenaBlock) % ALLOCATOR_DEFAULT_ALIGNMENT == 0, "arena block data would be misaligned");
+
+static inline u8 *block_data(ArenaBlock *block) { return (u8 *)(block + 1); }
+
+static inline u64 align_up(u64 value, u64 alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+static ArenaBlock *block_new(Arena *arena, u64 capacity) {
+    ArenaBlock *block = allocator_allocate(arena->backing, sizeof(ArenaBlock) + capacity, ALLOCATOR_DEFAULT_ALIGNMENT);
+    block->previous = arena->block;
+    block->capacity = capacity;
+    block->used = 0;
+    arena->block = block;
+    return block;
+}
+
+static void block_release(Arena *arena) {
+    ArenaBlock *block = arena->block;
+    arena->block = block->previous;
+    allocator_free(arena->backing, block, sizeof(ArenaBlock) + block->capacity);
+}
+
+// The offset `size` bytes aligned to `alignment` start at in the block, or
+// past its capacity when they do not fit
+static inline u64 fit(ArenaBlock *block, u64 size, u64 alignment) {
+    u64 address = (u64)block_data(block) + block->used;
+    u64 start = align_up(address, alignment) - (u64)block_data(block);
+    return start + size <= block->capacity ? start : block->capacity + 1;
+}
+
+void *arena_allocate(Arena *arena, u64 size, u64 alignment) {
+    ASSERT_DEBUG((alignment & (alignment - 1)) == 0);
+
+    ArenaBlock *block = arena->block;
+    u64 start = block != NULL ? fit(block, size, alignment) : 0;
+    if (block == NULL || start > block->capacity) {
+        u64 capacity = size + alignment > arena->block_size ? size + alignment : arena->block_size;
+        block = block_new(arena, capacity);
+        start = fit(block, size, alignment);
+    }
+
+    block->used = start + size;
+    return block_data(block) + start;
+}
+
+// Whether `memory` of `size` bytes is the last allocation of the newest block
+static inline b8 is_last(const Arena *arena, const void *memory, u64 size) {
+    return arena->block != NULL && (const u8 *)memory + size == block_data(arena->block) + arena->block->used;
+}
+
+static void *arena_vtable_allocate(Allocator *allocator, u64 size, u64 alignment) {
+    return arena_allocate((Arena *)allocator, size, alignment);
+}
+
+static void *arena_vtable_reallocate(Allocator *allocator, void *memory, u64 old_size, u64 new_size, u64 alignment) {
+    Arena *arena = (Arena *)allocator;
+    if (is_last(arena, memory, old_size)) {
+        u64 start = (u64)((u8 *)memory - block_data(arena->block));
+        if (start + new_size <= arena->block->capacity) {
+            arena->block->used = start + new_size;
+            return memory;
+        }
+    }
+
+    void *moved = arena_allocate(arena, new_size, alignment);
+    memcpy(moved, memory, old_size < new_size ? old_size : new_size);
+    return moved;
+}
+
+static void arena_vtable_free(Allocator *allocator, void *memory, u64 size) {
+    Arena *arena = (Arena *)allocator;
+    if (is_last(arena, memory, size)) {
+        arena->block->used -= size;
+    }
+}
+
+static const AllocatorVTable arena_vtable = {
+    .allocate = arena_vtable_allocate,
+    .reallocate = arena_vtable_reallocate,
+    .free = arena_vtable_free,
+};
+
+Arena arena_new(u64 block_size) { return arena_new_with(block_size, NULL); }
+
+Arena arena_new_with(u64 block_size, Allocator *backing) {
+    ASSERT(block_size > 0);
+    return (Arena){
+        .allocator = {.vtable = &arena_vtable},
+        .backing = backing,
+        .block = NULL,
+        .block_size = block_size,
+    };
+}
+
+void arena_destroy(Arena *arena) {
+    while (arena->block != NULL) {
+        block_release(arena);
+    }
+}
+
+ArenaMark arena_mark(const Arena *arena) {
+    return (ArenaMark){
+        .block = arena->block,
+        .used = arena->block != NULL ? arena->block->used : 0,
+    };
+}
+
+void arena_reset_to(Arena *arena, ArenaMark mark) {
+    while (arena->block != mark.block) {
+        ASSERT_MSG(arena->block != NULL, "mark does not belong to this arena or was already reset past");
+        block_release(arena);
+    }
+    if (arena->block != NULL) {
+        arena->block->used = mark.used;
+    }
+}
+
+void arena_reset(Arena *arena) {
+    if (arena->block == NULL) {
+        return;
+    }
+
+    if (arena->block->previous != NULL) {
+        u64 capacity = arena_capacity(arena);
+        arena_destroy(arena);
+        block_new(arena, capacity);
+    }
+    arena->block->used = 0;
+}
+
+u64 arena_used(const Arena *arena) {
+    u64 used = 0;
+    for (ArenaBlock *block = arena->block; block != NULL; block = block->previous) {
+        used += block->used;
+    }
+    return used;
+}
+
+u64 arena_capacity(const Arena *arena) {
+    u64 capacity = 0;
+    for (ArenaBlock *block = arena->block; block != NULL; block = block->previous) {
+        capacity += block->capacity;
+    }
+    return capacity;
+}
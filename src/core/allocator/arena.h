@@ -0,0 +1,81 @@
+#ifndef SE_ARENA_H
+#define SE_ARENA_H
+
+#include "core/allocator/allocator.h"
+#include "core/defines.h"
+
+typedef struct ArenaBlock ArenaBlock;
+
+/**
+ * Bump allocator over a chain of blocks. Allocating moves a cursor through
+ * the newest block and takes a new block once it is full, everything is
+ * released at once by a reset or by destroying the arena. Freeing or
+ * reallocating the most recent allocation works in place, freeing anything
+ * else keeps the memory until the next reset.
+ *
+ * The arena holds no pointers to itself, so it can be moved while no
+ * `Allocator *` to it is in use.
+ */
+typedef struct {
+    Allocator allocator;
+    // where blocks come from, NULL for the heap
+    Allocator *backing;
+    // the newest block, each links to the one before it
+    ArenaBlock *block;
+    u64 block_size;
+} Arena;
+
+/**
+ * The state of an arena at some point, arena_reset_to releases everything
+ * allocated after it.
+ */
+typedef struct {
+    ArenaBlock *block;
+    u64 used;
+} ArenaMark;
+
+/**
+ * Blocks are allocated on first use and are `block_size` bytes unless an
+ * allocation needs more.
+ */
+Arena arena_new(u64 block_size);
+
+Arena arena_new_with(u64 block_size, Allocator *backing);
+
+void arena_destroy(Arena *arena);
+
+void *arena_allocate(Arena *arena, u64 size, u64 alignment);
+
+#define arena_push(arena, type) (type *)arena_allocate(arena, sizeof(type), _Alignof(type))
+
+#define arena_push_array(arena, type, count) (type *)arena_allocate(arena, sizeof(type) * (count), _Alignof(type))
+
+ArenaMark arena_mark(const Arena *arena);
+
+/**
+ * Releases everything allocated since `mark` was taken, and the blocks
+ * added for it.
+ */
+void arena_reset_to(Arena *arena, ArenaMark mark);
+
+/**
+ * Releases every allocation but keeps the memory. An arena that spilled into
+ * several blocks swaps them for one block as large as all of them, so the
+ * same amount of allocations fits without taking new blocks.
+ */
+void arena_reset(Arena *arena);
+
+/**
+ * @return the bytes handed out since the last reset, alignment padding
+ * included
+ */
+u64 arena_used(const Arena *arena);
+
+/**
+ * @return the bytes of all blocks together
+ */
+u64 arena_capacity(const Arena *arena);
+
+static inline Allocator *arena_allocator(Arena *arena) { return &arena->allocator; }
+
+#endif // SE_ARENA_H
@@ -0,0 +1,22 @@
+#include "frame_allocator.h"
+
+FrameAllocator frame_allocator_new(u64 block_size) { return frame_allocator_new_with(block_size, NULL); }
+
+FrameAllocator frame_allocator_new_with(u64 block_size, Allocator *backing) {
+    FrameAllocator allocator = {.current = 0};
+    for (u32 i = 0; i < FRAME_ALLOCATOR_BUFFER_COUNT; i++) {
+        allocator.arenas[i] = arena_new_with(block_size, backing);
+    }
+    return allocator;
+}
+
+void frame_allocator_destroy(FrameAllocator *allocator) {
+    for (u32 i = 0; i < FRAME_ALLOCATOR_BUFFER_COUNT; i++) {
+        arena_destroy(&allocator->arenas[i]);
+    }
+}
+
+void frame_allocator_begin(FrameAllocator *allocator) {
+    allocator->current = (allocator->current + 1) % FRAME_ALLOCATOR_BUFFER_COUNT;
+    arena_reset(&allocator->arenas[allocator->current]);
+}
@@ -0,0 +1,47 @@
+#ifndef SE_FRAME_ALLOCATOR_H
+#define SE_FRAME_ALLOCATOR_H
+
+#include "core/allocator/arena.h"
+#include "core/defines.h"
+
+#define FRAME_ALLOCATOR_BUFFER_COUNT 2
+
+/**
+ * Linear allocator for data that lives for one frame. It alternates between
+ * two arenas and resets the one it switches to when a frame begins, so
+ * memory allocated during a frame stays valid through the next frame too,
+ * long enough for work recorded in one frame to be read while the next one
+ * is recorded. Nothing is freed individually.
+ *
+ * Like Arena, it can be moved while no `Allocator *` to it is in use.
+ */
+typedef struct {
+    Arena arenas[FRAME_ALLOCATOR_BUFFER_COUNT];
+    u32 current;
+} FrameAllocator;
+
+FrameAllocator frame_allocator_new(u64 block_size);
+
+FrameAllocator frame_allocator_new_with(u64 block_size, Allocator *backing);
+
+void frame_allocator_destroy(FrameAllocator *allocator);
+
+/**
+ * Switches to the other arena and releases what was allocated in it two
+ * frames ago.
+ */
+void frame_allocator_begin(FrameAllocator *allocator);
+
+static inline void *frame_allocator_allocate(FrameAllocator *allocator, u64 size, u64 alignment) {
+    return arena_allocate(&allocator->arenas[allocator->current], size, alignment);
+}
+
+/**
+ * @return the allocator for the current frame, valid until the frame after
+ * the next one begins
+ */
+static inline Allocator *frame_allocator_current(FrameAllocator *allocator) {
+    return arena_allocator(&allocator->arenas[allocator->current]);
+}
+
+#endif // SE_FRAME_ALLOCATOR_H
@@ -0,0 +1,205 @@
+#include "memory_tracker.h"
+#include "core/logging.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    atomic u64 current_bytes;
+    atomic u64 peak_bytes;
+    atomic u64 total_bytes;
+    atomic u64 allocations;
+    atomic u64 reallocations;
+    atomic u64 frees;
+    atomic u64 size_histogram[MEMORY_HISTOGRAM_BUCKETS];
+} TagCounters;
+
+typedef enum {
+    TRACKING_UNKNOWN,
+    TRACKING_ON,
+    TRACKING_OFF,
+} TrackingState;
+
+static TagCounters counters[MEMORY_TAG_COUNT];
+
+static atomic u32 tracking_state = TRACKING_UNKNOWN;
+
+static const char *tag_names[MEMORY_TAG_COUNT] = {
+    [MEMORY_TAG_UNKNOWN] = "unknown",
+    [MEMORY_TAG_DARRAY] = "darray",
+    [MEMORY_TAG_ECS] = "ecs",
+    [MEMORY_TAG_JSON] = "json",
+    [MEMORY_TAG_GLTF] = "gltf",
+    [MEMORY_TAG_TEXTURE] = "texture",
+    [MEMORY_TAG_RENDERER] = "renderer",
+    [MEMORY_TAG_NET] = "net",
+};
+
+const char *memory_tag_name(MemoryTag tag) { return tag < MEMORY_TAG_COUNT ? tag_names[tag] : "invalid"; }
+
+static void dump_at_exit(void) { memory_tracker_dump(); }
+
+// Set and not "0"
+static b8 environment_flag(const char *name) {
+    const char *variable = getenv(name);
+    return variable != NULL && strcmp(variable, "0") != 0;
+}
+
+b8 memory_tracker_enabled(void) {
+    u32 state = atomic_load_explicit(&tracking_state, memory_order_relaxed);
+    if (state != TRACKING_UNKNOWN) {
+        return state == TRACKING_ON;
+    }
+
+    const char *variable = getenv("SE_MEMORY_TRACKING");
+    u32 wanted = variable != NULL && strcmp(variable, "0") == 0 ? TRACKING_OFF : TRACKING_ON;
+    // only the thread that settles the state registers the dump
+    if (atomic_compare_exchange_strong_explicit(&tracking_state,
+                                                &state,
+                                                wanted,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        if (wanted == TRACKING_ON && environment_flag("SE_MEMORY_DUMP")) {
+            atexit(dump_at_exit);
+        }
+        return wanted == TRACKING_ON;
+    }
+    return state == TRACKING_ON;
+}
+
+static u32 histogram_bucket(u64 size) {
+    if (size < 16) {
+        return 0;
+    }
+    u32 bucket = 63 - (u32)__builtin_clzll(size) - 3;
+    return bucket < MEMORY_HISTOGRAM_BUCKETS ? bucket : MEMORY_HISTOGRAM_BUCKETS - 1;
+}
+
+static void add_current(TagCounters *tag, u64 size) {
+    u64 current = atomic_fetch_add_explicit(&tag->current_bytes, size, memory_order_relaxed) + size;
+    u64 peak = atomic_load_explicit(&tag->peak_bytes, memory_order_relaxed);
+    while (current > peak && !atomic_compare_exchange_weak_explicit(&tag->peak_bytes,
+                                                                     &peak,
+                                                                     current,
+                                                                     memory_order_relaxed,
+                                                                     memory_order_relaxed)) {
+    }
+}
+
+void memory_tracker_record_allocate(MemoryTag tag, u64 size) {
+    TagCounters *counter = &counters[tag];
+    add_current(counter, size);
+    atomic_fetch_add_explicit(&counter->total_bytes, size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counter->allocations, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counter->size_histogram[histogram_bucket(size)], 1, memory_order_relaxed);
+}
+
+void memory_tracker_record_reallocate(MemoryTag tag, u64 old_size, u64 new_size) {
+    TagCounters *counter = &counters[tag];
+    if (new_size >= old_size) {
+        add_current(counter, new_size - old_size);
+    } else {
+        atomic_fetch_sub_explicit(&counter->current_bytes, old_size - new_size, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&counter->total_bytes, new_size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counter->reallocations, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counter->size_histogram[histogram_bucket(new_size)], 1, memory_order_relaxed);
+}
+
+void memory_tracker_record_free(MemoryTag tag, u64 size) {
+    TagCounters *counter = &counters[tag];
+    atomic_fetch_sub_explicit(&counter->current_bytes, size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counter->frees, 1, memory_order_relaxed);
+}
+
+static Allocator tracking_allocators[MEMORY_TAG_COUNT];
+
+static MemoryTag allocator_tag(const Allocator *allocator) { return (MemoryTag)(allocator - tracking_allocators); }
+
+static void *tracking_allocate(Allocator *allocator, u64 size, u64 alignment) {
+    memory_tracker_record_allocate(allocator_tag(allocator), size);
+    return allocator_allocate(allocator_heap(), size, alignment);
+}
+
+static void *tracking_reallocate(Allocator *allocator, void *memory, u64 old_size, u64 new_size, u64 alignment) {
+    memory_tracker_record_reallocate(allocator_tag(allocator), old_size, new_size);
+    return allocator_reallocate(allocator_heap(), memory, old_size, new_size, alignment);
+}
+
+static void tracking_free(Allocator *allocator, void *memory, u64 size) {
+    memory_tracker_record_free(allocator_tag(allocator), size);
+    allocator_free(allocator_heap(), memory, size);
+}
+
+static const AllocatorVTable tracking_vtable = {
+    .allocate = tracking_allocate,
+    .reallocate = tracking_reallocate,
+    .free = tracking_free,
+};
+
+static Allocator tracking_allocators[MEMORY_TAG_COUNT] = {
+    [MEMORY_TAG_UNKNOWN] = {&tracking_vtable},
+    [MEMORY_TAG_DARRAY] = {&tracking_vtable},
+    [MEMORY_TAG_ECS] = {&tracking_vtable},
+    [MEMORY_TAG_JSON] = {&tracking_vtable},
+    [MEMORY_TAG_GLTF] = {&tracking_vtable},
+    [MEMORY_TAG_TEXTURE] = {&tracking_vtable},
+    [MEMORY_TAG_RENDERER] = {&tracking_vtable},
+    [MEMORY_TAG_NET] = {&tracking_vtable},
+};
+
+STATIC_ASSERT(MEMORY_TAG_COUNT == 8, "every tag needs a tracking allocator and a name");
+
+Allocator *memory_tracker_allocator(MemoryTag tag) { return &tracking_allocators[tag]; }
+
+MemoryStats memory_tracker_stats(MemoryTag tag) {
+    TagCounters *counter = &counters[tag];
+    MemoryStats stats = {
+        .current_bytes = atomic_load_explicit(&counter->current_bytes, memory_order_relaxed),
+        .peak_bytes = atomic_load_explicit(&counter->peak_bytes, memory_order_relaxed),
+        .total_bytes = atomic_load_explicit(&counter->total_bytes, memory_order_relaxed),
+        .allocations = atomic_load_explicit(&counter->allocations, memory_order_relaxed),
+        .reallocations = atomic_load_explicit(&counter->reallocations, memory_order_relaxed),
+        .frees = atomic_load_explicit(&counter->frees, memory_order_relaxed),
+    };
+    for (u32 i = 0; i < MEMORY_HISTOGRAM_BUCKETS; i++) {
+        stats.size_histogram[i] = atomic_load_explicit(&counter->size_histogram[i], memory_order_relaxed);
+    }
+    return stats;
+}
+
+void memory_tracker_dump(void) {
+    LOG_INFO("memory by tag:");
+    for (u32 tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+        MemoryStats stats = memory_tracker_stats(tag);
+        if (stats.allocations == 0) {
+            continue;
+        }
+        LOG_INFO("%-8s current %llu B, peak %llu B, total %llu B, %llu allocations, %llu reallocations, %llu frees",
+                 memory_tag_name(tag),
+                 stats.current_bytes,
+                 stats.peak_bytes,
+                 stats.total_bytes,
+                 stats.allocations,
+                 stats.reallocations,
+                 stats.frees);
+
+        char histogram[MEMORY_HISTOGRAM_BUCKETS * 32] = "";
+        u64 length = 0;
+        for (u32 i = 0; i < MEMORY_HISTOGRAM_BUCKETS; i++) {
+            if (stats.size_histogram[i] == 0) {
+                continue;
+            }
+            // each bucket is labelled with its lower bound
+            u64 lower_bound = i == 0 ? 0 : 1ull << (i + 3);
+            length += (u64)snprintf(histogram + length,
+                                    sizeof(histogram) - length,
+                                    " %llu:%llu",
+                                    lower_bound,
+                                    stats.size_histogram[i]);
+        }
+        LOG_INFO("%-8s sizes from (B):count%s", memory_tag_name(tag), histogram);
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef SE_MEMORY_TRACKER_H
+#define SE_MEMORY_TRACKER_H
+
+#include "core/allocator/allocator.h"
+#include "core/defines.h"
+
+// Debug builds track by default, define SE_MEMORY_TRACKING=1 to track in
+// release builds too. Setting the environment variable SE_MEMORY_TRACKING=0
+// turns it off at runtime, SE_MEMORY_DUMP=1 logs memory_tracker_dump at exit.
+#ifndef SE_MEMORY_TRACKING
+    #define SE_MEMORY_TRACKING SE_DEBUG
+#endif
+
+// Bucket 0 counts allocations below 16 bytes, bucket i those in
+// [2^(i + 3), 2^(i + 4)) and the last one everything from 4 MB up
+#define MEMORY_HISTOGRAM_BUCKETS 20
+
+typedef enum {
+    MEMORY_TAG_UNKNOWN,
+    MEMORY_TAG_DARRAY,
+    MEMORY_TAG_ECS,
+    MEMORY_TAG_JSON,
+    MEMORY_TAG_GLTF,
+    MEMORY_TAG_TEXTURE,
+    MEMORY_TAG_RENDERER,
+    MEMORY_TAG_NET,
+    MEMORY_TAG_COUNT,
+} MemoryTag;
+
+typedef struct {
+    u64 current_bytes;
+    u64 peak_bytes;
+    u64 total_bytes;
+    u64 allocations;
+    u64 reallocations;
+    u64 frees;
+    u64 size_histogram[MEMORY_HISTOGRAM_BUCKETS];
+} MemoryStats;
+
+const char *memory_tag_name(MemoryTag tag);
+
+/**
+ * @return false when tracking was turned off through the environment. With
+ * SE_MEMORY_DUMP set the first call registers memory_tracker_dump to run at
+ * exit.
+ */
+b8 memory_tracker_enabled(void);
+
+void memory_tracker_record_allocate(MemoryTag tag, u64 size);
+
+void memory_tracker_record_reallocate(MemoryTag tag, u64 old_size, u64 new_size);
+
+void memory_tracker_record_free(MemoryTag tag, u64 size);
+
+/**
+ * A heap allocator that records everything allocated through it under
+ * `tag`. The allocators are static, one per tag.
+ */
+Allocator *memory_tracker_allocator(MemoryTag tag);
+
+/**
+ * @return a snapshot of the tag's counters, each read on its own while
+ * other threads may still be allocating
+ */
+MemoryStats memory_tracker_stats(MemoryTag tag);
+
+/**
+ * Logs the stats and size histogram of every tag that allocated anything.
+ */
+void memory_tracker_dump(void);
+
+/**
+ * The allocator to hand to code that should be tracked under `tag`: the
+ * tracking allocator while tracking is on, NULL for the plain heap
+ * otherwise.
+ */
+static inline Allocator *memory_tag_allocator(MemoryTag tag) {
+#if SE_MEMORY_TRACKING
+    return memory_tracker_enabled() ? memory_tracker_allocator(tag) : NULL;
+#else
+    (void)tag;
+    return NULL;
+#endif
+}
+
+// For memory allocated outside of an Allocator, such as by a library or a
+// driver
+
+static inline void memory_tag_allocate(MemoryTag tag, u64 size) {
+#if SE_MEMORY_TRACKING
+    if (memory_tracker_enabled()) {
+        memory_tracker_record_allocate(tag, size);
+    }
+#else
+    (void)tag;
+    (void)size;
+#endif
+}
+
+static inline void memory_tag_free(MemoryTag tag, u64 size) {
+#if SE_MEMORY_TRACKING
+    if (memory_tracker_enabled()) {
+        memory_tracker_record_free(tag, size);
+    }
+#else
+    (void)tag;
+    (void)size;
+#endif
+}
+
+#endif // SE_MEMORY_TRACKER_H
@@ -0,0 +1,92 @@
+#include "pool.h"
+#include "core/assert.h"
+
+// The first bytes of a chunk link it to the next one, padded so the blocks
+// behind them keep the chunk's alignment
+#define CHUNK_HEADER_SIZE ALLOCATOR_DEFAULT_ALIGNMENT
+
+static inline u64 chunk_size(const Pool *pool) { return CHUNK_HEADER_SIZE + pool->block_size * pool->blocks_per_chunk; }
+
+void *pool_allocate(Pool *pool) {
+    void *block = pool->free_blocks;
+    if (block != NULL) {
+        pool->free_blocks = *(void **)block;
+    } else {
+        if (pool->chunks == NULL || pool->chunk_used == pool->blocks_per_chunk) {
+            void *chunk = allocator_allocate(pool->backing, chunk_size(pool), ALLOCATOR_DEFAULT_ALIGNMENT);
+            *(void **)chunk = pool->chunks;
+            pool->chunks = chunk;
+            pool->chunk_used = 0;
+        }
+        block = (u8 *)pool->chunks + CHUNK_HEADER_SIZE + pool->block_size * pool->chunk_used;
+        pool->chunk_used++;
+    }
+
+    pool->block_count++;
+    return block;
+}
+
+void pool_free(Pool *pool, void *block) {
+    if (block == NULL) {
+        return;
+    }
+
+    ASSERT_DEBUG(pool->block_count > 0);
+    *(void **)block = pool->free_blocks;
+    pool->free_blocks = block;
+    pool->block_count--;
+}
+
+static void *pool_vtable_allocate(Allocator *allocator, u64 size, u64 alignment) {
+    Pool *pool = (Pool *)allocator;
+    ASSERT_MSG(size <= pool->block_size, "allocation does not fit in a pool block");
+    ASSERT_MSG(alignment <= ALLOCATOR_DEFAULT_ALIGNMENT && pool->block_size % alignment == 0,
+               "pool blocks are not aligned enough");
+    return pool_allocate(pool);
+}
+
+static void *pool_vtable_reallocate(Allocator *allocator, void *memory, u64 old_size, u64 new_size, u64 alignment) {
+    (void)old_size;
+    (void)alignment;
+    ASSERT_MSG(new_size <= ((Pool *)allocator)->block_size, "allocation does not fit in a pool block");
+    return memory;
+}
+
+static void pool_vtable_free(Allocator *allocator, void *memory, u64 size) {
+    (void)size;
+    pool_free((Pool *)allocator, memory);
+}
+
+static const AllocatorVTable pool_vtable = {
+    .allocate = pool_vtable_allocate,
+    .reallocate = pool_vtable_reallocate,
+    .free = pool_vtable_free,
+};
+
+Pool pool_new(u64 block_size, u32 blocks_per_chunk) { return pool_new_with(block_size, blocks_per_chunk, NULL); }
+
+Pool pool_new_with(u64 block_size, u32 blocks_per_chunk, Allocator *backing) {
+    ASSERT(blocks_per_chunk > 0);
+    return (Pool){
+        .allocator = {.vtable = &pool_vtable},
+        .backing = backing,
+        .chunks = NULL,
+        .free_blocks = NULL,
+        .block_size = (block_size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *),
+        .blocks_per_chunk = blocks_per_chunk,
+        .chunk_used = 0,
+        .block_count = 0,
+    };
+}
+
+void pool_destroy(Pool *pool) {
+    void *chunk = pool->chunks;
+    while (chunk != NULL) {
+        void *next = *(void **)chunk;
+        allocator_free(pool->backing, chunk, chunk_size(pool));
+        chunk = next;
+    }
+    pool->chunks = NULL;
+    pool->free_blocks = NULL;
+    pool->block_count = 0;
+}
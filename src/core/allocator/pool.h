@@ -0,0 +1,52 @@
+#ifndef SE_POOL_H
+#define SE_POOL_H
+
+#include "core/allocator/allocator.h"
+#include "core/defines.h"
+
+/**
+ * Hands out blocks of one fixed size, carved from chunks of
+ * `blocks_per_chunk` blocks. Freed blocks go on a free list and are handed
+ * out again before the newest chunk is carved further, chunks are only
+ * released when the pool is destroyed.
+ *
+ * Blocks are aligned to the largest power of two dividing the block size,
+ * up to ALLOCATOR_DEFAULT_ALIGNMENT.
+ */
+typedef struct {
+    Allocator allocator;
+    // where chunks come from, NULL for the heap
+    Allocator *backing;
+    // linked through their first bytes, newest first
+    void *chunks;
+    // linked through their first bytes
+    void *free_blocks;
+    u64 block_size;
+    u32 blocks_per_chunk;
+    // blocks of the newest chunk handed out so far
+    u32 chunk_used;
+    u32 block_count;
+} Pool;
+
+/**
+ * `block_size` is rounded up to hold at least a pointer. The first chunk is
+ * allocated on first use.
+ */
+Pool pool_new(u64 block_size, u32 blocks_per_chunk);
+
+Pool pool_new_with(u64 block_size, u32 blocks_per_chunk, Allocator *backing);
+
+void pool_destroy(Pool *pool);
+
+void *pool_allocate(Pool *pool);
+
+void pool_free(Pool *pool, void *block);
+
+/**
+ * @return the blocks handed out and not freed
+ */
+static inline u32 pool_block_count(const Pool *pool) { return pool->block_count; }
+
+static inline Allocator *pool_allocator(Pool *pool) { return &pool->allocator; }
+
+#endif // SE_POOL_H
@@ -75,6 +75,10 @@ STATIC_ASSERT(sizeof(f64) == 8, "Expected f64 to be 8 byte.");
 
 #define atomic _Atomic
 
+// Fields written by different threads are kept this far apart, so writes to
+// one do not invalidate the cache line holding the other
+#define CACHE_LINE_SIZE 64
+
 typedef _Bool b8;
 typedef unsigned int b32;
 
@@ -0,0 +1,253 @@
+#include "job_pool.h"
+#include "core/assert.h"
+#include "core/defines.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define IDLE_SPIN_COUNT 64
+
+/**
+ * Chase-Lev deque: the owning thread pushes and pops at the bottom, other
+ * threads steal from the top.
+ */
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic i64 top;
+    _Alignas(CACHE_LINE_SIZE) atomic i64 bottom;
+    _Alignas(CACHE_LINE_SIZE) Job jobs[JOB_POOL_DEQUE_CAPACITY];
+} JobDeque;
+
+typedef struct {
+    JobPool *pool;
+    u32 index;
+} Worker;
+
+struct JobPool {
+    JobDeque *deques;
+    Worker *workers;
+    pthread_t *threads;
+    u32 thread_count;
+
+    pthread_mutex_t sleep_mutex;
+    pthread_cond_t wake_condition;
+    atomic u32 sleeping;
+    atomic u32 queued;
+    atomic b8 shutdown;
+};
+
+static _Thread_local u32 current_thread = 0;
+// the pool current_thread indexes, NULL outside of worker threads
+static _Thread_local const JobPool *current_pool = NULL;
+static _Thread_local u32 steal_seed = 0;
+
+static b8 deque_push(JobDeque *deque, Job job) {
+    i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    i64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= JOB_POOL_DEQUE_CAPACITY) {
+        return false;
+    }
+
+    deque->jobs[bottom & (JOB_POOL_DEQUE_CAPACITY - 1)] = job;
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+    return true;
+}
+
+static b8 deque_pop(JobDeque *deque, Job *out_job) {
+    i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    i64 top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return false;
+    }
+
+    *out_job = deque->jobs[bottom & (JOB_POOL_DEQUE_CAPACITY - 1)];
+    if (top != bottom) {
+        return true;
+    }
+
+    // last job, race against thieves for it
+    b8 won = atomic_compare_exchange_strong_explicit(&deque->top,
+                                                     &top,
+                                                     top + 1,
+                                                     memory_order_seq_cst,
+                                                     memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return won;
+}
+
+static b8 deque_steal(JobDeque *deque, Job *out_job) {
+    i64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom) {
+        return false;
+    }
+
+    *out_job = deque->jobs[top & (JOB_POOL_DEQUE_CAPACITY - 1)];
+    return atomic_compare_exchange_strong_explicit(&deque->top,
+                                                   &top,
+                                                   top + 1,
+                                                   memory_order_seq_cst,
+                                                   memory_order_relaxed);
+}
+
+static u32 next_random(void) {
+    // xorshift32
+    u32 x = steal_seed != 0 ? steal_seed : 0x9e3779b9u ^ (current_thread + 1);
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    steal_seed = x;
+    return x;
+}
+
+static b8 find_job(JobPool *pool, Job *out_job) {
+    if (deque_pop(&pool->deques[current_thread], out_job)) {
+        atomic_fetch_sub(&pool->queued, 1);
+        return true;
+    }
+
+    if (pool->thread_count == 1) {
+        return false;
+    }
+
+    u32 start = next_random() % pool->thread_count;
+    for (u32 i = 0; i < pool->thread_count; i++) {
+        u32 victim = (start + i) % pool->thread_count;
+        if (victim != current_thread && deque_steal(&pool->deques[victim], out_job)) {
+            atomic_fetch_sub(&pool->queued, 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void run_job(Job job) {
+    job.fn(job.data);
+    if (job.counter != NULL) {
+        atomic_fetch_sub_explicit(&job.counter->pending, 1, memory_order_release);
+    }
+}
+
+static void *worker_main(void *data) {
+    Worker *worker = data;
+    JobPool *pool = worker->pool;
+    current_thread = worker->index;
+    current_pool = pool;
+
+    u32 idle_spins = 0;
+    while (!atomic_load(&pool->shutdown)) {
+        Job job;
+        if (find_job(pool, &job)) {
+            run_job(job);
+            idle_spins = 0;
+            continue;
+        }
+
+        if (idle_spins++ < IDLE_SPIN_COUNT) {
+            sched_yield();
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->sleep_mutex);
+        atomic_fetch_add(&pool->sleeping, 1);
+        while (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->shutdown)) {
+            pthread_cond_wait(&pool->wake_condition, &pool->sleep_mutex);
+        }
+        atomic_fetch_sub(&pool->sleeping, 1);
+        pthread_mutex_unlock(&pool->sleep_mutex);
+        idle_spins = 0;
+    }
+
+    return NULL;
+}
+
+JobPool *job_pool_new(u32 thread_count) {
+    ASSERT_MSG(thread_count > 0 && thread_count <= JOB_POOL_MAX_THREADS, "invalid job pool thread count");
+
+    JobPool *pool = malloc(sizeof(JobPool));
+    pool->deques = aligned_alloc(CACHE_LINE_SIZE, sizeof(JobDeque) * thread_count);
+    pool->workers = malloc(sizeof(Worker) * thread_count);
+    pool->threads = malloc(sizeof(pthread_t) * thread_count);
+    pool->thread_count = thread_count;
+
+    pthread_mutex_init(&pool->sleep_mutex, NULL);
+    pthread_cond_init(&pool->wake_condition, NULL);
+    atomic_init(&pool->sleeping, 0);
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->shutdown, false);
+
+    for (u32 i = 0; i < thread_count; i++) {
+        atomic_init(&pool->deques[i].top, 0);
+        atomic_init(&pool->deques[i].bottom, 0);
+        pool->workers[i] = (Worker){.pool = pool, .index = i};
+    }
+
+    for (u32 i = 1; i < thread_count; i++) {
+        pthread_create(&pool->threads[i], NULL, worker_main, &pool->workers[i]);
+    }
+
+    return pool;
+}
+
+void job_pool_destroy(JobPool *pool) {
+    pthread_mutex_lock(&pool->sleep_mutex);
+    atomic_store(&pool->shutdown, true);
+    pthread_cond_broadcast(&pool->wake_condition);
+    pthread_mutex_unlock(&pool->sleep_mutex);
+
+    for (u32 i = 1; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->wake_condition);
+    pthread_mutex_destroy(&pool->sleep_mutex);
+    free(pool->threads);
+    free(pool->workers);
+    free(pool->deques);
+    free(pool);
+}
+
+u32 job_pool_thread_count(const JobPool *pool) { return pool->thread_count; }
+
+u32 job_pool_current_thread(void) { return current_thread; }
+
+u32 job_pool_thread_index(const JobPool *pool) { return current_pool == pool ? current_thread : 0; }
+
+void job_pool_submit(JobPool *pool, Job job) {
+    if (job.counter != NULL) {
+        atomic_fetch_add_explicit(&job.counter->pending, 1, memory_order_relaxed);
+    }
+
+    atomic_fetch_add(&pool->queued, 1);
+    if (!deque_push(&pool->deques[current_thread], job)) {
+        // deque is full, run the job right away instead
+        atomic_fetch_sub(&pool->queued, 1);
+        run_job(job);
+        return;
+    }
+
+    if (atomic_load(&pool->sleeping) > 0) {
+        pthread_mutex_lock(&pool->sleep_mutex);
+        pthread_cond_signal(&pool->wake_condition);
+        pthread_mutex_unlock(&pool->sleep_mutex);
+    }
+}
+
+void job_pool_wait(JobPool *pool, JobCounter *counter) {
+    while (atomic_load_explicit(&counter->pending, memory_order_acquire) > 0) {
+        Job job;
+        if (find_job(pool, &job)) {
+            run_job(job);
+        } else {
+            sched_yield();
+        }
+    }
+}
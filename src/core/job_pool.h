@@ -0,0 +1,61 @@
+#ifndef SE_JOB_POOL_H
+#define SE_JOB_POOL_H
+
+#include "core/defines.h"
+
+#define JOB_POOL_MAX_THREADS 64
+#define JOB_POOL_DEQUE_CAPACITY 4096
+
+typedef void (*job_fn)(void *data);
+
+/**
+ * Counts the jobs that still have to finish. Jobs submitted with a counter
+ * increment it on submission and decrement it when done.
+ */
+typedef struct {
+    atomic u32 pending;
+} JobCounter;
+
+typedef struct {
+    job_fn fn;
+    void *data;
+    JobCounter *counter;
+} Job;
+
+typedef struct JobPool JobPool;
+
+/**
+ * Creates a pool of `thread_count` threads, including the calling thread,
+ * which becomes thread 0 and only runs jobs while waiting in job_pool_wait.
+ * Each thread owns a work-stealing deque; idle threads steal from the others.
+ */
+JobPool *job_pool_new(u32 thread_count);
+
+void job_pool_destroy(JobPool *pool);
+
+u32 job_pool_thread_count(const JobPool *pool);
+
+/**
+ * @return the index of the calling thread in its pool, 0 for threads outside
+ * of any pool
+ */
+u32 job_pool_current_thread(void);
+
+/**
+ * @return the index of the calling thread in `pool`, 0 for threads that are
+ * not workers of `pool`, which includes its creating thread
+ */
+u32 job_pool_thread_index(const JobPool *pool);
+
+/**
+ * Pushes the job onto the deque of the calling thread. Must be called from the
+ * thread that created the pool or from inside a job.
+ */
+void job_pool_submit(JobPool *pool, Job job);
+
+/**
+ * Runs and steals jobs until `counter` reaches zero.
+ */
+void job_pool_wait(JobPool *pool, JobCounter *counter);
+
+#endif // SE_JOB_POOL_H
@@ -0,0 +1,233 @@
+#include "archetype.h"
+#include "containers/darray.h"
+#include "core/assert.h"
+#include "core/defines.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static u32 align_up(u32 value, u32 alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+/**
+ * @return the size a chunk needs to hold `capacity` entities, or 0 on overflow
+ */
+static u32 layout_columns(Archetype *archetype, u32 capacity) {
+    u32 offset = ARCHETYPE_CHUNK_ALIGNMENT + capacity * sizeof(entity_index);
+    for (u32 i = 0; i < darray_length(archetype->component_ids); i++) {
+        offset = align_up(offset, ARCHETYPE_CHUNK_ALIGNMENT);
+        if (archetype->column_offsets != NULL) {
+            archetype->column_offsets[i] = offset;
+        }
+        offset += capacity * archetype->component_sizes[i];
+
+        offset = align_up(offset, ARCHETYPE_CHUNK_ALIGNMENT);
+        if (archetype->tick_offsets != NULL) {
+            archetype->tick_offsets[i] = offset;
+        }
+        offset += capacity * 2 * sizeof(u32);
+    }
+    return offset;
+}
+
+Archetype archetype_new(const ComponentMask *mask,
+                        u32 component_count,
+                        const u32 *component_ids,
+                        const u32 *component_sizes,
+                        Allocator *allocator) {
+    Archetype archetype = {
+        .mask = *mask,
+        .component_ids = darray_new_with(u32, allocator),
+        .component_sizes = darray_new_with(u32, allocator),
+        .column_offsets = NULL,
+        .tick_offsets = NULL,
+        .chunks = darray_new_with(ArchetypeChunk *, allocator),
+        .edges = darray_new_with(ArchetypeEdge, allocator),
+        .entity_count = 0,
+        .allocator = allocator,
+    };
+    memset(archetype.column_of, ARCHETYPE_NO_COLUMN, sizeof(archetype.column_of));
+
+    ASSERT_MSG(component_count < ARCHETYPE_NO_COLUMN, "too many components in one archetype");
+
+    u32 row_size = sizeof(entity_index);
+    for (u32 i = 0; i < component_count; i++) {
+        darray_push(archetype.component_ids, component_ids[i]);
+        darray_push(archetype.component_sizes, component_sizes[i]);
+        archetype.column_of[component_ids[i]] = i;
+        // plus the added and changed ticks
+        row_size += component_sizes[i] + 2 * sizeof(u32);
+    }
+
+    u32 padding = ARCHETYPE_CHUNK_ALIGNMENT * (2 * component_count + 1);
+    ASSERT_MSG(row_size + padding <= ARCHETYPE_CHUNK_SIZE, "archetype row does not fit in a chunk");
+
+    u32 capacity = (ARCHETYPE_CHUNK_SIZE - padding) / row_size;
+    while (layout_columns(&archetype, capacity) > ARCHETYPE_CHUNK_SIZE) {
+        capacity--;
+    }
+    archetype.chunk_capacity = capacity;
+
+    archetype.column_offsets = darray_new_with(u32, allocator);
+    archetype.tick_offsets = darray_new_with(u32, allocator);
+    for (u32 i = 0; i < component_count; i++) {
+        darray_push(archetype.column_offsets, 0);
+        darray_push(archetype.tick_offsets, 0);
+    }
+    layout_columns(&archetype, capacity);
+
+    return archetype;
+}
+
+static ArchetypeChunk *chunk_new(Archetype *archetype) {
+    ArchetypeChunk *chunk = allocator_allocate(archetype->allocator, ARCHETYPE_CHUNK_SIZE, ARCHETYPE_CHUNK_ALIGNMENT);
+    chunk->count = 0;
+    return chunk;
+}
+
+static void chunk_free(Archetype *archetype, ArchetypeChunk *chunk) {
+    allocator_free(archetype->allocator, chunk, ARCHETYPE_CHUNK_SIZE);
+}
+
+void archetype_destroy(Archetype *archetype) {
+    for (u32 i = 0; i < darray_length(archetype->chunks); i++) {
+        chunk_free(archetype, archetype->chunks[i]);
+    }
+    darray_destroy(archetype->chunks);
+    darray_destroy(archetype->edges);
+    darray_destroy(archetype->column_offsets);
+    darray_destroy(archetype->tick_offsets);
+    darray_destroy(archetype->component_sizes);
+    darray_destroy(archetype->component_ids);
+}
+
+u32 archetype_push_entity(Archetype *archetype, entity_index entity) {
+    u32 row = archetype->entity_count;
+
+    if (row == darray_length(archetype->chunks) * archetype->chunk_capacity) {
+        darray_push(archetype->chunks, chunk_new(archetype));
+    }
+
+    ArchetypeChunk *chunk = archetype_chunk(archetype, row);
+    archetype_chunk_entities(chunk)[row % archetype->chunk_capacity] = entity;
+    chunk->count++;
+    archetype->entity_count++;
+
+    return row;
+}
+
+u32 archetype_push_entities(Archetype *archetype, entity_index first, u32 count) {
+    u32 first_row = archetype->entity_count;
+    u32 end = first_row + count;
+
+    while (darray_length(archetype->chunks) * archetype->chunk_capacity < end) {
+        darray_push(archetype->chunks, chunk_new(archetype));
+    }
+
+    u32 row = first_row;
+    while (row < end) {
+        ArchetypeChunk *chunk = archetype_chunk(archetype, row);
+        u32 slot = row % archetype->chunk_capacity;
+        u32 n = archetype->chunk_capacity - slot;
+        if (n > end - row) {
+            n = end - row;
+        }
+
+        entity_index *entities = archetype_chunk_entities(chunk) + slot;
+        for (u32 i = 0; i < n; i++) {
+            entities[i] = first + (row - first_row) + i;
+        }
+        chunk->count += n;
+        row += n;
+    }
+
+    archetype->entity_count = end;
+    return first_row;
+}
+
+entity_index archetype_remove_row(Archetype *archetype, u32 row) {
+    ASSERT_DEBUG(row < archetype->entity_count);
+
+    u32 last = archetype->entity_count - 1;
+    ArchetypeChunk *last_chunk = archetype_chunk(archetype, last);
+    u32 last_slot = last % archetype->chunk_capacity;
+
+    entity_index moved = ENTITY_INDEX_INVALID;
+    if (row != last) {
+        ArchetypeChunk *chunk = archetype_chunk(archetype, row);
+        u32 slot = row % archetype->chunk_capacity;
+
+        moved = archetype_chunk_entities(last_chunk)[last_slot];
+        archetype_chunk_entities(chunk)[slot] = moved;
+
+        for (u32 i = 0; i < darray_length(archetype->component_ids); i++) {
+            u32 size = archetype->component_sizes[i];
+            memcpy((u8 *)archetype_chunk_column(archetype, chunk, i) + slot * size,
+                   (u8 *)archetype_chunk_column(archetype, last_chunk, i) + last_slot * size,
+                   size);
+            archetype_chunk_added_ticks(archetype, chunk, i)[slot] =
+                archetype_chunk_added_ticks(archetype, last_chunk, i)[last_slot];
+            archetype_chunk_changed_ticks(archetype, chunk, i)[slot] =
+                archetype_chunk_changed_ticks(archetype, last_chunk, i)[last_slot];
+        }
+    }
+
+    last_chunk->count--;
+    archetype->entity_count--;
+
+    if (last_chunk->count == 0) {
+        darray_pop(archetype->chunks, NULL);
+        chunk_free(archetype, last_chunk);
+    }
+
+    return moved;
+}
+
+u32 archetype_move_row(Archetype *src, u32 row, Archetype *dst, entity_index *out_moved) {
+    const ArchetypeChunk *src_chunk = archetype_chunk(src, row);
+    u32 src_slot = row % src->chunk_capacity;
+    entity_index entity = archetype_chunk_entities(src_chunk)[src_slot];
+
+    u32 dst_row = archetype_push_entity(dst, entity);
+    ArchetypeChunk *dst_chunk = archetype_chunk(dst, dst_row);
+    u32 dst_slot = dst_row % dst->chunk_capacity;
+
+    for (u32 i = 0; i < darray_length(dst->component_ids); i++) {
+        u32 src_column = src->column_of[dst->component_ids[i]];
+        if (src_column == ARCHETYPE_NO_COLUMN) {
+            continue;
+        }
+
+        u32 size = dst->component_sizes[i];
+        memcpy((u8 *)archetype_chunk_column(dst, dst_chunk, i) + dst_slot * size,
+               (u8 *)archetype_chunk_column(src, src_chunk, src_column) + src_slot * size,
+               size);
+        archetype_chunk_added_ticks(dst, dst_chunk, i)[dst_slot] =
+            archetype_chunk_added_ticks(src, src_chunk, src_column)[src_slot];
+        archetype_chunk_changed_ticks(dst, dst_chunk, i)[dst_slot] =
+            archetype_chunk_changed_ticks(src, src_chunk, src_column)[src_slot];
+    }
+
+    entity_index moved = archetype_remove_row(src, row);
+    if (out_moved != NULL) {
+        *out_moved = moved;
+    }
+
+    return dst_row;
+}
+
+void archetype_restore(Archetype *archetype, u32 entity_count, const void *chunks) {
+    u32 chunk_count = (entity_count + archetype->chunk_capacity - 1) / archetype->chunk_capacity;
+    while (darray_length(archetype->chunks) > chunk_count) {
+        ArchetypeChunk *chunk;
+        darray_pop(archetype->chunks, &chunk);
+        chunk_free(archetype, chunk);
+    }
+    while (darray_length(archetype->chunks) < chunk_count) {
+        darray_push(archetype->chunks, chunk_new(archetype));
+    }
+
+    for (u32 i = 0; i < chunk_count; i++) {
+        memcpy(archetype->chunks[i], (const u8 *)chunks + (u64)i * ARCHETYPE_CHUNK_SIZE, ARCHETYPE_CHUNK_SIZE);
+    }
+    archetype->entity_count = entity_count;
+}
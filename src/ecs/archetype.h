@@ -0,0 +1,142 @@
+#ifndef ARCHETYPE_H
+#define ARCHETYPE_H
+
+#include "containers/darray.h"
+#include "ecs/component_mask.h"
+#include "ecs/entity.h"
+
+#define ARCHETYPE_CHUNK_SIZE (16 * 1024)
+#define ARCHETYPE_CHUNK_ALIGNMENT 64
+#define ARCHETYPE_INVALID ((u32)-1)
+#define ARCHETYPE_NO_COLUMN 0xFF
+
+/**
+ * A fixed-size block holding `count` entities of one archetype. The entity ids
+ * and every component column are stored as separate contiguous arrays (SoA) at
+ * the offsets recorded in the owning Archetype. Each column is followed by its
+ * added ticks and then its changed ticks, one u32 per entity.
+ */
+typedef struct {
+    u32 count;
+} ArchetypeChunk;
+
+typedef struct {
+    u32 component_id;
+    u32 add;
+    u32 remove;
+} ArchetypeEdge;
+
+typedef struct {
+    ComponentMask mask;
+    darray(u32) component_ids;
+    darray(u32) component_sizes;
+    darray(u32) column_offsets;
+    darray(u32) tick_offsets;
+    darray(ArchetypeChunk *) chunks;
+    darray(ArchetypeEdge) edges;
+    u8 column_of[ECS_MAX_COMPONENTS];
+    u32 chunk_capacity;
+    u32 entity_count;
+    // backs the chunks and arrays, NULL for the heap
+    Allocator *allocator;
+} Archetype;
+
+/**
+ * @param component_ids sorted ids of the components in this archetype
+ * @param component_sizes size of each component in `component_ids`
+ * @param allocator backs the chunks and arrays, NULL for the heap
+ */
+Archetype archetype_new(const ComponentMask *mask,
+                        u32 component_count,
+                        const u32 *component_ids,
+                        const u32 *component_sizes,
+                        Allocator *allocator);
+
+void archetype_destroy(Archetype *archetype);
+
+/**
+ * Appends an entity with uninitialized component data.
+ * @return the row of the new entity
+ */
+u32 archetype_push_entity(Archetype *archetype, entity_index entity);
+
+/**
+ * Appends the entities [first, first + count) with uninitialized component
+ * data, allocating all chunks they need at once.
+ * @return the row of the first new entity, the others follow it
+ */
+u32 archetype_push_entities(Archetype *archetype, entity_index first, u32 count);
+
+/**
+ * Removes the entity at `row` by moving the last entity of the archetype into
+ * the hole.
+ * @return the entity that now lives at `row`, or ENTITY_INDEX_INVALID when
+ * `row` was the last row
+ */
+entity_index archetype_remove_row(Archetype *archetype, u32 row);
+
+/**
+ * Moves the entity at `row` into `dst`, copying every component both
+ * archetypes share. Components only present in `dst` are left uninitialized.
+ * @param out_moved receives the entity that took the place of the moved one in
+ * `src`, or ENTITY_INDEX_INVALID
+ * @return the row of the entity in `dst`
+ */
+u32 archetype_move_row(Archetype *src, u32 row, Archetype *dst, entity_index *out_moved);
+
+/**
+ * Replaces every entity of the archetype with `entity_count` rows taken from
+ * `chunks`, which holds whole chunks of this archetype back to back.
+ */
+void archetype_restore(Archetype *archetype, u32 entity_count, const void *chunks);
+
+static inline ArchetypeChunk *archetype_chunk(const Archetype *archetype, u32 row) {
+    return archetype->chunks[row / archetype->chunk_capacity];
+}
+
+static inline entity_index *archetype_chunk_entities(const ArchetypeChunk *chunk) {
+    return (entity_index *)((u8 *)chunk + ARCHETYPE_CHUNK_ALIGNMENT);
+}
+
+static inline void *archetype_chunk_column(const Archetype *archetype, const ArchetypeChunk *chunk, u32 column) {
+    return (u8 *)chunk + archetype->column_offsets[column];
+}
+
+static inline u32 *archetype_chunk_added_ticks(const Archetype *archetype, const ArchetypeChunk *chunk, u32 column) {
+    return (u32 *)((u8 *)chunk + archetype->tick_offsets[column]);
+}
+
+static inline u32 *archetype_chunk_changed_ticks(const Archetype *archetype, const ArchetypeChunk *chunk, u32 column) {
+    return archetype_chunk_added_ticks(archetype, chunk, column) + archetype->chunk_capacity;
+}
+
+/**
+ * @return NULL when the archetype does not contain the component
+ */
+static inline void *archetype_get(const Archetype *archetype, u32 row, u32 component_id) {
+    u32 column = archetype->column_of[component_id];
+    if (column == ARCHETYPE_NO_COLUMN) {
+        return NULL;
+    }
+
+    const ArchetypeChunk *chunk = archetype_chunk(archetype, row);
+    return (u8 *)archetype_chunk_column(archetype, chunk, column) +
+           (row % archetype->chunk_capacity) * archetype->component_sizes[column];
+}
+
+/**
+ * @return the added tick of the component at `row`, the changed tick follows
+ * `chunk_capacity` entries later; NULL when the archetype does not contain the
+ * component
+ */
+static inline u32 *archetype_get_ticks(const Archetype *archetype, u32 row, u32 component_id) {
+    u32 column = archetype->column_of[component_id];
+    if (column == ARCHETYPE_NO_COLUMN) {
+        return NULL;
+    }
+
+    return archetype_chunk_added_ticks(archetype, archetype_chunk(archetype, row), column) +
+           row % archetype->chunk_capacity;
+}
+
+#endif // ARCHETYPE_H
@@ -0,0 +1,68 @@
+#include "command_buffer.h"
+#include "containers/darray.h"
+#include "core/assert.h"
+#include "core/defines.h"
+
+#include <string.h>
+
+#define PAYLOAD_ALIGNMENT 16
+
+EcsCommandBuffer ecs_command_buffer_new(void) {
+    return (EcsCommandBuffer){
+        .commands = darray_new(EcsCommand),
+        .payloads = arena_new(ECS_COMMAND_BUFFER_BLOCK_SIZE),
+        .pending_count = 0,
+    };
+}
+
+void ecs_command_buffer_destroy(EcsCommandBuffer *buffer) {
+    arena_destroy(&buffer->payloads);
+    darray_destroy(buffer->commands);
+}
+
+void ecs_command_buffer_clear(EcsCommandBuffer *buffer) {
+    // a buffer that spilled into several blocks keeps one block as large as
+    // all of them, so the next frame of commands fits without taking more
+    arena_reset(&buffer->payloads);
+    darray_clear(buffer->commands);
+    buffer->pending_count = 0;
+}
+
+static void *copy_payload(EcsCommandBuffer *buffer, const void *value_ptr, u64 size) {
+    void *payload = arena_allocate(&buffer->payloads, size, PAYLOAD_ALIGNMENT);
+    memcpy(payload, value_ptr, size);
+    return payload;
+}
+
+entity_id ecs_command_create(EcsCommandBuffer *buffer) {
+    entity_id entity = entity_make(buffer->pending_count++, ECS_COMMAND_PENDING_GENERATION);
+    darray_push(buffer->commands,
+                ((EcsCommand){.kind = ECS_COMMAND_CREATE,
+                              .component = COMPONENT_ID_INVALID,
+                              .entity = entity,
+                              .payload = NULL}));
+    return entity;
+}
+
+void ecs_command_destroy(EcsCommandBuffer *buffer, entity_id entity) {
+    darray_push(buffer->commands,
+                ((EcsCommand){.kind = ECS_COMMAND_DESTROY,
+                              .component = COMPONENT_ID_INVALID,
+                              .entity = entity,
+                              .payload = NULL}));
+}
+
+void ecs_command_attach_by_id(EcsCommandBuffer *buffer,
+                              entity_id entity,
+                              ComponentId component,
+                              const void *value_ptr,
+                              u64 size) {
+    void *payload = copy_payload(buffer, value_ptr, size);
+    darray_push(buffer->commands,
+                ((EcsCommand){.kind = ECS_COMMAND_ATTACH, .component = component, .entity = entity, .payload = payload}));
+}
+
+void ecs_command_detach_by_id(EcsCommandBuffer *buffer, entity_id entity, ComponentId component) {
+    darray_push(buffer->commands,
+                ((EcsCommand){.kind = ECS_COMMAND_DETACH, .component = component, .entity = entity, .payload = NULL}));
+}
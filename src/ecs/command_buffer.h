@@ -0,0 +1,81 @@
+#ifndef ECS_COMMAND_BUFFER_H
+#define ECS_COMMAND_BUFFER_H
+
+#include "containers/darray.h"
+#include "core/allocator/arena.h"
+#include "core/defines.h"
+#include "ecs/component_id.h"
+#include "ecs/entity.h"
+
+#define ECS_COMMAND_BUFFER_BLOCK_SIZE (64 * 1024)
+
+// Generation of the handles returned by ecs_command_create, the entity only
+// exists once the buffer has been applied
+#define ECS_COMMAND_PENDING_GENERATION ((u32)-1)
+
+typedef enum {
+    ECS_COMMAND_CREATE,
+    ECS_COMMAND_ATTACH,
+    ECS_COMMAND_DETACH,
+    ECS_COMMAND_DESTROY,
+} EcsCommandKind;
+
+typedef struct {
+    EcsCommandKind kind;
+    ComponentId component;
+    entity_id entity;
+    // copy of the attached value in the buffer's arena
+    void *payload;
+} EcsCommand;
+
+/**
+ * Records structural changes (create, destroy, attach, detach) so they can be
+ * applied later, when nothing is iterating the world. Component values are
+ * copied into an arena owned by the buffer, in blocks of
+ * ECS_COMMAND_BUFFER_BLOCK_SIZE. A buffer must only be written by one thread
+ * at a time, the world keeps one per job pool thread.
+ */
+typedef struct EcsCommandBuffer {
+    darray(EcsCommand) commands;
+    Arena payloads;
+    u32 pending_count;
+} EcsCommandBuffer;
+
+EcsCommandBuffer ecs_command_buffer_new(void);
+
+void ecs_command_buffer_destroy(EcsCommandBuffer *buffer);
+
+/**
+ * Drops every recorded command, keeping the payload memory for reuse.
+ */
+void ecs_command_buffer_clear(EcsCommandBuffer *buffer);
+
+static inline b8 ecs_command_is_pending(entity_id entity) {
+    return entity_get_generation(entity) == ECS_COMMAND_PENDING_GENERATION;
+}
+
+/**
+ * @return a pending handle that later commands in the same buffer can use, it
+ * is replaced by the real entity when the buffer is applied
+ */
+entity_id ecs_command_create(EcsCommandBuffer *buffer);
+
+void ecs_command_destroy(EcsCommandBuffer *buffer, entity_id entity);
+
+void ecs_command_attach_by_id(EcsCommandBuffer *buffer,
+                              entity_id entity,
+                              ComponentId component,
+                              const void *value_ptr,
+                              u64 size);
+
+void ecs_command_detach_by_id(EcsCommandBuffer *buffer, entity_id entity, ComponentId component);
+
+#define ecs_command_attach(buffer, entity, type, component)                                                            \
+    do {                                                                                                               \
+        type __temporary_value_copy__ = component;                                                                     \
+        ecs_command_attach_by_id(buffer, entity, component_id(type), &__temporary_value_copy__, sizeof(type));         \
+    } while (0)
+
+#define ecs_command_detach(buffer, entity, type) ecs_command_detach_by_id(buffer, entity, component_id(type))
+
+#endif // ECS_COMMAND_BUFFER_H
@@ -0,0 +1,62 @@
+#include "component_id.h"
+#include "core/assert.h"
+#include "core/defines.h"
+#include "ecs/component_mask.h"
+
+#include <pthread.h>
+#include <string.h>
+
+static struct {
+    pthread_mutex_t lock;
+    const char *names[ECS_MAX_COMPONENTS];
+    u64 sizes[ECS_MAX_COMPONENTS];
+    atomic u32 count;
+} registry = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static ComponentId find_locked(const char *name) {
+    for (u32 i = 0; i < registry.count; i++) {
+        if (strcmp(registry.names[i], name) == 0) {
+            return i;
+        }
+    }
+    return COMPONENT_ID_INVALID;
+}
+
+ComponentId component_id_register(const char *name, u64 size) {
+    pthread_mutex_lock(&registry.lock);
+
+    ComponentId id = find_locked(name);
+    if (id == COMPONENT_ID_INVALID) {
+        ASSERT_MSG(registry.count < ECS_MAX_COMPONENTS, "too many component types registered");
+        id = registry.count;
+        registry.names[id] = name;
+        registry.sizes[id] = size;
+        registry.count++;
+    } else {
+        ASSERT_MSG(registry.sizes[id] == size, "component type registered twice with different sizes");
+    }
+
+    pthread_mutex_unlock(&registry.lock);
+    return id;
+}
+
+ComponentId component_id_find(const char *name) {
+    pthread_mutex_lock(&registry.lock);
+    ComponentId id = find_locked(name);
+    pthread_mutex_unlock(&registry.lock);
+    return id;
+}
+
+const char *component_id_name(ComponentId id) {
+    ASSERT_DEBUG(id < registry.count);
+    return registry.names[id];
+}
+
+u64 component_id_size(ComponentId id) {
+    ASSERT_DEBUG(id < registry.count);
+    return registry.sizes[id];
+}
+
+u32 component_id_count(void) { return registry.count; }
@@ -0,0 +1,41 @@
+#ifndef COMPONENT_ID_H
+#define COMPONENT_ID_H
+
+#include "core/defines.h"
+
+typedef u32 ComponentId;
+
+#define COMPONENT_ID_INVALID ((ComponentId)-1)
+
+/**
+ * Interns a component type by name. Ids are dense, start at 0 and are shared
+ * by every world in the process, so two types with the same name must have the
+ * same size.
+ */
+ComponentId component_id_register(const char *name, u64 size);
+
+/**
+ * String lookup for tooling and serialization, not meant for hot paths.
+ * @return COMPONENT_ID_INVALID when no type with this name was registered
+ */
+ComponentId component_id_find(const char *name);
+
+const char *component_id_name(ComponentId id);
+
+u64 component_id_size(ComponentId id);
+
+u32 component_id_count(void);
+
+/**
+ * The id of `type`, looked up once per call site and cached in a static.
+ */
+#define component_id(type)                                                                                             \
+    __extension__({                                                                                                    \
+        static atomic ComponentId __component_id__ = COMPONENT_ID_INVALID;                                             \
+        if (UNLIKELY(__component_id__ == COMPONENT_ID_INVALID)) {                                                      \
+            __component_id__ = component_id_register(#type, sizeof(type));                                             \
+        }                                                                                                              \
+        (ComponentId) __component_id__;                                                                                \
+    })
+
+#endif // COMPONENT_ID_H
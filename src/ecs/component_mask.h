@@ -0,0 +1,66 @@
+#ifndef COMPONENT_MASK_H
+#define COMPONENT_MASK_H
+
+#include "core/defines.h"
+
+#define ECS_MAX_COMPONENTS 256
+
+typedef struct {
+    u64 bits[ECS_MAX_COMPONENTS / 64];
+} ComponentMask;
+
+static inline void component_mask_set(ComponentMask *mask, u32 component) {
+    mask->bits[component / 64] |= 1ull << (component % 64);
+}
+
+static inline void component_mask_clear(ComponentMask *mask, u32 component) {
+    mask->bits[component / 64] &= ~(1ull << (component % 64));
+}
+
+static inline b8 component_mask_has(const ComponentMask *mask, u32 component) {
+    return (mask->bits[component / 64] >> (component % 64)) & 1;
+}
+
+/**
+ * @return true when every component in `subset` is also in `mask`
+ */
+static inline b8 component_mask_contains(const ComponentMask *mask, const ComponentMask *subset) {
+    for (u32 i = 0; i < ARRAY_SIZE(mask->bits); i++) {
+        if ((mask->bits[i] & subset->bits[i]) != subset->bits[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @return true when the masks share a component
+ */
+static inline b8 component_mask_intersects(const ComponentMask *a, const ComponentMask *b) {
+    for (u32 i = 0; i < ARRAY_SIZE(a->bits); i++) {
+        if ((a->bits[i] & b->bits[i]) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline b8 component_mask_equal(const ComponentMask *a, const ComponentMask *b) {
+    for (u32 i = 0; i < ARRAY_SIZE(a->bits); i++) {
+        if (a->bits[i] != b->bits[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline b8 component_mask_is_empty(const ComponentMask *mask) {
+    for (u32 i = 0; i < ARRAY_SIZE(mask->bits); i++) {
+        if (mask->bits[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // COMPONENT_MASK_H
@@ -1,5 +1,5 @@
 #include "ecs/component_store.h"
-#include "containers/darray.h"
+#include "core/allocator/memory_tracker.h"
 #include "core/assert.h"
 #include "core/defines.h"
 #include "ecs/entity.h"
@@ -8,143 +8,205 @@
 #include <string.h>
 #include <unistd.h>
 
-#define DEFAULT_ORDER 5
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// Medians of eight bench_component_store sweeps over 1M shuffled keys, in ns
+// per op for insert, lookup, churn and scan: order 32 390, 245, 402, 29;
+// order 64 321, 229, 376, 27. Orders 128 and 256 were within noise of 64
+// with twice the node size.
+#define DEFAULT_ORDER 64
+#define MIN_ORDER 4
+#define MAX_ORDER 1024
 #define DEFAULT_COMPONENT_ARRAY_CAPACITY 8
 #define COMPONENT_ARRAY_GROWTH_FACTOR 2
+#define NO_INDEX COMPONENT_STORE_INVALID_INDEX
 
+#define NODE_ALIGNMENT 64
+#define NODE_HEADER_SIZE 32
+#define NODES_PER_BLOCK 64
+
+/**
+ * Header of a B+tree node. The node continues with room for `order` keys and
+ * then `order + 1` slots, one more than a node may hold at rest so a full
+ * node can take the new entry before it is split. Leaves store the component
+ * index of each key in their slots, internal nodes store their children.
+ */
 typedef struct node {
-    darray(void *) pointers;
-    darray(entity_id) keys;
     struct node *parent;
     struct node *next;
+    u32 key_count;
     b8 is_leaf;
 } node;
 
-static node *find_leaf(const ComponentStore *store, entity_id key) {
-    if (store->root == NULL) {
-        return NULL;
-    }
+_Static_assert(sizeof(node) <= NODE_HEADER_SIZE, "node header does not fit");
 
-    node *c = store->root;
+static inline entity_index *node_keys(const node *n) { return (entity_index *)((u8 *)n + NODE_HEADER_SIZE); }
 
-    while (!c->is_leaf) {
-        u32 next_index = 0;
-        while (next_index < darray_length(c->keys)) {
-            if (key >= c->keys[next_index]) {
-                next_index++;
-            } else {
-                break;
-            }
-        }
-        c = (node *)c->pointers[next_index];
-    }
+static inline node **node_children(const ComponentStore *store, const node *n) {
+    return (node **)((u8 *)n + store->node_pool.slots_offset);
+}
 
-    return c;
+static inline u32 *node_values(const ComponentStore *store, const node *n) {
+    return (u32 *)((u8 *)n + store->node_pool.slots_offset);
 }
 
-u32 find_range(const ComponentStore *store,
-               entity_id key_start,
-               entity_id key_end,
-               entity_id *returned_keys,
-               void **returned_pointers) {
-    node *n = find_leaf(store, key_start);
-    if (n == NULL) {
-        return 0;
-    }
+static u32 align_up(u32 value, u32 alignment) { return (value + alignment - 1) / alignment * alignment; }
 
-    u32 i;
-    for (i = 0; i < darray_length(n->keys) && n->keys[i] < key_start; i++) {
-    }
-    if (i == darray_length(n->keys)) {
-        return 0;
-    }
+static void node_pool_init(ComponentStoreNodePool *pool, u32 order) {
+    u32 slots_offset = align_up(NODE_HEADER_SIZE + order * sizeof(entity_index), sizeof(node *));
+    *pool = (ComponentStoreNodePool){
+        .blocks = NULL,
+        .free_nodes = NULL,
+        .node_size = align_up(slots_offset + (order + 1) * sizeof(node *), NODE_ALIGNMENT),
+        .slots_offset = slots_offset,
+        .block_used = NODES_PER_BLOCK,
+    };
+}
 
-    u32 num_found = 0;
-    while (n != NULL) {
-        for (; i < darray_length(n) && n->keys[i] <= key_end; i++) {
-            returned_keys[num_found] = n->keys[i];
-            returned_pointers[num_found] = n->pointers[i];
-            num_found++;
-        }
+static inline u64 node_block_size(const ComponentStoreNodePool *pool) {
+    return NODE_ALIGNMENT + (u64)pool->node_size * NODES_PER_BLOCK;
+}
 
-        n = n->pointers[store->order - 1];
-        i = 0;
+static void node_pool_destroy(ComponentStore *store) {
+    ComponentStoreNodePool *pool = &store->node_pool;
+    void *block = pool->blocks;
+    while (block != NULL) {
+        void *next = *(void **)block;
+        allocator_free(store->allocator, block, node_block_size(pool));
+        block = next;
     }
-
-    return num_found;
+    pool->blocks = NULL;
+    pool->free_nodes = NULL;
 }
 
-static node *make_node(void) {
-    node *new_node = malloc(sizeof(node));
-    new_node->keys = darray_new(entity_id);
-    new_node->pointers = darray_new(void *);
-    new_node->is_leaf = false;
+static node *make_node(ComponentStore *store) {
+    ComponentStoreNodePool *pool = &store->node_pool;
+
+    node *new_node = pool->free_nodes;
+    if (new_node != NULL) {
+        pool->free_nodes = new_node->next;
+    } else {
+        if (pool->block_used == NODES_PER_BLOCK) {
+            // the first cache line links the blocks together
+            void *block = allocator_allocate(store->allocator, node_block_size(pool), NODE_ALIGNMENT);
+            *(void **)block = pool->blocks;
+            pool->blocks = block;
+            pool->block_used = 0;
+        }
+        new_node = (node *)((u8 *)pool->blocks + NODE_ALIGNMENT + (u64)pool->node_size * pool->block_used);
+        pool->block_used++;
+    }
+
     new_node->parent = NULL;
     new_node->next = NULL;
+    new_node->key_count = 0;
+    new_node->is_leaf = false;
     return new_node;
 }
 
-static node *make_leaf(void) {
-    node *leaf = make_node();
+static node *make_leaf(ComponentStore *store) {
+    node *leaf = make_node(store);
     leaf->is_leaf = true;
     return leaf;
 }
 
-static void node_destroy(node *node) {
-    darray_destroy(node->keys);
-    darray_destroy(node->pointers);
-    free(node);
+static void node_destroy(ComponentStore *store, node *n) {
+    n->next = store->node_pool.free_nodes;
+    store->node_pool.free_nodes = n;
 }
 
-static u32 get_left_index(node *parent, node *left) {
-    u32 left_index = 0;
-    while (left_index <= darray_length(parent->keys) &&
-           parent->pointers[left_index] != left) {
-        left_index++;
+/**
+ * @return the number of keys smaller than `key`, the position of `key` in
+ * the sorted array
+ */
+static u32 count_less(const entity_index *keys, u32 count, entity_index key) {
+    u32 i = 0;
+#if defined(__SSE2__)
+    // SSE2 only compares signed integers, flipping the sign bit keeps the
+    // unsigned order
+    const __m128i bias = _mm_set1_epi32(INT32_MIN);
+    const __m128i needle = _mm_xor_si128(_mm_set1_epi32((i32)key), bias);
+    for (; i + 4 <= count; i += 4) {
+        __m128i chunk = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(keys + i)), bias);
+        u32 less = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(needle, chunk)));
+        if (less != 0xF) {
+            // the keys are sorted, so the smaller ones are a prefix
+            return i + __builtin_ctz(~less);
+        }
     }
-    return left_index;
-}
-
-static void insert_into_leaf(node *leaf, entity_id key, void *value) {
-    u32 insertion_point = 0;
-    while (insertion_point < darray_length(leaf->keys) &&
-           leaf->keys[insertion_point] < key) {
-        insertion_point++;
+#endif
+    while (i < count && keys[i] < key) {
+        i++;
     }
-
-    darray_insert_at(leaf->keys, insertion_point, key);
-    darray_insert_at(leaf->pointers, insertion_point, value);
+    return i;
 }
 
 /**
- * @return NULL when nothing is found
+ * @return the number of keys smaller than or equal to `key`, the child of an
+ * internal node to descend into
  */
-static void *find(const ComponentStore *store, entity_id key, node **leaf_out) {
-    if (store->root == NULL) {
-        if (leaf_out != NULL) {
-            *leaf_out = NULL;
+static u32 count_less_equal(const entity_index *keys, u32 count, entity_index key) {
+    u32 i = 0;
+#if defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi32(INT32_MIN);
+    const __m128i needle = _mm_xor_si128(_mm_set1_epi32((i32)key), bias);
+    for (; i + 4 <= count; i += 4) {
+        __m128i chunk = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(keys + i)), bias);
+        u32 greater = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(chunk, needle)));
+        if (greater != 0) {
+            return i + __builtin_ctz(greater);
         }
+    }
+#endif
+    while (i < count && keys[i] <= key) {
+        i++;
+    }
+    return i;
+}
+
+static node *find_leaf(const ComponentStore *store, entity_index key) {
+    node *c = store->root;
+    if (c == NULL) {
         return NULL;
     }
 
-    node *leaf = find_leaf(store, key);
+    while (!c->is_leaf) {
+        c = node_children(store, c)[count_less_equal(node_keys(c), c->key_count, key)];
+    }
 
-    i32 found_index = -1;
-    for (u32 i = 0; i < darray_length(leaf->keys); i++) {
-        if (leaf->keys[i] == key) {
-            found_index = i;
-            break;
-        }
+    return c;
+}
+
+/**
+ * @return the position of `key` in `leaf`, or -1 when it is not there
+ */
+static i32 find_in_leaf(const node *leaf, entity_index key) {
+    u32 position = count_less(node_keys(leaf), leaf->key_count, key);
+    if (position < leaf->key_count && node_keys(leaf)[position] == key) {
+        return position;
     }
+    return -1;
+}
+
+/**
+ * @return the component index of `key`, NO_INDEX when nothing is found
+ */
+static u32 find(const ComponentStore *store, entity_index key, node **leaf_out, i32 *position_out) {
+    node *leaf = find_leaf(store, key);
+    i32 position = leaf != NULL ? find_in_leaf(leaf, key) : -1;
 
     if (leaf_out != NULL) {
         *leaf_out = leaf;
     }
-    if (found_index == -1) {
-        return NULL;
-    } else {
-        return leaf->pointers[found_index];
+    if (position_out != NULL) {
+        *position_out = position;
     }
+    if (position == -1) {
+        return NO_INDEX;
+    }
+    return node_values(store, leaf)[position];
 }
 
 static u32 cut(u32 length) {
@@ -155,402 +217,862 @@ static u32 cut(u32 length) {
     }
 }
 
-static void insert_into_new_root(ComponentStore *store,
-                                 node *left,
-                                 entity_id key,
-                                 node *right) {
-    node *root = make_node();
-    darray_push(root->keys, key);
-    darray_push(root->pointers, left);
-    darray_push(root->pointers, right);
-    root->parent = NULL;
+static void insert_into_new_root(ComponentStore *store, node *left, entity_index key, node *right) {
+    node *root = make_node(store);
+    node_keys(root)[0] = key;
+    node_children(store, root)[0] = left;
+    node_children(store, root)[1] = right;
+    root->key_count = 1;
     left->parent = root;
     right->parent = root;
     store->root = root;
 }
 
-static void insert_into_node(node *n,
-                             u32 left_index,
-                             entity_id key,
-                             node *right) {
-    darray_insert_at(n->keys, left_index, key);
-    darray_insert_at(n->pointers, left_index + 1, right);
-}
+static void insert_into_parent(ComponentStore *store, node *left, entity_index key, node *right);
+
+/**
+ * Splits an internal node that holds `order` keys, one more than allowed. The
+ * middle key moves up into the parent.
+ */
+static void split_node(ComponentStore *store, node *old_node) {
+    node *new_node = make_node(store);
+    entity_index *keys = node_keys(old_node);
+    node **children = node_children(store, old_node);
 
-static void insert_into_parent(ComponentStore *store,
-                               node *left,
-                               entity_id key,
-                               node *right);
+    u32 split = store->order / 2;
+    entity_index k_prime = keys[split];
 
-static void insert_into_node_after_splitting(ComponentStore *store,
-                                             node *old_node,
-                                             u32 left_index,
-                                             entity_id key,
-                                             node *right) {
-    node *temp_pointers[store->order + 1];
-    entity_id temp_keys[store->order];
+    new_node->key_count = old_node->key_count - split - 1;
+    memcpy(node_keys(new_node), keys + split + 1, sizeof(entity_index) * new_node->key_count);
+    memcpy(node_children(store, new_node), children + split + 1, sizeof(node *) * (new_node->key_count + 1));
+    old_node->key_count = split;
 
-    for (u32 i = 0, j = 0; i < darray_length(old_node->keys) + 1; i++, j++) {
-        if (j == left_index + 1)
-            j++;
-        temp_pointers[j] = old_node->pointers[i];
+    new_node->parent = old_node->parent;
+    for (u32 i = 0; i <= new_node->key_count; i++) {
+        node_children(store, new_node)[i]->parent = new_node;
     }
-    for (u32 i = 0, j = 0; i < darray_length(old_node->keys); i++, j++) {
-        if (j == left_index)
-            j++;
-        temp_keys[j] = old_node->keys[i];
+
+    insert_into_parent(store, old_node, k_prime, new_node);
+}
+
+static void insert_into_parent(ComponentStore *store, node *left, entity_index key, node *right) {
+    node *parent = left->parent;
+
+    if (parent == NULL) {
+        insert_into_new_root(store, left, key, right);
+        return;
     }
 
-    temp_pointers[left_index + 1] = right;
-    temp_keys[left_index] = key;
+    entity_index *keys = node_keys(parent);
+    node **children = node_children(store, parent);
+
+    u32 left_index = 0;
+    while (children[left_index] != left) {
+        left_index++;
+    }
 
-    u32 split = cut(store->order);
-    node *new_node = make_node();
+    memmove(keys + left_index + 1, keys + left_index, sizeof(entity_index) * (parent->key_count - left_index));
+    memmove(children + left_index + 2, children + left_index + 1, sizeof(node *) * (parent->key_count - left_index));
+    keys[left_index] = key;
+    children[left_index + 1] = right;
+    parent->key_count++;
+    right->parent = parent;
 
-    darray_clear(old_node->keys);
-    darray_clear(old_node->pointers);
-    for (u32 i = 0; i < split - 1; i++) {
-        darray_push(old_node->pointers, temp_pointers[i]);
-        darray_push(old_node->keys, temp_keys[i]);
+    if (parent->key_count == store->order) {
+        split_node(store, parent);
     }
-    darray_push(old_node->pointers, temp_pointers[split]);
+}
+
+/**
+ * Splits a leaf that holds `order` keys, one more than allowed. The first key
+ * of the new leaf is copied into the parent.
+ */
+static void split_leaf(ComponentStore *store, node *leaf) {
+    node *new_leaf = make_leaf(store);
+
+    u32 split = store->order / 2;
+    new_leaf->key_count = leaf->key_count - split;
+    memcpy(node_keys(new_leaf), node_keys(leaf) + split, sizeof(entity_index) * new_leaf->key_count);
+    memcpy(node_values(store, new_leaf), node_values(store, leaf) + split, sizeof(u32) * new_leaf->key_count);
+    leaf->key_count = split;
 
-    entity_id k_prime = temp_keys[split - 1];
-    for (u32 i = split + 1; i < store->order; i++) {
-        darray_push(new_node->pointers, temp_pointers[i]);
-        darray_push(new_node->keys, temp_keys[i]);
+    new_leaf->next = leaf->next;
+    leaf->next = new_leaf;
+    new_leaf->parent = leaf->parent;
+
+    insert_into_parent(store, leaf, node_keys(new_leaf)[0], new_leaf);
+}
+
+static void insert_into_leaf(ComponentStore *store, node *leaf, entity_index key, u32 value) {
+    entity_index *keys = node_keys(leaf);
+    u32 *values = node_values(store, leaf);
+
+    u32 insertion_point = count_less(keys, leaf->key_count, key);
+    memmove(keys + insertion_point + 1, keys + insertion_point, sizeof(entity_index) * (leaf->key_count - insertion_point));
+    memmove(values + insertion_point + 1, values + insertion_point, sizeof(u32) * (leaf->key_count - insertion_point));
+    keys[insertion_point] = key;
+    values[insertion_point] = value;
+    leaf->key_count++;
+
+    if (leaf->key_count == store->order) {
+        split_leaf(store, leaf);
     }
-    darray_push(new_node->pointers, temp_pointers[store->order]);
+}
 
-    new_node->parent = old_node->parent;
-    for (u32 i = 0; i <= darray_length(new_node->keys); i++) {
-        node *child = new_node->pointers[i];
-        child->parent = new_node;
+static void btree_insert(ComponentStore *store, entity_index key, u32 value) {
+    if (store->root == NULL) {
+        store->root = make_leaf(store);
     }
 
-    insert_into_parent(store, old_node, k_prime, new_node);
+    insert_into_leaf(store, find_leaf(store, key), key, value);
 }
 
-static void insert_into_parent(ComponentStore *store,
-                               node *left,
-                               entity_id key,
-                               node *right) {
-    node *parent = left->parent;
+/**
+ * Removes the key at `index`. Internal nodes also lose the child to the right
+ * of the key, which is the node that was merged into its left neighbour.
+ */
+static void remove_entry_from_node(ComponentStore *store, node *n, u32 index) {
+    entity_index *keys = node_keys(n);
+    u32 tail = n->key_count - index - 1;
+
+    memmove(keys + index, keys + index + 1, sizeof(entity_index) * tail);
+    if (n->is_leaf) {
+        u32 *values = node_values(store, n);
+        memmove(values + index, values + index + 1, sizeof(u32) * tail);
+    } else {
+        node **children = node_children(store, n);
+        memmove(children + index + 1, children + index + 2, sizeof(node *) * tail);
+    }
+    n->key_count--;
+}
 
-    if (parent == NULL) {
-        insert_into_new_root(store, left, key, right);
+static void adjust_root(ComponentStore *store) {
+    if (store->root->key_count > 0) {
         return;
     }
 
-    u32 left_index = get_left_index(parent, left);
+    node *new_root;
+    if (!store->root->is_leaf) {
+        new_root = node_children(store, store->root)[0];
+        new_root->parent = NULL;
+    } else {
+        new_root = NULL;
+    }
 
-    if (darray_length(parent->keys) < store->order - 1) {
-        insert_into_node(parent, left_index, key, right);
-        return;
+    node_destroy(store, store->root);
+
+    store->root = new_root;
+}
+
+static i32 get_neighbor_index(const ComponentStore *store, node *n) {
+    node **children = node_children(store, n->parent);
+    for (u32 i = 0; i <= n->parent->key_count; i++) {
+        if (children[i] == n) {
+            return (i32)i - 1;
+        }
     }
 
-    insert_into_node_after_splitting(store, parent, left_index, key, right);
+    ASSERT_UNREACHABLE();
 }
 
-static void insert_into_leaf_after_splitting(ComponentStore *store,
-                                             node *leaf,
-                                             entity_id key,
-                                             void *value) {
-    u32 insertion_index = 0;
-    while (insertion_index < store->order - 1 &&
-           leaf->keys[insertion_index] < key) {
-        insertion_index++;
+static void delete_entry(ComponentStore *store, node *n, u32 index);
+
+static void coalesce_nodes(ComponentStore *store, node *n, node *neighbor, i32 neighbor_index, u32 k_prime_index) {
+    // always merge the right node into the left one
+    if (neighbor_index == -1) {
+        node *tmp = n;
+        n = neighbor;
+        neighbor = tmp;
     }
 
-    entity_id temp_keys[store->order];
-    void *temp_pointers[store->order];
+    entity_index *neighbor_keys = node_keys(neighbor);
+    u32 insertion_index = neighbor->key_count;
 
-    for (u32 i = 0, j = 0; i < darray_length(leaf->keys); i++, j++) {
-        if (j == insertion_index) {
-            j++;
+    if (!n->is_leaf) {
+        node **neighbor_children = node_children(store, neighbor);
+        neighbor_keys[insertion_index] = node_keys(n->parent)[k_prime_index];
+        memcpy(neighbor_keys + insertion_index + 1, node_keys(n), sizeof(entity_index) * n->key_count);
+        memcpy(neighbor_children + insertion_index + 1, node_children(store, n), sizeof(node *) * (n->key_count + 1));
+        neighbor->key_count += n->key_count + 1;
+
+        for (u32 i = insertion_index + 1; i <= neighbor->key_count; i++) {
+            neighbor_children[i]->parent = neighbor;
         }
-        temp_keys[j] = leaf->keys[i];
-        temp_pointers[j] = leaf->pointers[i];
+    } else {
+        memcpy(neighbor_keys + insertion_index, node_keys(n), sizeof(entity_index) * n->key_count);
+        memcpy(node_values(store, neighbor) + insertion_index, node_values(store, n), sizeof(u32) * n->key_count);
+        neighbor->key_count += n->key_count;
+        neighbor->next = n->next;
     }
 
-    temp_keys[insertion_index] = key;
-    temp_pointers[insertion_index] = value;
+    delete_entry(store, n->parent, k_prime_index);
+    node_destroy(store, n);
+}
+
+static void redistribute_nodes(ComponentStore *store, node *n, node *neighbor, i32 neighbor_index, u32 k_prime_index) {
+    entity_index *keys = node_keys(n);
+    entity_index *neighbor_keys = node_keys(neighbor);
+    entity_index *parent_keys = node_keys(n->parent);
+
+    if (neighbor_index != -1) {
+        // take the last entry of the left neighbour
+        memmove(keys + 1, keys, sizeof(entity_index) * n->key_count);
+
+        if (!n->is_leaf) {
+            node **children = node_children(store, n);
+            memmove(children + 1, children, sizeof(node *) * (n->key_count + 1));
+            children[0] = node_children(store, neighbor)[neighbor->key_count];
+            children[0]->parent = n;
+            keys[0] = parent_keys[k_prime_index];
+            parent_keys[k_prime_index] = neighbor_keys[neighbor->key_count - 1];
+        } else {
+            u32 *values = node_values(store, n);
+            memmove(values + 1, values, sizeof(u32) * n->key_count);
+            values[0] = node_values(store, neighbor)[neighbor->key_count - 1];
+            keys[0] = neighbor_keys[neighbor->key_count - 1];
+            parent_keys[k_prime_index] = keys[0];
+        }
+    } else {
+        // take the first entry of the right neighbour
+        if (n->is_leaf) {
+            u32 *neighbor_values = node_values(store, neighbor);
+            keys[n->key_count] = neighbor_keys[0];
+            node_values(store, n)[n->key_count] = neighbor_values[0];
+            memmove(neighbor_values, neighbor_values + 1, sizeof(u32) * (neighbor->key_count - 1));
+            memmove(neighbor_keys, neighbor_keys + 1, sizeof(entity_index) * (neighbor->key_count - 1));
+            parent_keys[k_prime_index] = neighbor_keys[0];
+        } else {
+            node **neighbor_children = node_children(store, neighbor);
+            keys[n->key_count] = parent_keys[k_prime_index];
+            node_children(store, n)[n->key_count + 1] = neighbor_children[0];
+            neighbor_children[0]->parent = n;
+            parent_keys[k_prime_index] = neighbor_keys[0];
+            memmove(neighbor_children, neighbor_children + 1, sizeof(node *) * neighbor->key_count);
+            memmove(neighbor_keys, neighbor_keys + 1, sizeof(entity_index) * (neighbor->key_count - 1));
+        }
+    }
 
-    darray_clear(leaf->keys);
-    darray_clear(leaf->pointers);
+    n->key_count++;
+    neighbor->key_count--;
+}
 
-    u32 split = cut(store->order - 1);
+static void delete_entry(ComponentStore *store, node *n, u32 index) {
+    remove_entry_from_node(store, n, index);
 
-    for (u32 i = 0; i < split; i++) {
-        darray_push(leaf->pointers, temp_pointers[i]);
-        darray_push(leaf->keys, temp_keys[i]);
+    if (n == store->root) {
+        adjust_root(store);
+        return;
     }
 
-    node *new_leaf = make_leaf();
+    u32 min_keys = n->is_leaf ? cut(store->order - 1) : cut(store->order) - 1;
 
-    for (u32 i = split; i < store->order; i++) {
-        darray_push(new_leaf->pointers, temp_pointers[i]);
-        darray_push(new_leaf->keys, temp_keys[i]);
+    if (n->key_count >= min_keys) {
+        return;
     }
 
-    new_leaf->next = leaf->next;
-    leaf->next = new_leaf;
+    i32 neighbor_index = get_neighbor_index(store, n);
+    u32 k_prime_index = neighbor_index == -1 ? 0 : neighbor_index;
+    node *neighbor = node_children(store, n->parent)[neighbor_index == -1 ? 1 : neighbor_index];
 
-    new_leaf->parent = leaf->parent;
-    entity_id new_key = new_leaf->keys[0];
+    u32 capacity = n->is_leaf ? store->order : store->order - 1;
 
-    insert_into_parent(store, leaf, new_key, new_leaf);
+    if (neighbor->key_count + n->key_count < capacity) {
+        coalesce_nodes(store, n, neighbor, neighbor_index, k_prime_index);
+    } else {
+        redistribute_nodes(store, n, neighbor, neighbor_index, k_prime_index);
+    }
 }
 
 ComponentStore component_store_new(const char *component_name,
                                    u64 component_size) {
-    return (ComponentStore){
+    return component_store_new_with_backend(component_name, component_size, COMPONENT_STORE_BTREE);
+}
+
+ComponentStore component_store_new_with_backend(const char *component_name,
+                                                u64 component_size,
+                                                ComponentStoreBackend backend) {
+    return component_store_new_with_allocator(component_name,
+                                              component_size,
+                                              backend,
+                                              memory_tag_allocator(MEMORY_TAG_ECS));
+}
+
+static void *array_new(Allocator *allocator, u64 size) {
+    void *array = allocator_allocate(allocator, size, ALLOCATOR_DEFAULT_ALIGNMENT);
+    memset(array, 0, size);
+    return array;
+}
+
+ComponentStore component_store_new_with_allocator(const char *component_name,
+                                                  u64 component_size,
+                                                  ComponentStoreBackend backend,
+                                                  Allocator *allocator) {
+    ComponentStore store = {
+        .backend = backend,
+        .root = NULL,
+        .sparse_pages = NULL,
+        .sparse_page_count = 0,
         .component_name = component_name,
         .order = DEFAULT_ORDER,
-        .component_array =
-            calloc(DEFAULT_COMPONENT_ARRAY_CAPACITY, component_size),
+        .component_array = array_new(allocator, DEFAULT_COMPONENT_ARRAY_CAPACITY * component_size),
+        .entities = array_new(allocator, DEFAULT_COMPONENT_ARRAY_CAPACITY * sizeof(entity_index)),
+        .added_ticks = array_new(allocator, DEFAULT_COMPONENT_ARRAY_CAPACITY * sizeof(u32)),
+        .changed_ticks = array_new(allocator, DEFAULT_COMPONENT_ARRAY_CAPACITY * sizeof(u32)),
+        .change_tick = 0,
         .component_size = component_size,
         .component_capacity = DEFAULT_COMPONENT_ARRAY_CAPACITY,
         .component_count = 0,
-        .free_slots = darray_new(u64),
+        .allocator = allocator,
     };
+    node_pool_init(&store.node_pool, store.order);
+    return store;
 }
 
-static void tree_destroy(node *n) {
-    if (!n->is_leaf) {
-        for (u32 i = 0; i < darray_length(n->pointers); i++) {
-            tree_destroy(n->pointers[i]);
-        }
-    }
+void component_store_set_order(ComponentStore *store, u32 order) {
+    ASSERT_MSG(store->component_count == 0, "the order of a store can only change while it is empty");
+    ASSERT_MSG(order >= MIN_ORDER && order <= MAX_ORDER, "invalid B+tree order");
 
-    node_destroy(n);
+    node_pool_destroy(store);
+    store->root = NULL;
+    store->order = order;
+    node_pool_init(&store->node_pool, order);
 }
 
 void component_store_destroy(ComponentStore *store) {
-    if (store->root != NULL) {
-        tree_destroy(store->root);
+    node_pool_destroy(store);
+    store->root = NULL;
+    for (u32 i = 0; i < store->sparse_page_count; i++) {
+        allocator_free(store->allocator, store->sparse_pages[i], sizeof(u32) * COMPONENT_STORE_PAGE_SIZE);
     }
-    free(store->component_array);
-    darray_destroy(store->free_slots);
+    allocator_free(store->allocator, store->sparse_pages, sizeof(u32 *) * store->sparse_page_count);
+
+    u64 capacity = store->component_capacity;
+    allocator_free(store->allocator, store->component_array, capacity * store->component_size);
+    allocator_free(store->allocator, store->entities, capacity * sizeof(entity_index));
+    allocator_free(store->allocator, store->added_ticks, capacity * sizeof(u32));
+    allocator_free(store->allocator, store->changed_ticks, capacity * sizeof(u32));
 }
 
-static void start_new_tree(ComponentStore *store, entity_id key, void *value) {
-    node *root = make_leaf();
+static void *array_grow(const ComponentStore *store, void *array, u64 element_size, u32 old_capacity) {
+    return allocator_reallocate(store->allocator,
+                                array,
+                                (u64)old_capacity * element_size,
+                                (u64)store->component_capacity * element_size,
+                                ALLOCATOR_DEFAULT_ALIGNMENT);
+}
 
-    darray_push(root->keys, key);
-    darray_push(root->pointers, value);
+static void reserve_components(ComponentStore *store, u32 capacity) {
+    if (capacity <= store->component_capacity) {
+        return;
+    }
 
-    store->root = root;
+    u32 old_capacity = store->component_capacity;
+    while (store->component_capacity < capacity) {
+        store->component_capacity *= COMPONENT_ARRAY_GROWTH_FACTOR;
+    }
+    store->component_array = array_grow(store, store->component_array, store->component_size, old_capacity);
+    store->entities = array_grow(store, store->entities, sizeof(entity_index), old_capacity);
+    store->added_ticks = array_grow(store, store->added_ticks, sizeof(u32), old_capacity);
+    store->changed_ticks = array_grow(store, store->changed_ticks, sizeof(u32), old_capacity);
 }
 
-void component_store_insert(ComponentStore *store,
-                            entity_id key,
-                            const void *value_ptr) {
-    void *component_pointer = find(store, key, NULL);
-    if (component_pointer != NULL) {
-        memcpy(component_pointer, value_ptr, store->component_size);
-        return;
+/**
+ * Appends a component to the dense arrays, growing them when needed.
+ * @return the index of the new component
+ */
+static u32 push_component(ComponentStore *store, entity_index key, const void *value_ptr) {
+    reserve_components(store, store->component_count + 1);
+    u32 component_index = store->component_count;
+    store->component_count++;
+
+    memcpy(component_store_at(store, component_index), value_ptr, store->component_size);
+    store->entities[component_index] = key;
+    store->added_ticks[component_index] = store->change_tick;
+    store->changed_ticks[component_index] = store->change_tick;
+
+    return component_index;
+}
+
+/**
+ * Moves the last component into the hole left at `component_index`.
+ * @return the entity of the moved component, ENTITY_INDEX_INVALID when the
+ * removed component was the last one
+ */
+static entity_index pop_component(ComponentStore *store, u32 component_index) {
+    u32 last = store->component_count - 1;
+    store->component_count--;
+    if (component_index == last) {
+        return ENTITY_INDEX_INVALID;
     }
 
-    u64 component_index;
-    if (darray_length(store->free_slots) > 0) {
-        darray_pop(store->free_slots, &component_index);
-    } else {
-        if (store->component_count >= store->component_capacity) {
-            store->component_capacity *= COMPONENT_ARRAY_GROWTH_FACTOR;
-            store->component_array =
-                realloc(store->component_array,
-                        store->component_capacity * store->component_size);
+    entity_index moved = store->entities[last];
+    memcpy(component_store_at(store, component_index), component_store_at(store, last), store->component_size);
+    store->entities[component_index] = moved;
+    store->added_ticks[component_index] = store->added_ticks[last];
+    store->changed_ticks[component_index] = store->changed_ticks[last];
+    return moved;
+}
+
+static u32 *sparse_slot(const ComponentStore *store, entity_index key) {
+    u32 page = key / COMPONENT_STORE_PAGE_SIZE;
+    if (page >= store->sparse_page_count || store->sparse_pages[page] == NULL) {
+        return NULL;
+    }
+    return &store->sparse_pages[page][key % COMPONENT_STORE_PAGE_SIZE];
+}
+
+static u32 *sparse_slot_or_create(ComponentStore *store, entity_index key) {
+    u32 page = key / COMPONENT_STORE_PAGE_SIZE;
+    if (page >= store->sparse_page_count) {
+        u32 page_count = store->sparse_page_count == 0 ? 1 : store->sparse_page_count;
+        while (page_count <= page) {
+            page_count *= 2;
         }
-        component_index = store->component_count;
-        store->component_count++;
+        store->sparse_pages = allocator_reallocate(store->allocator,
+                                                   store->sparse_pages,
+                                                   sizeof(u32 *) * store->sparse_page_count,
+                                                   sizeof(u32 *) * page_count,
+                                                   ALLOCATOR_DEFAULT_ALIGNMENT);
+        memset(store->sparse_pages + store->sparse_page_count,
+               0,
+               sizeof(u32 *) * (page_count - store->sparse_page_count));
+        store->sparse_page_count = page_count;
     }
-    memcpy((u8 *)store->component_array +
-               component_index * store->component_size,
-           value_ptr,
-           store->component_size);
 
-    component_pointer = (void *)((u64)store->component_array +
-                                 component_index * store->component_size);
+    if (store->sparse_pages[page] == NULL) {
+        store->sparse_pages[page] =
+            allocator_allocate(store->allocator, sizeof(u32) * COMPONENT_STORE_PAGE_SIZE, ALLOCATOR_DEFAULT_ALIGNMENT);
+        // every byte 0xFF reads as NO_INDEX
+        memset(store->sparse_pages[page], 0xFF, sizeof(u32) * COMPONENT_STORE_PAGE_SIZE);
+    }
 
-    if (store->root == NULL) {
-        start_new_tree(store, key, component_pointer);
+    return &store->sparse_pages[page][key % COMPONENT_STORE_PAGE_SIZE];
+}
+
+static void sparse_set_insert(ComponentStore *store, entity_index key, const void *value_ptr) {
+    u32 *slot = sparse_slot_or_create(store, key);
+    if (*slot != NO_INDEX) {
+        memcpy(component_store_at(store, *slot), value_ptr, store->component_size);
+        store->changed_ticks[*slot] = store->change_tick;
         return;
     }
 
-    node *leaf = find_leaf(store, key);
+    *slot = push_component(store, key, value_ptr);
+}
+
+static b8 sparse_set_remove(ComponentStore *store, entity_index key) {
+    u32 *slot = sparse_slot(store, key);
+    if (slot == NULL || *slot == NO_INDEX) {
+        return false;
+    }
+
+    u32 component_index = *slot;
+    *slot = NO_INDEX;
+
+    entity_index moved = pop_component(store, component_index);
+    if (moved != ENTITY_INDEX_INVALID) {
+        *sparse_slot(store, moved) = component_index;
+    }
+    return true;
+}
+
+void component_store_insert(ComponentStore *store,
+                            entity_index key,
+                            const void *value_ptr) {
+    if (store->backend == COMPONENT_STORE_SPARSE_SET) {
+        sparse_set_insert(store, key, value_ptr);
+        return;
+    }
 
-    if (darray_length(leaf->keys) < store->order - 1) {
-        insert_into_leaf(leaf, key, component_pointer);
+    u32 component_index = find(store, key, NULL, NULL);
+    if (component_index != NO_INDEX) {
+        memcpy(component_store_at(store, component_index), value_ptr, store->component_size);
+        store->changed_ticks[component_index] = store->change_tick;
         return;
     }
 
-    insert_into_leaf_after_splitting(store, leaf, key, component_pointer);
+    btree_insert(store, key, push_component(store, key, value_ptr));
 }
 
-static void remove_entry_from_node(node *n, entity_id key) {
-    u32 index = 0;
-    while (n->keys[index] != key) {
-        index++;
+/**
+ * Appends ascending keys that are all larger than every key in the tree by
+ * filling the rightmost leaf up and chaining new full leaves behind it, so no
+ * key needs its own descent or split. `sorted_keys` and `sorted_values` hold
+ * the entries, when NULL the keys are consecutive from `first_key` and the
+ * values consecutive from `first_value`.
+ */
+static void btree_append(ComponentStore *store,
+                         const entity_index *sorted_keys,
+                         const u32 *sorted_values,
+                         entity_index first_key,
+                         u32 first_value,
+                         u32 count) {
+    if (store->root == NULL) {
+        store->root = make_leaf(store);
     }
 
-    darray_remove_at_sorted(n->keys, index);
-    darray_remove_at_sorted(n->pointers, index);
+    node *leaf = find_leaf(store, sorted_keys != NULL ? sorted_keys[0] : first_key);
+    u32 done = 0;
+    while (done < count) {
+        if (leaf->key_count == store->order - 1) {
+            node *new_leaf = make_leaf(store);
+            node_keys(new_leaf)[0] = sorted_keys != NULL ? sorted_keys[done] : first_key + done;
+            node_values(store, new_leaf)[0] = sorted_values != NULL ? sorted_values[done] : first_value + done;
+            new_leaf->key_count = 1;
+            new_leaf->parent = leaf->parent;
+            leaf->next = new_leaf;
+            done++;
+
+            insert_into_parent(store, leaf, node_keys(new_leaf)[0], new_leaf);
+            leaf = new_leaf;
+            continue;
+        }
+
+        u32 n = store->order - 1 - leaf->key_count;
+        if (n > count - done) {
+            n = count - done;
+        }
+        entity_index *keys = node_keys(leaf) + leaf->key_count;
+        u32 *values = node_values(store, leaf) + leaf->key_count;
+        if (sorted_keys != NULL) {
+            memcpy(keys, sorted_keys + done, n * sizeof(entity_index));
+        } else {
+            for (u32 i = 0; i < n; i++) {
+                keys[i] = first_key + done + i;
+            }
+        }
+        if (sorted_values != NULL) {
+            memcpy(values, sorted_values + done, n * sizeof(u32));
+        } else {
+            for (u32 i = 0; i < n; i++) {
+                values[i] = first_value + done + i;
+            }
+        }
+        leaf->key_count += n;
+        done += n;
+    }
 }
 
-static void adjust_root(ComponentStore *store) {
-    if (darray_length(store->root->keys) > 0) {
+void component_store_insert_batch(ComponentStore *store, entity_index first_key, u32 count, const void *values) {
+    if (count == 0) {
         return;
     }
 
-    node *new_root;
-    if (!store->root->is_leaf) {
-        new_root = store->root->pointers[0];
-        new_root->parent = NULL;
+    reserve_components(store, store->component_count + count);
+    u32 first_index = store->component_count;
+    if (values != NULL) {
+        memcpy(component_store_at(store, first_index), values, (u64)count * store->component_size);
     } else {
-        new_root = NULL;
+        memset(component_store_at(store, first_index), 0, (u64)count * store->component_size);
     }
+    for (u32 i = 0; i < count; i++) {
+        store->entities[first_index + i] = first_key + i;
+        store->added_ticks[first_index + i] = store->change_tick;
+        store->changed_ticks[first_index + i] = store->change_tick;
+    }
+    store->component_count += count;
 
-    node_destroy(store->root);
+    if (store->backend == COMPONENT_STORE_SPARSE_SET) {
+        for (u32 i = 0; i < count; i++) {
+            u32 *slot = sparse_slot_or_create(store, first_key + i);
+            ASSERT_DEBUG(*slot == NO_INDEX);
+            *slot = first_index + i;
+        }
+        return;
+    }
 
-    store->root = new_root;
+    node *last_leaf = find_leaf(store, ENTITY_INDEX_INVALID);
+    if (last_leaf == NULL || last_leaf->key_count == 0 || node_keys(last_leaf)[last_leaf->key_count - 1] < first_key) {
+        btree_append(store, NULL, NULL, first_key, first_index, count);
+        return;
+    }
+
+    // the batch lands in front of the largest key, the keys are ascending so
+    // each one is in the leaf of the one before it or further along the
+    // chain, no key needs its own descent
+    node *leaf = find_leaf(store, first_key);
+    for (u32 i = 0; i < count; i++) {
+        entity_index key = first_key + i;
+        ASSERT_DEBUG(find(store, key, NULL, NULL) == NO_INDEX);
+        while (leaf->next != NULL && node_keys(leaf->next)[0] <= key) {
+            leaf = leaf->next;
+        }
+        insert_into_leaf(store, leaf, key, first_index + i);
+    }
 }
 
-static i32 get_neighbor_index(node *n) {
-    for (i32 i = 0; (u32)i <= darray_length(n->parent->keys); i++) {
-        if (n->parent->pointers[i] == n) {
-            return i - 1;
+void component_store_insert_sorted(ComponentStore *store,
+                                   const entity_index *keys,
+                                   const void *const *values,
+                                   u32 count) {
+    // keys up to the largest one in the tree may already be there or land
+    // between existing keys, they take a descent each
+    u32 inner = count;
+    if (store->backend == COMPONENT_STORE_BTREE) {
+        node *last_leaf = find_leaf(store, ENTITY_INDEX_INVALID);
+        entity_index largest = 0;
+        b8 empty = last_leaf == NULL || last_leaf->key_count == 0;
+        if (!empty) {
+            largest = node_keys(last_leaf)[last_leaf->key_count - 1];
         }
+        for (inner = 0; inner < count && !empty && keys[inner] <= largest; inner++) {
+            ASSERT_DEBUG(inner == 0 || keys[inner - 1] < keys[inner]);
+        }
+    }
+    for (u32 i = 0; i < inner; i++) {
+        component_store_insert(store, keys[i], values[i]);
+    }
+    if (inner == count) {
+        return;
     }
 
-    ASSERT_UNREACHABLE();
+    // the rest is new and appended behind the last leaf
+    u32 appended = count - inner;
+    reserve_components(store, store->component_count + appended);
+    u32 first_index = store->component_count;
+    for (u32 i = 0; i < appended; i++) {
+        ASSERT_DEBUG(i == 0 || keys[inner + i - 1] < keys[inner + i]);
+        memcpy(component_store_at(store, first_index + i), values[inner + i], store->component_size);
+        store->entities[first_index + i] = keys[inner + i];
+        store->added_ticks[first_index + i] = store->change_tick;
+        store->changed_ticks[first_index + i] = store->change_tick;
+    }
+    store->component_count += appended;
+    btree_append(store, keys + inner, NULL, 0, first_index, appended);
 }
 
-static void delete_entry(ComponentStore *store, node *n, entity_id key);
+/**
+ * Sorts (key << 32 | component index) pairs by key, one counting pass per key
+ * byte. The result ends up back in `pairs`.
+ */
+static void radix_sort_by_key(u64 *pairs, u64 *scratch, u32 count) {
+    for (u32 shift = 32; shift < 64; shift += 8) {
+        u32 offsets[256] = {0};
+        for (u32 i = 0; i < count; i++) {
+            offsets[(pairs[i] >> shift) & 0xFF]++;
+        }
+        u32 total = 0;
+        for (u32 b = 0; b < 256; b++) {
+            u32 n = offsets[b];
+            offsets[b] = total;
+            total += n;
+        }
+        for (u32 i = 0; i < count; i++) {
+            scratch[offsets[(pairs[i] >> shift) & 0xFF]++] = pairs[i];
+        }
 
-static void coalesce_nodes(ComponentStore *store,
-                           node *n,
-                           node *neigbor,
-                           i32 neighbor_index,
-                           entity_id k_prime) {
-    if (neighbor_index == -1) {
-        node *tmp = n;
-        n = neigbor;
-        neigbor = tmp;
+        u64 *swap = pairs;
+        pairs = scratch;
+        scratch = swap;
     }
+}
 
-    if (!n->is_leaf) {
-        darray_push(neigbor->keys, k_prime);
-
-        for (u32 i = 0; i < darray_length(n->keys); i++) {
-            darray_push(neigbor->keys, n->keys[i]);
-            darray_push(neigbor->pointers, n->pointers[i]);
-        }
-        darray_push(neigbor->pointers,
-                    n->pointers[darray_length(n->pointers) - 1]);
+// Rebuilds the entity to component index mapping from `entities`
+static void rebuild_index(ComponentStore *store) {
+    u32 count = store->component_count;
 
-        for (u32 i = 0; i < darray_length(neigbor->pointers); i++) {
-            node *tmp = (node *)neigbor->pointers[i];
-            tmp->parent = neigbor;
+    if (store->backend == COMPONENT_STORE_SPARSE_SET) {
+        for (u32 page = 0; page < store->sparse_page_count; page++) {
+            if (store->sparse_pages[page] != NULL) {
+                memset(store->sparse_pages[page], 0xFF, sizeof(u32) * COMPONENT_STORE_PAGE_SIZE);
+            }
         }
-    } else {
-        for (u32 i = 0; i < darray_length(n->keys); i++) {
-            darray_push(neigbor->keys, n->keys[i]);
-            darray_push(neigbor->pointers, n->pointers[i]);
+        for (u32 i = 0; i < count; i++) {
+            *sparse_slot_or_create(store, store->entities[i]) = i;
         }
-        neigbor->next = n->next;
+        return;
     }
 
-    delete_entry(store, n->parent, k_prime);
-    node_destroy(n);
-}
+    node_pool_destroy(store);
+    node_pool_init(&store->node_pool, store->order);
+    store->root = NULL;
+    if (count == 0) {
+        return;
+    }
 
-static void redistribute_nodes(node *n,
-                               node *neighbor,
-                               i32 neighbor_index,
-                               u32 k_prime_index,
-                               entity_id k_prime) {
-    if (neighbor_index != -1) {
-        void *neighbor_pointer;
-        darray_pop(neighbor->pointers, &neighbor_pointer);
-        darray_insert_at(n->pointers, 0, neighbor_pointer);
+    u64 *pairs = allocator_allocate(store->allocator, sizeof(u64) * count, ALLOCATOR_DEFAULT_ALIGNMENT);
+    u64 *scratch = allocator_allocate(store->allocator, sizeof(u64) * count, ALLOCATOR_DEFAULT_ALIGNMENT);
+    ASSERT(pairs != NULL && scratch != NULL);
 
-        entity_id neighbor_key;
-        darray_pop(neighbor->keys, &neighbor_key);
+    b8 sorted = true;
+    for (u32 i = 0; i < count; i++) {
+        pairs[i] = (u64)store->entities[i] << 32 | i;
+        sorted &= i == 0 || store->entities[i - 1] < store->entities[i];
+    }
+    if (!sorted) {
+        radix_sort_by_key(pairs, scratch, count);
+    }
 
-        if (!n->is_leaf) {
-            node *tmp = (node *)n->pointers[0];
-            tmp->parent = n;
-            darray_insert_at(n->keys, 0, k_prime);
-            n->parent->keys[k_prime_index] = neighbor_key;
-        } else {
-            darray_insert_at(n->keys, 0, neighbor_key);
-            n->parent->keys[k_prime_index] = n->keys[0];
-        }
-    } else {
-        entity_id neighbor_key;
-        darray_pop_front(neighbor->keys, &neighbor_key);
+    // scratch is free again, split the pairs into its two halves
+    entity_index *keys = (entity_index *)scratch;
+    u32 *values = (u32 *)scratch + count;
+    for (u32 i = 0; i < count; i++) {
+        keys[i] = (entity_index)(pairs[i] >> 32);
+        values[i] = (u32)pairs[i];
+    }
+    btree_append(store, keys, values, 0, 0, count);
 
-        void *neighbor_pointer;
-        darray_pop_front(neighbor->pointers, &neighbor_pointer);
+    allocator_free(store->allocator, pairs, sizeof(u64) * count);
+    allocator_free(store->allocator, scratch, sizeof(u64) * count);
+}
 
-        if (n->is_leaf) {
-            darray_push(n->keys, neighbor_key);
-            darray_push(n->pointers, neighbor_pointer);
-            n->parent->keys[k_prime_index] = neighbor->keys[0];
-        } else {
-            darray_push(n->keys, k_prime);
-            darray_push(n->pointers, neighbor_pointer);
-            ((node *)(neighbor_pointer))->parent = n;
-            n->parent->keys[k_prime_index] = neighbor_key;
-        }
+void component_store_restore(ComponentStore *store,
+                             u32 count,
+                             const void *components,
+                             const entity_index *entities,
+                             const u32 *added_ticks,
+                             const u32 *changed_ticks) {
+    if (count == 0) {
+        store->component_count = 0;
+        rebuild_index(store);
+        return;
+    }
+
+    // the index only depends on which entity sits where
+    b8 same_keys =
+        count == store->component_count && memcmp(store->entities, entities, sizeof(entity_index) * count) == 0;
+
+    reserve_components(store, count);
+    memcpy(store->component_array, components, (u64)count * store->component_size);
+    memcpy(store->entities, entities, sizeof(entity_index) * count);
+    memcpy(store->added_ticks, added_ticks, sizeof(u32) * count);
+    memcpy(store->changed_ticks, changed_ticks, sizeof(u32) * count);
+    store->component_count = count;
+
+    if (!same_keys) {
+        rebuild_index(store);
     }
 }
 
-static void delete_entry(ComponentStore *store, node *n, entity_id key) {
-    remove_entry_from_node(n, key);
+b8 component_store_remove(ComponentStore *store, entity_index key) {
+    if (store->backend == COMPONENT_STORE_SPARSE_SET) {
+        return sparse_set_remove(store, key);
+    }
 
-    if (n == store->root) {
-        adjust_root(store);
-        return;
+    node *leaf;
+    i32 position;
+    u32 component_index = find(store, key, &leaf, &position);
+
+    if (component_index == NO_INDEX) {
+        return false;
     }
 
-    u32 min_keys = n->is_leaf ? cut(store->order - 1) : cut(store->order) - 1;
+    delete_entry(store, leaf, position);
 
-    if (darray_length(n->keys) >= min_keys) {
-        return;
+    // keep the array dense by moving the last component into the hole
+    entity_index moved = pop_component(store, component_index);
+    if (moved != ENTITY_INDEX_INVALID) {
+        node *moved_leaf = find_leaf(store, moved);
+        node_values(store, moved_leaf)[find_in_leaf(moved_leaf, moved)] = component_index;
     }
+    return true;
+}
 
-    i32 neighbor_index = get_neighbor_index(n);
-    u32 k_prime_index = neighbor_index == -1 ? 0 : neighbor_index;
-    entity_id k_prime = n->parent->keys[k_prime_index];
-    node *neigbor = neighbor_index == -1 ? n->parent->pointers[1]
-                                         : n->parent->pointers[neighbor_index];
+u32 component_store_index_of(const ComponentStore *store, entity_index key) {
+    if (store->backend == COMPONENT_STORE_SPARSE_SET) {
+        const u32 *slot = sparse_slot(store, key);
+        return slot != NULL ? *slot : NO_INDEX;
+    }
+    return find(store, key, NULL, NULL);
+}
 
-    u32 capacity = n->is_leaf ? store->order : store->order - 1;
+void *component_store_find(const ComponentStore *store, entity_index key) {
+    u32 component_index = component_store_index_of(store, key);
+    if (component_index == NO_INDEX) {
+        return NULL;
+    }
+    return component_store_at(store, component_index);
+}
 
-    if (darray_length(neigbor->keys) + darray_length(n->keys) < capacity) {
-        coalesce_nodes(store, n, neigbor, neighbor_index, k_prime);
-    } else {
-        redistribute_nodes(n, neigbor, neighbor_index, k_prime_index, k_prime);
+ComponentStoreIter component_store_iter_begin(const ComponentStore *store) {
+    return component_store_iter_range(store, 0, ENTITY_INDEX_INVALID);
+}
+
+ComponentStoreIter component_store_iter_range(const ComponentStore *store, entity_index first, entity_index last) {
+    ComponentStoreIter iter = {
+        .store = store,
+        .leaf = NULL,
+        .position = first,
+        .last = last,
+        .done = first > last,
+    };
+
+    if (store->backend == COMPONENT_STORE_SPARSE_SET || iter.done) {
+        return iter;
     }
+
+    iter.leaf = find_leaf(store, first);
+    iter.position = 0;
+    if (iter.leaf != NULL) {
+        iter.position = count_less(node_keys(iter.leaf), iter.leaf->key_count, first);
+    }
+    return iter;
 }
 
-void component_store_remove(ComponentStore *store, entity_id key) {
-    node *leaf;
-    void *found_component = find(store, key, &leaf);
+static b8 sparse_set_iter_next(ComponentStoreIter *iter, entity_index *out_key, u32 *out_index) {
+    const ComponentStore *store = iter->store;
+    u64 end = (u64)store->sparse_page_count * COMPONENT_STORE_PAGE_SIZE;
+    if ((u64)iter->last + 1 < end) {
+        end = (u64)iter->last + 1;
+    }
 
-    if (found_component == NULL) {
-        return;
+    u64 key = iter->position;
+    while (key < end) {
+        const u32 *page = store->sparse_pages[key / COMPONENT_STORE_PAGE_SIZE];
+        if (page == NULL) {
+            key = (key / COMPONENT_STORE_PAGE_SIZE + 1) * COMPONENT_STORE_PAGE_SIZE;
+            continue;
+        }
+
+        if (page[key % COMPONENT_STORE_PAGE_SIZE] != NO_INDEX) {
+            *out_key = (entity_index)key;
+            *out_index = page[key % COMPONENT_STORE_PAGE_SIZE];
+            iter->position = (u32)(key + 1);
+            iter->done = key == iter->last;
+            return true;
+        }
+        key++;
     }
 
-    delete_entry(store, leaf, key);
+    iter->done = true;
+    return false;
+}
 
-    u64 slot = ((u64)found_component - (u64)store->component_array) /
-               store->component_size;
-    darray_push(store->free_slots, slot);
+static b8 btree_iter_next(ComponentStoreIter *iter, entity_index *out_key, u32 *out_index) {
+    while (iter->leaf != NULL && iter->position >= iter->leaf->key_count) {
+        iter->leaf = iter->leaf->next;
+        iter->position = 0;
+    }
+
+    if (iter->leaf == NULL || node_keys(iter->leaf)[iter->position] > iter->last) {
+        iter->done = true;
+        return false;
+    }
+
+    *out_key = node_keys(iter->leaf)[iter->position];
+    *out_index = node_values(iter->store, iter->leaf)[iter->position];
+    iter->position++;
+    return true;
 }
 
-void *component_store_find(const ComponentStore *store, entity_id key) {
-    return find(store, key, NULL);
+b8 component_store_iter_next(ComponentStoreIter *iter, entity_index *out_key, void **out_component) {
+    if (iter->done) {
+        return false;
+    }
+
+    entity_index key;
+    u32 component_index;
+    b8 found = iter->store->backend == COMPONENT_STORE_SPARSE_SET ? sparse_set_iter_next(iter, &key, &component_index)
+                                                                   : btree_iter_next(iter, &key, &component_index);
+    if (!found) {
+        return false;
+    }
+
+    if (out_key != NULL) {
+        *out_key = key;
+    }
+    if (out_component != NULL) {
+        *out_component = component_store_at(iter->store, component_index);
+    }
+    return true;
 }
@@ -1,43 +1,190 @@
 #ifndef COMPONENT_STORE_H
 #define COMPONENT_STORE_H
 
-#include "containers/darray.h"
+#include "core/allocator/allocator.h"
 #include "ecs/entity.h"
 
-typedef struct {
-    // TODO: better types
-    void *(*deserialize)(void *);
-    void *(*serialize)(void *);
-} component_serializer;
-
 typedef enum {
     COMPONENT_FLAG_REPLICATED = 1 << 0,
     COMPONENT_FLAG_INTERPOLATE = 1 << 1,
 } ComponentFlags;
 
+typedef enum {
+    // sorted B+tree index, compact for sparse entity ranges
+    COMPONENT_STORE_BTREE,
+    // paged sparse set, O(1) insert, remove and lookup for components that
+    // are attached and detached often
+    COMPONENT_STORE_SPARSE_SET,
+} ComponentStoreBackend;
+
+#define COMPONENT_STORE_PAGE_SIZE 4096
+#define COMPONENT_STORE_INVALID_INDEX ((u32)-1)
+
+/**
+ * B+tree nodes have a fixed size per store and are carved out of 64-byte
+ * aligned blocks, freed nodes are kept on a free list for reuse.
+ */
 typedef struct {
+    void *blocks;
+    struct node *free_nodes;
+    u32 node_size;
+    // offset of the child/value array behind the inline keys
+    u32 slots_offset;
+    u32 block_used;
+} ComponentStoreNodePool;
+
+/**
+ * Components are packed densely in `component_array`, `entities[i]` is the
+ * entity owning the i-th component. The backend maps each entity to the index
+ * of its component, so the array can grow without invalidating the index.
+ *
+ * `added_ticks[i]` and `changed_ticks[i]` record when the i-th component was
+ * attached and last written. Inserts stamp them with `change_tick`, which the
+ * owning world keeps current.
+ *
+ * The sparse set backend keeps `sparse_pages[key / COMPONENT_STORE_PAGE_SIZE]`,
+ * pages are allocated on first use and hold the component index of every key
+ * in their range.
+ */
+typedef struct {
+    ComponentStoreBackend backend;
     struct node *root;
+    ComponentStoreNodePool node_pool;
+    u32 **sparse_pages;
+    u32 sparse_page_count;
     const char *component_name;
-    darray(u64) free_slots;
     void *component_array;
+    entity_index *entities;
+    u32 *added_ticks;
+    u32 *changed_ticks;
+    u32 change_tick;
     u32 component_size;
     u32 component_capacity;
     u32 component_count;
     u32 order;
     ComponentFlags flags;
+    // backs the arrays, pages and nodes, NULL for the heap
+    Allocator *allocator;
 } ComponentStore;
 
+/**
+ * Walks the components of a store in ascending entity order without
+ * allocating. The B+tree backend follows its leaf chain, the sparse set
+ * backend scans its pages and skips the ones that were never allocated.
+ *
+ * Inserting into or removing from the store invalidates the cursor.
+ */
+typedef struct {
+    const ComponentStore *store;
+    struct node *leaf;
+    // slot in `leaf` for the B+tree, next entity to look at for the sparse set
+    u32 position;
+    entity_index last;
+    b8 done;
+} ComponentStoreIter;
+
 ComponentStore component_store_new(const char *component_name,
                                    u64 component_size);
 
+ComponentStore component_store_new_with_backend(const char *component_name,
+                                                u64 component_size,
+                                                ComponentStoreBackend backend);
+
+/**
+ * Takes the dense arrays, the sparse pages and the B+tree nodes from
+ * `allocator`, NULL for the heap.
+ */
+ComponentStore component_store_new_with_allocator(const char *component_name,
+                                                  u64 component_size,
+                                                  ComponentStoreBackend backend,
+                                                  Allocator *allocator);
+
 void component_store_destroy(ComponentStore *store);
 
+/**
+ * Sets the maximum number of children of a B+tree node. Only allowed while the
+ * store is empty. The default, 64, is the smallest order the larger ones in
+ * bench_component_store's sweep do not beat.
+ */
+void component_store_set_order(ComponentStore *store, u32 order);
+
+/**
+ * Inserts or overwrites the component of `key`. May grow the component array,
+ * which invalidates every pointer previously returned by the store.
+ */
 void component_store_insert(ComponentStore *store,
-                            entity_id key,
+                            entity_index key,
                             const void *value_ptr);
 
-void component_store_remove(ComponentStore *store, entity_id key);
+/**
+ * Inserts the components of the keys [first_key, first_key + count), none of
+ * which may be in the store yet. `values` holds `count` consecutive components
+ * and is copied with one memcpy, NULL zeroes them. Keys larger than every key
+ * in the store are appended to the B+tree without a descent per key.
+ */
+void component_store_insert_batch(ComponentStore *store, entity_index first_key, u32 count, const void *values);
+
+/**
+ * Inserts or overwrites the components of `count` ascending keys, copying the
+ * component of `keys[i]` from `values[i]`. Keys larger than every key in the
+ * B+tree are appended without a descent per key, only the ones up to the
+ * largest existing key take one.
+ */
+void component_store_insert_sorted(ComponentStore *store,
+                                   const entity_index *keys,
+                                   const void *const *values,
+                                   u32 count);
+
+/**
+ * Replaces the whole content of the store with `count` components and the
+ * entities owning them, as laid out in the dense arrays. The index is only
+ * rebuilt when the entities differ from the current ones, so restoring
+ * changed values of the same entities is four memcpys.
+ */
+void component_store_restore(ComponentStore *store,
+                             u32 count,
+                             const void *components,
+                             const entity_index *entities,
+                             const u32 *added_ticks,
+                             const u32 *changed_ticks);
+
+/**
+ * Moves the last component into the removed component's place, which
+ * invalidates pointers to the last component.
+ * @return false when `key` had no component
+ */
+b8 component_store_remove(ComponentStore *store, entity_index key);
+
+/**
+ * @return the position of the component of `key` in the dense arrays, or
+ * COMPONENT_STORE_INVALID_INDEX
+ */
+u32 component_store_index_of(const ComponentStore *store, entity_index key);
+
+/**
+ * @return a pointer into the component array that stays valid until the next
+ * insert into or remove from this store, or NULL when `key` has no component
+ */
+void *component_store_find(const ComponentStore *store, entity_index key);
+
+/**
+ * @return a cursor over every component of the store
+ */
+ComponentStoreIter component_store_iter_begin(const ComponentStore *store);
+
+/**
+ * @return a cursor over the components of the entities in [first, last]
+ */
+ComponentStoreIter component_store_iter_range(const ComponentStore *store, entity_index first, entity_index last);
+
+/**
+ * Advances the cursor. `out_key` and `out_component` may be NULL.
+ * @return false once there are no components left
+ */
+b8 component_store_iter_next(ComponentStoreIter *iter, entity_index *out_key, void **out_component);
 
-void *component_store_find(const ComponentStore *store, entity_id key);
+static inline void *component_store_at(const ComponentStore *store, u32 index) {
+    return (u8 *)store->component_array + (u64)index * store->component_size;
+}
 
 #endif // COMPONENT_STORE_H
@@ -3,11 +3,44 @@
 
 #include "core/defines.h"
 
-typedef u32 entity_id;
+// Slot of an entity in the world, component storage is keyed by it
+typedef u32 entity_index;
+
+// Entity handle: the slot index in the low 32 bits and the generation of the
+// slot in the high 32 bits, so handles to destroyed entities can be detected
+// after their slot has been reused
+typedef u64 entity_id;
+
+#define ENTITY_INVALID ((entity_id)-1)
+#define ENTITY_INDEX_INVALID ((entity_index)-1)
 
 typedef struct {
-    entity_id id;
+    entity_index index;
     u32 generation;
 } Entity;
 
+// Consecutive entities created together, all in fresh slots
+typedef struct {
+    entity_index first;
+    u32 count;
+} EntityRange;
+
+static inline entity_id entity_make(entity_index index, u32 generation) {
+    return ((entity_id)generation << 32) | index;
+}
+
+static inline entity_index entity_get_index(entity_id entity) { return (entity_index)(entity & 0xFFFFFFFFu); }
+
+static inline u32 entity_get_generation(entity_id entity) { return (u32)(entity >> 32); }
+
+static inline Entity entity_unpack(entity_id entity) {
+    return (Entity){.index = entity_get_index(entity), .generation = entity_get_generation(entity)};
+}
+
+/**
+ * @return the handle of the i-th entity in the range, fresh slots start at
+ * generation 0
+ */
+static inline entity_id entity_range_get(EntityRange range, u32 i) { return entity_make(range.first + i, 0); }
+
 #endif // ENTITY_H
@@ -0,0 +1,395 @@
+#include "interpolation.h"
+#include "containers/darray.h"
+#include "core/assert.h"
+#include "ecs/archetype.h"
+#include "ecs/component_store.h"
+#include "ecs/entity.h"
+#include "ecs/slot_columns.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// Below this sine the quaternions are too close for slerp's division, they
+// are lerped instead
+#define SLERP_MIN_SINE 1e-5f
+
+STATIC_ASSERT(INTERPOLATION_MAX_COMPONENTS <= SLOT_COLUMNS_MAX, "sample masks have one bit per component");
+
+// The interpolated components of a world at one time, column c of `slots`
+// holds InterpolationState.components[c]
+typedef struct {
+    f64 time;
+    SlotColumns slots;
+} InterpolationSample;
+
+typedef struct {
+    u32 float_count;
+    // f32 offsets of the quaternions in the component
+    u32 quaternions[INTERPOLATION_MAX_QUATERNIONS];
+    u32 quaternion_count;
+} InterpolatedComponent;
+
+struct InterpolationState {
+    f64 delay;
+    f64 now;
+    InterpolatedComponent components[INTERPOLATION_MAX_COMPONENTS];
+    // ids and byte sizes of `components`, as the sample columns take them
+    ComponentId ids[INTERPOLATION_MAX_COMPONENTS];
+    u32 sizes[INTERPOLATION_MAX_COMPONENTS];
+    u32 component_count;
+    // a ring, `samples[newest]` is the last push
+    InterpolationSample samples[INTERPOLATION_SAMPLE_COUNT];
+    u32 sample_count;
+    u32 newest;
+    // blended values of one component, indexed like the sample columns
+    f32 *blended;
+    u64 blended_capacity;
+};
+
+void interpolation_enable(World *world, f64 delay) {
+    if (world->interpolation != NULL) {
+        world->interpolation->delay = delay;
+        return;
+    }
+
+    InterpolationState *state = malloc(sizeof(InterpolationState));
+    ASSERT(state != NULL);
+    // zeroes the samples too
+    *state = (InterpolationState){
+        .delay = delay,
+        .now = 0.0,
+        .component_count = 0,
+        .sample_count = 0,
+        .newest = 0,
+        .blended = NULL,
+        .blended_capacity = 0,
+    };
+
+    for (u32 id = 0; id < darray_length(world->components); id++) {
+        const ComponentInfo *info = &world->components[id];
+        if (info->name == NULL || !(info->flags & COMPONENT_FLAG_INTERPOLATE)) {
+            continue;
+        }
+
+        ASSERT_MSG(state->component_count < INTERPOLATION_MAX_COMPONENTS, "too many interpolated components");
+        ASSERT_MSG(info->size % sizeof(f32) == 0, "interpolated components must consist of f32s");
+        state->ids[state->component_count] = id;
+        state->sizes[state->component_count] = info->size;
+        state->components[state->component_count++] = (InterpolatedComponent){
+            .float_count = info->size / sizeof(f32),
+            .quaternion_count = 0,
+        };
+    }
+    world->interpolation = state;
+}
+
+void interpolation_state_destroy(InterpolationState *state) {
+    for (u32 s = 0; s < INTERPOLATION_SAMPLE_COUNT; s++) {
+        slot_columns_destroy(&state->samples[s].slots, NULL, state->sizes, state->component_count);
+    }
+    free(state->blended);
+    free(state);
+}
+
+void interpolation_add_quaternion(World *world, ComponentId component, u32 offset) {
+    InterpolationState *state = world->interpolation;
+    ASSERT_MSG(state != NULL, "interpolation is not enabled for this world");
+
+    for (u32 c = 0; c < state->component_count; c++) {
+        InterpolatedComponent *interpolated = &state->components[c];
+        if (state->ids[c] != component) {
+            continue;
+        }
+
+        ASSERT(offset % sizeof(f32) == 0 && offset / sizeof(f32) + 4 <= interpolated->float_count);
+        ASSERT(interpolated->quaternion_count < INTERPOLATION_MAX_QUATERNIONS);
+        interpolated->quaternions[interpolated->quaternion_count++] = offset / sizeof(f32);
+        return;
+    }
+    ASSERT_MSG(false, "component is not interpolated");
+}
+
+void interpolation_push(World *world, f64 time) {
+    InterpolationState *state = world->interpolation;
+    ASSERT_MSG(state != NULL, "interpolation is not enabled for this world");
+    if (state->sample_count > 0 && time <= state->samples[state->newest].time) {
+        return;
+    }
+
+    state->newest = (state->newest + 1) % INTERPOLATION_SAMPLE_COUNT;
+    state->sample_count = MIN(state->sample_count + 1, INTERPOLATION_SAMPLE_COUNT);
+    InterpolationSample *sample = &state->samples[state->newest];
+    sample->time = time;
+
+    slot_columns_capture(&sample->slots, NULL, world, state->ids, state->sizes, state->component_count);
+}
+
+void interpolation_set_time(World *world, f64 now) {
+    ASSERT_MSG(world->interpolation != NULL, "interpolation is not enabled for this world");
+    world->interpolation->now = now;
+}
+
+static void lerp_column(f32 *out, const f32 *a, const f32 *b, f32 t, u64 count) {
+    u64 i = 0;
+#if defined(__SSE2__)
+    const __m128 weight = _mm_set1_ps(t);
+    for (; i + 4 <= count; i += 4) {
+        __m128 from = _mm_loadu_ps(a + i);
+        __m128 to = _mm_loadu_ps(b + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), weight)));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = a[i] + (b[i] - a[i]) * t;
+    }
+}
+
+static void slerp_one(f32 *out, const f32 *a, const f32 *b, f32 t) {
+    f32 dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    // q and -q are the same rotation, take the shorter way
+    f32 sign = dot < 0.0f ? -1.0f : 1.0f;
+    dot = fminf(dot * sign, 1.0f);
+
+    f32 theta = acosf(dot);
+    f32 sine = sinf(theta);
+    f32 wa = 1.0f - t;
+    f32 wb = t;
+    if (sine > SLERP_MIN_SINE) {
+        wa = sinf(wa * theta) / sine;
+        wb = sinf(wb * theta) / sine;
+    }
+    wb *= sign;
+
+    f32 q[4];
+    f32 length = 0.0f;
+    for (u32 i = 0; i < 4; i++) {
+        q[i] = wa * a[i] + wb * b[i];
+        length += q[i] * q[i];
+    }
+    f32 scale = 1.0f / sqrtf(length);
+    for (u32 i = 0; i < 4; i++) {
+        out[i] = q[i] * scale;
+    }
+}
+
+#if defined(__SSE2__)
+// sin(x) for x in [0, pi/2], Taylor series up to x^11
+static __m128 sin_quadrant(__m128 x) {
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 p = _mm_set1_ps(-1.0f / 39916800.0f);
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f / 362880.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 5040.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f / 120.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 6.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f));
+    return _mm_mul_ps(p, x);
+}
+
+// acos(x) for x in [0, 1], Abramowitz and Stegun 4.4.46
+static __m128 acos_positive(__m128 x) {
+    __m128 p = _mm_set1_ps(-0.0012624911f);
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(0.0066700901f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(-0.0170881256f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(0.0308918810f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(-0.0501743046f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(0.0889789874f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(-0.2145988016f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(1.5707963050f));
+    return _mm_mul_ps(p, _mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), x)));
+}
+#endif
+
+/**
+ * Slerps the quaternion at f32 offset `offset` of `count` consecutive
+ * components of `stride` f32s each.
+ */
+static void slerp_column(f32 *out, const f32 *a, const f32 *b, f32 t, u32 stride, u32 offset, u32 count) {
+    u32 i = 0;
+#if defined(__SSE2__)
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 sign_bit = _mm_set1_ps(-0.0f);
+    const __m128 weight = _mm_set1_ps(t);
+    for (; i + 4 <= count; i += 4) {
+        // four quaternions transposed into one register per axis
+        __m128 ax = _mm_loadu_ps(a + (u64)i * stride + offset);
+        __m128 ay = _mm_loadu_ps(a + (u64)(i + 1) * stride + offset);
+        __m128 az = _mm_loadu_ps(a + (u64)(i + 2) * stride + offset);
+        __m128 aw = _mm_loadu_ps(a + (u64)(i + 3) * stride + offset);
+        _MM_TRANSPOSE4_PS(ax, ay, az, aw);
+        __m128 bx = _mm_loadu_ps(b + (u64)i * stride + offset);
+        __m128 by = _mm_loadu_ps(b + (u64)(i + 1) * stride + offset);
+        __m128 bz = _mm_loadu_ps(b + (u64)(i + 2) * stride + offset);
+        __m128 bw = _mm_loadu_ps(b + (u64)(i + 3) * stride + offset);
+        _MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+                                _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+        __m128 sign = _mm_and_ps(dot, sign_bit);
+        dot = _mm_min_ps(_mm_xor_ps(dot, sign), one);
+
+        __m128 theta = acos_positive(dot);
+        __m128 sine = sin_quadrant(theta);
+        __m128 wa = _mm_sub_ps(one, weight);
+        __m128 wb = weight;
+        __m128 use_slerp = _mm_cmpgt_ps(sine, _mm_set1_ps(SLERP_MIN_SINE));
+        __m128 inverse_sine = _mm_div_ps(one, _mm_or_ps(_mm_and_ps(use_slerp, sine), _mm_andnot_ps(use_slerp, one)));
+        __m128 slerp_a = _mm_mul_ps(sin_quadrant(_mm_mul_ps(wa, theta)), inverse_sine);
+        __m128 slerp_b = _mm_mul_ps(sin_quadrant(_mm_mul_ps(wb, theta)), inverse_sine);
+        wa = _mm_or_ps(_mm_and_ps(use_slerp, slerp_a), _mm_andnot_ps(use_slerp, wa));
+        wb = _mm_xor_ps(_mm_or_ps(_mm_and_ps(use_slerp, slerp_b), _mm_andnot_ps(use_slerp, wb)), sign);
+
+        __m128 x = _mm_add_ps(_mm_mul_ps(wa, ax), _mm_mul_ps(wb, bx));
+        __m128 y = _mm_add_ps(_mm_mul_ps(wa, ay), _mm_mul_ps(wb, by));
+        __m128 z = _mm_add_ps(_mm_mul_ps(wa, az), _mm_mul_ps(wb, bz));
+        __m128 w = _mm_add_ps(_mm_mul_ps(wa, aw), _mm_mul_ps(wb, bw));
+        __m128 length = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                                   _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+        __m128 scale = _mm_div_ps(one, _mm_sqrt_ps(length));
+        x = _mm_mul_ps(x, scale);
+        y = _mm_mul_ps(y, scale);
+        z = _mm_mul_ps(z, scale);
+        w = _mm_mul_ps(w, scale);
+
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _mm_storeu_ps(out + (u64)i * stride + offset, x);
+        _mm_storeu_ps(out + (u64)(i + 1) * stride + offset, y);
+        _mm_storeu_ps(out + (u64)(i + 2) * stride + offset, z);
+        _mm_storeu_ps(out + (u64)(i + 3) * stride + offset, w);
+    }
+#endif
+    for (; i < count; i++) {
+        u64 at = (u64)i * stride + offset;
+        slerp_one(out + at, a + at, b + at, t);
+    }
+}
+
+/**
+ * Writes the blended value of every entity that has the component in both
+ * samples under the same generation, the newer sample's value for the ones
+ * only `to` has. Values that already hold it are left alone and keep their
+ * changed tick.
+ */
+static void write_back(World *world,
+                       u32 c,
+                       const InterpolatedComponent *component,
+                       const SlotColumns *from,
+                       const SlotColumns *to,
+                       const f32 *blended,
+                       u32 tick,
+                       const entity_index *entities,
+                       u8 *values,
+                       u32 *changed_ticks,
+                       u32 count) {
+    u32 bit = 1u << c;
+    u32 size = component->float_count * sizeof(f32);
+    for (u32 i = 0; i < count; i++) {
+        entity_index slot = entities[i];
+        if (slot >= to->slot_count || !(to->masks[slot] & bit) || to->generations[slot] != world->generations[slot]) {
+            continue;
+        }
+
+        b8 blend = slot < from->slot_count && (from->masks[slot] & bit) &&
+                   from->generations[slot] == to->generations[slot];
+        const f32 *source = blend ? blended : (const f32 *)to->columns[c];
+        const f32 *value = source + (u64)slot * component->float_count;
+        if (memcmp(values + (u64)i * size, value, size) == 0) {
+            continue;
+        }
+        memcpy(values + (u64)i * size, value, size);
+        changed_ticks[i] = tick;
+    }
+}
+
+void interpolation_apply(World *world) {
+    InterpolationState *state = world->interpolation;
+    ASSERT_MSG(state != NULL, "interpolation is not enabled for this world");
+    if (state->sample_count == 0) {
+        return;
+    }
+
+    // the samples around render time, the nearest one twice outside of them
+    f64 render_time = state->now - state->delay;
+    u32 oldest = (state->newest + INTERPOLATION_SAMPLE_COUNT + 1 - state->sample_count) % INTERPOLATION_SAMPLE_COUNT;
+    const InterpolationSample *from = &state->samples[oldest];
+    const InterpolationSample *to = from;
+    for (u32 n = 1; n < state->sample_count && to->time <= render_time; n++) {
+        from = to;
+        to = &state->samples[(oldest + n) % INTERPOLATION_SAMPLE_COUNT];
+    }
+    if (to->time <= render_time) {
+        from = to;
+    }
+    f32 t = to == from ? 1.0f : (f32)((render_time - from->time) / (to->time - from->time));
+    t = fminf(fmaxf(t, 0.0f), 1.0f);
+
+    const SlotColumns *from_slots = &from->slots;
+    const SlotColumns *to_slots = &to->slots;
+    u32 tick = world->change_tick++;
+    for (u32 c = 0; c < state->component_count; c++) {
+        const InterpolatedComponent *component = &state->components[c];
+        u64 float_count = (u64)to_slots->slot_count * component->float_count;
+        if (float_count > state->blended_capacity) {
+            state->blended_capacity = MAX(float_count, state->blended_capacity * 2);
+            state->blended = realloc(state->blended, state->blended_capacity * sizeof(f32));
+            ASSERT(state->blended != NULL);
+        }
+
+        const f32 *from_column = (const f32 *)from_slots->columns[c];
+        const f32 *to_column = (const f32 *)to_slots->columns[c];
+        u32 slot_count = MIN(from_slots->slot_count, to_slots->slot_count);
+        lerp_column(state->blended, from_column, to_column, t, (u64)slot_count * component->float_count);
+        for (u32 q = 0; q < component->quaternion_count; q++) {
+            slerp_column(state->blended,
+                         from_column,
+                         to_column,
+                         t,
+                         component->float_count,
+                         component->quaternions[q],
+                         slot_count);
+        }
+
+        if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+            ComponentStore *store = &world->component_stores[state->ids[c]];
+            write_back(world,
+                       c,
+                       component,
+                       from_slots,
+                       to_slots,
+                       state->blended,
+                       tick,
+                       store->entities,
+                       store->component_array,
+                       store->changed_ticks,
+                       store->component_count);
+            continue;
+        }
+
+        for (u32 a = 0; a < darray_length(world->archetypes); a++) {
+            const Archetype *archetype = &world->archetypes[a];
+            u32 column = archetype->column_of[state->ids[c]];
+            if (column == ARCHETYPE_NO_COLUMN) {
+                continue;
+            }
+
+            for (u32 k = 0; k < darray_length(archetype->chunks); k++) {
+                ArchetypeChunk *chunk = archetype->chunks[k];
+                write_back(world,
+                           c,
+                           component,
+                           from_slots,
+                           to_slots,
+                           state->blended,
+                           tick,
+                           archetype_chunk_entities(chunk),
+                           archetype_chunk_column(archetype, chunk, column),
+                           archetype_chunk_changed_ticks(archetype, chunk, column),
+                           chunk->count);
+            }
+        }
+    }
+}
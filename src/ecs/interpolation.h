@@ -0,0 +1,48 @@
+#ifndef ECS_INTERPOLATION_H
+#define ECS_INTERPOLATION_H
+
+#include "core/defines.h"
+#include "ecs/component_id.h"
+#include "ecs/world.h"
+
+// Snapshots kept per world, the oldest is dropped by the next push
+#define INTERPOLATION_SAMPLE_COUNT 8
+#define INTERPOLATION_MAX_COMPONENTS 32
+#define INTERPOLATION_MAX_QUATERNIONS 4
+
+/**
+ * Registers every component flagged COMPONENT_FLAG_INTERPOLATE so far, which
+ * must consist of f32s, and makes world_run write their values at render
+ * time, the time given to interpolation_set_time minus `delay`, before the
+ * UPDATE schedule. Times are in whatever unit the pushes use, the
+ * replication client pushes snapshots at their sequence number.
+ */
+void interpolation_enable(World *world, f64 delay);
+
+void interpolation_state_destroy(InterpolationState *state);
+
+/**
+ * Marks the four f32s at byte `offset` of an interpolated component as a
+ * unit quaternion (versors), which is slerped along the shortest arc. Every
+ * other f32 is lerped.
+ */
+void interpolation_add_quaternion(World *world, ComponentId component, u32 offset);
+
+/**
+ * Records the current value of every interpolated component as the snapshot
+ * at `time`. Times must increase, older pushes are ignored.
+ */
+void interpolation_push(World *world, f64 time);
+
+void interpolation_set_time(World *world, f64 now);
+
+/**
+ * Writes the values at render time, blended between the two snapshots
+ * around it and stamped as changed. Before the oldest snapshot and after the
+ * newest the nearest one is used, entities missing from either snapshot, or
+ * whose slot was reused in between, take the newer snapshot's value. Whole
+ * columns are blended at once, four floats or quaternions at a time.
+ */
+void interpolation_apply(World *world);
+
+#endif // ECS_INTERPOLATION_H
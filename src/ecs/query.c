@@ -1,7 +1,8 @@
 #include "query.h"
+#include "core/assert.h"
 
 #include <stdarg.h>
-#include <string.h>
+#include <stdlib.h>
 
 Query _query_new(const char *first, ...) {
     va_list args;
@@ -9,10 +10,14 @@ Query _query_new(const char *first, ...) {
     u32 count = 0;
     const char *str = first;
     u64 size;
+    ComponentId id;
+    int term;
 
     va_start(args, first);
     while (str != NULL) {
         size = va_arg(args, u64);
+        id = va_arg(args, ComponentId);
+        term = va_arg(args, int);
         count++;
         str = va_arg(args, const char *);
     }
@@ -20,20 +25,68 @@ Query _query_new(const char *first, ...) {
 
     const char **names = malloc(sizeof(char *) * count);
     u64 *sizes = malloc(sizeof(u64) * count);
+    ComponentId *ids = malloc(sizeof(ComponentId) * count);
+    QueryAccess *accesses = malloc(sizeof(QueryAccess) * count);
+    QueryFilter *filters = malloc(sizeof(QueryFilter) * count);
+    ComponentMask mask = {0};
+    ComponentMask excluded = {0};
+    u32 removed_count = 0;
+    u32 required_count = 0;
 
     va_start(args, first);
     str = first;
     for (u32 i = 0; i < count; i++) {
         size = va_arg(args, u64);
+        id = va_arg(args, ComponentId);
+        term = va_arg(args, int);
         names[i] = str;
         sizes[i] = size;
+        ids[i] = id;
+        accesses[i] = term & ((1 << QUERY_TERM_FILTER_SHIFT) - 1);
+        filters[i] = term >> QUERY_TERM_FILTER_SHIFT;
+        switch (filters[i]) {
+        case QUERY_FILTER_REMOVED:
+            removed_count++;
+            break;
+        case QUERY_FILTER_WITHOUT:
+            component_mask_set(&excluded, id);
+            break;
+        case QUERY_FILTER_OPTIONAL:
+            break;
+        default:
+            component_mask_set(&mask, id);
+            required_count++;
+            break;
+        }
         str = va_arg(args, const char *);
     }
     va_end(args);
 
+    ASSERT_MSG(removed_count <= 1, "a query can only have one Removed term");
+    ASSERT_MSG(required_count + removed_count > 0, "a query needs a term that is not Without or Optional");
+
     return (Query){
         .names = names,
         .count = count,
         .sizes = sizes,
+        .ids = ids,
+        .access = accesses,
+        .filters = filters,
+        .mask = mask,
+        .excluded = excluded,
     };
 }
+
+void query_destroy(Query *query) {
+    free(query->names);
+    free(query->sizes);
+    free(query->ids);
+    free(query->access);
+    free(query->filters);
+    query->names = NULL;
+    query->sizes = NULL;
+    query->ids = NULL;
+    query->access = NULL;
+    query->filters = NULL;
+    query->count = 0;
+}
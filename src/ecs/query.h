@@ -2,18 +2,108 @@
 #define QUERY_H
 
 #include "core/defines.h"
+#include "ecs/component_id.h"
+#include "ecs/component_mask.h"
+
+typedef enum {
+    QUERY_ACCESS_READ,
+    QUERY_ACCESS_WRITE,
+} QueryAccess;
+
+/**
+ * How a term restricts the entities a query matches. Changed and Added only
+ * match components stamped since the system last ran: writing through a
+ * QUERY_ACCESS_WRITE term counts as a change, attaching a component counts as
+ * both added and changed.
+ *
+ * The component pointer handed to the system is NULL for With, Without and
+ * Removed terms, and for Optional terms the entity does not have.
+ */
+typedef enum {
+    QUERY_FILTER_NONE,
+    QUERY_FILTER_CHANGED,
+    QUERY_FILTER_ADDED,
+    // matches entities that lost the component (or were destroyed)
+    QUERY_FILTER_REMOVED,
+    // the entity must have the component, but it is not accessed
+    QUERY_FILTER_WITH,
+    // the entity must not have the component
+    QUERY_FILTER_WITHOUT,
+    // the entity may or may not have the component
+    QUERY_FILTER_OPTIONAL,
+} QueryFilter;
 
 typedef struct {
     u32 count;
     const char **names;
     u64 *sizes;
+    ComponentId *ids;
+    QueryAccess *access;
+    QueryFilter *filters;
+    // every component a matching entity has, i.e. all but the Removed,
+    // Without and Optional terms
+    ComponentMask mask;
+    // the components of the Without terms
+    ComponentMask excluded;
 } Query;
 
+// Term index meaning "no such term"
+#define QUERY_NO_TERM ((u32)-1)
+
+// The filter of a term is packed above its access
+#define QUERY_TERM_FILTER_SHIFT 8
+
+/**
+ * @return true for terms the system reads or writes the component of
+ */
+static inline b8 query_term_accesses(const Query *query, u32 term) {
+    QueryFilter filter = query->filters[term];
+    return filter != QUERY_FILTER_REMOVED && filter != QUERY_FILTER_WITH && filter != QUERY_FILTER_WITHOUT;
+}
+
+/**
+ * @return true for terms every matching entity has a component of
+ */
+static inline b8 query_term_is_required(const Query *query, u32 term) {
+    QueryFilter filter = query->filters[term];
+    return filter != QUERY_FILTER_REMOVED && filter != QUERY_FILTER_WITHOUT && filter != QUERY_FILTER_OPTIONAL;
+}
+
+/**
+ * Expects (name, size, ComponentId, access | filter << QUERY_TERM_FILTER_SHIFT)
+ * terms terminated by NULL. A query has at most one Removed term, and needs a
+ * term that is neither Without nor Optional.
+ */
 Query _query_new(const char *first, ...);
 
-// Helper macro to stringify each argument
-#define STRINGIFY(x) (#x), (u64)(sizeof(x))
-#define EXPAND_AND_STRINGIFY(x) STRINGIFY(x)
+void query_destroy(Query *query);
+
+// Query terms, e.g. query_new(Write(Position), Read(Velocity), Without(Frozen)).
+// Terms without a wrapper are read-write, and so are Optional terms. The other
+// filter terms are read-only, With and Without do not access the component.
+#define Read(type) (QUERY_ACCESS_READ, type)
+#define Write(type) (QUERY_ACCESS_WRITE, type)
+#define Changed(type) (QUERY_ACCESS_READ | QUERY_FILTER_CHANGED << QUERY_TERM_FILTER_SHIFT, type)
+#define Added(type) (QUERY_ACCESS_READ | QUERY_FILTER_ADDED << QUERY_TERM_FILTER_SHIFT, type)
+#define Removed(type) (QUERY_ACCESS_READ | QUERY_FILTER_REMOVED << QUERY_TERM_FILTER_SHIFT, type)
+#define With(type) (QUERY_ACCESS_READ | QUERY_FILTER_WITH << QUERY_TERM_FILTER_SHIFT, type)
+#define Without(type) (QUERY_ACCESS_READ | QUERY_FILTER_WITHOUT << QUERY_TERM_FILTER_SHIFT, type)
+#define Optional(type) (QUERY_ACCESS_WRITE | QUERY_FILTER_OPTIONAL << QUERY_TERM_FILTER_SHIFT, type)
+
+// Detect whether a term is wrapped: a wrapped term is a parenthesized list
+#define QUERY_PROBE(...) ~, 1
+#define QUERY_SECOND_(a, b, ...) b
+#define QUERY_SECOND(...) QUERY_SECOND_(__VA_ARGS__)
+#define QUERY_IS_WRAPPED(x) QUERY_SECOND(QUERY_PROBE x, 0, ~)
+
+#define QUERY_CAT_(a, b) a##b
+#define QUERY_CAT(a, b) QUERY_CAT_(a, b)
+
+// Expand each term to its name, size, id and access
+#define QUERY_TERM(x) QUERY_CAT(QUERY_TERM_, QUERY_IS_WRAPPED(x))(x)
+#define QUERY_TERM_0(type) (#type), (u64)(sizeof(type)), component_id(type), QUERY_ACCESS_WRITE
+#define QUERY_TERM_1(term) QUERY_TERM_WRAPPED term
+#define QUERY_TERM_WRAPPED(access, type) (#type), (u64)(sizeof(type)), component_id(type), access
 
 // Apply a macro to each argument
 #define MAP_1(m, x) m(x)
@@ -43,6 +133,6 @@ Query _query_new(const char *first, ...);
                   MAP_1)(m, __VA_ARGS__)
 
 // Final macro to use
-#define query_new(...) _query_new(MAP(EXPAND_AND_STRINGIFY, __VA_ARGS__), NULL)
+#define query_new(...) _query_new(MAP(QUERY_TERM, __VA_ARGS__), NULL)
 
 #endif // QUERY_H
@@ -0,0 +1,98 @@
+#include "slot_columns.h"
+#include "containers/darray.h"
+#include "core/assert.h"
+#include "ecs/archetype.h"
+#include "ecs/component_store.h"
+
+#include <string.h>
+
+// The added capacity is zeroed, slots without a component are still read
+// whole by blends and compares
+static void *grow(Allocator *allocator, void *array, u64 element_size, u32 old_capacity, u32 capacity) {
+    u64 old_size = (u64)old_capacity * element_size;
+    u64 new_size = (u64)capacity * element_size;
+    u8 *grown = allocator_reallocate(allocator, array, old_size, new_size, ALLOCATOR_DEFAULT_ALIGNMENT);
+    ASSERT(grown != NULL);
+    memset(grown + old_size, 0, new_size - old_size);
+    return grown;
+}
+
+void slot_columns_resize(SlotColumns *slots, Allocator *allocator, const u32 *sizes, u32 count, u32 slot_count) {
+    ASSERT(count <= SLOT_COLUMNS_MAX);
+    if (slot_count > slots->slot_capacity) {
+        u32 capacity = MAX(slot_count, slots->slot_capacity * 2);
+        slots->generations = grow(allocator, slots->generations, sizeof(u32), slots->slot_capacity, capacity);
+        slots->masks = grow(allocator, slots->masks, sizeof(u32), slots->slot_capacity, capacity);
+        for (u32 c = 0; c < count; c++) {
+            slots->columns[c] = grow(allocator, slots->columns[c], sizes[c], slots->slot_capacity, capacity);
+        }
+        slots->slot_capacity = capacity;
+    }
+
+    if (slot_count > slots->slot_count) {
+        u32 added = slot_count - slots->slot_count;
+        memset(slots->generations + slots->slot_count, 0, added * sizeof(u32));
+        memset(slots->masks + slots->slot_count, 0, added * sizeof(u32));
+    }
+    slots->slot_count = slot_count;
+}
+
+static void copy_to_column(SlotColumns *slots,
+                           u32 c,
+                           u32 size,
+                           const entity_index *entities,
+                           const u8 *components,
+                           u32 count) {
+    u8 *column = slots->columns[c];
+    for (u32 i = 0; i < count; i++) {
+        memcpy(column + (u64)entities[i] * size, components + (u64)i * size, size);
+        slots->masks[entities[i]] |= 1u << c;
+    }
+}
+
+void slot_columns_capture(SlotColumns *slots,
+                          Allocator *allocator,
+                          const World *world,
+                          const ComponentId *ids,
+                          const u32 *sizes,
+                          u32 count) {
+    u32 slot_count = darray_length(world->generations);
+    slot_columns_resize(slots, allocator, sizes, count, slot_count);
+    memcpy(slots->generations, world->generations, slot_count * sizeof(u32));
+    memset(slots->masks, 0, slot_count * sizeof(u32));
+
+    for (u32 c = 0; c < count; c++) {
+        if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+            const ComponentStore *store = &world->component_stores[ids[c]];
+            copy_to_column(slots, c, sizes[c], store->entities, store->component_array, store->component_count);
+            continue;
+        }
+
+        for (u32 a = 0; a < darray_length(world->archetypes); a++) {
+            const Archetype *archetype = &world->archetypes[a];
+            u32 column = archetype->column_of[ids[c]];
+            if (column == ARCHETYPE_NO_COLUMN) {
+                continue;
+            }
+
+            for (u32 k = 0; k < darray_length(archetype->chunks); k++) {
+                const ArchetypeChunk *chunk = archetype->chunks[k];
+                copy_to_column(slots,
+                               c,
+                               sizes[c],
+                               archetype_chunk_entities(chunk),
+                               archetype_chunk_column(archetype, chunk, column),
+                               chunk->count);
+            }
+        }
+    }
+}
+
+void slot_columns_destroy(SlotColumns *slots, Allocator *allocator, const u32 *sizes, u32 count) {
+    allocator_free(allocator, slots->generations, (u64)slots->slot_capacity * sizeof(u32));
+    allocator_free(allocator, slots->masks, (u64)slots->slot_capacity * sizeof(u32));
+    for (u32 c = 0; c < count; c++) {
+        allocator_free(allocator, slots->columns[c], (u64)slots->slot_capacity * sizes[c]);
+    }
+    *slots = (SlotColumns){0};
+}
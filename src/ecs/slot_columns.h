@@ -0,0 +1,49 @@
+#ifndef ECS_SLOT_COLUMNS_H
+#define ECS_SLOT_COLUMNS_H
+
+#include "core/allocator/allocator.h"
+#include "core/defines.h"
+#include "ecs/component_id.h"
+#include "ecs/world.h"
+
+// One bit per column in `masks`
+#define SLOT_COLUMNS_MAX 32
+
+/**
+ * Components of a world copied out by entity slot, the storage behind
+ * interpolation samples and replication frames. Every array is indexed by
+ * entity slot like World.generations, bit c of `masks` is set when the slot's
+ * entity had the component of column c. A column only holds valid bytes where
+ * the mask has its bit, the others stay zeroed or hold stale values.
+ *
+ * Zero-initialize before the first resize.
+ */
+typedef struct {
+    u32 slot_count;
+    u32 slot_capacity;
+    u32 *generations;
+    u32 *masks;
+    u8 *columns[SLOT_COLUMNS_MAX];
+} SlotColumns;
+
+/**
+ * Sets the slot count, growing every array when needed. Slots past the
+ * previous count start with generation and mask 0.
+ * @param sizes byte size of each column's component
+ */
+void slot_columns_resize(SlotColumns *slots, Allocator *allocator, const u32 *sizes, u32 count, u32 slot_count);
+
+/**
+ * Copies the world's generations and the components `ids` into the columns,
+ * resized to the world's slot count.
+ */
+void slot_columns_capture(SlotColumns *slots,
+                          Allocator *allocator,
+                          const World *world,
+                          const ComponentId *ids,
+                          const u32 *sizes,
+                          u32 count);
+
+void slot_columns_destroy(SlotColumns *slots, Allocator *allocator, const u32 *sizes, u32 count);
+
+#endif // ECS_SLOT_COLUMNS_H
@@ -0,0 +1,463 @@
+#include "snapshot.h"
+#include "containers/darray.h"
+#include "core/assert.h"
+#include "ecs/archetype.h"
+#include "ecs/component_mask.h"
+#include "ecs/component_store.h"
+#include "ecs/world.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_MAGIC 0x504E5357u // "WSNP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ALIGNMENT 64
+// offset of a delta section whose payload is the base's
+#define SNAPSHOT_FROM_BASE ((u64)-1)
+
+typedef enum {
+    SECTION_GENERATIONS,
+    SECTION_FREE_IDS,
+    SECTION_ENTITY_LOCATIONS,
+    SECTION_COMPONENT_STORE,
+    SECTION_ARCHETYPE,
+} SectionKind;
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u64 size;
+    // size of the snapshot a delta was taken against, 0 for full snapshots
+    u64 base_size;
+    u32 storage;
+    u32 section_count;
+    u32 tick;
+    u32 change_tick;
+} SnapshotHeader;
+
+/**
+ * Describes one payload. Component store payloads hold the components, the
+ * entities, the added ticks and the changed ticks, each array starting on a
+ * SNAPSHOT_ALIGNMENT boundary. Archetype payloads are whole chunks.
+ */
+typedef struct {
+    u32 kind;
+    // ComponentId of stores, archetype index of archetypes
+    u32 id;
+    // entities, components or archetype rows
+    u32 count;
+    // bytes per element, per chunk for archetypes
+    u32 element_size;
+    // from the start of the blob, or SNAPSHOT_FROM_BASE
+    u64 offset;
+    u64 size;
+    ComponentMask mask;
+} SnapshotSection;
+
+_Static_assert(sizeof(SnapshotHeader) <= SNAPSHOT_ALIGNMENT, "snapshot header does not fit");
+
+// A contiguous part of a section's payload
+typedef struct {
+    const void *data;
+    u64 size;
+    u64 offset;
+} SnapshotPiece;
+
+static u64 align_up(u64 value) { return (value + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT; }
+
+// Offsets of the four arrays of a component store payload
+static void store_layout(u32 count, u32 component_size, u64 offsets[4], u64 *size) {
+    offsets[0] = 0;
+    offsets[1] = align_up((u64)count * component_size);
+    offsets[2] = offsets[1] + align_up((u64)count * sizeof(entity_index));
+    offsets[3] = offsets[2] + align_up((u64)count * sizeof(u32));
+    *size = offsets[3] + (u64)count * sizeof(u32);
+}
+
+static SnapshotSection array_section(SectionKind kind, const void *array) {
+    return (SnapshotSection){
+        .kind = kind,
+        .count = darray_length(array),
+        .element_size = darray_stride(array),
+        .size = darray_size(array),
+    };
+}
+
+static void collect_sections(const World *world, darray(SnapshotSection) * sections) {
+    darray_push(*sections, array_section(SECTION_GENERATIONS, world->generations));
+    darray_push(*sections, array_section(SECTION_FREE_IDS, world->free_ids));
+
+    if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        for (ComponentId id = 0; id < darray_length(world->components); id++) {
+            if (world->components[id].name == NULL) {
+                continue;
+            }
+
+            const ComponentStore *store = &world->component_stores[id];
+            SnapshotSection section = {
+                .kind = SECTION_COMPONENT_STORE,
+                .id = id,
+                .count = store->component_count,
+                .element_size = store->component_size,
+            };
+            u64 offsets[4];
+            store_layout(section.count, section.element_size, offsets, &section.size);
+            darray_push(*sections, section);
+        }
+        return;
+    }
+
+    darray_push(*sections, array_section(SECTION_ENTITY_LOCATIONS, world->entity_locations));
+    for (u32 i = 0; i < darray_length(world->archetypes); i++) {
+        const Archetype *archetype = &world->archetypes[i];
+        darray_push(*sections,
+                    ((SnapshotSection){
+                        .kind = SECTION_ARCHETYPE,
+                        .id = i,
+                        .count = archetype->entity_count,
+                        .element_size = ARCHETYPE_CHUNK_SIZE,
+                        .size = (u64)darray_length(archetype->chunks) * ARCHETYPE_CHUNK_SIZE,
+                        .mask = archetype->mask,
+                    }));
+    }
+}
+
+/**
+ * The `index`-th piece of the world's data making up `section`.
+ * @return false once the section has no pieces left
+ */
+static b8 section_piece(const World *world, const SnapshotSection *section, u32 index, SnapshotPiece *piece) {
+    switch (section->kind) {
+    case SECTION_GENERATIONS:
+    case SECTION_FREE_IDS:
+    case SECTION_ENTITY_LOCATIONS: {
+        const void *arrays[] = {world->generations, world->free_ids, world->entity_locations};
+        *piece = (SnapshotPiece){.data = arrays[section->kind], .size = section->size, .offset = 0};
+        return index == 0;
+    }
+    case SECTION_COMPONENT_STORE: {
+        const ComponentStore *store = &world->component_stores[section->id];
+        const void *arrays[] = {store->component_array, store->entities, store->added_ticks, store->changed_ticks};
+        u64 offsets[4];
+        u64 size;
+        store_layout(section->count, section->element_size, offsets, &size);
+        if (index >= 4) {
+            return false;
+        }
+        u64 length = index == 0 ? (u64)section->count * section->element_size : (u64)section->count * sizeof(u32);
+        *piece = (SnapshotPiece){.data = arrays[index], .size = length, .offset = offsets[index]};
+        return true;
+    }
+    case SECTION_ARCHETYPE: {
+        const Archetype *archetype = &world->archetypes[section->id];
+        if (index >= darray_length(archetype->chunks)) {
+            return false;
+        }
+        *piece = (SnapshotPiece){
+            .data = archetype->chunks[index],
+            .size = ARCHETYPE_CHUNK_SIZE,
+            .offset = (u64)index * ARCHETYPE_CHUNK_SIZE,
+        };
+        return true;
+    }
+    }
+    return false;
+}
+
+static const SnapshotSection *snapshot_sections(const WorldSnapshot *snapshot) {
+    return (const SnapshotSection *)((const u8 *)snapshot->data + SNAPSHOT_ALIGNMENT);
+}
+
+/**
+ * Sections are written in the same order every time, so the search starts
+ * where the section was found last time.
+ */
+static const SnapshotSection *find_section(const WorldSnapshot *snapshot, u32 kind, u32 id, u32 hint) {
+    const SnapshotHeader *header = snapshot->data;
+    const SnapshotSection *sections = snapshot_sections(snapshot);
+    for (u32 i = 0; i < header->section_count; i++) {
+        const SnapshotSection *section = &sections[(hint + i) % header->section_count];
+        if (section->kind == kind && section->id == id) {
+            return section;
+        }
+    }
+    return NULL;
+}
+
+static b8 matches_base(const World *world, const SnapshotSection *section, const WorldSnapshot *base, u32 hint) {
+    const SnapshotSection *other = find_section(base, section->kind, section->id, hint);
+    if (other == NULL || other->count != section->count || other->element_size != section->element_size ||
+        other->size != section->size || !component_mask_equal(&other->mask, &section->mask)) {
+        return false;
+    }
+
+    const u8 *payload = (const u8 *)base->data + other->offset;
+    SnapshotPiece piece;
+    for (u32 i = 0; section_piece(world, section, i, &piece); i++) {
+        if (piece.size > 0 && memcmp(payload + piece.offset, piece.data, piece.size) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void world_snapshot_capture(const World *world, const WorldSnapshot *base, WorldSnapshot *snapshot) {
+    if (base != NULL) {
+        ASSERT_MSG(!world_snapshot_is_delta(base), "deltas must be taken against a full snapshot");
+    }
+
+    darray(SnapshotSection) sections = darray_new(SnapshotSection);
+    collect_sections(world, &sections);
+    u32 section_count = darray_length(sections);
+
+    u64 size = align_up(SNAPSHOT_ALIGNMENT + sizeof(SnapshotSection) * section_count);
+    for (u32 i = 0; i < section_count; i++) {
+        if (base != NULL && matches_base(world, &sections[i], base, i)) {
+            sections[i].offset = SNAPSHOT_FROM_BASE;
+            continue;
+        }
+        sections[i].offset = size;
+        size = align_up(size + sections[i].size);
+    }
+
+    if (snapshot->capacity < size) {
+        free(snapshot->data);
+        snapshot->data = aligned_alloc(SNAPSHOT_ALIGNMENT, size);
+        ASSERT(snapshot->data != NULL);
+        snapshot->capacity = size;
+    }
+    snapshot->size = size;
+
+    u8 *data = snapshot->data;
+    *(SnapshotHeader *)data = (SnapshotHeader){
+        .magic = SNAPSHOT_MAGIC,
+        .version = SNAPSHOT_VERSION,
+        .size = size,
+        .base_size = base != NULL ? base->size : 0,
+        .storage = world->storage,
+        .section_count = section_count,
+        .tick = world->tick,
+        .change_tick = world->change_tick,
+    };
+    memcpy(data + SNAPSHOT_ALIGNMENT, sections, sizeof(SnapshotSection) * section_count);
+
+    for (u32 i = 0; i < section_count; i++) {
+        if (sections[i].offset == SNAPSHOT_FROM_BASE) {
+            continue;
+        }
+        SnapshotPiece piece;
+        for (u32 p = 0; section_piece(world, &sections[i], p, &piece); p++) {
+            if (piece.size > 0) {
+                memcpy(data + sections[i].offset + piece.offset, piece.data, piece.size);
+            }
+        }
+    }
+
+    darray_destroy(sections);
+}
+
+// Copies the payload into a darray of the same element type
+static void *restore_array(void *array, const SnapshotSection *section, const u8 *payload) {
+    ASSERT_MSG(section->element_size == darray_stride(array), "snapshot array has a different element size");
+
+    if (darray_length(array) == section->count && memcmp(array, payload, section->size) == 0) {
+        return array;
+    }
+
+    darray_resize_uninit(array, section->count);
+    if (section->size > 0) {
+        memcpy(array, payload, section->size);
+    }
+    return array;
+}
+
+static void stamp_changed(u32 *ticks, u32 count, u32 tick) {
+    for (u32 i = 0; i < count; i++) {
+        ticks[i] = tick;
+    }
+}
+
+/**
+ * @return true when components moved, which invalidates pointers to them
+ */
+static b8 restore_store(World *world, const SnapshotSection *section, const u8 *payload) {
+    ASSERT_MSG(section->id < darray_length(world->components) && world->components[section->id].name != NULL &&
+                   world->components[section->id].size == section->element_size,
+               "snapshot component is not registered with this world");
+
+    ComponentStore *store = &world->component_stores[section->id];
+    u64 offsets[4];
+    u64 size;
+    store_layout(section->count, section->element_size, offsets, &size);
+
+    const entity_index *entities = (const entity_index *)(payload + offsets[1]);
+    b8 same_keys = store->component_count == section->count &&
+                   memcmp(store->entities, entities, sizeof(entity_index) * section->count) == 0;
+    if (same_keys && memcmp(store->component_array, payload, (u64)section->count * section->element_size) == 0) {
+        return false;
+    }
+
+    u32 capacity_before = store->component_capacity;
+    component_store_restore(store,
+                            section->count,
+                            payload,
+                            entities,
+                            (const u32 *)(payload + offsets[2]),
+                            (const u32 *)(payload + offsets[3]));
+    stamp_changed(store->changed_ticks, store->component_count, world->change_tick);
+
+    return !same_keys || store->component_capacity != capacity_before;
+}
+
+/**
+ * @return true when rows changed, which invalidates pointers to components
+ */
+static b8 restore_archetype(World *world, u32 target, const SnapshotSection *section, const u8 *payload) {
+    Archetype *archetype = &world->archetypes[target];
+    u32 chunk_count = section->size / ARCHETYPE_CHUNK_SIZE;
+
+    b8 same_rows = archetype->entity_count == section->count;
+    b8 same_bytes = same_rows;
+    for (u32 c = 0; same_rows && c < chunk_count; c++) {
+        const ArchetypeChunk *chunk = archetype->chunks[c];
+        const ArchetypeChunk *captured = (const ArchetypeChunk *)(payload + (u64)c * ARCHETYPE_CHUNK_SIZE);
+        same_rows = memcmp(archetype_chunk_entities(chunk),
+                           archetype_chunk_entities(captured),
+                           sizeof(entity_index) * chunk->count) == 0;
+        same_bytes = same_bytes && same_rows && memcmp(chunk, captured, ARCHETYPE_CHUNK_SIZE) == 0;
+    }
+    if (same_bytes) {
+        return false;
+    }
+
+    archetype_restore(archetype, section->count, payload);
+    for (u32 c = 0; c < chunk_count; c++) {
+        ArchetypeChunk *chunk = archetype->chunks[c];
+        for (u32 column = 0; column < darray_length(archetype->component_ids); column++) {
+            stamp_changed(archetype_chunk_changed_ticks(archetype, chunk, column), chunk->count, world->change_tick);
+        }
+    }
+
+    return !same_rows;
+}
+
+static const u8 *section_payload(const WorldSnapshot *snapshot,
+                                 const WorldSnapshot *base,
+                                 const SnapshotSection *section,
+                                 u32 hint) {
+    if (section->offset != SNAPSHOT_FROM_BASE) {
+        return (const u8 *)snapshot->data + section->offset;
+    }
+
+    const SnapshotSection *other = find_section(base, section->kind, section->id, hint);
+    ASSERT_MSG(other != NULL && other->size == section->size, "delta does not belong to this base snapshot");
+    return (const u8 *)base->data + other->offset;
+}
+
+void world_snapshot_restore(World *world, const WorldSnapshot *snapshot, const WorldSnapshot *base) {
+    const SnapshotHeader *header = snapshot->data;
+    ASSERT_MSG(header->magic == SNAPSHOT_MAGIC && header->version == SNAPSHOT_VERSION && header->size == snapshot->size,
+               "not a world snapshot");
+    ASSERT_MSG(header->storage == world->storage, "snapshot was taken of a world with a different storage");
+    ASSERT_MSG(header->base_size == 0 || (base != NULL && base->size == header->base_size),
+               "a delta can only be restored with its base snapshot");
+
+    const SnapshotSection *sections = snapshot_sections(snapshot);
+    b8 *stores_restored = calloc(darray_length(world->components) + 1, sizeof(b8));
+    // archetype index in the snapshot -> archetype index in this world
+    darray(u32) archetype_map = darray_new(u32);
+    b8 remap_locations = false;
+    b8 moved = false;
+
+    for (u32 i = 0; i < header->section_count; i++) {
+        const SnapshotSection *section = &sections[i];
+        const u8 *payload = section_payload(snapshot, base, section, i);
+
+        switch (section->kind) {
+        case SECTION_GENERATIONS:
+            world->generations = restore_array(world->generations, section, payload);
+            break;
+        case SECTION_FREE_IDS:
+            world->free_ids = restore_array(world->free_ids, section, payload);
+            break;
+        case SECTION_ENTITY_LOCATIONS:
+            world->entity_locations = restore_array(world->entity_locations, section, payload);
+            break;
+        case SECTION_COMPONENT_STORE:
+            moved |= restore_store(world, section, payload);
+            stores_restored[section->id] = true;
+            break;
+        case SECTION_ARCHETYPE: {
+            u32 target = section->id;
+            if (target >= darray_length(world->archetypes) ||
+                !component_mask_equal(&world->archetypes[target].mask, &section->mask)) {
+                target = world_find_or_create_archetype(world, &section->mask);
+            }
+            if (darray_length(archetype_map) <= section->id) {
+                darray_push_n(archetype_map, ARCHETYPE_INVALID, section->id + 1 - darray_length(archetype_map));
+            }
+            archetype_map[section->id] = target;
+            remap_locations |= target != section->id;
+
+            moved |= restore_archetype(world, target, section, payload);
+            break;
+        }
+        }
+    }
+
+    // whatever was not captured did not exist yet
+    if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        for (ComponentId id = 0; id < darray_length(world->components); id++) {
+            ComponentStore *store = &world->component_stores[id];
+            if (world->components[id].name != NULL && !stores_restored[id] && store->component_count > 0) {
+                component_store_restore(store, 0, NULL, NULL, NULL, NULL);
+                moved = true;
+            }
+        }
+    } else {
+        b8 *archetypes_restored = calloc(darray_length(world->archetypes) + 1, sizeof(b8));
+        for (u32 i = 0; i < darray_length(archetype_map); i++) {
+            if (archetype_map[i] != ARCHETYPE_INVALID) {
+                archetypes_restored[archetype_map[i]] = true;
+            }
+        }
+        for (u32 i = 0; i < darray_length(world->archetypes); i++) {
+            if (!archetypes_restored[i] && world->archetypes[i].entity_count > 0) {
+                archetype_restore(&world->archetypes[i], 0, NULL);
+                moved = true;
+            }
+        }
+        free(archetypes_restored);
+    }
+
+    if (remap_locations) {
+        for (u32 i = 0; i < darray_length(world->entity_locations); i++) {
+            EntityLocation *location = &world->entity_locations[i];
+            if (location->archetype != ARCHETYPE_INVALID) {
+                location->archetype = archetype_map[location->archetype];
+            }
+        }
+    }
+
+    // the change tick only moves forward, so systems see restored components
+    // as changed rather than as older than their last run
+    world->tick = header->tick;
+    if (moved) {
+        world->structure_version++;
+        for (ComponentId id = 0; id < darray_length(world->components); id++) {
+            world->components[id].structure_version++;
+        }
+    }
+
+    darray_destroy(archetype_map);
+    free(stores_restored);
+}
+
+b8 world_snapshot_is_delta(const WorldSnapshot *snapshot) {
+    return ((const SnapshotHeader *)snapshot->data)->base_size != 0;
+}
+
+void world_snapshot_destroy(WorldSnapshot *snapshot) {
+    free(snapshot->data);
+    *snapshot = (WorldSnapshot){0};
+}
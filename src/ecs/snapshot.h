@@ -0,0 +1,47 @@
+#ifndef ECS_SNAPSHOT_H
+#define ECS_SNAPSHOT_H
+
+#include "core/defines.h"
+#include "ecs/world.h"
+
+/**
+ * The entities and components of a world copied into one allocation: entity
+ * generations, free slots, and the dense arrays of every component store or
+ * the chunks of every archetype. The blob holds offsets instead of pointers,
+ * so it can be kept for rollback, written to disk or sent as is, and restored
+ * into any world with the same storage that registered the same components
+ * (component ids are handed out in registration order).
+ *
+ * A delta snapshot leaves out every store, archetype and entity array whose
+ * bytes equal those of the full snapshot it was taken against.
+ *
+ * Zero-initialize before the first capture.
+ */
+typedef struct {
+    void *data;
+    u64 size;
+    u64 capacity;
+} WorldSnapshot;
+
+/**
+ * Captures `world` into `snapshot`, reusing its allocation when it is large
+ * enough. Every part is copied with one memcpy per array or archetype chunk.
+ * @param base a full snapshot to take a delta against, or NULL
+ */
+void world_snapshot_capture(const World *world, const WorldSnapshot *base, WorldSnapshot *snapshot);
+
+/**
+ * Puts the entities and components of `world` back into the captured state.
+ * Stores and archetypes that already hold the captured bytes are left alone,
+ * the others are copied back and their components stamped as changed at the
+ * current change tick; the removal log is not touched. Like attach and
+ * detach, this must not be called while systems run.
+ * @param base the snapshot a delta was taken against, NULL for full snapshots
+ */
+void world_snapshot_restore(World *world, const WorldSnapshot *snapshot, const WorldSnapshot *base);
+
+b8 world_snapshot_is_delta(const WorldSnapshot *snapshot);
+
+void world_snapshot_destroy(WorldSnapshot *snapshot);
+
+#endif // ECS_SNAPSHOT_H
@@ -8,8 +8,11 @@
 #define MAX_REQUIRED_COMPONENTS 8
 
 typedef enum {
-    // TODO: add more system flags
+    // the system simulates replicated state, so only the server runs it and
+    // replica worlds skip it
     SYSTEM_FLAG_NETWORKED = 1 << 0,
+    // the system may process disjoint entity ranges on several threads at once
+    SYSTEM_FLAG_PARALLEL = 1 << 1,
 } SystemFlag;
 
 typedef enum {
@@ -17,14 +20,33 @@ typedef enum {
     SYSTEM_SCHEDULE_UPDATE,
 } SystemSchedule;
 
+typedef struct EcsCommandBuffer EcsCommandBuffer;
+
+/**
+ * Given to systems that take a context. `commands` belongs to the thread
+ * running the system, structural changes recorded in it are applied once the
+ * current schedule has finished.
+ */
+typedef struct {
+    entity_id entity;
+    EcsCommandBuffer *commands;
+} SystemContext;
+
 typedef void (*system_run)(void **components);
 
+typedef void (*system_run_with_context)(SystemContext *context, void **components);
+
 typedef struct {
     const char *name;
     Query query;
+    // exactly one of `fn` and `fn_with_context` is set
     system_run fn;
+    system_run_with_context fn_with_context;
     SystemSchedule schedule;
     SystemFlag flags;
+    // world change tick of the system's previous run, set by world_run and
+    // compared against by the Changed, Added and Removed query filters
+    u32 last_run_tick;
 } SystemInfo;
 
 #endif // SYSTEM_H
@@ -0,0 +1,349 @@
+#include "transform.h"
+#include "containers/darray.h"
+#include "core/assert.h"
+#include "core/job_pool.h"
+#include "ecs/component_id.h"
+#include "ecs/entity.h"
+#include "ecs/world.h"
+
+#include <stdlib.h>
+
+#define NO_PARENT ((u32)-1)
+
+// Nodes handed to one job, trees are never split between jobs
+#define TRANSFORM_BATCH_NODES 8192
+
+typedef struct {
+    const LocalTransform *local;
+    const u32 *local_changed_tick;
+    GlobalTransform *global;
+    u32 *global_changed_tick;
+    // index of the parent's node, always smaller than this node's
+    u32 parent;
+} TransformNode;
+
+/**
+ * Every tree flattened breadth first, one tree after the other, so a single
+ * forward pass sees each parent before its children. The component pointers
+ * stay valid until the structure version of a transform component changes.
+ */
+struct TransformHierarchy {
+    darray(TransformNode) nodes;
+    // nodes [batch_offsets[i], batch_offsets[i + 1]) are whole trees
+    // propagated by one job
+    darray(u32) batch_offsets;
+    // per node, whether its GlobalTransform was recomputed this pass
+    b8 *dirty;
+    // hierarchy_version() when the nodes were last built
+    u32 hierarchy_version;
+    u32 last_tick;
+    b8 built;
+};
+
+typedef struct {
+    TransformHierarchy *hierarchy;
+    u32 begin;
+    u32 end;
+    u32 since;
+    u32 tick;
+} PropagateBatch;
+
+void transform_enable(World *world) {
+    if (world->transforms != NULL) {
+        return;
+    }
+
+    world_register_component(world, LocalTransform);
+    world_register_component(world, GlobalTransform);
+    world_register_component(world, Parent);
+    world_register_component(world, Children);
+
+    TransformHierarchy *hierarchy = malloc(sizeof(TransformHierarchy));
+    ASSERT(hierarchy != NULL);
+    *hierarchy = (TransformHierarchy){
+        .nodes = darray_new(TransformNode),
+        .batch_offsets = darray_new(u32),
+        .dirty = NULL,
+        .hierarchy_version = 0,
+        .last_tick = 0,
+        .built = false,
+    };
+    world->transforms = hierarchy;
+}
+
+void transform_hierarchy_destroy(TransformHierarchy *hierarchy) {
+    darray_destroy(hierarchy->nodes);
+    darray_destroy(hierarchy->batch_offsets);
+    free(hierarchy->dirty);
+    free(hierarchy);
+}
+
+static b8 is_ancestor(const World *world, entity_id ancestor, entity_id entity) {
+    for (const Parent *parent = world_get_component(world, entity, Parent); parent != NULL;
+         parent = world_get_component(world, parent->entity, Parent)) {
+        if (parent->entity == ancestor) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Takes the child out of its parent's list and detaches its Parent
+static void unlink_from_parent(World *world, entity_id child) {
+    const Parent *parent = world_get_component(world, child, Parent);
+    if (parent == NULL) {
+        return;
+    }
+    Parent link = *parent;
+
+    if (link.previous_sibling != ENTITY_INVALID) {
+        world_get_component(world, link.previous_sibling, Parent)->next_sibling = link.next_sibling;
+    }
+    if (link.next_sibling != ENTITY_INVALID) {
+        world_get_component(world, link.next_sibling, Parent)->previous_sibling = link.previous_sibling;
+    }
+
+    // the parent may already be gone
+    Children *children = world_get_component(world, link.entity, Children);
+    if (children != NULL) {
+        if (link.previous_sibling == ENTITY_INVALID) {
+            children->first = link.next_sibling;
+        }
+        if (--children->count == 0) {
+            world_detach_component(world, link.entity, Children);
+        }
+    }
+
+    world_detach_component(world, child, Parent);
+}
+
+void transform_set_parent(World *world, entity_id child, entity_id parent) {
+    ASSERT_MSG(world->transforms != NULL, "transforms are not enabled for this world");
+    ASSERT_MSG(world_is_valid_entity(world, child) && world_is_valid_entity(world, parent), "stale entity handle");
+    ASSERT_MSG(child != parent && !is_ancestor(world, child, parent), "transform hierarchy would contain a cycle");
+
+    unlink_from_parent(world, child);
+
+    // read before attaching, attaching may move the parent's components
+    const Children *children = world_get_component(world, parent, Children);
+    Children updated = {.first = child, .count = 1};
+    if (children != NULL) {
+        updated.count += children->count;
+        world_get_component(world, children->first, Parent)->previous_sibling = child;
+    }
+
+    world_attach_component(world,
+                           child,
+                           Parent,
+                           ((Parent){
+                               .entity = parent,
+                               .previous_sibling = ENTITY_INVALID,
+                               .next_sibling = children != NULL ? children->first : ENTITY_INVALID,
+                           }));
+    world_attach_component(world, parent, Children, updated);
+
+    // the new parent's transform applies from the next propagation on
+    world_mark_changed(world, child, LocalTransform);
+}
+
+void transform_remove_parent(World *world, entity_id child) {
+    ASSERT_MSG(world->transforms != NULL, "transforms are not enabled for this world");
+
+    unlink_from_parent(world, child);
+    world_mark_changed(world, child, LocalTransform);
+}
+
+void transform_unlink(World *world, entity_id entity) {
+    ASSERT_MSG(world->transforms != NULL, "transforms are not enabled for this world");
+
+    unlink_from_parent(world, entity);
+
+    const Children *children = world_get_component(world, entity, Children);
+    entity_id child = children != NULL ? children->first : ENTITY_INVALID;
+    while (child != ENTITY_INVALID) {
+        entity_id next = world_get_component(world, child, Parent)->next_sibling;
+        world_detach_component(world, child, Parent);
+        world_mark_changed(world, child, LocalTransform);
+        child = next;
+    }
+    world_detach_component(world, entity, Children);
+}
+
+void transform_destroy_recursive(World *world, entity_id entity) {
+    ASSERT_MSG(world->transforms != NULL, "transforms are not enabled for this world");
+
+    if (!world_is_valid_entity(world, entity)) {
+        return;
+    }
+
+    darray(entity_id) stack = darray_new(entity_id);
+    darray_push(stack, entity);
+    while (darray_length(stack) > 0) {
+        entity_id current;
+        darray_pop(stack, &current);
+
+        const Children *children = world_get_component(world, current, Children);
+        entity_id child = children != NULL ? children->first : ENTITY_INVALID;
+        while (child != ENTITY_INVALID) {
+            darray_push(stack, child);
+            child = world_get_component(world, child, Parent)->next_sibling;
+        }
+
+        // unlinks the children, they are destroyed next
+        world_destroy_entity(world, current);
+    }
+    darray_destroy(stack);
+}
+
+static b8 resolve_node(const World *world, entity_id entity, u32 parent, TransformNode *node) {
+    LocalTransform *local = world_get_component(world, entity, LocalTransform);
+    GlobalTransform *global = world_get_component(world, entity, GlobalTransform);
+    if (local == NULL || global == NULL) {
+        return false;
+    }
+
+    *node = (TransformNode){
+        .local = local,
+        .local_changed_tick = world_get_changed_tick_by_id(world, entity, component_id(LocalTransform)),
+        .global = global,
+        .global_changed_tick = world_get_changed_tick_by_id(world, entity, component_id(GlobalTransform)),
+        .parent = parent,
+    };
+    return true;
+}
+
+// Entities whose parent does not take part in propagation count as roots
+static b8 is_root(const World *world, entity_id entity) {
+    const Parent *parent = world_get_component(world, entity, Parent);
+    return parent == NULL || world_get_component(world, parent->entity, LocalTransform) == NULL ||
+           world_get_component(world, parent->entity, GlobalTransform) == NULL;
+}
+
+// Changes whenever one of the transform components does
+static u32 hierarchy_version(const World *world) {
+    return world->components[component_id(LocalTransform)].structure_version +
+           world->components[component_id(GlobalTransform)].structure_version +
+           world->components[component_id(Parent)].structure_version +
+           world->components[component_id(Children)].structure_version;
+}
+
+static void rebuild(World *world, TransformHierarchy *hierarchy) {
+    darray_clear(hierarchy->nodes);
+    darray_clear(hierarchy->batch_offsets);
+    darray_push(hierarchy->batch_offsets, 0);
+
+    // entity of every node, the queue of the breadth first walks
+    darray(entity_id) entities = darray_new(entity_id);
+    u32 batch_start = 0;
+
+    for (entity_index index = 0; index < darray_length(world->generations); index++) {
+        entity_id root = entity_make(index, world->generations[index]);
+        TransformNode node;
+        if (!is_root(world, root) || !resolve_node(world, root, NO_PARENT, &node)) {
+            continue;
+        }
+
+        darray_push(hierarchy->nodes, node);
+        darray_push(entities, root);
+
+        for (u32 n = darray_length(hierarchy->nodes) - 1; n < darray_length(hierarchy->nodes); n++) {
+            const Children *children = world_get_component(world, entities[n], Children);
+            entity_id child = children != NULL ? children->first : ENTITY_INVALID;
+            while (child != ENTITY_INVALID) {
+                if (resolve_node(world, child, n, &node)) {
+                    darray_push(hierarchy->nodes, node);
+                    darray_push(entities, child);
+                }
+                child = world_get_component(world, child, Parent)->next_sibling;
+            }
+        }
+
+        if (darray_length(hierarchy->nodes) - batch_start >= TRANSFORM_BATCH_NODES) {
+            batch_start = darray_length(hierarchy->nodes);
+            darray_push(hierarchy->batch_offsets, batch_start);
+        }
+    }
+
+    if (darray_length(hierarchy->nodes) > batch_start) {
+        darray_push(hierarchy->batch_offsets, darray_length(hierarchy->nodes));
+    }
+    darray_destroy(entities);
+
+    free(hierarchy->dirty);
+    hierarchy->dirty = malloc(MAX(darray_length(hierarchy->nodes), 1));
+    ASSERT(hierarchy->dirty != NULL);
+
+    hierarchy->hierarchy_version = hierarchy_version(world);
+    hierarchy->built = true;
+}
+
+// translation * rotation * scale
+static mat4s local_matrix(const LocalTransform *local) {
+    mat4s matrix = quat_mat4(local->rotation);
+    for (u32 column = 0; column < 3; column++) {
+        for (u32 row = 0; row < 3; row++) {
+            matrix.raw[column][row] *= local->scale.raw[column];
+        }
+    }
+    matrix.raw[3][0] = local->translation.x;
+    matrix.raw[3][1] = local->translation.y;
+    matrix.raw[3][2] = local->translation.z;
+    return matrix;
+}
+
+static void propagate_nodes(TransformHierarchy *hierarchy, u32 begin, u32 end, u32 since, u32 tick) {
+    const TransformNode *nodes = hierarchy->nodes;
+    b8 *dirty = hierarchy->dirty;
+
+    for (u32 n = begin; n < end; n++) {
+        const TransformNode *node = &nodes[n];
+        // ticks wrap around, see the Changed query filter
+        dirty[n] = (i32)(*node->local_changed_tick - since) > 0 || (node->parent != NO_PARENT && dirty[node->parent]);
+        if (!dirty[n]) {
+            continue;
+        }
+
+        mat4s local = local_matrix(node->local);
+        node->global->matrix = node->parent == NO_PARENT ? local : mat4_mul(nodes[node->parent].global->matrix, local);
+        *node->global_changed_tick = tick;
+    }
+}
+
+static void propagate_job(void *data) {
+    const PropagateBatch *batch = data;
+    propagate_nodes(batch->hierarchy, batch->begin, batch->end, batch->since, batch->tick);
+}
+
+void transform_propagate(World *world) {
+    TransformHierarchy *hierarchy = world->transforms;
+    ASSERT_MSG(hierarchy != NULL, "transforms are not enabled for this world");
+
+    if (!hierarchy->built || hierarchy->hierarchy_version != hierarchy_version(world)) {
+        rebuild(world, hierarchy);
+    }
+
+    u32 since = hierarchy->last_tick;
+    u32 tick = world->change_tick++;
+    hierarchy->last_tick = tick;
+
+    u32 batch_count = darray_length(hierarchy->batch_offsets) - 1;
+    if (world->job_pool == NULL || batch_count <= 1) {
+        propagate_nodes(hierarchy, 0, darray_length(hierarchy->nodes), since, tick);
+        return;
+    }
+
+    PropagateBatch *batches = malloc(sizeof(PropagateBatch) * batch_count);
+    JobCounter counter = {0};
+    for (u32 i = 0; i < batch_count; i++) {
+        batches[i] = (PropagateBatch){
+            .hierarchy = hierarchy,
+            .begin = hierarchy->batch_offsets[i],
+            .end = hierarchy->batch_offsets[i + 1],
+            .since = since,
+            .tick = tick,
+        };
+        job_pool_submit(world->job_pool, (Job){.fn = propagate_job, .data = &batches[i], .counter = &counter});
+    }
+    job_pool_wait(world->job_pool, &counter);
+    free(batches);
+}
@@ -0,0 +1,83 @@
+#ifndef ECS_TRANSFORM_H
+#define ECS_TRANSFORM_H
+
+#include "core/defines.h"
+#include "ecs/entity.h"
+#include "ecs/world.h"
+
+// Transform of an entity relative to its parent, or to the world for roots
+typedef struct {
+    vec3s translation;
+    versors rotation;
+    vec3s scale;
+} LocalTransform;
+
+// Written by transform_propagate: the parent's GlobalTransform times the
+// entity's LocalTransform
+typedef struct {
+    mat4s matrix;
+} GlobalTransform;
+
+// Children of one parent form a list through their Parent components
+typedef struct {
+    entity_id entity;
+    entity_id previous_sibling;
+    entity_id next_sibling;
+} Parent;
+
+typedef struct {
+    entity_id first;
+    u32 count;
+} Children;
+
+static inline LocalTransform local_transform_identity(void) {
+    return (LocalTransform){
+        .translation = vec3_zero(),
+        .rotation = quat_identity(),
+        .scale = vec3_one(),
+    };
+}
+
+/**
+ * Registers the transform components and makes world_run propagate them after
+ * every UPDATE schedule. Only entities with both a LocalTransform and a
+ * GlobalTransform take part.
+ */
+void transform_enable(World *world);
+
+void transform_hierarchy_destroy(TransformHierarchy *hierarchy);
+
+/**
+ * Makes `child` a child of `parent`, detaching it from its previous parent.
+ * Like attach and detach, this must not be called while systems run.
+ */
+void transform_set_parent(World *world, entity_id child, entity_id parent);
+
+/**
+ * Turns `child` back into a root.
+ */
+void transform_remove_parent(World *world, entity_id child);
+
+/**
+ * Destroys the entity and all of its descendants.
+ */
+void transform_destroy_recursive(World *world, entity_id entity);
+
+/**
+ * Takes the entity out of its parent's children and turns its own children
+ * into roots. world_destroy_entity calls this for worlds with transforms
+ * enabled, so no sibling stays linked to a dead entity.
+ */
+void transform_unlink(World *world, entity_id entity);
+
+/**
+ * Recomputes the GlobalTransform of every entity whose LocalTransform, or
+ * that of an ancestor, changed since the previous propagation. Hierarchies
+ * are kept flattened in depth order and are only rebuilt when an entity
+ * gains or loses a transform component or such components move in storage,
+ * other structural changes leave them alone. Separate roots are spread over
+ * the world's job pool.
+ */
+void transform_propagate(World *world);
+
+#endif // ECS_TRANSFORM_H
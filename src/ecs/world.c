@@ -1,43 +1,536 @@
 #include "world.h"
 #include "containers/darray.h"
+#include "core/allocator/memory_tracker.h"
 #include "core/assert.h"
+#include "ecs/archetype.h"
+#include "ecs/command_buffer.h"
+#include "ecs/component_mask.h"
 #include "ecs/component_store.h"
 #include "ecs/entity.h"
+#include "ecs/interpolation.h"
+#include "ecs/query.h"
 #include "ecs/system.h"
+#include "ecs/transform.h"
 
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <string.h>
 
-World world_new(void) {
-    return (World){
-        .component_stores = darray_new(ComponentStore),
-        .free_ids = darray_new(entity_id),
-        .systems = darray_new(SystemInfo),
-        .next_id = 0,
+static b8 is_registered(const World *world, ComponentId id) {
+    return id < darray_length(world->components) && world->components[id].name != NULL;
+}
+
+static b8 queries_conflict(const Query *a, const Query *b) {
+    for (u32 i = 0; i < a->count; i++) {
+        for (u32 j = 0; j < b->count; j++) {
+            if (a->ids[i] != b->ids[j] || !query_term_accesses(a, i) || !query_term_accesses(b, j)) {
+                continue;
+            }
+            if (a->access[i] == QUERY_ACCESS_WRITE || b->access[j] == QUERY_ACCESS_WRITE) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static b8 query_matches_archetype(const Query *query, const Archetype *archetype) {
+    return component_mask_contains(&archetype->mask, &query->mask) &&
+           !component_mask_intersects(&archetype->mask, &query->excluded);
+}
+
+// Looks the component sizes up once every component of the query is registered
+static void query_cache_resolve(const World *world, const Query *query, QueryCache *cache) {
+    for (u32 i = 0; i < query->count; i++) {
+        if (!is_registered(world, query->ids[i])) {
+            return;
+        }
+    }
+
+    for (u32 i = 0; i < query->count; i++) {
+        cache->component_sizes[i] = world->components[query->ids[i]].size;
+    }
+    cache->resolved = true;
+}
+
+static QueryCache query_cache_new(const World *world, const SystemInfo *system) {
+    const Query *query = &system->query;
+    QueryCache cache = {
+        .archetypes = darray_new_with(u32, world->allocator),
+        .dependencies = darray_new_with(u32, world->allocator),
+        .required_count = 0,
+        .filtered_count = 0,
+        .write_count = 0,
+        .removed_term = QUERY_NO_TERM,
+        .resolved = false,
     };
+
+    for (u32 i = 0; i < query->count; i++) {
+        switch (query->filters[i]) {
+        case QUERY_FILTER_CHANGED:
+        case QUERY_FILTER_ADDED:
+            cache.filtered_terms[cache.filtered_count++] = i;
+            break;
+        case QUERY_FILTER_REMOVED:
+            cache.removed_term = i;
+            break;
+        default:
+            break;
+        }
+
+        if (query->access[i] == QUERY_ACCESS_WRITE && query_term_accesses(query, i)) {
+            cache.write_terms[cache.write_count++] = i;
+        }
+    }
+
+    // Changed and Added terms go first, they win a tie for driving the walk
+    // since unmatched entities only cost a tick read there
+    for (u32 f = 0; f < cache.filtered_count; f++) {
+        cache.required_terms[cache.required_count++] = cache.filtered_terms[f];
+    }
+    for (u32 i = 0; i < query->count; i++) {
+        QueryFilter filter = query->filters[i];
+        if (query_term_is_required(query, i) && filter != QUERY_FILTER_CHANGED && filter != QUERY_FILTER_ADDED) {
+            cache.required_terms[cache.required_count++] = i;
+        }
+    }
+
+    query_cache_resolve(world, query, &cache);
+
+    for (u32 a = 0; a < darray_length(world->archetypes); a++) {
+        if (query_matches_archetype(query, &world->archetypes[a])) {
+            darray_push(cache.archetypes, a);
+        }
+    }
+
+    // a system depends on every earlier system it conflicts with
+    for (u32 s = 0; s < darray_length(world->systems); s++) {
+        if (world->systems[s].schedule == system->schedule && queries_conflict(&world->systems[s].query, query)) {
+            darray_push(cache.dependencies, s);
+        }
+    }
+
+    return cache;
+}
+
+static void query_cache_destroy(QueryCache *cache) {
+    darray_destroy(cache->archetypes);
+    darray_destroy(cache->dependencies);
+}
+
+World world_new(void) { return world_new_with_storage(WORLD_STORAGE_COMPONENT_STORE); }
+
+World world_new_with_storage(WorldStorage storage) {
+    return world_new_with_allocator(storage, memory_tag_allocator(MEMORY_TAG_ECS));
+}
+
+World world_new_with_allocator(WorldStorage storage, Allocator *allocator) {
+    World world = {
+        .storage = storage,
+        .allocator = allocator,
+        .components = darray_new_with(ComponentInfo, allocator),
+        .component_stores = darray_new_with(ComponentStore, allocator),
+        .archetypes = darray_new_with(Archetype, allocator),
+        .entity_locations = darray_new_with(EntityLocation, allocator),
+        .generations = darray_new_with(u32, allocator),
+        .free_ids = darray_new_with(entity_index, allocator),
+        .systems = darray_new_with(SystemInfo, allocator),
+        .query_caches = darray_new_with(QueryCache, allocator),
+        .command_buffers = NULL,
+        .removed_components = darray_new_with(RemovedComponent *, allocator),
+        .job_pool = NULL,
+        .transforms = NULL,
+        .interpolation = NULL,
+        .frame_allocator = frame_allocator_new_with(WORLD_FRAME_BLOCK_SIZE, allocator),
+        .structure_version = 0,
+        .tick = 0,
+        // systems start at last_run_tick 0, so everything created before the
+        // first run counts as added
+        .change_tick = 1,
+        .last_tick_check = 1,
+        .has_started = false,
+        .is_replica = false,
+    };
+    world.command_buffers = darray_new(EcsCommandBuffer);
+    darray_push(world.command_buffers, ecs_command_buffer_new());
+    return world;
 }
 
 void world_destroy(World *world) {
     for (u32 i = 0; i < darray_length(world->component_stores); i++) {
         component_store_destroy(&world->component_stores[i]);
     }
+    for (u32 i = 0; i < darray_length(world->archetypes); i++) {
+        archetype_destroy(&world->archetypes[i]);
+    }
+    for (u32 i = 0; i < darray_length(world->systems); i++) {
+        query_destroy(&world->systems[i].query);
+        query_cache_destroy(&world->query_caches[i]);
+    }
+    for (u32 i = 0; i < darray_length(world->command_buffers); i++) {
+        ecs_command_buffer_destroy(&world->command_buffers[i]);
+    }
+    for (u32 i = 0; i < darray_length(world->removed_components); i++) {
+        darray_destroy(world->removed_components[i]);
+    }
+    if (world->transforms != NULL) {
+        transform_hierarchy_destroy(world->transforms);
+    }
+    if (world->interpolation != NULL) {
+        interpolation_state_destroy(world->interpolation);
+    }
+    darray_destroy(world->components);
     darray_destroy(world->component_stores);
+    darray_destroy(world->archetypes);
+    darray_destroy(world->entity_locations);
+    darray_destroy(world->generations);
     darray_destroy(world->free_ids);
+    darray_destroy(world->systems);
+    darray_destroy(world->query_caches);
+    darray_destroy(world->command_buffers);
+    darray_destroy(world->removed_components);
+    frame_allocator_destroy(&world->frame_allocator);
+}
+
+ComponentId _world_register_component(World *world,
+                                      const char *component_name,
+                                      u64 component_size) {
+    return _world_register_component_with_backend(world, component_name, component_size, COMPONENT_STORE_BTREE);
 }
 
-void _world_register_component(World *world,
-                               const char *component_name,
-                               u64 component_size) {
-    darray_push(world->component_stores,
-                component_store_new(component_name, component_size));
+// Systems can name components before they are registered, so both grow the
+// per-component arrays
+static void reserve_component(World *world, ComponentId id) {
+    while (darray_length(world->components) <= id) {
+        darray_push(world->components,
+                    ((ComponentInfo){
+                        .name = NULL,
+                        .size = 0,
+                        .flags = 0,
+                        .structure_version = 0,
+                        .removal_watchers = 0,
+                    }));
+        darray_push(world->removed_components, darray_new_with(RemovedComponent, world->allocator));
+        if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+            darray_push(world->component_stores, ((ComponentStore){0}));
+        }
+    }
+}
+
+ComponentId _world_register_component_with_backend(World *world,
+                                                   const char *component_name,
+                                                   u64 component_size,
+                                                   ComponentStoreBackend backend) {
+    ComponentId id = component_id_register(component_name, component_size);
+    reserve_component(world, id);
+
+    if (world->components[id].name != NULL) {
+        return id;
+    }
+
+    world->components[id].name = component_name;
+    world->components[id].size = component_size;
+
+    if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        world->component_stores[id] =
+            component_store_new_with_allocator(component_name, component_size, backend, world->allocator);
+    }
+
+    for (u32 i = 0; i < darray_length(world->query_caches); i++) {
+        if (!world->query_caches[i].resolved) {
+            query_cache_resolve(world, &world->systems[i].query, &world->query_caches[i]);
+        }
+    }
+
+    return id;
+}
+
+ComponentId world_find_component(const World *world, const char *component_name) {
+    ComponentId id = component_id_find(component_name);
+    if (id == COMPONENT_ID_INVALID || id >= darray_length(world->components) || world->components[id].name == NULL) {
+        return COMPONENT_ID_INVALID;
+    }
+    return id;
+}
+
+void world_set_component_flags(World *world, ComponentId component, ComponentFlags flags) {
+    ASSERT_MSG(is_registered(world, component), "component is not registered with this world");
+
+    world->components[component].flags = flags;
+    if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        world->component_stores[component].flags = flags;
+    }
+}
+
+// Ticks wrap around, a tick is newer when it is less than half the range ahead
+static b8 tick_is_newer(u32 tick, u32 than) { return (i32)(tick - than) > 0; }
+
+static void log_removed(World *world, entity_index entity, ComponentId component) {
+    if (world->components[component].removal_watchers == 0) {
+        return;
+    }
+    darray_push(world->removed_components[component],
+                ((RemovedComponent){
+                    .entity = entity_make(entity, world->generations[entity]),
+                    .tick = world->change_tick,
+                }));
+}
+
+/**
+ * Stamps the component at the entity's current row as changed, and as added
+ * when `added` is set.
+ */
+static void stamp_archetype_ticks(World *world, entity_index entity, ComponentId component, b8 added) {
+    const EntityLocation *location = &world->entity_locations[entity];
+    const Archetype *archetype = &world->archetypes[location->archetype];
+    u32 *ticks = archetype_get_ticks(archetype, location->row, component);
+    if (added) {
+        ticks[0] = world->change_tick;
+    }
+    ticks[archetype->chunk_capacity] = world->change_tick;
+}
+
+u32 world_find_or_create_archetype(World *world, const ComponentMask *mask) {
+    for (u32 i = 0; i < darray_length(world->archetypes); i++) {
+        if (component_mask_equal(&world->archetypes[i].mask, mask)) {
+            return i;
+        }
+    }
+
+    u32 ids[ECS_MAX_COMPONENTS];
+    u32 sizes[ECS_MAX_COMPONENTS];
+    u32 count = 0;
+    for (ComponentId i = 0; i < darray_length(world->components); i++) {
+        if (component_mask_has(mask, i)) {
+            ids[count] = i;
+            sizes[count] = world->components[i].size;
+            count++;
+        }
+    }
+
+    darray_push(world->archetypes, archetype_new(mask, count, ids, sizes, world->allocator));
+    u32 index = darray_length(world->archetypes) - 1;
+
+    for (u32 i = 0; i < darray_length(world->query_caches); i++) {
+        if (query_matches_archetype(&world->systems[i].query, &world->archetypes[index])) {
+            darray_push(world->query_caches[i].archetypes, index);
+        }
+    }
+
+    return index;
+}
+
+/**
+ * @return the archetype reached by adding (or removing) `component_id` to the
+ * archetype at `archetype_index`, or ARCHETYPE_INVALID for the empty set
+ */
+static u32 archetype_neighbour(World *world, u32 archetype_index, u32 component_id, b8 add) {
+    if (archetype_index != ARCHETYPE_INVALID) {
+        Archetype *archetype = &world->archetypes[archetype_index];
+        for (u32 i = 0; i < darray_length(archetype->edges); i++) {
+            if (archetype->edges[i].component_id == component_id) {
+                return add ? archetype->edges[i].add : archetype->edges[i].remove;
+            }
+        }
+    }
+
+    ComponentMask mask = {0};
+    if (archetype_index != ARCHETYPE_INVALID) {
+        mask = world->archetypes[archetype_index].mask;
+    }
+    if (add) {
+        component_mask_set(&mask, component_id);
+    } else {
+        component_mask_clear(&mask, component_id);
+    }
+
+    u32 target = component_mask_is_empty(&mask) ? ARCHETYPE_INVALID : world_find_or_create_archetype(world, &mask);
+
+    if (archetype_index != ARCHETYPE_INVALID) {
+        Archetype *archetype = &world->archetypes[archetype_index];
+        darray_push(archetype->edges,
+                    ((ArchetypeEdge){
+                        .component_id = component_id,
+                        .add = add ? target : archetype_index,
+                        .remove = add ? archetype_index : target,
+                    }));
+    }
+
+    return target;
+}
+
+// An entity gained or lost the component, or components of the type moved
+static void component_moved(World *world, ComponentId component_id) {
+    world->structure_version++;
+    world->components[component_id].structure_version++;
+}
+
+// Rows of the archetype were added, removed or moved
+static void archetype_moved(World *world, u32 archetype_index) {
+    const Archetype *archetype = &world->archetypes[archetype_index];
+    for (u32 i = 0; i < darray_length(archetype->component_ids); i++) {
+        world->components[archetype->component_ids[i]].structure_version++;
+    }
+    world->structure_version++;
+}
+
+static void remove_from_archetype(World *world, entity_index entity) {
+    EntityLocation *location = &world->entity_locations[entity];
+    if (location->archetype == ARCHETYPE_INVALID) {
+        return;
+    }
+
+    archetype_moved(world, location->archetype);
+    entity_index moved = archetype_remove_row(&world->archetypes[location->archetype], location->row);
+    if (moved != ENTITY_INDEX_INVALID) {
+        world->entity_locations[moved].row = location->row;
+    }
+
+    location->archetype = ARCHETYPE_INVALID;
+}
+
+static void move_to_archetype(World *world, entity_index entity, u32 target) {
+    EntityLocation *location = &world->entity_locations[entity];
+
+    if (target == ARCHETYPE_INVALID) {
+        remove_from_archetype(world, entity);
+        return;
+    }
+
+    archetype_moved(world, target);
+
+    if (location->archetype == ARCHETYPE_INVALID) {
+        location->row = archetype_push_entity(&world->archetypes[target], entity);
+        location->archetype = target;
+        return;
+    }
+
+    archetype_moved(world, location->archetype);
+    entity_index moved;
+    u32 row = archetype_move_row(&world->archetypes[location->archetype],
+                                 location->row,
+                                 &world->archetypes[target],
+                                 &moved);
+    if (moved != ENTITY_INDEX_INVALID) {
+        world->entity_locations[moved].row = location->row;
+    }
+
+    location->archetype = target;
+    location->row = row;
 }
 
 entity_id world_create_entity(World *world) {
+    entity_index index;
     if (darray_length(world->free_ids) > 0) {
-        entity_id entity;
-        darray_pop(world->free_ids, &entity);
-        return entity;
+        darray_pop(world->free_ids, &index);
+    } else {
+        index = darray_length(world->generations);
+        ASSERT_MSG(index != ENTITY_INDEX_INVALID, "ran out of entity slots");
+        darray_push(world->generations, 0);
+        if (world->storage == WORLD_STORAGE_ARCHETYPE) {
+            darray_push(world->entity_locations, ((EntityLocation){.archetype = ARCHETYPE_INVALID, .row = 0}));
+        }
+    }
+
+    return entity_make(index, world->generations[index]);
+}
+
+static void spawn_batch_archetype(World *world,
+                                  EntityRange range,
+                                  u32 component_count,
+                                  const ComponentId *component_ids,
+                                  const void *const *initial_values) {
+    darray_resize_uninit(world->entity_locations, (u64)range.first + range.count);
+    EntityLocation *locations = world->entity_locations + range.first;
+
+    if (component_count == 0) {
+        for (u32 i = 0; i < range.count; i++) {
+            locations[i] = (EntityLocation){.archetype = ARCHETYPE_INVALID, .row = 0};
+        }
+        return;
+    }
+
+    ComponentMask mask = {0};
+    for (u32 i = 0; i < component_count; i++) {
+        component_mask_set(&mask, component_ids[i]);
+    }
+    u32 target = world_find_or_create_archetype(world, &mask);
+    Archetype *archetype = &world->archetypes[target];
+
+    u32 first_row = archetype_push_entities(archetype, range.first, range.count);
+    u32 end = first_row + range.count;
+
+    for (u32 c = 0; c < component_count; c++) {
+        u32 column = archetype->column_of[component_ids[c]];
+        u32 size = archetype->component_sizes[column];
+        const u8 *values = initial_values != NULL ? initial_values[c] : NULL;
+
+        // copy one run per chunk
+        u32 row = first_row;
+        while (row < end) {
+            ArchetypeChunk *chunk = archetype_chunk(archetype, row);
+            u32 slot = row % archetype->chunk_capacity;
+            u32 n = archetype->chunk_capacity - slot;
+            if (n > end - row) {
+                n = end - row;
+            }
+
+            u8 *dst = (u8 *)archetype_chunk_column(archetype, chunk, column) + (u64)slot * size;
+            if (values != NULL) {
+                memcpy(dst, values + (u64)(row - first_row) * size, (u64)n * size);
+            } else {
+                memset(dst, 0, (u64)n * size);
+            }
+
+            u32 *added_ticks = archetype_chunk_added_ticks(archetype, chunk, column) + slot;
+            u32 *changed_ticks = archetype_chunk_changed_ticks(archetype, chunk, column) + slot;
+            for (u32 i = 0; i < n; i++) {
+                added_ticks[i] = world->change_tick;
+                changed_ticks[i] = world->change_tick;
+            }
+            row += n;
+        }
+    }
+
+    for (u32 i = 0; i < range.count; i++) {
+        locations[i] = (EntityLocation){.archetype = target, .row = first_row + i};
+    }
+}
+
+EntityRange world_spawn_batch(World *world,
+                              u32 count,
+                              u32 component_count,
+                              const ComponentId *component_ids,
+                              const void *const *initial_values) {
+    for (u32 i = 0; i < component_count; i++) {
+        ASSERT_MSG(is_registered(world, component_ids[i]), "component type not registered with this world");
+    }
+
+    EntityRange range = {.first = darray_length(world->generations), .count = count};
+    world->structure_version++;
+    for (u32 i = 0; i < component_count; i++) {
+        world->components[component_ids[i]].structure_version++;
     }
-    return world->next_id++;
+    ASSERT_MSG((u64)range.first + count < ENTITY_INDEX_INVALID, "ran out of entity slots");
+
+    darray_resize_uninit(world->generations, (u64)range.first + count);
+    memset(world->generations + range.first, 0, sizeof(u32) * count);
+
+    if (world->storage == WORLD_STORAGE_ARCHETYPE) {
+        spawn_batch_archetype(world, range, component_count, component_ids, initial_values);
+        return range;
+    }
+
+    for (u32 i = 0; i < component_count; i++) {
+        world->component_stores[component_ids[i]].change_tick = world->change_tick;
+        component_store_insert_batch(&world->component_stores[component_ids[i]],
+                                     range.first,
+                                     count,
+                                     initial_values != NULL ? initial_values[i] : NULL);
+    }
+
+    return range;
 }
 
 void world_destroy_entity(World *world, entity_id entity) {
@@ -45,94 +538,1049 @@ void world_destroy_entity(World *world, entity_id entity) {
         return;
     }
 
-    for (u32 i = 0; i < darray_length(world->component_stores); i++) {
-        component_store_remove(&world->component_stores[i], entity);
+    if (world->transforms != NULL) {
+        transform_unlink(world, entity);
     }
 
-    darray_push(world->free_ids, entity);
+    entity_index index = entity_get_index(entity);
+
+    if (world->storage == WORLD_STORAGE_ARCHETYPE) {
+        u32 archetype = world->entity_locations[index].archetype;
+        if (archetype != ARCHETYPE_INVALID) {
+            for (u32 i = 0; i < darray_length(world->archetypes[archetype].component_ids); i++) {
+                log_removed(world, index, world->archetypes[archetype].component_ids[i]);
+            }
+        }
+        remove_from_archetype(world, index);
+    } else {
+        for (u32 i = 0; i < darray_length(world->component_stores); i++) {
+            if (component_store_remove(&world->component_stores[i], index)) {
+                log_removed(world, index, i);
+                component_moved(world, i);
+            }
+        }
+    }
+
+    // invalidates every handle to this slot
+    world->generations[index]++;
+    darray_push(world->free_ids, index);
 }
 
-b8 world_is_valid_entity(World *world, entity_id entity) {
-    if (entity >= world->next_id) {
-        return false;
+b8 world_is_valid_entity(const World *world, entity_id entity) {
+    entity_index index = entity_get_index(entity);
+    return index < darray_length(world->generations) && world->generations[index] == entity_get_generation(entity);
+}
+
+void world_attach_component_by_id(World *world,
+                                  entity_id entity,
+                                  ComponentId component_id,
+                                  const void *value_ptr) {
+    // TODO: maybe register the component, but would need the size
+    ASSERT_MSG(is_registered(world, component_id), "component type not registered with this world");
+
+    if (!world_is_valid_entity(world, entity)) {
+        return;
     }
 
-    for (u32 i = 0; i < darray_length(world->free_ids); i++) {
-        if (world->free_ids[i] == entity) {
-            return false;
+    entity_index index = entity_get_index(entity);
+
+    if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        ComponentStore *store = &world->component_stores[component_id];
+        u32 count = store->component_count;
+        store->change_tick = world->change_tick;
+        component_store_insert(store, index, value_ptr);
+        if (store->component_count != count) {
+            component_moved(world, component_id);
         }
+        return;
     }
 
-    return true;
+    EntityLocation *location = &world->entity_locations[index];
+    b8 added = location->archetype == ARCHETYPE_INVALID ||
+               !component_mask_has(&world->archetypes[location->archetype].mask, component_id);
+    if (added) {
+        u32 target = archetype_neighbour(world, location->archetype, component_id, true);
+        move_to_archetype(world, index, target);
+    }
+
+    void *component = archetype_get(&world->archetypes[location->archetype], location->row, component_id);
+    memcpy(component, value_ptr, world->components[component_id].size);
+    stamp_archetype_ticks(world, index, component_id, added);
 }
 
-void _world_attach_component(World *world,
-                             entity_id entity,
-                             const char *type,
-                             void *value_ptr) {
-    ComponentStore *store = NULL;
+void world_detach_component_by_id(World *world,
+                                  entity_id entity,
+                                  ComponentId component_id) {
+    ASSERT_MSG(is_registered(world, component_id), "component type not registered with this world");
 
-    for (u32 i = 0; i < darray_length(world->component_stores); i++) {
-        if (strcmp(world->component_stores[i].component_name, type) == 0) {
-            store = &world->component_stores[i];
-            break;
+    if (!world_is_valid_entity(world, entity)) {
+        return;
+    }
+
+    entity_index index = entity_get_index(entity);
+
+    if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        if (component_store_remove(&world->component_stores[component_id], index)) {
+            log_removed(world, index, component_id);
+            component_moved(world, component_id);
         }
+        return;
     }
 
-    if (store == NULL) {
-        // TODO: maybe create the component_store, but would need size from
-        // signature
-        ASSERT_UNREACHABLE();
+    EntityLocation *location = &world->entity_locations[index];
+    if (location->archetype == ARCHETYPE_INVALID ||
+        !component_mask_has(&world->archetypes[location->archetype].mask, component_id)) {
+        return;
     }
 
-    component_store_insert(store, entity, value_ptr);
+    log_removed(world, index, component_id);
+    u32 target = archetype_neighbour(world, location->archetype, component_id, false);
+    move_to_archetype(world, index, target);
 }
 
-void _world_detach_component(World *world,
-                             entity_id entity,
-                             const char *component_name) {
-    ComponentStore *store = NULL;
+void *world_get_component_by_id(const World *world,
+                                entity_id entity,
+                                ComponentId component_id) {
+    ASSERT_MSG(is_registered(world, component_id), "component type not registered with this world");
 
-    for (u32 i = 0; i < darray_length(world->component_stores); i++) {
-        if (strcmp(world->component_stores[i].component_name, component_name) ==
-            0) {
-            store = &world->component_stores[i];
-            break;
+    if (!world_is_valid_entity(world, entity)) {
+        return NULL;
+    }
+
+    entity_index index = entity_get_index(entity);
+
+    if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        return component_store_find(&world->component_stores[component_id], index);
+    }
+
+    const EntityLocation *location = &world->entity_locations[index];
+    if (location->archetype == ARCHETYPE_INVALID) {
+        return NULL;
+    }
+
+    return archetype_get(&world->archetypes[location->archetype], location->row, component_id);
+}
+
+u32 *world_get_changed_tick_by_id(const World *world,
+                                  entity_id entity,
+                                  ComponentId component_id) {
+    ASSERT_MSG(is_registered(world, component_id), "component type not registered with this world");
+
+    if (!world_is_valid_entity(world, entity)) {
+        return NULL;
+    }
+
+    entity_index index = entity_get_index(entity);
+
+    if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        const ComponentStore *store = &world->component_stores[component_id];
+        u32 component_index = component_store_index_of(store, index);
+        return component_index != COMPONENT_STORE_INVALID_INDEX ? &store->changed_ticks[component_index] : NULL;
+    }
+
+    const EntityLocation *location = &world->entity_locations[index];
+    if (location->archetype == ARCHETYPE_INVALID) {
+        return NULL;
+    }
+
+    const Archetype *archetype = &world->archetypes[location->archetype];
+    u32 *ticks = archetype_get_ticks(archetype, location->row, component_id);
+    return ticks != NULL ? ticks + archetype->chunk_capacity : NULL;
+}
+
+void world_mark_changed_by_id(World *world,
+                              entity_id entity,
+                              ComponentId component_id) {
+    u32 *tick = world_get_changed_tick_by_id(world, entity, component_id);
+    if (tick != NULL) {
+        *tick = world->change_tick;
+    }
+}
+
+// The buffers belong to the threads of the world's own pool, any other thread
+// falls back to the first one
+static EcsCommandBuffer *current_command_buffer(World *world) {
+    u32 thread = world->job_pool != NULL ? job_pool_thread_index(world->job_pool) : 0;
+    return &world->command_buffers[thread < darray_length(world->command_buffers) ? thread : 0];
+}
+
+EcsCommandBuffer *world_command_buffer(World *world) { return current_command_buffer(world); }
+
+typedef struct {
+    EcsCommand command;
+    // position of the command across all buffers, keeps the recorded order
+    // of commands on the same entity and component
+    u64 sequence;
+} SortedCommand;
+
+static i32 compare_u64(u64 a, u64 b) { return (a > b) - (a < b); }
+
+// entity major, so every entity moves archetype once
+static int compare_by_entity(const void *a, const void *b) {
+    const SortedCommand *x = a;
+    const SortedCommand *y = b;
+    i32 order = compare_u64(entity_get_index(x->command.entity), entity_get_index(y->command.entity));
+    return order != 0 ? order : compare_u64(x->sequence, y->sequence);
+}
+
+// component major, so every store is walked in ascending key order; destroys
+// have COMPONENT_ID_INVALID and come last
+static int compare_by_component(const void *a, const void *b) {
+    const SortedCommand *x = a;
+    const SortedCommand *y = b;
+    i32 order = compare_u64(x->command.component, y->command.component);
+    if (order == 0) {
+        order = compare_u64(entity_get_index(x->command.entity), entity_get_index(y->command.entity));
+    }
+    return order != 0 ? order : compare_u64(x->sequence, y->sequence);
+}
+
+// The attaches of each component are inserted as one ascending batch, so new
+// entities past the end of a B+tree are appended without a descent each.
+// Detaches go through the store one by one.
+static void apply_sorted_commands_component_store(World *world, const SortedCommand *commands, u32 count) {
+    Allocator *scratch = frame_allocator_current(&world->frame_allocator);
+    entity_index *keys = allocator_new_array(scratch, entity_index, count);
+    const void **values = allocator_new_array(scratch, const void *, count);
+
+    u32 i = 0;
+    while (i < count && commands[i].command.kind != ECS_COMMAND_DESTROY) {
+        ComponentId component = commands[i].command.component;
+        ASSERT_MSG(is_registered(world, component), "component type not registered with this world");
+        ComponentStore *store = &world->component_stores[component];
+
+        u32 attach_count = 0;
+        for (; i < count && commands[i].command.component == component; i++) {
+            const EcsCommand *command = &commands[i].command;
+            // only the last attach or detach per entity and component matters
+            if (i + 1 < count && commands[i + 1].command.component == component &&
+                commands[i + 1].command.entity == command->entity) {
+                continue;
+            }
+            if (!world_is_valid_entity(world, command->entity)) {
+                continue;
+            }
+
+            if (command->kind == ECS_COMMAND_DETACH) {
+                world_detach_component_by_id(world, command->entity, component);
+            } else {
+                keys[attach_count] = entity_get_index(command->entity);
+                values[attach_count] = command->payload;
+                attach_count++;
+            }
+        }
+
+        u32 component_count = store->component_count;
+        store->change_tick = world->change_tick;
+        component_store_insert_sorted(store, keys, values, attach_count);
+        if (store->component_count != component_count) {
+            component_moved(world, component);
         }
     }
 
-    if (store == NULL) {
-        // TODO: maybe create the component_store, but would need size from
+    // destroys sort last
+    for (; i < count; i++) {
+        world_destroy_entity(world, commands[i].command.entity);
+    }
+
+    // newest first, so the arena takes the memory back
+    allocator_free(scratch, values, sizeof(void *) * count);
+    allocator_free(scratch, keys, sizeof(entity_index) * count);
+}
+
+static void apply_sorted_commands_archetype(World *world, const SortedCommand *commands, u32 count) {
+    void *values[ECS_MAX_COMPONENTS] = {0};
+    ComponentId attached[ECS_MAX_COMPONENTS];
+
+    u32 i = 0;
+    while (i < count) {
+        entity_id entity = commands[i].command.entity;
+        u32 end = i;
+        while (end < count && commands[end].command.entity == entity) {
+            end++;
+        }
+
+        if (!world_is_valid_entity(world, entity)) {
+            i = end;
+            continue;
+        }
+
+        entity_index index = entity_get_index(entity);
+        EntityLocation *location = &world->entity_locations[index];
+        ComponentMask mask = {0};
+        if (location->archetype != ARCHETYPE_INVALID) {
+            mask = world->archetypes[location->archetype].mask;
+        }
+
+        b8 destroy = false;
+        u32 attached_count = 0;
+        ComponentMask touched = {0};
+        for (; i < end; i++) {
+            const EcsCommand *command = &commands[i].command;
+            ASSERT_MSG(command->kind == ECS_COMMAND_DESTROY || is_registered(world, command->component),
+                       "component type not registered with this world");
+
+            switch (command->kind) {
+            case ECS_COMMAND_ATTACH:
+                if (!component_mask_has(&touched, command->component)) {
+                    component_mask_set(&touched, command->component);
+                    attached[attached_count++] = command->component;
+                }
+                values[command->component] = command->payload;
+                component_mask_set(&mask, command->component);
+                break;
+            case ECS_COMMAND_DETACH:
+                values[command->component] = NULL;
+                component_mask_clear(&mask, command->component);
+                break;
+            case ECS_COMMAND_DESTROY:
+                destroy = true;
+                break;
+            case ECS_COMMAND_CREATE:
+                ASSERT_UNREACHABLE();
+            }
+        }
+
+        if (destroy) {
+            world_destroy_entity(world, entity);
+        } else {
+            ComponentMask old_mask = {0};
+            if (location->archetype != ARCHETYPE_INVALID) {
+                old_mask = world->archetypes[location->archetype].mask;
+            }
+
+            u32 target =
+                component_mask_is_empty(&mask) ? ARCHETYPE_INVALID : world_find_or_create_archetype(world, &mask);
+            if (target != location->archetype) {
+                for (ComponentId c = 0; c < darray_length(world->components); c++) {
+                    if (component_mask_has(&old_mask, c) && !component_mask_has(&mask, c)) {
+                        log_removed(world, index, c);
+                    }
+                }
+                move_to_archetype(world, index, target);
+            }
+
+            for (u32 a = 0; a < attached_count; a++) {
+                ComponentId component = attached[a];
+                if (values[component] != NULL) {
+                    memcpy(archetype_get(&world->archetypes[location->archetype], location->row, component),
+                           values[component],
+                           world->components[component].size);
+                    stamp_archetype_ticks(world, index, component, !component_mask_has(&old_mask, component));
+                }
+            }
+        }
+
+        for (u32 a = 0; a < attached_count; a++) {
+            values[attached[a]] = NULL;
+        }
+    }
+}
+
+static entity_id resolve_entity(entity_id entity, const entity_id *created, u32 created_count) {
+    if (!ecs_command_is_pending(entity)) {
+        return entity;
+    }
+
+    ASSERT_MSG(entity_get_index(entity) < created_count, "pending entity used outside of the buffer that created it");
+    return created[entity_get_index(entity)];
+}
+
+static void apply_command_buffers(World *world, EcsCommandBuffer *buffers, u32 buffer_count) {
+    u32 total = 0;
+    u32 max_pending = 0;
+    for (u32 b = 0; b < buffer_count; b++) {
+        total += darray_length(buffers[b].commands);
+        max_pending = MAX(max_pending, buffers[b].pending_count);
+    }
+    if (total == 0) {
+        return;
+    }
+
+    Allocator *scratch = frame_allocator_current(&world->frame_allocator);
+    SortedCommand *sorted = allocator_new_array(scratch, SortedCommand, total);
+    u32 created_capacity = MAX(max_pending, 1);
+    entity_id *created = allocator_new_array(scratch, entity_id, created_capacity);
+    u32 sorted_count = 0;
+
+    for (u32 b = 0; b < buffer_count; b++) {
+        const EcsCommandBuffer *buffer = &buffers[b];
+
+        // creates run first so later commands can refer to the new entities
+        for (u32 i = 0; i < darray_length(buffer->commands); i++) {
+            if (buffer->commands[i].kind == ECS_COMMAND_CREATE) {
+                created[entity_get_index(buffer->commands[i].entity)] = world_create_entity(world);
+            }
+        }
+
+        for (u32 i = 0; i < darray_length(buffer->commands); i++) {
+            EcsCommand command = buffer->commands[i];
+            if (command.kind == ECS_COMMAND_CREATE) {
+                continue;
+            }
+
+            command.entity = resolve_entity(command.entity, created, buffer->pending_count);
+            sorted[sorted_count] = (SortedCommand){.command = command, .sequence = ((u64)b << 32) | i};
+            sorted_count++;
+        }
+    }
+
+    if (world->storage == WORLD_STORAGE_ARCHETYPE) {
+        qsort(sorted, sorted_count, sizeof(SortedCommand), compare_by_entity);
+        apply_sorted_commands_archetype(world, sorted, sorted_count);
+    } else {
+        qsort(sorted, sorted_count, sizeof(SortedCommand), compare_by_component);
+        apply_sorted_commands_component_store(world, sorted, sorted_count);
+    }
+
+    allocator_free(scratch, created, sizeof(entity_id) * created_capacity);
+    allocator_free(scratch, sorted, sizeof(SortedCommand) * total);
+}
+
+void world_apply_command_buffer(World *world, EcsCommandBuffer *buffer) {
+    apply_command_buffers(world, buffer, 1);
+    ecs_command_buffer_clear(buffer);
+}
+
+void world_flush_commands(World *world) {
+    apply_command_buffers(world, world->command_buffers, darray_length(world->command_buffers));
+    for (u32 i = 0; i < darray_length(world->command_buffers); i++) {
+        ecs_command_buffer_clear(&world->command_buffers[i]);
+    }
+}
+
+static ComponentId find_component(const World *world, const char *component_name) {
+    ComponentId id = world_find_component(world, component_name);
+    if (id == COMPONENT_ID_INVALID) {
+        // TODO: maybe register the component, but would need size from
         // signature
         ASSERT_UNREACHABLE();
     }
+    return id;
+}
+
+void _world_attach_component(World *world,
+                             entity_id entity,
+                             const char *type,
+                             void *value_ptr) {
+    world_attach_component_by_id(world, entity, find_component(world, type), value_ptr);
+}
 
-    component_store_remove(store, entity);
+void _world_detach_component(World *world,
+                             entity_id entity,
+                             const char *component_name) {
+    world_detach_component_by_id(world, entity, find_component(world, component_name));
 }
 
 void *_world_get_component(const World *world,
                            entity_id entity,
                            const char *type) {
-    ComponentStore *store = NULL;
+    return world_get_component_by_id(world, entity, find_component(world, type));
+}
 
-    for (u32 i = 0; i < darray_length(world->component_stores); i++) {
-        if (strcmp(world->component_stores[i].component_name, type) == 0) {
-            store = &world->component_stores[i];
-            break;
+// Counts the query's Removed term, if any, towards logging that component's
+// removals
+static void watch_removals(World *world, const Query *query, i32 watchers) {
+    for (u32 i = 0; i < query->count; i++) {
+        if (query->filters[i] == QUERY_FILTER_REMOVED) {
+            reserve_component(world, query->ids[i]);
+            world->components[query->ids[i]].removal_watchers += watchers;
         }
     }
+}
 
-    if (store == NULL) {
-        // TODO: maybe create the component_store, but would need size from
-        // signature
-        ASSERT_UNREACHABLE();
+void world_add_system(World *world, SystemInfo system) {
+    ASSERT_MSG(system.query.count <= MAX_REQUIRED_COMPONENTS, "system query has too many components");
+
+    // startup systems added after the first run never run
+    if (system.schedule != SYSTEM_SCHEDULE_STARTUP || !world->has_started) {
+        watch_removals(world, &system.query, 1);
     }
 
-    return component_store_find(store, entity);
+    darray_push(world->query_caches, query_cache_new(world, &system));
+    darray_push(world->systems, system);
 }
 
-void world_add_system(World *world, SystemInfo system) {
-    darray_push(world->systems, system);
+// Entities (component store) or chunks (archetype) handed to one job
+#define SYSTEM_BATCH_ENTITIES 16384
+#define SYSTEM_BATCH_CHUNKS 16
+
+typedef struct {
+    const Archetype *archetype;
+    const ArchetypeChunk *chunk;
+} ChunkRef;
+
+typedef struct SystemRun {
+    World *world;
+    SystemInfo *system;
+    const QueryCache *cache;
+    const ComponentId *component_ids;
+    // term whose store is walked in component store worlds, the required
+    // term with the fewest components
+    u32 driver;
+    u32 last_run_tick;
+    u32 change_tick;
+    darray(ChunkRef) chunks;
+    u32 work_count;
+    u32 batch_size;
+
+    darray(struct SystemRun *) dependents;
+    u32 dependency_count;
+    atomic u32 remaining_dependencies;
+    JobCounter *stage_counter;
+} SystemRun;
+
+typedef struct {
+    SystemRun *run;
+    u32 begin;
+    u32 end;
+} SystemBatch;
+
+static b8 term_matches(const SystemRun *run, u32 term, u32 added_tick, u32 changed_tick) {
+    switch (run->system->query.filters[term]) {
+    case QUERY_FILTER_CHANGED:
+        return tick_is_newer(changed_tick, run->last_run_tick);
+    case QUERY_FILTER_ADDED:
+        return tick_is_newer(added_tick, run->last_run_tick);
+    default:
+        return true;
+    }
+}
+
+static b8 term_allows_missing(const SystemRun *run, u32 term) {
+    QueryFilter filter = run->system->query.filters[term];
+    return filter == QUERY_FILTER_WITHOUT || filter == QUERY_FILTER_OPTIONAL;
+}
+
+static void call_system(const SystemRun *run, entity_id entity, void **components) {
+    if (run->system->fn_with_context != NULL) {
+        SystemContext context = {
+            .entity = entity,
+            .commands = current_command_buffer(run->world),
+        };
+        run->system->fn_with_context(&context, components);
+    } else {
+        run->system->fn(components);
+    }
+}
+
+static void mark_written(const SystemRun *run, u32 **changed_ticks) {
+    for (u32 w = 0; w < run->cache->write_count; w++) {
+        u32 *tick = changed_ticks[run->cache->write_terms[w]];
+        if (tick != NULL) {
+            *tick = run->change_tick;
+        }
+    }
+}
+
+/**
+ * Checks the entity against one term in a component store world. `component`
+ * and `changed_tick` are set for terms that access a component the entity has,
+ * and are NULL otherwise.
+ * @return false when the entity does not match the term
+ */
+static b8 probe_store(const SystemRun *run,
+                      ComponentStore *store,
+                      u32 term,
+                      entity_index entity,
+                      void **component,
+                      u32 **changed_tick) {
+    *component = NULL;
+    *changed_tick = NULL;
+
+    u32 index = component_store_index_of(store, entity);
+    if (index == COMPONENT_STORE_INVALID_INDEX) {
+        return term_allows_missing(run, term);
+    }
+
+    if (run->system->query.filters[term] == QUERY_FILTER_WITHOUT ||
+        !term_matches(run, term, store->added_ticks[index], store->changed_ticks[index])) {
+        return false;
+    }
+
+    if (query_term_accesses(&run->system->query, term)) {
+        *component = component_store_at(store, index);
+        *changed_tick = &store->changed_ticks[index];
+    }
+    return true;
+}
+
+// Walks the dense array of the driving component and probes the other stores.
+// A Changed or Added driver only reads its tick column for entities that do
+// not match.
+static void run_batch_component_store(const SystemRun *run, u32 begin, u32 end) {
+    u32 count = run->system->query.count;
+    u32 driver_term = run->driver;
+    ComponentStore *stores[MAX_REQUIRED_COMPONENTS];
+    void *components[MAX_REQUIRED_COMPONENTS];
+    u32 *changed_ticks[MAX_REQUIRED_COMPONENTS];
+
+    for (u32 i = 0; i < count; i++) {
+        stores[i] = &run->world->component_stores[run->component_ids[i]];
+    }
+
+    ComponentStore *driver = stores[driver_term];
+    const u32 *driver_ticks = NULL;
+    switch (run->system->query.filters[driver_term]) {
+    case QUERY_FILTER_CHANGED:
+        driver_ticks = driver->changed_ticks;
+        break;
+    case QUERY_FILTER_ADDED:
+        driver_ticks = driver->added_ticks;
+        break;
+    default:
+        break;
+    }
+    b8 driver_accessed = query_term_accesses(&run->system->query, driver_term);
+
+    for (u32 index = begin; index < end; index++) {
+        if (driver_ticks != NULL && !tick_is_newer(driver_ticks[index], run->last_run_tick)) {
+            continue;
+        }
+
+        entity_index entity = driver->entities[index];
+
+        b8 matches = true;
+        for (u32 i = 0; i < count && matches; i++) {
+            if (i != driver_term) {
+                matches = probe_store(run, stores[i], i, entity, &components[i], &changed_ticks[i]);
+            }
+        }
+
+        if (!matches) {
+            continue;
+        }
+
+        components[driver_term] = driver_accessed ? component_store_at(driver, index) : NULL;
+        changed_ticks[driver_term] = driver_accessed ? &driver->changed_ticks[index] : NULL;
+
+        call_system(run, entity_make(entity, run->world->generations[entity]), components);
+        mark_written(run, changed_ticks);
+    }
+}
+
+static void run_batch_archetype(const SystemRun *run, u32 begin, u32 end) {
+    const Query *query = &run->system->query;
+    u32 count = query->count;
+    void *components[MAX_REQUIRED_COMPONENTS];
+    u8 *columns[MAX_REQUIRED_COMPONENTS];
+    u32 *filter_ticks[MAX_REQUIRED_COMPONENTS];
+    u32 *changed_columns[MAX_REQUIRED_COMPONENTS];
+    u32 *changed_ticks[MAX_REQUIRED_COMPONENTS];
+
+    for (u32 c = begin; c < end; c++) {
+        const Archetype *archetype = run->chunks[c].archetype;
+        const ArchetypeChunk *chunk = run->chunks[c].chunk;
+        for (u32 i = 0; i < count; i++) {
+            // missing for Without terms and absent Optional ones
+            u32 column = archetype->column_of[run->component_ids[i]];
+            columns[i] = NULL;
+            changed_columns[i] = NULL;
+            if (column == ARCHETYPE_NO_COLUMN) {
+                continue;
+            }
+
+            filter_ticks[i] = query->filters[i] == QUERY_FILTER_ADDED
+                                  ? archetype_chunk_added_ticks(archetype, chunk, column)
+                                  : archetype_chunk_changed_ticks(archetype, chunk, column);
+            if (query_term_accesses(query, i)) {
+                columns[i] = archetype_chunk_column(archetype, chunk, column);
+                changed_columns[i] = archetype_chunk_changed_ticks(archetype, chunk, column);
+            }
+        }
+
+        const entity_index *entities = archetype_chunk_entities(chunk);
+        for (u32 slot = 0; slot < chunk->count; slot++) {
+            b8 matches = true;
+            for (u32 f = 0; f < run->cache->filtered_count && matches; f++) {
+                matches = tick_is_newer(filter_ticks[run->cache->filtered_terms[f]][slot], run->last_run_tick);
+            }
+
+            if (!matches) {
+                continue;
+            }
+
+            for (u32 i = 0; i < count; i++) {
+                components[i] = columns[i] != NULL ? columns[i] + slot * run->cache->component_sizes[i] : NULL;
+                changed_ticks[i] = changed_columns[i] != NULL ? changed_columns[i] + slot : NULL;
+            }
+
+            call_system(run, entity_make(entities[slot], run->world->generations[entities[slot]]), components);
+            mark_written(run, changed_ticks);
+        }
+    }
+}
+
+/**
+ * Checks any entity against one term, see probe_store.
+ */
+static b8 probe_term(const SystemRun *run, entity_id entity, u32 term, void **component, u32 **changed_tick) {
+    const World *world = run->world;
+    *component = NULL;
+    *changed_tick = NULL;
+
+    if (!world_is_valid_entity(world, entity)) {
+        return term_allows_missing(run, term);
+    }
+
+    entity_index index = entity_get_index(entity);
+    ComponentId component_id = run->component_ids[term];
+
+    if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        return probe_store(run, &world->component_stores[component_id], term, index, component, changed_tick);
+    }
+
+    const EntityLocation *location = &world->entity_locations[index];
+    u32 *ticks = NULL;
+    if (location->archetype != ARCHETYPE_INVALID) {
+        ticks = archetype_get_ticks(&world->archetypes[location->archetype], location->row, component_id);
+    }
+    if (ticks == NULL) {
+        return term_allows_missing(run, term);
+    }
+
+    const Archetype *archetype = &world->archetypes[location->archetype];
+    if (run->system->query.filters[term] == QUERY_FILTER_WITHOUT ||
+        !term_matches(run, term, ticks[0], ticks[archetype->chunk_capacity])) {
+        return false;
+    }
+
+    if (query_term_accesses(&run->system->query, term)) {
+        *component = archetype_get(archetype, location->row, component_id);
+        *changed_tick = &ticks[archetype->chunk_capacity];
+    }
+    return true;
+}
+
+// Walks the removal log of the Removed term, the other terms are looked up
+// for every entity that still exists
+static void run_batch_removed(const SystemRun *run, u32 begin, u32 end) {
+    u32 count = run->system->query.count;
+    u32 removed_term = run->cache->removed_term;
+    const RemovedComponent *removed = run->world->removed_components[run->component_ids[removed_term]];
+    void *components[MAX_REQUIRED_COMPONENTS];
+    u32 *changed_ticks[MAX_REQUIRED_COMPONENTS];
+
+    for (u32 r = begin; r < end; r++) {
+        if (!tick_is_newer(removed[r].tick, run->last_run_tick)) {
+            continue;
+        }
+
+        b8 matches = true;
+        for (u32 i = 0; i < count && matches; i++) {
+            if (i == removed_term) {
+                components[i] = NULL;
+                changed_ticks[i] = NULL;
+            } else {
+                matches = probe_term(run, removed[r].entity, i, &components[i], &changed_ticks[i]);
+            }
+        }
+
+        if (!matches) {
+            continue;
+        }
+
+        call_system(run, removed[r].entity, components);
+        mark_written(run, changed_ticks);
+    }
+}
+
+static void run_batch(const SystemRun *run, u32 begin, u32 end) {
+    if (run->cache->removed_term != QUERY_NO_TERM) {
+        run_batch_removed(run, begin, end);
+    } else if (run->world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        run_batch_component_store(run, begin, end);
+    } else {
+        run_batch_archetype(run, begin, end);
+    }
+}
+
+static void system_batch_job(void *data) {
+    SystemBatch *batch = data;
+    run_batch(batch->run, batch->begin, batch->end);
+}
+
+static void system_run_prepare(SystemRun *run, World *world, SystemInfo *system, const QueryCache *cache) {
+    ASSERT_MSG(cache->resolved, "system queries an unregistered component");
+
+    *run = (SystemRun){
+        .world = world,
+        .system = system,
+        .cache = cache,
+        .component_ids = system->query.ids,
+        .driver = QUERY_NO_TERM,
+        .last_run_tick = system->last_run_tick,
+        .change_tick = world->change_tick++,
+        .chunks = NULL,
+        .dependents = darray_new(SystemRun *),
+        .dependency_count = 0,
+    };
+
+    if (cache->removed_term != QUERY_NO_TERM) {
+        run->work_count = darray_length(world->removed_components[run->component_ids[cache->removed_term]]);
+        run->batch_size = SYSTEM_BATCH_ENTITIES;
+        return;
+    }
+
+    if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+        // every match is in each required store, so the smallest one bounds
+        // the walk and the others are only probed
+        run->work_count = (u32)-1;
+        for (u32 r = 0; r < cache->required_count; r++) {
+            u32 term = cache->required_terms[r];
+            u32 size = world->component_stores[run->component_ids[term]].component_count;
+            if (size < run->work_count) {
+                run->driver = term;
+                run->work_count = size;
+            }
+        }
+        run->batch_size = SYSTEM_BATCH_ENTITIES;
+        return;
+    }
+
+    run->chunks = darray_new(ChunkRef);
+    for (u32 a = 0; a < darray_length(cache->archetypes); a++) {
+        const Archetype *archetype = &world->archetypes[cache->archetypes[a]];
+        for (u32 c = 0; c < darray_length(archetype->chunks); c++) {
+            darray_push(run->chunks, ((ChunkRef){.archetype = archetype, .chunk = archetype->chunks[c]}));
+        }
+    }
+    run->work_count = darray_length(run->chunks);
+    run->batch_size = SYSTEM_BATCH_CHUNKS;
+}
+
+static void system_run_cleanup(SystemRun *run) {
+    if (run->chunks != NULL) {
+        darray_destroy(run->chunks);
+    }
+    darray_destroy(run->dependents);
+}
+
+static void system_run_execute(SystemRun *run) {
+    JobPool *pool = run->world->job_pool;
+    b8 split = pool != NULL && (run->system->flags & SYSTEM_FLAG_PARALLEL) && run->work_count > run->batch_size;
+
+    if (!split) {
+        run_batch(run, 0, run->work_count);
+        return;
+    }
+
+    u32 batch_count = (run->work_count + run->batch_size - 1) / run->batch_size;
+    SystemBatch *batches = malloc(sizeof(SystemBatch) * batch_count);
+    JobCounter counter = {0};
+
+    for (u32 i = 0; i < batch_count; i++) {
+        batches[i] = (SystemBatch){
+            .run = run,
+            .begin = i * run->batch_size,
+            .end = MIN((i + 1) * run->batch_size, run->work_count),
+        };
+        job_pool_submit(pool, (Job){.fn = system_batch_job, .data = &batches[i], .counter = &counter});
+    }
+
+    job_pool_wait(pool, &counter);
+    free(batches);
+}
+
+static void system_job(void *data) {
+    SystemRun *run = data;
+    system_run_execute(run);
+
+    for (u32 i = 0; i < darray_length(run->dependents); i++) {
+        SystemRun *dependent = run->dependents[i];
+        if (atomic_fetch_sub(&dependent->remaining_dependencies, 1) == 1) {
+            job_pool_submit(run->world->job_pool,
+                            (Job){.fn = system_job, .data = dependent, .counter = dependent->stage_counter});
+        }
+    }
+}
+
+#define SKIPPED_RUN ((u32)-1)
+
+static b8 system_runs_in(const World *world, const SystemInfo *system, SystemSchedule schedule) {
+    return system->schedule == schedule && !(world->is_replica && (system->flags & SYSTEM_FLAG_NETWORKED));
+}
+
+// Drops the removal log entries of the component that every system still to
+// run with a Removed term on it has seen. Called after such a system ran, the
+// only time the oldest of their last runs can advance.
+static void trim_removed_components(World *world, ComponentId component) {
+    darray(RemovedComponent) removed = world->removed_components[component];
+    if (darray_length(removed) == 0) {
+        return;
+    }
+
+    b8 watched = false;
+    u32 oldest = 0;
+    for (u32 s = 0; s < darray_length(world->systems); s++) {
+        const SystemInfo *system = &world->systems[s];
+        if (system->schedule == SYSTEM_SCHEDULE_STARTUP && world->has_started) {
+            continue;
+        }
+        for (u32 i = 0; i < system->query.count; i++) {
+            if (system->query.filters[i] == QUERY_FILTER_REMOVED && system->query.ids[i] == component &&
+                (!watched || tick_is_newer(oldest, system->last_run_tick))) {
+                oldest = system->last_run_tick;
+                watched = true;
+            }
+        }
+    }
+
+    u32 kept = 0;
+    for (u32 r = 0; watched && r < darray_length(removed); r++) {
+        if (tick_is_newer(removed[r].tick, oldest)) {
+            removed[kept++] = removed[r];
+        }
+    }
+    darray_length_set(removed, kept);
+}
+
+static void run_schedule(World *world, SystemSchedule schedule) {
+    u32 run_count = 0;
+    for (u32 i = 0; i < darray_length(world->systems); i++) {
+        run_count += system_runs_in(world, &world->systems[i], schedule);
+    }
+    if (run_count == 0) {
+        return;
+    }
+
+    Allocator *scratch = frame_allocator_current(&world->frame_allocator);
+    SystemRun *runs = allocator_new_array(scratch, SystemRun, run_count);
+    // index into `runs` of every system in this schedule
+    u32 *run_of = allocator_new_array(scratch, u32, darray_length(world->systems));
+    for (u32 i = 0, r = 0; i < darray_length(world->systems); i++) {
+        run_of[i] = SKIPPED_RUN;
+        if (system_runs_in(world, &world->systems[i], schedule)) {
+            run_of[i] = r;
+            system_run_prepare(&runs[r++], world, &world->systems[i], &world->query_caches[i]);
+        }
+    }
+
+    if (world->job_pool == NULL) {
+        for (u32 i = 0; i < run_count; i++) {
+            system_run_execute(&runs[i]);
+        }
+    } else {
+        for (u32 j = 0; j < run_count; j++) {
+            const QueryCache *cache = runs[j].cache;
+            for (u32 d = 0; d < darray_length(cache->dependencies); d++) {
+                if (run_of[cache->dependencies[d]] == SKIPPED_RUN) {
+                    continue;
+                }
+                darray_push(runs[run_of[cache->dependencies[d]]].dependents, &runs[j]);
+                runs[j].dependency_count++;
+            }
+        }
+
+        JobCounter counter = {0};
+        for (u32 i = 0; i < run_count; i++) {
+            runs[i].stage_counter = &counter;
+            atomic_init(&runs[i].remaining_dependencies, runs[i].dependency_count);
+        }
+        for (u32 i = 0; i < run_count; i++) {
+            if (runs[i].dependency_count == 0) {
+                job_pool_submit(world->job_pool, (Job){.fn = system_job, .data = &runs[i], .counter = &counter});
+            }
+        }
+        job_pool_wait(world->job_pool, &counter);
+    }
+
+    for (u32 i = 0; i < run_count; i++) {
+        runs[i].system->last_run_tick = runs[i].change_tick;
+        if (runs[i].cache->removed_term != QUERY_NO_TERM) {
+            trim_removed_components(world, runs[i].component_ids[runs[i].cache->removed_term]);
+        }
+        system_run_cleanup(&runs[i]);
+    }
+    allocator_free(scratch, run_of, sizeof(u32) * darray_length(world->systems));
+    allocator_free(scratch, runs, sizeof(SystemRun) * run_count);
+
+    // sync point, nothing iterates the world until the next schedule
+    world_flush_commands(world);
+}
+
+void world_set_job_pool(World *world, JobPool *pool) {
+    world->job_pool = pool;
+    if (pool == NULL) {
+        return;
+    }
+
+    while (darray_length(world->command_buffers) < job_pool_thread_count(pool)) {
+        darray_push(world->command_buffers, ecs_command_buffer_new());
+    }
+}
+
+// Measured as an unsigned age, which stays exact up to 2^32 - 1 ticks where
+// tick_is_newer is only right up to 2^31
+static void clamp_ticks(u32 *ticks, u64 count, u32 change_tick) {
+    for (u64 i = 0; i < count; i++) {
+        if (change_tick - ticks[i] > WORLD_MAX_TICK_AGE) {
+            ticks[i] = change_tick - WORLD_MAX_TICK_AGE;
+        }
+    }
+}
+
+// Ticks older than WORLD_MAX_TICK_AGE all become the oldest tick kept. They
+// were not newer than any system's last run before and are not after, since
+// the last runs are clamped alike.
+static void check_ticks(World *world) {
+    u32 change_tick = world->change_tick;
+    for (u32 c = 0; c < darray_length(world->component_stores); c++) {
+        ComponentStore *store = &world->component_stores[c];
+        clamp_ticks(store->added_ticks, store->component_count, change_tick);
+        clamp_ticks(store->changed_ticks, store->component_count, change_tick);
+        clamp_ticks(&store->change_tick, 1, change_tick);
+    }
+
+    for (u32 a = 0; a < darray_length(world->archetypes); a++) {
+        Archetype *archetype = &world->archetypes[a];
+        for (u32 k = 0; k < darray_length(archetype->chunks); k++) {
+            ArchetypeChunk *chunk = archetype->chunks[k];
+            for (u32 column = 0; column < darray_length(archetype->component_ids); column++) {
+                clamp_ticks(archetype_chunk_added_ticks(archetype, chunk, column), chunk->count, change_tick);
+                clamp_ticks(archetype_chunk_changed_ticks(archetype, chunk, column), chunk->count, change_tick);
+            }
+        }
+    }
+
+    for (u32 s = 0; s < darray_length(world->systems); s++) {
+        clamp_ticks(&world->systems[s].last_run_tick, 1, change_tick);
+    }
+
+    for (u32 c = 0; c < darray_length(world->removed_components); c++) {
+        darray(RemovedComponent) removed = world->removed_components[c];
+        for (u32 r = 0; r < darray_length(removed); r++) {
+            clamp_ticks(&removed[r].tick, 1, change_tick);
+        }
+    }
+
+    world->last_tick_check = change_tick;
 }
 
-void world_run(World *world) { (void)world; }
+void world_run(World *world) {
+    frame_allocator_begin(&world->frame_allocator);
+
+    if (world->change_tick - world->last_tick_check >= WORLD_TICK_CHECK_INTERVAL) {
+        check_ticks(world);
+    }
+
+    if (!world->has_started) {
+        run_schedule(world, SYSTEM_SCHEDULE_STARTUP);
+        world->has_started = true;
+        // startup systems never run again, stop logging for them
+        for (u32 s = 0; s < darray_length(world->systems); s++) {
+            if (world->systems[s].schedule == SYSTEM_SCHEDULE_STARTUP) {
+                watch_removals(world, &world->systems[s].query, -1);
+            }
+        }
+    }
+
+    if (world->interpolation != NULL) {
+        interpolation_apply(world);
+    }
+    run_schedule(world, SYSTEM_SCHEDULE_UPDATE);
+    if (world->transforms != NULL) {
+        transform_propagate(world);
+    }
+    world->tick++;
+}
@@ -3,64 +3,320 @@
 
 #include "component_store.h"
 #include "containers/darray.h"
+#include "core/allocator/frame_allocator.h"
+#include "core/job_pool.h"
+#include "ecs/archetype.h"
+#include "ecs/command_buffer.h"
+#include "ecs/component_id.h"
 #include "ecs/entity.h"
 #include "ecs/system.h"
 
+// Ticks are compared by their wrapping difference, which only holds while no
+// stored tick is more than 2^31 behind the change tick. world_run clamps every
+// stored tick to at most WORLD_MAX_TICK_AGE behind each time the change tick
+// has advanced WORLD_TICK_CHECK_INTERVAL, so none ever gets that far.
+#define WORLD_TICK_CHECK_INTERVAL (1u << 30)
+#define WORLD_MAX_TICK_AGE (1u << 30)
+
+// Blocks of World.frame_allocator
+#define WORLD_FRAME_BLOCK_SIZE (64 * 1024)
+
+typedef struct TransformHierarchy TransformHierarchy;
+typedef struct InterpolationState InterpolationState;
+
+typedef enum {
+    // one ComponentStore per component type, see ComponentStoreBackend
+    WORLD_STORAGE_COMPONENT_STORE,
+    // entities with the same component set share chunked SoA storage
+    WORLD_STORAGE_ARCHETYPE,
+} WorldStorage;
+
+// Indexed by ComponentId, `name` is NULL for types this world did not register
+typedef struct {
+    const char *name;
+    u32 size;
+    ComponentFlags flags;
+    // World.structure_version for this type alone, pointers to components of
+    // the type stay valid while it is unchanged
+    u32 structure_version;
+    // systems still to run with a Removed term on the type, removals are only
+    // logged while there are any
+    u32 removal_watchers;
+} ComponentInfo;
+
+typedef struct {
+    u32 archetype;
+    u32 row;
+} EntityLocation;
+
+/**
+ * What a system's query resolves to in one world. It is built when the system
+ * is added and kept in step as component types and archetypes are created, so
+ * running the system does no matching.
+ */
+typedef struct {
+    // indices of the archetypes containing Query.mask and none of Query.excluded
+    darray(u32) archetypes;
+    // indices of the earlier systems in the same schedule whose queries
+    // conflict with this one, they must finish first
+    darray(u32) dependencies;
+    u32 component_sizes[MAX_REQUIRED_COMPONENTS];
+    // terms every match has a component of, see query_term_is_required
+    u32 required_terms[MAX_REQUIRED_COMPONENTS];
+    u32 required_count;
+    // Changed and Added terms, and the terms written by the system
+    u32 filtered_terms[MAX_REQUIRED_COMPONENTS];
+    u32 filtered_count;
+    u32 write_terms[MAX_REQUIRED_COMPONENTS];
+    u32 write_count;
+    // QUERY_NO_TERM without a Removed term
+    u32 removed_term;
+    // false until every component in the query is registered
+    b8 resolved;
+} QueryCache;
+
+// An entry of the removal log read by Removed query terms
+typedef struct {
+    entity_id entity;
+    u32 tick;
+} RemovedComponent;
+
 typedef struct {
+    WorldStorage storage;
+    // backs the entity, component and archetype storage, NULL for the heap
+    Allocator *allocator;
+    darray(ComponentInfo) components;
+    // indexed by ComponentId, like `components`
     darray(ComponentStore) component_stores;
-    darray(entity_id) free_ids;
+    darray(Archetype) archetypes;
+    // indexed by entity_index
+    darray(EntityLocation) entity_locations;
+    darray(u32) generations;
+    darray(entity_index) free_ids;
     darray(SystemInfo) systems;
-    entity_id next_id;
+    // indexed like `systems`
+    darray(QueryCache) query_caches;
+    // one per job pool thread, indexed by job_pool_thread_index of job_pool
+    darray(EcsCommandBuffer) command_buffers;
+    // indexed by ComponentId, kept until every system with a Removed term on
+    // the component has seen the entry, trimmed after such a system runs
+    darray(darray(RemovedComponent)) removed_components;
+    JobPool *job_pool;
+    // set by transform_enable, propagated after every UPDATE schedule
+    TransformHierarchy *transforms;
+    // set by interpolation_enable, applied before every UPDATE schedule
+    InterpolationState *interpolation;
+    // scratch arrays of schedules and command flushes, begun by every
+    // world_run. Only the thread running the world allocates from it.
+    FrameAllocator frame_allocator;
+    // bumped whenever an entity gains or loses a component, pointers to
+    // components stay valid while it is unchanged
+    u32 structure_version;
+    u32 tick;
+    // stamped on attached and written components, advanced by every system
+    // run so each run sees the changes made since its previous one
+    u32 change_tick;
+    // change tick of the last pass that clamped the stored ticks
+    u32 last_tick_check;
+    b8 has_started;
+    // set for worlds whose replicated state comes from a server, they skip
+    // SYSTEM_FLAG_NETWORKED systems
+    b8 is_replica;
 } World;
 
 World world_new(void);
 
+World world_new_with_storage(WorldStorage storage);
+
+/**
+ * Takes the world's entity, component, archetype and system storage from
+ * `allocator`. Command buffers, queries and the transform and interpolation
+ * state stay on the heap, so world_destroy is still needed. With an arena the
+ * storage it hands back is only released by the arena's next reset.
+ */
+World world_new_with_allocator(WorldStorage storage, Allocator *allocator);
+
 void world_destroy(World *world);
 
-void _world_register_component(World *world,
-                               const char *component_name,
-                               u64 component_size);
+/**
+ * Registers a component type with this world. Registering the same type
+ * twice is a no-op.
+ * @return the dense id of the component, shared by every world
+ */
+ComponentId _world_register_component(World *world,
+                                      const char *component_name,
+                                      u64 component_size);
+
+/**
+ * Like _world_register_component, but picks the index used by the component's
+ * store. The backend only applies to WORLD_STORAGE_COMPONENT_STORE worlds and
+ * is fixed by the first registration of the type.
+ */
+ComponentId _world_register_component_with_backend(World *world,
+                                                   const char *component_name,
+                                                   u64 component_size,
+                                                   ComponentStoreBackend backend);
 
 #define world_register_component(world, type)                                  \
-    _world_register_component(world, #type, sizeof(type));
+    _world_register_component(world, #type, sizeof(type))
+
+#define world_register_component_with_backend(world, type, backend)            \
+    _world_register_component_with_backend(world, #type, sizeof(type), backend)
 
 entity_id world_create_entity(World *world);
+
+/**
+ * Creates `count` entities that all get the components in `component_ids`.
+ * `initial_values[i]` points to `count` consecutive values of the i-th
+ * component, NULL leaves that component zeroed (a NULL `initial_values`
+ * zeroes all of them). The entities take fresh,
+ * consecutive slots instead of reusing destroyed ones, so every component is
+ * copied and indexed in bulk.
+ */
+EntityRange world_spawn_batch(World *world,
+                              u32 count,
+                              u32 component_count,
+                              const ComponentId *component_ids,
+                              const void *const *initial_values);
+
+/**
+ * Removes every component of the entity and bumps the generation of its slot,
+ * so the handle and all copies of it become invalid.
+ */
 void world_destroy_entity(World *world, entity_id entity);
-b8 world_is_valid_entity(World *world, entity_id entity);
 
+/**
+ * @return false for handles to destroyed entities, even when their slot has
+ * been reused since
+ */
+b8 world_is_valid_entity(const World *world, entity_id entity);
+
+/**
+ * @return COMPONENT_ID_INVALID when the world has no component with this name
+ */
+ComponentId world_find_component(const World *world, const char *component_name);
+
+void world_set_component_flags(World *world, ComponentId component, ComponentFlags flags);
+
+// Handles to destroyed entities are ignored, getting a component of one
+// returns NULL.
+void world_attach_component_by_id(World *world,
+                                  entity_id entity,
+                                  ComponentId component,
+                                  const void *value_ptr);
+
+void world_detach_component_by_id(World *world,
+                                  entity_id entity,
+                                  ComponentId component);
+
+void *world_get_component_by_id(const World *world,
+                                entity_id entity,
+                                ComponentId component);
+
+// String based variants for tooling and serialization, these look the
+// component up by name on every call.
 void _world_attach_component(World *world,
                              entity_id entity,
                              const char *type,
                              void *value_ptr);
 
-#define world_attach_component(world, entity, type, component)                 \
-    do {                                                                       \
-        type __temporary_value_copy__ = component;                             \
-        _world_attach_component(world,                                         \
-                                entity,                                        \
-                                #type,                                         \
-                                &__temporary_value_copy__);                    \
-    } while (0)
-
 void _world_detach_component(World *world,
                              entity_id entity,
                              const char *component_name);
 
-#define world_detach_component(world, entity, type)                            \
-    do {                                                                       \
-        (void)sizeof(type); /* for lsp autocomplete */                         \
-        _world_detach_component(world, entity, #type);                         \
-    } while (0)
-
 void *_world_get_component(const World *world,
                            entity_id entity,
                            const char *type);
 
+#define world_attach_component(world, entity, type, component)                 \
+    do {                                                                       \
+        type __temporary_value_copy__ = component;                             \
+        world_attach_component_by_id(world,                                    \
+                                     entity,                                   \
+                                     component_id(type),                       \
+                                     &__temporary_value_copy__);               \
+    } while (0)
+
+#define world_detach_component(world, entity, type)                            \
+    world_detach_component_by_id(world, entity, component_id(type))
+
 #define world_get_component(world, entity, type)                               \
-    (type *)_world_get_component(world, entity, #type)
+    ((type *)world_get_component_by_id(world, entity, component_id(type)))
+
+/**
+ * Flags a component that was written through world_get_component as changed,
+ * writes through a system's query are flagged automatically.
+ */
+void world_mark_changed_by_id(World *world,
+                              entity_id entity,
+                              ComponentId component);
+
+#define world_mark_changed(world, entity, type)                                \
+    world_mark_changed_by_id(world, entity, component_id(type))
 
+/**
+ * @return the changed tick of the entity's component, compared against by
+ * Changed query terms, or NULL when the entity does not have the component
+ */
+u32 *world_get_changed_tick_by_id(const World *world,
+                                  entity_id entity,
+                                  ComponentId component);
+
+/**
+ * Only for WORLD_STORAGE_ARCHETYPE worlds, `mask` must not be empty.
+ * @return the index of the archetype with exactly the components in `mask`
+ */
+u32 world_find_or_create_archetype(World *world, const ComponentMask *mask);
+
+/**
+ * The world takes ownership of `system.query`.
+ */
 void world_add_system(World *world, SystemInfo system);
 
+/**
+ * Lets world_run spread systems over the threads of `pool`. The world does not
+ * take ownership of the pool, pass NULL to run single threaded again.
+ */
+void world_set_job_pool(World *world, JobPool *pool);
+
+/**
+ * @return the command buffer of the calling thread, the first one for threads
+ * that are not workers of the world's job pool
+ */
+EcsCommandBuffer *world_command_buffer(World *world);
+
+/**
+ * Applies the commands of every thread's buffer and clears the buffers.
+ * Commands are sorted so each entity changes archetype at most once and each
+ * component store is updated in ascending entity order, only the last attach
+ * or detach of a component per entity takes effect. Commands on handles that
+ * are stale by the time they are applied are skipped.
+ */
+void world_flush_commands(World *world);
+
+/**
+ * Applies and clears a single command buffer, see world_flush_commands.
+ */
+void world_apply_command_buffer(World *world, EcsCommandBuffer *buffer);
+
+/**
+ * Runs one tick: STARTUP systems on the first call, then interpolation when
+ * it is enabled, then every UPDATE system, then transform propagation when
+ * transforms are enabled.
+ * Each system is called once for every entity that has all of the components
+ * in its query, with the component pointers in query order. Changed and Added
+ * terms only match components stamped since the system's previous run, a
+ * Removed term matches every entity that lost the component since then.
+ *
+ * With a job pool set, systems whose queries do not conflict (one writes a
+ * component the other reads or writes) run at the same time, conflicting
+ * systems run in the order they were added. Systems with SYSTEM_FLAG_PARALLEL
+ * also split their entities into batches that run in parallel.
+ *
+ * Systems must not change the structure of the world directly while it runs,
+ * they record changes in SystemContext.commands instead, which are flushed
+ * after each schedule.
+ */
 void world_run(World *world);
 
 #endif // ECS_WORLD_H
@@ -0,0 +1,111 @@
+#include "bit_stream.h"
+#include "core/assert.h"
+
+BitWriter bit_writer_new(void *buffer, u32 capacity) {
+    return (BitWriter){
+        .data = buffer,
+        .capacity = capacity,
+        .byte_position = 0,
+        .scratch = 0,
+        .scratch_bits = 0,
+        .overflow = false,
+    };
+}
+
+void bit_write(BitWriter *writer, u32 value, u32 bits) {
+    ASSERT_DEBUG(bits <= 32);
+    if (bits == 0) {
+        return;
+    }
+
+    u64 masked = bits == 32 ? value : value & ((1u << bits) - 1);
+    writer->scratch |= masked << writer->scratch_bits;
+    writer->scratch_bits += bits;
+
+    while (writer->scratch_bits >= 8) {
+        if (writer->byte_position < writer->capacity) {
+            writer->data[writer->byte_position] = (u8)writer->scratch;
+        } else {
+            writer->overflow = true;
+        }
+        writer->byte_position++;
+        writer->scratch >>= 8;
+        writer->scratch_bits -= 8;
+    }
+}
+
+void bit_write_varint(BitWriter *writer, u32 value) {
+    while (value >= 0x80) {
+        bit_write(writer, (value & 0x7F) | 0x80, 8);
+        value >>= 7;
+    }
+    bit_write(writer, value, 8);
+}
+
+void bit_write_bytes(BitWriter *writer, const void *bytes, u32 count) {
+    const u8 *in = bytes;
+    for (u32 i = 0; i < count; i++) {
+        bit_write(writer, in[i], 8);
+    }
+}
+
+u32 bit_writer_finish(BitWriter *writer) {
+    if (writer->scratch_bits > 0) {
+        bit_write(writer, 0, 8 - writer->scratch_bits);
+    }
+    return writer->byte_position;
+}
+
+BitReader bit_reader_new(const void *data, u32 size) {
+    return (BitReader){
+        .data = data,
+        .size = size,
+        .byte_position = 0,
+        .scratch = 0,
+        .scratch_bits = 0,
+        .overflow = false,
+    };
+}
+
+u32 bit_read(BitReader *reader, u32 bits) {
+    ASSERT_DEBUG(bits <= 32);
+    if (bits == 0) {
+        return 0;
+    }
+
+    while (reader->scratch_bits < bits) {
+        u64 byte = 0;
+        if (reader->byte_position < reader->size) {
+            byte = reader->data[reader->byte_position];
+        } else {
+            reader->overflow = true;
+        }
+        reader->byte_position++;
+        reader->scratch |= byte << reader->scratch_bits;
+        reader->scratch_bits += 8;
+    }
+
+    u32 value = (u32)(bits == 32 ? reader->scratch : reader->scratch & ((1u << bits) - 1));
+    reader->scratch >>= bits;
+    reader->scratch_bits -= bits;
+    return value;
+}
+
+u32 bit_read_varint(BitReader *reader) {
+    u32 value = 0;
+    for (u32 shift = 0; shift < 35; shift += 7) {
+        u32 byte = bit_read(reader, 8);
+        value |= (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    return value;
+}
+
+void bit_read_bytes(BitReader *reader, void *bytes, u32 count) {
+    u8 *out = bytes;
+    for (u32 i = 0; i < count; i++) {
+        out[i] = (u8)bit_read(reader, 8);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef NET_BIT_STREAM_H
+#define NET_BIT_STREAM_H
+
+#include "core/defines.h"
+
+/**
+ * Packs values of arbitrary bit widths into a caller-owned buffer, least
+ * significant bits first. Writes past the end of the buffer are dropped and
+ * set `overflow`.
+ */
+typedef struct {
+    u8 *data;
+    u32 capacity;
+    u32 byte_position;
+    u64 scratch;
+    u32 scratch_bits;
+    b8 overflow;
+} BitWriter;
+
+typedef struct {
+    const u8 *data;
+    u32 size;
+    u32 byte_position;
+    u64 scratch;
+    u32 scratch_bits;
+    b8 overflow;
+} BitReader;
+
+BitWriter bit_writer_new(void *buffer, u32 capacity);
+
+// `bits` is at most 32
+void bit_write(BitWriter *writer, u32 value, u32 bits);
+
+// 7 bits per byte, small values take few bits
+void bit_write_varint(BitWriter *writer, u32 value);
+
+void bit_write_bytes(BitWriter *writer, const void *bytes, u32 count);
+
+/**
+ * Flushes the partially filled last byte.
+ * @return the number of bytes written
+ */
+u32 bit_writer_finish(BitWriter *writer);
+
+// Bits written so far, including the ones not flushed yet
+static inline u32 bit_writer_bits(const BitWriter *writer) { return writer->byte_position * 8 + writer->scratch_bits; }
+
+BitReader bit_reader_new(const void *data, u32 size);
+
+// Reading past the end returns zeroes and sets `overflow`
+u32 bit_read(BitReader *reader, u32 bits);
+
+u32 bit_read_varint(BitReader *reader);
+
+void bit_read_bytes(BitReader *reader, void *bytes, u32 count);
+
+#endif // NET_BIT_STREAM_H
@@ -0,0 +1,181 @@
+#include "interest_grid.h"
+#include "core/assert.h"
+#include "ecs/archetype.h"
+#include "ecs/component_store.h"
+#include "ecs/transform.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define BUCKET_COUNT (1u << 14)
+
+InterestGrid interest_grid_new(f32 cell_size) {
+    ASSERT(cell_size > 0.0f);
+
+    InterestGrid grid = {
+        .cell_size = cell_size,
+        .bucket_mask = BUCKET_COUNT - 1,
+        .buckets = malloc(sizeof(u32 *) * BUCKET_COUNT),
+        .slots = darray_new(InterestGridSlot),
+        .visited = calloc(BUCKET_COUNT, sizeof(u32)),
+        .query_stamp = 0,
+        .update_stamp = 0,
+        .last_tick = 0,
+    };
+    ASSERT(grid.buckets != NULL && grid.visited != NULL);
+    for (u32 i = 0; i < BUCKET_COUNT; i++) {
+        grid.buckets[i] = darray_new(u32);
+    }
+    return grid;
+}
+
+void interest_grid_destroy(InterestGrid *grid) {
+    for (u32 i = 0; i < BUCKET_COUNT; i++) {
+        darray_destroy(grid->buckets[i]);
+    }
+    free(grid->buckets);
+    free(grid->visited);
+    darray_destroy(grid->slots);
+}
+
+static i32 cell_of(const InterestGrid *grid, f32 coordinate) { return (i32)floorf(coordinate / grid->cell_size); }
+
+static u32 bucket_of(const InterestGrid *grid, i32 x, i32 y, i32 z) {
+    u32 hash = (u32)x * 73856093u ^ (u32)y * 19349663u ^ (u32)z * 83492791u;
+    return hash & grid->bucket_mask;
+}
+
+static void remove_from_bucket(InterestGrid *grid, u32 slot) {
+    InterestGridSlot *entry = &grid->slots[slot];
+    darray(u32) bucket = grid->buckets[entry->bucket];
+    u32 last = bucket[darray_length(bucket) - 1];
+    bucket[entry->position] = last;
+    grid->slots[last].position = entry->position;
+    darray_length_set(bucket, darray_length(bucket) - 1);
+    entry->bucket = INTEREST_GRID_NONE;
+}
+
+static void place(InterestGrid *grid, u32 slot, u32 generation, const GlobalTransform *transform) {
+    vec3s point = {{transform->matrix.raw[3][0], transform->matrix.raw[3][1], transform->matrix.raw[3][2]}};
+    u32 bucket = bucket_of(grid, cell_of(grid, point.x), cell_of(grid, point.y), cell_of(grid, point.z));
+
+    InterestGridSlot *entry = &grid->slots[slot];
+    entry->point = point;
+    entry->generation = generation;
+    if (entry->bucket == bucket) {
+        return;
+    }
+
+    if (entry->bucket != INTEREST_GRID_NONE) {
+        remove_from_bucket(grid, slot);
+    }
+    entry->bucket = bucket;
+    entry->position = darray_length(grid->buckets[bucket]);
+    darray_push(grid->buckets[bucket], slot);
+}
+
+static void place_changed(InterestGrid *grid,
+                          const World *world,
+                          const entity_index *entities,
+                          const GlobalTransform *transforms,
+                          const u32 *changed_ticks,
+                          u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        entity_index slot = entities[i];
+        InterestGridSlot *entry = &grid->slots[slot];
+        entry->seen = grid->update_stamp;
+
+        b8 moved = (i32)(changed_ticks[i] - grid->last_tick) > 0;
+        if (moved || entry->bucket == INTEREST_GRID_NONE || entry->generation != world->generations[slot]) {
+            place(grid, slot, world->generations[slot], &transforms[i]);
+        }
+    }
+}
+
+void interest_grid_update(InterestGrid *grid, const World *world) {
+    if (darray_length(grid->slots) < darray_length(world->generations)) {
+        darray_push_n(grid->slots,
+                      ((InterestGridSlot){.bucket = INTEREST_GRID_NONE}),
+                      darray_length(world->generations) - darray_length(grid->slots));
+    }
+    grid->update_stamp++;
+
+    ComponentId id = component_id(GlobalTransform);
+    if (id < darray_length(world->components) && world->components[id].name != NULL) {
+        if (world->storage == WORLD_STORAGE_COMPONENT_STORE) {
+            const ComponentStore *store = &world->component_stores[id];
+            place_changed(grid,
+                          world,
+                          store->entities,
+                          store->component_array,
+                          store->changed_ticks,
+                          store->component_count);
+        } else {
+            for (u32 a = 0; a < darray_length(world->archetypes); a++) {
+                const Archetype *archetype = &world->archetypes[a];
+                u32 column = archetype->column_of[id];
+                if (column == ARCHETYPE_NO_COLUMN) {
+                    continue;
+                }
+
+                for (u32 c = 0; c < darray_length(archetype->chunks); c++) {
+                    const ArchetypeChunk *chunk = archetype->chunks[c];
+                    place_changed(grid,
+                                  world,
+                                  archetype_chunk_entities(chunk),
+                                  archetype_chunk_column(archetype, chunk, column),
+                                  archetype_chunk_changed_ticks(archetype, chunk, column),
+                                  chunk->count);
+                }
+            }
+        }
+    }
+
+    // entities the walk did not see were destroyed or lost their transform
+    for (u32 slot = 0; slot < darray_length(grid->slots); slot++) {
+        if (grid->slots[slot].bucket != INTEREST_GRID_NONE && grid->slots[slot].seen != grid->update_stamp) {
+            remove_from_bucket(grid, slot);
+        }
+    }
+
+    // stamps from now on are newer
+    grid->last_tick = world->change_tick - 1;
+}
+
+darray(InterestHit) interest_grid_query(InterestGrid *grid, vec3s center, f32 radius, darray(InterestHit) hits) {
+    grid->query_stamp++;
+    i32 low[3];
+    i32 high[3];
+    for (u32 axis = 0; axis < 3; axis++) {
+        low[axis] = cell_of(grid, center.raw[axis] - radius);
+        high[axis] = cell_of(grid, center.raw[axis] + radius);
+    }
+
+    // cells share buckets, each bucket is searched once
+    f32 radius_squared = radius * radius;
+    for (i32 x = low[0]; x <= high[0]; x++) {
+        for (i32 y = low[1]; y <= high[1]; y++) {
+            for (i32 z = low[2]; z <= high[2]; z++) {
+                u32 bucket = bucket_of(grid, x, y, z);
+                if (grid->visited[bucket] == grid->query_stamp) {
+                    continue;
+                }
+                grid->visited[bucket] = grid->query_stamp;
+
+                const u32 *slots = grid->buckets[bucket];
+                u32 count = darray_length(slots);
+                for (u32 i = 0; i < count; i++) {
+                    vec3s point = grid->slots[slots[i]].point;
+                    f32 dx = point.x - center.x;
+                    f32 dy = point.y - center.y;
+                    f32 dz = point.z - center.z;
+                    f32 distance_squared = dx * dx + dy * dy + dz * dz;
+                    if (distance_squared <= radius_squared) {
+                        darray_push(hits, ((InterestHit){.slot = slots[i], .distance = sqrtf(distance_squared)}));
+                    }
+                }
+            }
+        }
+    }
+    return hits;
+}
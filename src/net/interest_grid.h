@@ -0,0 +1,67 @@
+#ifndef NET_INTEREST_GRID_H
+#define NET_INTEREST_GRID_H
+
+#include "containers/darray.h"
+#include "core/defines.h"
+#include "ecs/world.h"
+
+#define INTEREST_GRID_NONE ((u32)-1)
+
+typedef struct {
+    // INTEREST_GRID_NONE for slots without a placed entity
+    u32 bucket;
+    // index in the bucket
+    u32 position;
+    u32 generation;
+    // update stamp of the last update that saw the entity
+    u32 seen;
+    vec3s point;
+} InterestGridSlot;
+
+typedef struct {
+    u32 slot;
+    f32 distance;
+} InterestHit;
+
+/**
+ * Buckets entities by the translation of their GlobalTransform in a uniform
+ * grid of cubic cells. Cells are hashed into a fixed number of buckets, so
+ * the grid is unbounded and sparse worlds take no memory for empty cells.
+ */
+typedef struct {
+    f32 cell_size;
+    u32 bucket_mask;
+    // entity slots in each bucket
+    darray(u32) *buckets;
+    // indexed by entity slot
+    darray(InterestGridSlot) slots;
+    // per bucket, the query that last visited it
+    u32 *visited;
+    u32 query_stamp;
+    u32 update_stamp;
+    // GlobalTransforms changed after this tick are placed again
+    u32 last_tick;
+} InterestGrid;
+
+InterestGrid interest_grid_new(f32 cell_size);
+
+void interest_grid_destroy(InterestGrid *grid);
+
+/**
+ * Moves the entities whose GlobalTransform changed since the previous update
+ * to their new cell, places new ones and drops the ones that were destroyed
+ * or lost their GlobalTransform.
+ */
+void interest_grid_update(InterestGrid *grid, const World *world);
+
+/**
+ * Appends every entity within `radius` of `center` to `hits`.
+ * @return `hits`, which may have moved
+ */
+darray(InterestHit) interest_grid_query(InterestGrid *grid, vec3s center, f32 radius, darray(InterestHit) hits);
+
+static inline b8 interest_grid_contains(const InterestGrid *grid, u32 slot) {
+    return slot < darray_length(grid->slots) && grid->slots[slot].bucket != INTEREST_GRID_NONE;
+}
+
+#endif // NET_INTEREST_GRID_H
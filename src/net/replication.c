@@ -0,0 +1,1026 @@
+#include "replication.h"
+#include "containers/darray.h"
+#include "core/allocator/memory_tracker.h"
+#include "core/assert.h"
+#include "core/logging.h"
+#include "ecs/interpolation.h"
+#include "ecs/slot_columns.h"
+#include "net/bit_stream.h"
+#include "net/interest_grid.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACKET_SNAPSHOT 1
+#define PACKET_ACK 2
+
+// Sequences start at 1, an acknowledgement of 0 is a client saying hello
+#define NO_SEQUENCE 0
+
+// type, sequence, baseline, fragment, fragment count and slot count, written
+// byte aligned in front of the bit-packed entries
+#define SNAPSHOT_HEADER_SIZE 17
+#define FRAGMENT_COUNT_OFFSET 11
+#define ACK_SIZE 5
+#define PAYLOAD_BITS ((UDP_MAX_PACKET_SIZE - SNAPSHOT_HEADER_SIZE) * 8)
+
+STATIC_ASSERT(REPLICATION_MAX_COMPONENTS <= SLOT_COLUMNS_MAX, "frame masks have one bit per component");
+
+// The replicated components, indexed by their bit in a frame's masks
+typedef struct {
+    u32 count;
+    ComponentId ids[REPLICATION_MAX_COMPONENTS];
+    u32 sizes[REPLICATION_MAX_COMPONENTS];
+    // bits of the components that are also COMPONENT_FLAG_INTERPOLATE
+    u32 interpolated;
+    // the most an entity's entry can take, so a packet is only started
+    // when one fits
+    u32 max_entry_bits;
+} ReplicationSchema;
+
+/**
+ * The replicated state of a world at one sequence, column r of `slots` holds
+ * schema component r. Masks are 0 for dead slots.
+ */
+typedef struct {
+    u32 sequence;
+    SlotColumns slots;
+} ReplicationFrame;
+
+// Entries in a sent snapshot's slot list that removed the entity
+#define SLOT_REMOVED 0x80000000u
+// Removals go out ahead of most changes, the client should not keep showing
+// entities it can no longer see
+#define REMOVAL_PRIORITY 2.0f
+// Slots carried by a snapshot the client has not acknowledged go out again
+// whatever the budget: the next snapshot replaces it on the client and is a
+// delta against the same view, so leaving them out would undo them
+#define IN_FLIGHT_PRIORITY FLT_MAX
+// The server deltas against the newest snapshot a client acknowledged, the
+// client keeps a few more in case acknowledgements are lost
+#define CLIENT_HISTORY 8
+
+typedef struct {
+    u32 sequence;
+    // sequence of the view the snapshot is a delta against
+    u32 baseline;
+    // the slots it has entries for, ascending, with SLOT_REMOVED for removals
+    darray(u32) slots;
+} SentSnapshot;
+
+typedef struct {
+    // grows every update the slot differs from the view and is not sent
+    f32 priority;
+    // the last update the slot was relevant to the client
+    u32 relevant;
+    // the newest snapshot with an entry for the slot
+    u32 sent;
+    // index in the peer's `known`, ENTITY_INDEX_INVALID when not in the view
+    u32 known;
+} PeerSlot;
+
+typedef struct {
+    NetAddress address;
+    vec3s focus;
+    // what the client holds as of the newest snapshot it acknowledged,
+    // deltas are taken against it
+    ReplicationFrame view;
+    // slots with an entity in the view
+    darray(u32) known;
+    darray(PeerSlot) slots;
+    // indexed by sequence % REPLICATION_HISTORY
+    SentSnapshot sent[REPLICATION_HISTORY];
+} ReplicationPeer;
+
+typedef struct {
+    // with SLOT_REMOVED for removals
+    u32 slot;
+    f32 priority;
+} Candidate;
+
+struct ReplicationServer {
+    World *world;
+    UdpSocket socket;
+    ReplicationServerConfig config;
+    ReplicationSchema schema;
+    // indexed by sequence % REPLICATION_HISTORY
+    ReplicationFrame history[REPLICATION_HISTORY];
+    u32 sequence;
+    darray(ReplicationPeer) peers;
+    ReplicationServerStats stats;
+    // only used with a relevance radius
+    InterestGrid grid;
+    // slots relevant to every client: all of them without a relevance
+    // radius, otherwise the replicated entities without a GlobalTransform
+    darray(u32) everywhere;
+    // scratch space of the per-client passes
+    darray(InterestHit) hits;
+    darray(Candidate) candidates;
+    // encoded packets of one snapshot, back to back
+    darray(u8) packets;
+    darray(u32) packet_sizes;
+    // per peer, the newest acknowledged sequence of one batch of acks
+    darray(u32) newest_acks;
+};
+
+struct ReplicationClient {
+    World *world;
+    UdpSocket socket;
+    NetAddress server;
+    ReplicationSchema schema;
+    // completed snapshots, indexed by sequence % CLIENT_HISTORY
+    ReplicationFrame history[CLIENT_HISTORY];
+    // sequence of the snapshot the world shows
+    u32 applied;
+    // the snapshot whose fragments are arriving, starts as a copy of its
+    // baseline that every fragment's entries are decoded over
+    ReplicationFrame pending;
+    darray(b8) pending_received;
+    u32 pending_missing;
+    // local handle of the entity in each server slot
+    darray(entity_id) entities;
+};
+
+static void put_u16(u8 *out, u16 value) {
+    out[0] = (u8)value;
+    out[1] = (u8)(value >> 8);
+}
+
+static void put_u32(u8 *out, u32 value) {
+    put_u16(out, (u16)value);
+    put_u16(out + 2, (u16)(value >> 16));
+}
+
+static u16 get_u16(const u8 *in) { return (u16)(in[0] | in[1] << 8); }
+
+static u32 get_u32(const u8 *in) { return get_u16(in) | (u32)get_u16(in + 2) << 16; }
+
+static ReplicationSchema schema_new(const World *world) {
+    ReplicationSchema schema = {0};
+    // more, slot gap, identity changed, generation and mask
+    schema.max_entry_bits = 1 + 40 + 1 + 40;
+
+    for (u32 id = 0; id < darray_length(world->components); id++) {
+        const ComponentInfo *info = &world->components[id];
+        if (info->name == NULL || !(info->flags & COMPONENT_FLAG_REPLICATED)) {
+            continue;
+        }
+
+        ASSERT_MSG(schema.count < REPLICATION_MAX_COMPONENTS, "too many replicated components");
+        schema.ids[schema.count] = id;
+        schema.sizes[schema.count] = info->size;
+        if (info->flags & COMPONENT_FLAG_INTERPOLATE) {
+            schema.interpolated |= 1u << schema.count;
+        }
+        // changed bit, byte mask and every byte
+        schema.max_entry_bits += 1 + 1 + info->size * 9;
+        schema.count++;
+    }
+
+    ASSERT_MSG(schema.max_entry_bits <= PAYLOAD_BITS, "replicated components do not fit in a packet");
+    return schema;
+}
+
+static void frame_resize(ReplicationFrame *frame, const ReplicationSchema *schema, u32 slot_count) {
+    slot_columns_resize(&frame->slots, memory_tag_allocator(MEMORY_TAG_NET), schema->sizes, schema->count, slot_count);
+}
+
+static void frame_copy(ReplicationFrame *dst, const ReplicationFrame *src, const ReplicationSchema *schema) {
+    frame_resize(dst, schema, src->slots.slot_count);
+    memcpy(dst->slots.generations, src->slots.generations, src->slots.slot_count * sizeof(u32));
+    memcpy(dst->slots.masks, src->slots.masks, src->slots.slot_count * sizeof(u32));
+    for (u32 r = 0; r < schema->count; r++) {
+        memcpy(dst->slots.columns[r], src->slots.columns[r], (u64)src->slots.slot_count * schema->sizes[r]);
+    }
+    dst->sequence = src->sequence;
+}
+
+static void frame_destroy(ReplicationFrame *frame, const ReplicationSchema *schema) {
+    slot_columns_destroy(&frame->slots, memory_tag_allocator(MEMORY_TAG_NET), schema->sizes, schema->count);
+    frame->sequence = NO_SEQUENCE;
+}
+
+static void frame_capture(ReplicationFrame *frame, const ReplicationSchema *schema, const World *world) {
+    slot_columns_capture(
+        &frame->slots, memory_tag_allocator(MEMORY_TAG_NET), world, schema->ids, schema->sizes, schema->count);
+}
+
+static const ReplicationFrame *find_frame(const ReplicationFrame *history, u32 history_size, u32 sequence) {
+    const ReplicationFrame *frame = &history[sequence % history_size];
+    return sequence != NO_SEQUENCE && frame->sequence == sequence ? frame : NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Server
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    ReplicationServer *server;
+    u8 packet[UDP_MAX_PACKET_SIZE];
+    BitWriter writer;
+    u32 sequence;
+    u32 baseline;
+    u32 slot_count;
+    u32 fragment;
+    // slot of the previous entry in this packet, ENTITY_INDEX_INVALID before
+    // the first
+    u32 previous;
+} SnapshotEncoder;
+
+static void encoder_begin_packet(SnapshotEncoder *encoder) {
+    encoder->packet[0] = PACKET_SNAPSHOT;
+    put_u32(encoder->packet + 1, encoder->sequence);
+    put_u32(encoder->packet + 5, encoder->baseline);
+    put_u16(encoder->packet + 9, (u16)encoder->fragment);
+    put_u32(encoder->packet + 13, encoder->slot_count);
+    encoder->writer = bit_writer_new(encoder->packet + SNAPSHOT_HEADER_SIZE, PAYLOAD_BITS / 8);
+    encoder->previous = ENTITY_INDEX_INVALID;
+}
+
+static void encoder_end_packet(SnapshotEncoder *encoder) {
+    bit_write(&encoder->writer, 0, 1);
+    u32 size = SNAPSHOT_HEADER_SIZE + bit_writer_finish(&encoder->writer);
+    ASSERT_DEBUG(!encoder->writer.overflow);
+
+    ReplicationServer *server = encoder->server;
+    darray_extend_from(server->packets, encoder->packet, size);
+    darray_push(server->packet_sizes, size);
+    encoder->fragment++;
+}
+
+static void write_component_delta(BitWriter *writer, const u8 *value, const u8 *baseline, u32 size) {
+    for (u32 i = 0; i < size; i += 32) {
+        u32 bits = MIN(32, size - i);
+        u32 mask = 0;
+        for (u32 b = 0; b < bits; b++) {
+            mask |= (u32)(value[i + b] != baseline[i + b]) << b;
+        }
+        bit_write(writer, mask, bits);
+    }
+    for (u32 i = 0; i < size; i++) {
+        if (value[i] != baseline[i]) {
+            bit_write(writer, value[i], 8);
+        }
+    }
+}
+
+static b8 slot_differs(const ReplicationSchema *schema,
+                       const ReplicationFrame *frame,
+                       const ReplicationFrame *view,
+                       u32 slot) {
+    u32 mask = frame->slots.masks[slot];
+    if (mask != view->slots.masks[slot] || frame->slots.generations[slot] != view->slots.generations[slot]) {
+        return true;
+    }
+    for (u32 bits = mask; bits != 0; bits &= bits - 1) {
+        u32 r = __builtin_ctz(bits);
+        u64 offset = (u64)slot * schema->sizes[r];
+        if (memcmp(frame->slots.columns[r] + offset, view->slots.columns[r] + offset, schema->sizes[r]) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Writes the entry that takes `slot` from the client's view to `frame`, or
+ * removes its entity for SLOT_REMOVED: its generation and component mask
+ * when either changed, then each component, as a delta when the view's
+ * entity has it or in full otherwise.
+ */
+static void write_entry(BitWriter *writer,
+                        const ReplicationSchema *schema,
+                        const ReplicationFrame *frame,
+                        const ReplicationFrame *view,
+                        u32 entry,
+                        u32 gap) {
+    u32 slot = entry & ~SLOT_REMOVED;
+    b8 removed = (entry & SLOT_REMOVED) != 0;
+    u32 mask = removed ? 0 : frame->slots.masks[slot];
+    u32 generation = removed ? 0 : frame->slots.generations[slot];
+    u32 view_mask = view->slots.masks[slot];
+    u32 view_generation = view->slots.generations[slot];
+
+    bit_write(writer, 1, 1);
+    bit_write_varint(writer, gap);
+
+    b8 identity_changed = mask != view_mask || generation != view_generation;
+    bit_write(writer, identity_changed, 1);
+    if (identity_changed) {
+        bit_write_varint(writer, generation);
+        bit_write(writer, mask, schema->count);
+    }
+
+    // components the client can delta against
+    u32 shared = generation == view_generation ? mask & view_mask : 0;
+    for (u32 bits = mask; bits != 0; bits &= bits - 1) {
+        u32 r = __builtin_ctz(bits);
+        u32 size = schema->sizes[r];
+        const u8 *value = frame->slots.columns[r] + (u64)slot * size;
+        if (shared & (1u << r)) {
+            const u8 *baseline = view->slots.columns[r] + (u64)slot * size;
+            b8 component_changed = memcmp(value, baseline, size) != 0;
+            bit_write(writer, component_changed, 1);
+            if (component_changed) {
+                write_component_delta(writer, value, baseline, size);
+            }
+        } else {
+            bit_write_bytes(writer, value, size);
+        }
+    }
+}
+
+/**
+ * Encodes the entries of `slots`, ascending, into the server's packet
+ * buffer as a delta against the peer's view.
+ */
+static void encode_snapshot(ReplicationServer *server,
+                            const ReplicationPeer *peer,
+                            const ReplicationFrame *frame,
+                            const u32 *slots,
+                            u32 count) {
+    SnapshotEncoder state = {
+        .server = server,
+        .sequence = frame->sequence,
+        .baseline = peer->view.sequence,
+        .slot_count = frame->slots.slot_count,
+    };
+    SnapshotEncoder *encoder = &state;
+    darray_clear(server->packets);
+    darray_clear(server->packet_sizes);
+    encoder_begin_packet(encoder);
+
+    for (u32 i = 0; i < count; i++) {
+        if (bit_writer_bits(&encoder->writer) + server->schema.max_entry_bits + 1 > PAYLOAD_BITS) {
+            encoder_end_packet(encoder);
+            encoder_begin_packet(encoder);
+        }
+
+        u32 slot = slots[i] & ~SLOT_REMOVED;
+        u32 gap = encoder->previous == ENTITY_INDEX_INVALID ? slot : slot - encoder->previous - 1;
+        write_entry(&encoder->writer, &server->schema, frame, &peer->view, slots[i], gap);
+        encoder->previous = slot;
+    }
+    encoder_end_packet(encoder);
+
+    // every fragment carries the count, so the client knows when it has all
+    u32 offset = 0;
+    for (u32 i = 0; i < darray_length(server->packet_sizes); i++) {
+        put_u16(server->packets + offset + FRAGMENT_COUNT_OFFSET, (u16)encoder->fragment);
+        offset += server->packet_sizes[i];
+    }
+}
+
+static void peer_remember(ReplicationPeer *peer, u32 slot) {
+    if (peer->slots[slot].known == ENTITY_INDEX_INVALID) {
+        peer->slots[slot].known = darray_length(peer->known);
+        darray_push(peer->known, slot);
+    }
+}
+
+static void peer_forget(ReplicationPeer *peer, u32 slot) {
+    u32 position = peer->slots[slot].known;
+    if (position == ENTITY_INDEX_INVALID) {
+        return;
+    }
+
+    u32 last = peer->known[darray_length(peer->known) - 1];
+    peer->known[position] = last;
+    peer->slots[last].known = position;
+    darray_length_set(peer->known, darray_length(peer->known) - 1);
+    peer->slots[slot].known = ENTITY_INDEX_INVALID;
+}
+
+// The client starts over from an empty world
+static void peer_reset_view(ReplicationPeer *peer, const ReplicationSchema *schema) {
+    for (u32 i = 0; i < darray_length(peer->known); i++) {
+        peer->slots[peer->known[i]].known = ENTITY_INDEX_INVALID;
+    }
+    for (u32 i = 0; i < darray_length(peer->slots); i++) {
+        peer->slots[i].sent = NO_SEQUENCE;
+    }
+    darray_clear(peer->known);
+    frame_resize(&peer->view, schema, 0);
+    peer->view.sequence = NO_SEQUENCE;
+}
+
+static void peer_grow(ReplicationPeer *peer, const ReplicationSchema *schema, u32 slot_count) {
+    if (peer->view.slots.slot_count < slot_count) {
+        frame_resize(&peer->view, schema, slot_count);
+    }
+    if (darray_length(peer->slots) < slot_count) {
+        darray_push_n(peer->slots,
+                      ((PeerSlot){.known = ENTITY_INDEX_INVALID}),
+                      slot_count - darray_length(peer->slots));
+    }
+}
+
+/**
+ * The client holds what `sequence` wrote over the view, the entries' values
+ * are taken from the captured frame of that sequence.
+ */
+static void peer_apply_ack(ReplicationServer *server, ReplicationPeer *peer, u32 sequence) {
+    const ReplicationFrame *frame = find_frame(server->history, REPLICATION_HISTORY, sequence);
+    if (frame == NULL) {
+        return;
+    }
+
+    const ReplicationSchema *schema = &server->schema;
+    ReplicationFrame *view = &peer->view;
+    peer_grow(peer, schema, frame->slots.slot_count);
+
+    const SentSnapshot *sent = &peer->sent[sequence % REPLICATION_HISTORY];
+    for (u32 i = 0; i < darray_length(sent->slots); i++) {
+        u32 slot = sent->slots[i] & ~SLOT_REMOVED;
+        if (sent->slots[i] & SLOT_REMOVED) {
+            view->slots.masks[slot] = 0;
+            peer_forget(peer, slot);
+            continue;
+        }
+
+        view->slots.generations[slot] = frame->slots.generations[slot];
+        view->slots.masks[slot] = frame->slots.masks[slot];
+        for (u32 bits = frame->slots.masks[slot]; bits != 0; bits &= bits - 1) {
+            u32 r = __builtin_ctz(bits);
+            u64 offset = (u64)slot * schema->sizes[r];
+            memcpy(view->slots.columns[r] + offset, frame->slots.columns[r] + offset, schema->sizes[r]);
+        }
+        peer_remember(peer, slot);
+    }
+    view->sequence = sequence;
+}
+
+static ReplicationPeer *find_peer(ReplicationServer *server, NetAddress address, b8 create) {
+    for (u32 i = 0; i < darray_length(server->peers); i++) {
+        if (net_address_equal(server->peers[i].address, address)) {
+            return &server->peers[i];
+        }
+    }
+
+    if (!create || (server->config.max_clients != 0 && darray_length(server->peers) >= server->config.max_clients)) {
+        return NULL;
+    }
+
+    ReplicationPeer peer = {
+        .address = address,
+        .focus = vec3_zero(),
+        .known = darray_new(u32),
+        .slots = darray_new(PeerSlot),
+    };
+    for (u32 i = 0; i < REPLICATION_HISTORY; i++) {
+        peer.sent[i].slots = darray_new(u32);
+    }
+    darray_push(server->peers, peer);
+    LOG_INFO("replication: client %08x:%u connected", address.host, address.port);
+    return &server->peers[darray_length(server->peers) - 1];
+}
+
+static void receive_acks(ReplicationServer *server) {
+    // of the snapshots acknowledged in this batch, the newest that was a
+    // delta against the current view moves the view forward
+    u32 peer_count = darray_length(server->peers);
+    darray_clear(server->newest_acks);
+    darray_push_n(server->newest_acks, NO_SEQUENCE, peer_count);
+
+    u8 packet[UDP_MAX_PACKET_SIZE];
+    NetAddress from;
+    u32 size;
+    while ((size = udp_socket_receive(&server->socket, &from, packet, sizeof(packet))) > 0) {
+        if (size != ACK_SIZE || packet[0] != PACKET_ACK) {
+            continue;
+        }
+
+        ReplicationPeer *peer = find_peer(server, from, true);
+        if (peer == NULL) {
+            continue;
+        }
+        u32 index = (u32)(peer - server->peers);
+        if (index >= peer_count) {
+            // connected in this batch
+            peer_count++;
+            darray_push(server->newest_acks, NO_SEQUENCE);
+        }
+
+        // a hello, or a client that lost the baseline of what it was sent
+        u32 sequence = get_u32(packet + 1);
+        if (sequence == NO_SEQUENCE) {
+            peer_reset_view(peer, &server->schema);
+            server->newest_acks[index] = NO_SEQUENCE;
+            continue;
+        }
+
+        const SentSnapshot *sent = &peer->sent[sequence % REPLICATION_HISTORY];
+        if (sent->sequence == sequence && sent->baseline == peer->view.sequence &&
+            sequence > server->newest_acks[index]) {
+            server->newest_acks[index] = sequence;
+        }
+    }
+
+    for (u32 i = 0; i < peer_count; i++) {
+        if (server->newest_acks[i] != NO_SEQUENCE) {
+            peer_apply_ack(server, &server->peers[i], server->newest_acks[i]);
+        }
+    }
+}
+
+static void add_candidate(ReplicationServer *server,
+                          ReplicationPeer *peer,
+                          const ReplicationFrame *frame,
+                          u32 slot,
+                          f32 weight) {
+    PeerSlot *state = &peer->slots[slot];
+    state->relevant = frame->sequence;
+    if (!slot_differs(&server->schema, frame, &peer->view, slot)) {
+        state->priority = 0.0f;
+        return;
+    }
+
+    state->priority += weight;
+    f32 priority = state->sent > peer->view.sequence ? IN_FLIGHT_PRIORITY : state->priority;
+    darray_push(server->candidates, ((Candidate){.slot = slot, .priority = priority}));
+}
+
+/**
+ * Collects the slots the peer should be sent: relevant entities that differ
+ * from its view, weighted by closeness to its focus, and entities in its
+ * view that are no longer relevant or no longer exist.
+ */
+static void gather_candidates(ReplicationServer *server, ReplicationPeer *peer, const ReplicationFrame *frame) {
+    darray_clear(server->candidates);
+
+    if (server->config.relevance_radius > 0.0f) {
+        darray_clear(server->hits);
+        server->hits = interest_grid_query(&server->grid, peer->focus, server->config.relevance_radius, server->hits);
+        for (u32 i = 0; i < darray_length(server->hits); i++) {
+            u32 slot = server->hits[i].slot;
+            if (slot < frame->slots.slot_count && frame->slots.masks[slot] != 0) {
+                f32 closeness = 1.0f - server->hits[i].distance / server->config.relevance_radius;
+                add_candidate(server, peer, frame, slot, 1.0f + closeness);
+            }
+        }
+    }
+    for (u32 i = 0; i < darray_length(server->everywhere); i++) {
+        add_candidate(server, peer, frame, server->everywhere[i], 1.0f);
+    }
+
+    for (u32 i = 0; i < darray_length(peer->known); i++) {
+        u32 slot = peer->known[i];
+        PeerSlot *state = &peer->slots[slot];
+        if (state->relevant != frame->sequence) {
+            state->priority += REMOVAL_PRIORITY;
+            f32 priority = state->sent > peer->view.sequence ? IN_FLIGHT_PRIORITY : state->priority;
+            darray_push(server->candidates, ((Candidate){.slot = slot | SLOT_REMOVED, .priority = priority}));
+        }
+    }
+}
+
+static int compare_priority(const void *a, const void *b) {
+    const Candidate *x = a;
+    const Candidate *y = b;
+    if (x->priority != y->priority) {
+        return x->priority > y->priority ? -1 : 1;
+    }
+    return x->slot < y->slot ? -1 : x->slot > y->slot;
+}
+
+static int compare_slot(const void *a, const void *b) {
+    u32 x = *(const u32 *)a & ~SLOT_REMOVED;
+    u32 y = *(const u32 *)b & ~SLOT_REMOVED;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Takes the candidates with the highest priority that fit the budget, and
+ * every in-flight one even past it, counting packets the way
+ * encode_snapshot fills them. Entries are measured
+ * with their slot as the gap, which bounds the gap they get.
+ * @return how many candidates, moved to the front, are sent
+ */
+static u32 select_within_budget(ReplicationServer *server, const ReplicationPeer *peer, const ReplicationFrame *frame) {
+    u32 count = darray_length(server->candidates);
+    if (server->config.bytes_per_update == 0) {
+        return count;
+    }
+
+    qsort(server->candidates, count, sizeof(Candidate), compare_priority);
+
+    u8 scratch[UDP_MAX_PACKET_SIZE];
+    u32 bytes = 0;
+    u32 packet_bits = 0;
+    u32 selected = 0;
+    for (; selected < count; selected++) {
+        u32 entry = server->candidates[selected].slot;
+        BitWriter writer = bit_writer_new(scratch, sizeof(scratch));
+        write_entry(&writer, &server->schema, frame, &peer->view, entry, entry & ~SLOT_REMOVED);
+        u32 bits = bit_writer_bits(&writer);
+
+        if (packet_bits + server->schema.max_entry_bits + 1 > PAYLOAD_BITS) {
+            bytes += SNAPSHOT_HEADER_SIZE + (packet_bits + 8) / 8;
+            packet_bits = 0;
+        }
+        // always send one, so a small budget still makes progress
+        u32 total = bytes + SNAPSHOT_HEADER_SIZE + (packet_bits + bits + 8) / 8;
+        if (selected != 0 && total > server->config.bytes_per_update &&
+            server->candidates[selected].priority != IN_FLIGHT_PRIORITY) {
+            break;
+        }
+        packet_bits += bits;
+    }
+    return selected;
+}
+
+static void send_snapshot(ReplicationServer *server, ReplicationPeer *peer, const ReplicationFrame *frame) {
+    gather_candidates(server, peer, frame);
+    u32 count = select_within_budget(server, peer, frame);
+    server->stats.deferred_entities += darray_length(server->candidates) - count;
+
+    SentSnapshot *sent = &peer->sent[frame->sequence % REPLICATION_HISTORY];
+    sent->sequence = frame->sequence;
+    sent->baseline = peer->view.sequence;
+    darray_clear(sent->slots);
+    for (u32 i = 0; i < count; i++) {
+        u32 entry = server->candidates[i].slot;
+        peer->slots[entry & ~SLOT_REMOVED].priority = 0.0f;
+        peer->slots[entry & ~SLOT_REMOVED].sent = frame->sequence;
+        darray_push(sent->slots, entry);
+    }
+    qsort(sent->slots, count, sizeof(u32), compare_slot);
+
+    encode_snapshot(server, peer, frame, sent->slots, count);
+    u32 offset = 0;
+    for (u32 i = 0; i < darray_length(server->packet_sizes); i++) {
+        u32 size = server->packet_sizes[i];
+        udp_socket_send(&server->socket, peer->address, server->packets + offset, size);
+        offset += size;
+    }
+    server->stats.bytes_sent += offset;
+    server->stats.update_bytes += offset;
+    server->stats.packets_sent += darray_length(server->packet_sizes);
+    server->stats.snapshots_sent++;
+}
+
+// Finds the slots relevant to every client
+static void update_relevance(ReplicationServer *server, const ReplicationFrame *frame) {
+    b8 spatial = server->config.relevance_radius > 0.0f;
+    if (spatial) {
+        interest_grid_update(&server->grid, server->world);
+    }
+
+    darray_clear(server->everywhere);
+    for (u32 slot = 0; slot < frame->slots.slot_count; slot++) {
+        if (frame->slots.masks[slot] != 0 && (!spatial || !interest_grid_contains(&server->grid, slot))) {
+            darray_push(server->everywhere, slot);
+        }
+    }
+}
+
+ReplicationServer *replication_server_new(World *world, ReplicationServerConfig config) {
+    ReplicationServer *server = malloc(sizeof(ReplicationServer));
+    *server = (ReplicationServer){
+        .world = world,
+        .config = config,
+        .schema = schema_new(world),
+        .sequence = NO_SEQUENCE,
+        .peers = darray_new(ReplicationPeer),
+    };
+
+    if (!udp_socket_open(&server->socket, config.port)) {
+        darray_destroy(server->peers);
+        free(server);
+        return NULL;
+    }
+
+    if (config.relevance_radius > 0.0f) {
+        server->grid = interest_grid_new(config.cell_size > 0.0f ? config.cell_size : config.relevance_radius);
+    }
+    server->everywhere = darray_new(u32);
+    server->hits = darray_new(InterestHit);
+    server->candidates = darray_new(Candidate);
+    server->packets = darray_new(u8);
+    server->packet_sizes = darray_new(u32);
+    server->newest_acks = darray_new_with(u32, memory_tag_allocator(MEMORY_TAG_NET));
+    return server;
+}
+
+void replication_server_destroy(ReplicationServer *server) {
+    udp_socket_close(&server->socket);
+    for (u32 i = 0; i < REPLICATION_HISTORY; i++) {
+        frame_destroy(&server->history[i], &server->schema);
+    }
+    for (u32 i = 0; i < darray_length(server->peers); i++) {
+        ReplicationPeer *peer = &server->peers[i];
+        frame_destroy(&peer->view, &server->schema);
+        darray_destroy(peer->known);
+        darray_destroy(peer->slots);
+        for (u32 s = 0; s < REPLICATION_HISTORY; s++) {
+            darray_destroy(peer->sent[s].slots);
+        }
+    }
+    darray_destroy(server->peers);
+
+    if (server->config.relevance_radius > 0.0f) {
+        interest_grid_destroy(&server->grid);
+    }
+    darray_destroy(server->everywhere);
+    darray_destroy(server->hits);
+    darray_destroy(server->candidates);
+    darray_destroy(server->packets);
+    darray_destroy(server->packet_sizes);
+    darray_destroy(server->newest_acks);
+    free(server);
+}
+
+u16 replication_server_port(const ReplicationServer *server) { return server->socket.port; }
+
+u32 replication_server_client_count(const ReplicationServer *server) { return darray_length(server->peers); }
+
+u32 replication_server_sequence(const ReplicationServer *server) { return server->sequence; }
+
+b8 replication_server_set_focus(ReplicationServer *server, NetAddress client, vec3s position) {
+    ReplicationPeer *peer = find_peer(server, client, false);
+    if (peer == NULL) {
+        return false;
+    }
+    peer->focus = position;
+    return true;
+}
+
+void replication_server_update(ReplicationServer *server) {
+    receive_acks(server);
+
+    server->sequence++;
+    ReplicationFrame *frame = &server->history[server->sequence % REPLICATION_HISTORY];
+    frame_capture(frame, &server->schema, server->world);
+    frame->sequence = server->sequence;
+    update_relevance(server, frame);
+
+    server->stats.update_bytes = 0;
+    server->stats.deferred_entities = 0;
+    for (u32 i = 0; i < darray_length(server->peers); i++) {
+        ReplicationPeer *peer = &server->peers[i];
+        peer_grow(peer, &server->schema, frame->slots.slot_count);
+        send_snapshot(server, peer, frame);
+    }
+}
+
+ReplicationServerStats replication_server_stats(const ReplicationServer *server) { return server->stats; }
+
+// ---------------------------------------------------------------------------
+// Client
+// ---------------------------------------------------------------------------
+
+static void send_ack(const ReplicationClient *client, u32 sequence) {
+    u8 packet[ACK_SIZE];
+    packet[0] = PACKET_ACK;
+    put_u32(packet + 1, sequence);
+    udp_socket_send(&client->socket, client->server, packet, sizeof(packet));
+}
+
+static void read_component_delta(BitReader *reader, u8 *value, u32 size) {
+    u32 masks[(UDP_MAX_PACKET_SIZE + 31) / 32];
+    for (u32 i = 0; i < size; i += 32) {
+        masks[i / 32] = bit_read(reader, MIN(32, size - i));
+    }
+    for (u32 i = 0; i < size; i++) {
+        if (masks[i / 32] & (1u << (i % 32))) {
+            value[i] = (u8)bit_read(reader, 8);
+        }
+    }
+}
+
+/**
+ * Decodes one fragment's entries over the pending frame. Each slot appears
+ * in at most one fragment, so until its entry is decoded the pending frame
+ * still holds the baseline's values the entry is relative to.
+ * @return false for malformed packets
+ */
+static b8 decode_fragment(ReplicationClient *client, const u8 *payload, u32 size) {
+    const ReplicationSchema *schema = &client->schema;
+    ReplicationFrame *frame = &client->pending;
+    BitReader reader = bit_reader_new(payload, size);
+
+    u32 slot = ENTITY_INDEX_INVALID;
+    while (bit_read(&reader, 1)) {
+        u32 gap = bit_read_varint(&reader);
+        slot = slot == ENTITY_INDEX_INVALID ? gap : slot + gap + 1;
+        if (reader.overflow || slot >= frame->slots.slot_count) {
+            return false;
+        }
+
+        u32 baseline_mask = frame->slots.masks[slot];
+        u32 baseline_generation = frame->slots.generations[slot];
+        u32 mask = baseline_mask;
+        u32 generation = baseline_generation;
+        if (bit_read(&reader, 1)) {
+            generation = bit_read_varint(&reader);
+            mask = bit_read(&reader, schema->count);
+        }
+        u32 shared = generation == baseline_generation ? mask & baseline_mask : 0;
+
+        for (u32 bits = mask; bits != 0; bits &= bits - 1) {
+            u32 r = __builtin_ctz(bits);
+            u32 component_size = schema->sizes[r];
+            u8 *value = frame->slots.columns[r] + (u64)slot * component_size;
+            if (!(shared & (1u << r))) {
+                bit_read_bytes(&reader, value, component_size);
+            } else if (bit_read(&reader, 1)) {
+                read_component_delta(&reader, value, component_size);
+            }
+        }
+        frame->slots.generations[slot] = generation;
+        frame->slots.masks[slot] = mask;
+    }
+    return !reader.overflow;
+}
+
+static void destroy_local(ReplicationClient *client, u32 slot) {
+    if (client->entities[slot] != ENTITY_INVALID) {
+        world_destroy_entity(client->world, client->entities[slot]);
+        client->entities[slot] = ENTITY_INVALID;
+    }
+}
+
+/**
+ * Brings the world from the shown frame to `frame`: entities whose slot
+ * died or was reused are destroyed, new ones created, and only components
+ * that differ from the shown frame attached or detached. Interpolated
+ * components are always written, the world holds blended values between
+ * snapshots.
+ */
+static void apply_frame(ReplicationClient *client, const ReplicationFrame *frame) {
+    const ReplicationSchema *schema = &client->schema;
+    const ReplicationFrame *shown = find_frame(client->history, CLIENT_HISTORY, client->applied);
+    u32 shown_slots = shown != NULL ? shown->slots.slot_count : 0;
+
+    if (darray_length(client->entities) < frame->slots.slot_count) {
+        darray_push_n(client->entities, ENTITY_INVALID, frame->slots.slot_count - darray_length(client->entities));
+    }
+
+    for (u32 slot = 0; slot < frame->slots.slot_count; slot++) {
+        u32 mask = frame->slots.masks[slot];
+        u32 shown_mask = slot < shown_slots ? shown->slots.masks[slot] : 0;
+        if (mask == 0) {
+            destroy_local(client, slot);
+            continue;
+        }
+
+        if (shown_mask != 0 && shown->slots.generations[slot] != frame->slots.generations[slot]) {
+            destroy_local(client, slot);
+            shown_mask = 0;
+        }
+        if (client->entities[slot] == ENTITY_INVALID) {
+            client->entities[slot] = world_create_entity(client->world);
+            shown_mask = 0;
+        }
+
+        entity_id entity = client->entities[slot];
+        for (u32 r = 0; r < schema->count; r++) {
+            u32 bit = 1u << r;
+            u64 offset = (u64)slot * schema->sizes[r];
+            if (mask & bit) {
+                const u8 *value = frame->slots.columns[r] + offset;
+                if (!(shown_mask & bit) || (schema->interpolated & bit) ||
+                    memcmp(value, shown->slots.columns[r] + offset, schema->sizes[r]) != 0) {
+                    world_attach_component_by_id(client->world, entity, schema->ids[r], value);
+                }
+            } else if (shown_mask & bit) {
+                world_detach_component_by_id(client->world, entity, schema->ids[r]);
+            }
+        }
+    }
+}
+
+static void complete_pending(ReplicationClient *client) {
+    apply_frame(client, &client->pending);
+    if (client->world->interpolation != NULL) {
+        interpolation_push(client->world, client->pending.sequence);
+    }
+
+    // the completed frame takes the history slot, the slot's old buffers
+    // are reused by the next pending snapshot
+    ReplicationFrame *slot = &client->history[client->pending.sequence % CLIENT_HISTORY];
+    ReplicationFrame completed = client->pending;
+    client->pending = *slot;
+    client->pending.sequence = NO_SEQUENCE;
+    *slot = completed;
+
+    client->applied = completed.sequence;
+    send_ack(client, completed.sequence);
+}
+
+static void receive_snapshot(ReplicationClient *client, const u8 *packet, u32 size) {
+    if (size < SNAPSHOT_HEADER_SIZE || packet[0] != PACKET_SNAPSHOT) {
+        return;
+    }
+
+    u32 sequence = get_u32(packet + 1);
+    u32 baseline_sequence = get_u32(packet + 5);
+    u16 fragment = get_u16(packet + 9);
+    u16 fragment_count = get_u16(packet + 11);
+    u32 slot_count = get_u32(packet + 13);
+    if (sequence <= client->applied || sequence < client->pending.sequence || fragment >= fragment_count) {
+        return;
+    }
+
+    if (sequence != client->pending.sequence) {
+        const ReplicationFrame *baseline = find_frame(client->history, CLIENT_HISTORY, baseline_sequence);
+        if (baseline == NULL && baseline_sequence != NO_SEQUENCE) {
+            // the server starts over with a full snapshot
+            send_ack(client, NO_SEQUENCE);
+            return;
+        }
+
+        if (baseline != NULL) {
+            frame_copy(&client->pending, baseline, &client->schema);
+        } else {
+            frame_resize(&client->pending, &client->schema, 0);
+        }
+        frame_resize(&client->pending, &client->schema, slot_count);
+        client->pending.sequence = sequence;
+
+        darray_clear(client->pending_received);
+        for (u32 i = 0; i < fragment_count; i++) {
+            darray_push(client->pending_received, false);
+        }
+        client->pending_missing = fragment_count;
+    }
+
+    if (fragment_count != darray_length(client->pending_received) || client->pending_received[fragment]) {
+        return;
+    }
+
+    if (!decode_fragment(client, packet + SNAPSHOT_HEADER_SIZE, size - SNAPSHOT_HEADER_SIZE)) {
+        LOG_WARN("replication: dropping malformed snapshot %u", sequence);
+        client->pending.sequence = NO_SEQUENCE;
+        return;
+    }
+
+    client->pending_received[fragment] = true;
+    if (--client->pending_missing == 0) {
+        complete_pending(client);
+    }
+}
+
+ReplicationClient *replication_client_new(World *world, NetAddress server_address) {
+    ReplicationClient *client = malloc(sizeof(ReplicationClient));
+    *client = (ReplicationClient){
+        .world = world,
+        .server = server_address,
+        .schema = schema_new(world),
+        .applied = NO_SEQUENCE,
+        .pending_received = darray_new(b8),
+        .entities = darray_new(entity_id),
+    };
+
+    if (!udp_socket_open(&client->socket, 0)) {
+        darray_destroy(client->pending_received);
+        darray_destroy(client->entities);
+        free(client);
+        return NULL;
+    }
+
+    world->is_replica = true;
+    return client;
+}
+
+void replication_client_destroy(ReplicationClient *client) {
+    udp_socket_close(&client->socket);
+    for (u32 i = 0; i < CLIENT_HISTORY; i++) {
+        frame_destroy(&client->history[i], &client->schema);
+    }
+    frame_destroy(&client->pending, &client->schema);
+    darray_destroy(client->pending_received);
+    darray_destroy(client->entities);
+    free(client);
+}
+
+void replication_client_update(ReplicationClient *client) {
+    // the server learns about clients from their packets
+    if (client->applied == NO_SEQUENCE) {
+        send_ack(client, NO_SEQUENCE);
+    }
+
+    u8 packet[UDP_MAX_PACKET_SIZE];
+    NetAddress from;
+    u32 size;
+    while ((size = udp_socket_receive(&client->socket, &from, packet, sizeof(packet))) > 0) {
+        if (net_address_equal(from, client->server)) {
+            receive_snapshot(client, packet, size);
+        }
+    }
+}
+
+u16 replication_client_port(const ReplicationClient *client) { return client->socket.port; }
+
+u32 replication_client_sequence(const ReplicationClient *client) { return client->applied; }
+
+entity_id replication_client_local_entity(const ReplicationClient *client, entity_id server_entity) {
+    const ReplicationFrame *shown = find_frame(client->history, CLIENT_HISTORY, client->applied);
+    entity_index slot = entity_get_index(server_entity);
+    if (shown == NULL || slot >= shown->slots.slot_count || shown->slots.masks[slot] == 0 ||
+        shown->slots.generations[slot] != entity_get_generation(server_entity)) {
+        return ENTITY_INVALID;
+    }
+    return client->entities[slot];
+}
@@ -0,0 +1,131 @@
+#ifndef NET_REPLICATION_H
+#define NET_REPLICATION_H
+
+#include "core/defines.h"
+#include "ecs/entity.h"
+#include "ecs/world.h"
+#include "net/udp_socket.h"
+
+// Replicated components are identified by their position among the
+// COMPONENT_FLAG_REPLICATED components in ComponentId order, so server and
+// client must register the same replicated components in the same order
+#define REPLICATION_MAX_COMPONENTS 32
+// Snapshots the server keeps, acknowledgements of older ones are ignored
+#define REPLICATION_HISTORY 32
+
+typedef struct {
+    // 0 picks a free port
+    u16 port;
+    // 0 accepts any number of clients
+    u32 max_clients;
+    // upper bound on what one update sends to one client, the entities with
+    // the highest priority go first and the others wait for a later update;
+    // 0 sends everything at once
+    u32 bytes_per_update;
+    // entities whose GlobalTransform is further than this from a client's
+    // focus are not replicated to it, entities without one always are;
+    // 0 replicates everything to everyone
+    f32 relevance_radius;
+    // of the interest grid, 0 uses the relevance radius
+    f32 cell_size;
+} ReplicationServerConfig;
+
+typedef struct {
+    u64 bytes_sent;
+    u64 packets_sent;
+    u64 snapshots_sent;
+    // bytes sent to all clients by the last update
+    u32 update_bytes;
+    // entities the last update had to send but left out to stay within
+    // bytes_per_update, summed over clients
+    u32 deferred_entities;
+} ReplicationServerStats;
+
+/**
+ * Sends the components flagged COMPONENT_FLAG_REPLICATED to every client
+ * that contacted it. Each update captures the replicated state into a
+ * snapshot and encodes it for every client as a bit-packed delta against
+ * what the client acknowledged holding: only entities that changed are
+ * written, and of their components only the bytes that changed.
+ *
+ * With a relevance radius, a client only holds the entities near its focus.
+ * Entities are looked up in a uniform grid that is updated from the
+ * GlobalTransforms that changed, and ones that move out of range are
+ * removed from the client. Entities that differ from what a client holds
+ * gain priority every update they are not sent, nearer ones faster, and
+ * under a byte budget the highest priorities are sent first. What went out
+ * in a snapshot the client has not acknowledged yet is sent again, even
+ * past the budget, until one carrying it is acknowledged.
+ */
+typedef struct ReplicationServer ReplicationServer;
+
+/**
+ * Receives snapshots into a replica world. Entities are created, changed
+ * and destroyed to match the server's, under local handles. When the world
+ * has interpolation enabled, every applied snapshot is pushed to it at its
+ * sequence number.
+ */
+typedef struct ReplicationClient ReplicationClient;
+
+/**
+ * @return NULL when the socket could not be opened
+ */
+ReplicationServer *replication_server_new(World *world, ReplicationServerConfig config);
+
+void replication_server_destroy(ReplicationServer *server);
+
+u16 replication_server_port(const ReplicationServer *server);
+
+u32 replication_server_client_count(const ReplicationServer *server);
+
+/**
+ * Sets the position relevance is measured from for the client at `client`,
+ * the origin until set.
+ * @return false when no such client connected
+ */
+b8 replication_server_set_focus(ReplicationServer *server, NetAddress client, vec3s position);
+
+/**
+ * @return the sequence number of the last captured snapshot, a client whose
+ * replication_client_sequence reached it shows the world as of that update
+ */
+u32 replication_server_sequence(const ReplicationServer *server);
+
+/**
+ * Handles acknowledgements and new clients, captures a snapshot of the world
+ * and sends every client its delta. Call once per tick after world_run.
+ */
+void replication_server_update(ReplicationServer *server);
+
+ReplicationServerStats replication_server_stats(const ReplicationServer *server);
+
+/**
+ * Marks `world` as a replica, so it skips SYSTEM_FLAG_NETWORKED systems.
+ * @return NULL when the socket could not be opened
+ */
+ReplicationClient *replication_client_new(World *world, NetAddress server);
+
+void replication_client_destroy(ReplicationClient *client);
+
+/**
+ * Receives whatever arrived, applies the newest complete snapshot to the
+ * world and acknowledges it.
+ */
+void replication_client_update(ReplicationClient *client);
+
+// The local port the client sends from, its address on the server is the
+// host's address with this port
+u16 replication_client_port(const ReplicationClient *client);
+
+/**
+ * @return the sequence number of the snapshot the world shows, 0 before the
+ * first one arrived
+ */
+u32 replication_client_sequence(const ReplicationClient *client);
+
+/**
+ * @return the client world's handle of a server entity, or ENTITY_INVALID
+ */
+entity_id replication_client_local_entity(const ReplicationClient *client, entity_id server_entity);
+
+#endif // NET_REPLICATION_H
@@ -0,0 +1,83 @@
+#include "udp_socket.h"
+#include "core/logging.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define UDP_SOCKET_BUFFER_SIZE (1024 * 1024)
+
+b8 udp_socket_open(UdpSocket *udp, u16 port) {
+    i32 fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        LOG_ERROR("udp_socket_open: socket failed: %s", strerror(errno));
+        return false;
+    }
+
+    // a burst of snapshot fragments overflows the default buffers, the
+    // kernel clamps the size so a failure here is not an error
+    i32 buffer_size = UDP_SOCKET_BUFFER_SIZE;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        LOG_ERROR("udp_socket_open: bind to port %u failed: %s", port, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, (struct sockaddr *)&address, &length) < 0 ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+        LOG_ERROR("udp_socket_open: %s", strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    *udp = (UdpSocket){.fd = fd, .port = ntohs(address.sin_port)};
+    return true;
+}
+
+void udp_socket_close(UdpSocket *udp) {
+    if (udp->fd >= 0) {
+        close(udp->fd);
+    }
+    udp->fd = -1;
+}
+
+b8 udp_socket_send(const UdpSocket *udp, NetAddress to, const void *data, u32 size) {
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(to.port),
+        .sin_addr.s_addr = htonl(to.host),
+    };
+    ssize_t sent = sendto(udp->fd, data, size, 0, (struct sockaddr *)&address, sizeof(address));
+    if (sent != (ssize_t)size) {
+        LOG_WARN("udp_socket_send: %s", sent < 0 ? strerror(errno) : "short write");
+        return false;
+    }
+    return true;
+}
+
+u32 udp_socket_receive(const UdpSocket *udp, NetAddress *from, void *buffer, u32 capacity) {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    ssize_t received = recvfrom(udp->fd, buffer, capacity, 0, (struct sockaddr *)&address, &length);
+    if (received <= 0) {
+        return 0;
+    }
+
+    if (from != NULL) {
+        *from = (NetAddress){.host = ntohl(address.sin_addr.s_addr), .port = ntohs(address.sin_port)};
+    }
+    return (u32)received;
+}
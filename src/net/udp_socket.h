@@ -0,0 +1,40 @@
+#ifndef NET_UDP_SOCKET_H
+#define NET_UDP_SOCKET_H
+
+#include "core/defines.h"
+
+// Keeps datagrams below the usual path MTU, so they are never fragmented
+#define UDP_MAX_PACKET_SIZE 1200
+
+// IPv4 address and port in host byte order
+typedef struct {
+    u32 host;
+    u16 port;
+} NetAddress;
+
+typedef struct {
+    i32 fd;
+    u16 port;
+} UdpSocket;
+
+static inline NetAddress net_address_loopback(u16 port) { return (NetAddress){.host = 0x7F000001, .port = port}; }
+
+static inline b8 net_address_equal(NetAddress a, NetAddress b) { return a.host == b.host && a.port == b.port; }
+
+/**
+ * Opens a non-blocking socket bound to `port` on every interface, 0 picks a
+ * free port.
+ * @return false when the socket could not be opened or bound
+ */
+b8 udp_socket_open(UdpSocket *socket, u16 port);
+
+void udp_socket_close(UdpSocket *socket);
+
+b8 udp_socket_send(const UdpSocket *socket, NetAddress to, const void *data, u32 size);
+
+/**
+ * @return the size of the received datagram, or 0 when none is waiting
+ */
+u32 udp_socket_receive(const UdpSocket *socket, NetAddress *from, void *buffer, u32 capacity);
+
+#endif // NET_UDP_SOCKET_H
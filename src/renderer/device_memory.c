@@ -1,5 +1,6 @@
 #include "device_memory.h"
 
+#include "core/allocator/memory_tracker.h"
 #include "core/logging.h"
 #include "renderer/device.h"
 #include "renderer/vulkan.h"
@@ -17,6 +18,7 @@ DeviceMemory device_memory_new(const Device *device,
                                VkMemoryPropertyFlags property_flags) {
     DeviceMemory self = {
         .device = device,
+        .size = size,
     };
 
     VkMemoryAllocateFlagsInfo flags_info = {
@@ -36,6 +38,7 @@ DeviceMemory device_memory_new(const Device *device,
     vulkan_check(
         vkAllocateMemory(device->handle, &alloc_info, NULL, &self.handle),
         "allocate memory");
+    memory_tag_allocate(MEMORY_TAG_RENDERER, size);
 
     return self;
 }
@@ -44,6 +47,7 @@ DeviceMemory device_memory_move(DeviceMemory *other) {
     DeviceMemory self = {
         .device = other->device,
         .handle = other->handle,
+        .size = other->size,
     };
 
     other->handle = NULL;
@@ -54,6 +58,7 @@ DeviceMemory device_memory_move(DeviceMemory *other) {
 void device_memory_destroy(DeviceMemory *self) {
     if (self->handle != NULL) {
         vkFreeMemory(self->device->handle, self->handle, NULL);
+        memory_tag_free(MEMORY_TAG_RENDERER, self->size);
         self->handle = NULL;
     }
 }
@@ -7,6 +7,7 @@
 typedef struct {
     const Device *device;
     VkDeviceMemory handle;
+    u64 size;
 } DeviceMemory;
 
 DeviceMemory device_memory_new(const Device *device,
@@ -0,0 +1,203 @@
+#include "containers/darray.h"
+#include "core/allocator/allocator.h"
+#include "core/allocator/arena.h"
+#include "core/allocator/frame_allocator.h"
+#include "core/allocator/pool.h"
+#include "core/defines.h"
+#include "ecs/world.h"
+
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <cmocka.h>
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+static void test_arena_alignment(void **state) {
+    (void)state;
+    Arena arena = arena_new(1024);
+    for (u64 alignment = 1; alignment <= 256; alignment *= 2) {
+        u8 *byte = arena_allocate(&arena, 1, 1);
+        void *aligned = arena_allocate(&arena, 24, alignment);
+        assert_int_equal((u64)aligned % alignment, 0);
+        assert_true((u8 *)aligned > byte);
+    }
+    arena_destroy(&arena);
+}
+
+static void test_arena_mark_and_reset(void **state) {
+    (void)state;
+    Arena arena = arena_new(256);
+    u64 *first = arena_push(&arena, u64);
+    *first = 42;
+
+    ArenaMark mark = arena_mark(&arena);
+    u64 used = arena_used(&arena);
+    // spills into several blocks, one of them larger than the block size
+    for (u32 i = 0; i < 64; i++) {
+        arena_allocate(&arena, 100, 8);
+    }
+    arena_allocate(&arena, 4096, 16);
+    assert_true(arena_capacity(&arena) > 256);
+
+    arena_reset_to(&arena, mark);
+    assert_int_equal(arena_used(&arena), used);
+    assert_int_equal(arena_capacity(&arena), 256);
+    assert_int_equal(*first, 42);
+    // the next allocation continues where the mark was taken
+    assert_ptr_equal(arena_push(&arena, u64), first + 1);
+
+    for (u32 i = 0; i < 64; i++) {
+        arena_allocate(&arena, 100, 8);
+    }
+    u64 capacity = arena_capacity(&arena);
+    arena_reset(&arena);
+    assert_int_equal(arena_used(&arena), 0);
+    // the blocks were merged into one, so the same allocations fit again
+    // without taking another block
+    assert_int_equal(arena_capacity(&arena), capacity);
+    for (u32 i = 0; i < 64; i++) {
+        arena_allocate(&arena, 100, 8);
+    }
+    assert_int_equal(arena_capacity(&arena), capacity);
+
+    arena_destroy(&arena);
+}
+
+static void test_arena_last_allocation_in_place(void **state) {
+    (void)state;
+    Arena arena = arena_new(1024);
+    Allocator *allocator = arena_allocator(&arena);
+
+    u8 *memory = allocator_allocate(allocator, 16, 8);
+    memory[15] = 7;
+    u8 *grown = allocator_reallocate(allocator, memory, 16, 64, 8);
+    assert_ptr_equal(grown, memory);
+    assert_int_equal(grown[15], 7);
+    assert_int_equal(arena_used(&arena), 64);
+
+    allocator_free(allocator, grown, 64);
+    assert_int_equal(arena_used(&arena), 0);
+
+    // anything but the last allocation is copied
+    u8 *a = allocator_allocate(allocator, 16, 8);
+    a[0] = 1;
+    allocator_allocate(allocator, 16, 8);
+    u8 *moved = allocator_reallocate(allocator, a, 16, 32, 8);
+    assert_true(moved != a);
+    assert_int_equal(moved[0], 1);
+
+    arena_destroy(&arena);
+}
+
+static void test_pool(void **state) {
+    (void)state;
+    Pool pool = pool_new(sizeof(Position), 4);
+
+    void *blocks[10];
+    for (u32 i = 0; i < 10; i++) {
+        blocks[i] = pool_allocate(&pool);
+        assert_int_equal((u64)blocks[i] % sizeof(void *), 0);
+        for (u32 j = 0; j < i; j++) {
+            assert_true(blocks[i] != blocks[j]);
+        }
+    }
+    assert_int_equal(pool_block_count(&pool), 10);
+
+    // freed blocks come back first, most recently freed first
+    pool_free(&pool, blocks[3]);
+    pool_free(&pool, blocks[7]);
+    assert_int_equal(pool_block_count(&pool), 8);
+    assert_ptr_equal(pool_allocate(&pool), blocks[7]);
+    assert_ptr_equal(allocator_allocate(pool_allocator(&pool), sizeof(Position), 4), blocks[3]);
+
+    pool_destroy(&pool);
+}
+
+static void test_frame_allocator(void **state) {
+    (void)state;
+    FrameAllocator frames = frame_allocator_new(1024);
+
+    frame_allocator_begin(&frames);
+    u32 *previous = frame_allocator_allocate(&frames, sizeof(u32), sizeof(u32));
+    *previous = 1;
+
+    // still readable while the next frame is recorded
+    frame_allocator_begin(&frames);
+    u32 *current = frame_allocator_allocate(&frames, sizeof(u32), sizeof(u32));
+    *current = 2;
+    assert_int_equal(*previous, 1);
+    assert_true(current != previous);
+
+    // the frame after that takes the first frame's memory again
+    frame_allocator_begin(&frames);
+    assert_ptr_equal(allocator_allocate(frame_allocator_current(&frames), sizeof(u32), sizeof(u32)), previous);
+    assert_int_equal(*current, 2);
+
+    frame_allocator_destroy(&frames);
+}
+
+static void test_darray_in_arena(void **state) {
+    (void)state;
+    Arena arena = arena_new(4096);
+    darray(u32) numbers = darray_new_with(u32, arena_allocator(&arena));
+    for (u32 i = 0; i < 500; i++) {
+        darray_push(numbers, i);
+    }
+    assert_ptr_equal(darray_allocator(numbers), arena_allocator(&arena));
+
+    darray(u32) copy = darray_duplicate(u32, numbers);
+    assert_ptr_equal(darray_allocator(copy), arena_allocator(&arena));
+    for (u32 i = 0; i < 500; i++) {
+        assert_int_equal(copy[i], i);
+    }
+
+    // nothing is freed one by one, the reset drops both arrays
+    arena_reset(&arena);
+    assert_int_equal(arena_used(&arena), 0);
+    arena_destroy(&arena);
+}
+
+static void test_world_in_arena(void **state) {
+    (void)state;
+    const WorldStorage storages[] = {WORLD_STORAGE_COMPONENT_STORE, WORLD_STORAGE_ARCHETYPE};
+    for (u32 s = 0; s < 2; s++) {
+        Arena arena = arena_new(64 * 1024);
+        World world = world_new_with_allocator(storages[s], arena_allocator(&arena));
+        world_register_component(&world, Position);
+
+        entity_id entities[1000];
+        for (u32 i = 0; i < 1000; i++) {
+            entities[i] = world_create_entity(&world);
+            world_attach_component(&world, entities[i], Position, ((Position){(f32)i, 0.0f, 0.0f}));
+        }
+        for (u32 i = 0; i < 1000; i += 2) {
+            world_destroy_entity(&world, entities[i]);
+        }
+        for (u32 i = 1; i < 1000; i += 2) {
+            const Position *position = world_get_component(&world, entities[i], Position);
+            assert_float_equal(position->x, (f32)i, F32_EPSILON);
+        }
+        assert_true(arena_used(&arena) > 1000 * sizeof(Position));
+
+        world_destroy(&world);
+        arena_destroy(&arena);
+    }
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_arena_alignment),
+        cmocka_unit_test(test_arena_mark_and_reset),
+        cmocka_unit_test(test_arena_last_allocation_in_place),
+        cmocka_unit_test(test_pool),
+        cmocka_unit_test(test_frame_allocator),
+        cmocka_unit_test(test_darray_in_arena),
+        cmocka_unit_test(test_world_in_arena),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
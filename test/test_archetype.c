@@ -0,0 +1,116 @@
+#include "ecs/entity.h"
+#include "ecs/world.h"
+
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <cmocka.h>
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+typedef struct {
+    f32 x, y, z;
+} Velocity;
+
+typedef struct {
+    int health;
+} Health;
+
+#define ENTITY_COUNT 5000
+
+static void test_archetype_attach_and_retrieve(void **state) {
+    (void)state;
+    World world = world_new_with_storage(WORLD_STORAGE_ARCHETYPE);
+    world_register_component(&world, Health);
+
+    entity_id e = world_create_entity(&world);
+    Health h = {100};
+    world_attach_component(&world, e, Health, h);
+
+    Health *got = world_get_component(&world, e, Health);
+    assert_non_null(got);
+    assert_int_equal(got->health, 100);
+    world_destroy(&world);
+}
+
+static void test_archetype_move_keeps_components(void **state) {
+    (void)state;
+    World world = world_new_with_storage(WORLD_STORAGE_ARCHETYPE);
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+    world_register_component(&world, Health);
+
+    entity_id e = world_create_entity(&world);
+    world_attach_component(&world, e, Position, ((Position){1, 2, 3}));
+    world_attach_component(&world, e, Velocity, ((Velocity){4, 5, 6}));
+    world_attach_component(&world, e, Health, ((Health){7}));
+    world_detach_component(&world, e, Velocity);
+
+    Position *p = world_get_component(&world, e, Position);
+    Health *h = world_get_component(&world, e, Health);
+    assert_non_null(p);
+    assert_non_null(h);
+    assert_null(world_get_component(&world, e, Velocity));
+    assert_float_equal(p->z, 3, F32_EPSILON);
+    assert_int_equal(h->health, 7);
+
+    world_detach_component(&world, e, Position);
+    world_detach_component(&world, e, Health);
+    assert_null(world_get_component(&world, e, Health));
+
+    world_destroy(&world);
+}
+
+static void test_archetype_many_entities(void **state) {
+    (void)state;
+    World world = world_new_with_storage(WORLD_STORAGE_ARCHETYPE);
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+
+    entity_id entities[ENTITY_COUNT];
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        entities[i] = world_create_entity(&world);
+        world_attach_component(&world, entities[i], Position, ((Position){(f32)i, 0, 0}));
+        if (i % 2 == 0) {
+            world_attach_component(&world, entities[i], Velocity, ((Velocity){0, (f32)i, 0}));
+        }
+    }
+
+    for (u32 i = 0; i < ENTITY_COUNT; i += 3) {
+        world_destroy_entity(&world, entities[i]);
+    }
+
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        Position *p = world_get_component(&world, entities[i], Position);
+        Velocity *v = world_get_component(&world, entities[i], Velocity);
+        if (i % 3 == 0) {
+            assert_null(p);
+            assert_null(v);
+            continue;
+        }
+
+        assert_non_null(p);
+        assert_float_equal(p->x, (f32)i, F32_EPSILON);
+        if (i % 2 == 0) {
+            assert_non_null(v);
+            assert_float_equal(v->y, (f32)i, F32_EPSILON);
+        } else {
+            assert_null(v);
+        }
+    }
+
+    world_destroy(&world);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_archetype_attach_and_retrieve),
+        cmocka_unit_test(test_archetype_move_keeps_components),
+        cmocka_unit_test(test_archetype_many_entities),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
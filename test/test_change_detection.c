@@ -0,0 +1,384 @@
+#include "core/defines.h"
+#include "ecs/entity.h"
+#include "ecs/query.h"
+#include "ecs/system.h"
+#include "ecs/world.h"
+
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <cmocka.h>
+
+typedef struct {
+    int pos;
+} Position;
+
+typedef struct {
+    int vel;
+} Velocity;
+
+#define BATCH_COUNT 10000
+#define MARK_STRIDE 100
+
+static u32 changed_count;
+static u32 added_count;
+static u32 watched_count;
+static u32 removed_count;
+static entity_id removed_entities[4];
+
+static void count_changed(void **components) {
+    assert_non_null(components[0]);
+    changed_count++;
+}
+
+static void count_added(void **components) {
+    assert_non_null(components[0]);
+    added_count++;
+}
+
+static void count_watched(void **components) {
+    (void)components;
+    watched_count++;
+}
+
+static void move_system(void **components) {
+    Position *p = components[0];
+    Velocity *v = components[1];
+    p->pos += v->vel;
+}
+
+static void record_removed(SystemContext *context, void **components) {
+    assert_null(components[0]);
+    assert_true(removed_count < 4);
+    removed_entities[removed_count++] = context->entity;
+}
+
+static void reset_counts(void) {
+    changed_count = 0;
+    added_count = 0;
+    watched_count = 0;
+    removed_count = 0;
+}
+
+static void check_changed_and_added(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+
+    entity_id a = world_create_entity(&world);
+    entity_id b = world_create_entity(&world);
+    world_attach_component(&world, a, Position, ((Position){1}));
+    world_attach_component(&world, b, Position, ((Position){2}));
+
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Changed(Position)),
+                         .fn = count_changed,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Added(Position)),
+                         .fn = count_added,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+
+    // everything attached before the first run is new
+    reset_counts();
+    world_run(&world);
+    assert_int_equal(changed_count, 2);
+    assert_int_equal(added_count, 2);
+
+    reset_counts();
+    world_run(&world);
+    assert_int_equal(changed_count, 0);
+    assert_int_equal(added_count, 0);
+
+    // a write through get, an overwriting attach and a new component
+    world_get_component(&world, a, Position)->pos = 10;
+    world_mark_changed(&world, a, Position);
+    world_attach_component(&world, b, Position, ((Position){20}));
+    entity_id c = world_create_entity(&world);
+    world_attach_component(&world, c, Position, ((Position){3}));
+
+    reset_counts();
+    world_run(&world);
+    assert_int_equal(changed_count, 3);
+    assert_int_equal(added_count, 1);
+
+    world_destroy(&world);
+}
+
+static void test_changed_and_added(void **state) {
+    (void)state;
+    check_changed_and_added(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_changed_and_added_archetype(void **state) {
+    (void)state;
+    check_changed_and_added(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void check_writes_mark_changed(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+
+    entity_id moving = world_create_entity(&world);
+    entity_id still = world_create_entity(&world);
+    world_attach_component(&world, moving, Position, ((Position){0}));
+    world_attach_component(&world, moving, Velocity, ((Velocity){1}));
+    world_attach_component(&world, still, Position, ((Position){0}));
+
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Write(Position), Read(Velocity)),
+                         .fn = move_system,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Changed(Position)),
+                         .fn = count_changed,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Changed(Velocity)),
+                         .fn = count_watched,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+
+    reset_counts();
+    world_run(&world);
+    assert_int_equal(changed_count, 2);
+    assert_int_equal(watched_count, 1);
+
+    // only the moving entity is written every tick, reading never marks
+    for (int i = 0; i < 3; i++) {
+        reset_counts();
+        world_run(&world);
+        assert_int_equal(changed_count, 1);
+        assert_int_equal(watched_count, 0);
+    }
+
+    assert_int_equal(world_get_component(&world, moving, Position)->pos, 4);
+
+    world_destroy(&world);
+}
+
+static void test_writes_mark_changed(void **state) {
+    (void)state;
+    check_writes_mark_changed(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_writes_mark_changed_archetype(void **state) {
+    (void)state;
+    check_writes_mark_changed(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void check_removed(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+
+    entity_id detached = world_create_entity(&world);
+    entity_id destroyed = world_create_entity(&world);
+    entity_id kept = world_create_entity(&world);
+    world_attach_component(&world, detached, Position, ((Position){1}));
+    world_attach_component(&world, detached, Velocity, ((Velocity){1}));
+    world_attach_component(&world, destroyed, Position, ((Position){2}));
+    world_attach_component(&world, kept, Position, ((Position){3}));
+
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Removed(Position)),
+                         .fn_with_context = record_removed,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+
+    reset_counts();
+    world_run(&world);
+    assert_int_equal(removed_count, 0);
+
+    world_detach_component(&world, detached, Position);
+    world_destroy_entity(&world, destroyed);
+    // detaching a component the entity does not have is not a removal
+    world_detach_component(&world, kept, Velocity);
+
+    reset_counts();
+    world_run(&world);
+    assert_int_equal(removed_count, 2);
+    assert_true(removed_entities[0] == detached);
+    assert_true(removed_entities[1] == destroyed);
+
+    // every watcher has seen the entries, so the log is empty again
+    assert_int_equal(darray_length(world.removed_components[component_id(Position)]), 0);
+    assert_int_equal(darray_length(world.removed_components[component_id(Velocity)]), 0);
+
+    reset_counts();
+    world_run(&world);
+    assert_int_equal(removed_count, 0);
+
+    world_destroy(&world);
+}
+
+static void test_removed(void **state) {
+    (void)state;
+    check_removed(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_removed_archetype(void **state) {
+    (void)state;
+    check_removed(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void test_removed_only_logged_when_watched(void **state) {
+    (void)state;
+    World world = world_new();
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+
+    entity_id entities[3];
+    for (u32 i = 0; i < 3; i++) {
+        entities[i] = world_create_entity(&world);
+        world_attach_component(&world, entities[i], Position, ((Position){(int)i}));
+        world_attach_component(&world, entities[i], Velocity, ((Velocity){(int)i}));
+    }
+
+    // only a startup system watches Position
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Removed(Position)),
+                         .fn_with_context = record_removed,
+                         .schedule = SYSTEM_SCHEDULE_STARTUP,
+                     });
+
+    world_detach_component(&world, entities[0], Position);
+    world_detach_component(&world, entities[0], Velocity);
+    assert_int_equal(darray_length(world.removed_components[component_id(Position)]), 1);
+    assert_int_equal(darray_length(world.removed_components[component_id(Velocity)]), 0);
+
+    reset_counts();
+    world_run(&world);
+    assert_int_equal(removed_count, 1);
+    assert_int_equal(darray_length(world.removed_components[component_id(Position)]), 0);
+
+    // the startup system never runs again, nothing is left to log for
+    world_destroy_entity(&world, entities[1]);
+    assert_int_equal(darray_length(world.removed_components[component_id(Position)]), 0);
+
+    world_destroy(&world);
+}
+
+static void check_changed_after_batch_spawn(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+
+    ComponentId ids[] = {component_id(Position), component_id(Velocity)};
+    EntityRange range = world_spawn_batch(&world, BATCH_COUNT, 2, ids, NULL);
+
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Read(Velocity), Changed(Position)),
+                         .fn = count_watched,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+
+    reset_counts();
+    world_run(&world);
+    assert_int_equal(watched_count, BATCH_COUNT);
+
+    for (u32 i = 0; i < BATCH_COUNT; i += MARK_STRIDE) {
+        world_mark_changed(&world, entity_range_get(range, i), Position);
+    }
+
+    reset_counts();
+    world_run(&world);
+    assert_int_equal(watched_count, BATCH_COUNT / MARK_STRIDE);
+
+    world_destroy(&world);
+}
+
+static void test_changed_after_batch_spawn(void **state) {
+    (void)state;
+    check_changed_after_batch_spawn(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_changed_after_batch_spawn_archetype(void **state) {
+    (void)state;
+    check_changed_after_batch_spawn(WORLD_STORAGE_ARCHETYPE);
+}
+
+#define WRAP_ENTITIES 8
+
+static void check_tick_wraparound(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+    entity_id entities[WRAP_ENTITIES];
+    for (u32 i = 0; i < WRAP_ENTITIES; i++) {
+        entities[i] = world_create_entity(&world);
+        world_attach_component(&world, entities[i], Position, ((Position){(int)i}));
+    }
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Changed(Position)),
+                         .fn = count_changed,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+
+    reset_counts();
+    world_run(&world);
+    assert_int_equal(changed_count, WRAP_ENTITIES);
+
+    // the components stay untouched while the change tick moves more than
+    // half its range past them; after one run the system's last run is that
+    // far ahead too, and only the clamped ticks keep them from reading as new
+    world.change_tick += (1u << 31) + 16;
+    for (u32 run = 0; run < 2; run++) {
+        reset_counts();
+        world_run(&world);
+        assert_int_equal(changed_count, 0);
+    }
+
+    // the change tick itself wraps around zero during these runs
+    world.change_tick = (u32)-8;
+    for (u32 run = 0; run < 4 * WRAP_ENTITIES; run++) {
+        world_mark_changed(&world, entities[run % WRAP_ENTITIES], Position);
+        reset_counts();
+        world_run(&world);
+        assert_int_equal(changed_count, 1);
+    }
+    assert_true(world.change_tick < (1u << 31));
+
+    world_destroy(&world);
+}
+
+static void test_tick_wraparound(void **state) {
+    (void)state;
+    check_tick_wraparound(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_tick_wraparound_archetype(void **state) {
+    (void)state;
+    check_tick_wraparound(WORLD_STORAGE_ARCHETYPE);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_changed_and_added),
+        cmocka_unit_test(test_changed_and_added_archetype),
+        cmocka_unit_test(test_writes_mark_changed),
+        cmocka_unit_test(test_writes_mark_changed_archetype),
+        cmocka_unit_test(test_removed),
+        cmocka_unit_test(test_removed_archetype),
+        cmocka_unit_test(test_removed_only_logged_when_watched),
+        cmocka_unit_test(test_changed_after_batch_spawn),
+        cmocka_unit_test(test_changed_after_batch_spawn_archetype),
+        cmocka_unit_test(test_tick_wraparound),
+        cmocka_unit_test(test_tick_wraparound_archetype),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
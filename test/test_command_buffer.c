@@ -0,0 +1,334 @@
+#include "core/defines.h"
+#include "core/job_pool.h"
+#include "ecs/command_buffer.h"
+#include "ecs/entity.h"
+#include "ecs/query.h"
+#include "ecs/system.h"
+#include "ecs/world.h"
+
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include <cmocka.h>
+
+typedef struct {
+    int health;
+} Health;
+
+typedef struct {
+    int owner;
+} Corpse;
+
+#define ENTITY_COUNT 20000
+
+static void check_apply_command_buffer(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Health);
+    world_register_component(&world, Corpse);
+
+    entity_id doomed = world_create_entity(&world);
+    entity_id kept = world_create_entity(&world);
+    world_attach_component(&world, doomed, Health, ((Health){1}));
+    world_attach_component(&world, kept, Health, ((Health){2}));
+
+    EcsCommandBuffer buffer = ecs_command_buffer_new();
+
+    entity_id spawned = ecs_command_create(&buffer);
+    assert_true(ecs_command_is_pending(spawned));
+    ecs_command_attach(&buffer, spawned, Health, ((Health){3}));
+    ecs_command_attach(&buffer, spawned, Corpse, ((Corpse){4}));
+    ecs_command_destroy(&buffer, doomed);
+
+    // the last attach or detach of a component wins
+    ecs_command_attach(&buffer, kept, Health, ((Health){5}));
+    ecs_command_attach(&buffer, kept, Corpse, ((Corpse){6}));
+    ecs_command_detach(&buffer, kept, Corpse);
+    ecs_command_attach(&buffer, kept, Health, ((Health){7}));
+
+    // nothing happens until the buffer is applied
+    assert_true(world_is_valid_entity(&world, doomed));
+    assert_int_equal(world_get_component(&world, kept, Health)->health, 2);
+
+    world_apply_command_buffer(&world, &buffer);
+    assert_int_equal(darray_length(buffer.commands), 0);
+
+    assert_false(world_is_valid_entity(&world, doomed));
+
+    Health *health = world_get_component(&world, kept, Health);
+    assert_non_null(health);
+    assert_int_equal(health->health, 7);
+    assert_null(world_get_component(&world, kept, Corpse));
+
+    // the slot of `doomed` was not free yet, so the new entity took a fresh one
+    entity_id created = entity_make(2, 0);
+    assert_true(world_is_valid_entity(&world, created));
+    health = world_get_component(&world, created, Health);
+    Corpse *corpse = world_get_component(&world, created, Corpse);
+    assert_non_null(health);
+    assert_non_null(corpse);
+    assert_int_equal(health->health, 3);
+    assert_int_equal(corpse->owner, 4);
+
+    ecs_command_buffer_destroy(&buffer);
+    world_destroy(&world);
+}
+
+static void test_apply_command_buffer(void **state) {
+    (void)state;
+    check_apply_command_buffer(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_apply_command_buffer_archetype(void **state) {
+    (void)state;
+    check_apply_command_buffer(WORLD_STORAGE_ARCHETYPE);
+}
+
+// Attaches to fresh slots are appended to the stores in one batch per
+// component, attaches to recycled slots land between existing keys
+static void check_flush_mixed_keys(ComponentStoreBackend backend) {
+    World world = world_new_with_storage(WORLD_STORAGE_COMPONENT_STORE);
+    world_register_component_with_backend(&world, Health, backend);
+    world_register_component_with_backend(&world, Corpse, backend);
+
+    entity_id existing[1000];
+    for (u32 i = 0; i < 1000; i++) {
+        existing[i] = world_create_entity(&world);
+        world_attach_component(&world, existing[i], Health, ((Health){(int)i}));
+    }
+    for (u32 i = 0; i < 1000; i += 10) {
+        world_destroy_entity(&world, existing[i]);
+    }
+
+    EcsCommandBuffer buffer = ecs_command_buffer_new();
+    entity_id spawned[3000];
+    for (u32 i = 0; i < 3000; i++) {
+        spawned[i] = ecs_command_create(&buffer);
+        ecs_command_attach(&buffer, spawned[i], Health, ((Health){(int)(10000 + i)}));
+        ecs_command_attach(&buffer, spawned[i], Corpse, ((Corpse){(int)i}));
+    }
+    for (u32 i = 1; i < 1000; i += 10) {
+        ecs_command_attach(&buffer, existing[i], Health, ((Health){-(int)i}));
+        ecs_command_detach(&buffer, existing[i + 1], Health);
+    }
+    world_apply_command_buffer(&world, &buffer);
+
+    for (u32 i = 0; i < 1000; i++) {
+        Health *health = world_get_component(&world, existing[i], Health);
+        if (i % 10 == 0 || i % 10 == 2) {
+            assert_null(health);
+        } else {
+            assert_non_null(health);
+            assert_int_equal(health->health, i % 10 == 1 ? -(int)i : (int)i);
+        }
+    }
+
+    // the first 100 spawns reuse the destroyed slots, the others are new
+    u32 recycled = 0;
+    for (u32 index = 0; index < darray_length(world.generations); index++) {
+        if (world.generations[index] == 0 || index % 10 != 0 || index >= 1000) {
+            continue;
+        }
+        entity_id entity = entity_make(index, world.generations[index]);
+        assert_non_null(world_get_component(&world, entity, Corpse));
+        recycled++;
+    }
+    assert_int_equal(recycled, 100);
+
+    u32 health_count = 0;
+    for (u32 index = 0; index < darray_length(world.generations); index++) {
+        entity_id entity = entity_make(index, world.generations[index]);
+        Health *health = world_get_component(&world, entity, Health);
+        Corpse *corpse = world_get_component(&world, entity, Corpse);
+        if (corpse != NULL) {
+            assert_non_null(health);
+            assert_int_equal(health->health, 10000 + corpse->owner);
+        }
+        health_count += health != NULL;
+    }
+    assert_int_equal(health_count, 800 + 3000);
+    assert_int_equal(world.component_stores[component_id(Corpse)].component_count, 3000);
+
+    ecs_command_buffer_destroy(&buffer);
+    world_destroy(&world);
+}
+
+static void test_flush_mixed_keys(void **state) {
+    (void)state;
+    check_flush_mixed_keys(COMPONENT_STORE_BTREE);
+}
+
+static void test_flush_mixed_keys_sparse_set(void **state) {
+    (void)state;
+    check_flush_mixed_keys(COMPONENT_STORE_SPARSE_SET);
+}
+
+// replaces every dead entity with a corpse entity while the world iterates
+static void reap_system(SystemContext *context, void **components) {
+    Health *health = components[0];
+    if (health->health > 0) {
+        return;
+    }
+
+    entity_id corpse = ecs_command_create(context->commands);
+    ecs_command_attach(context->commands, corpse, Corpse, ((Corpse){(int)entity_get_index(context->entity)}));
+    ecs_command_destroy(context->commands, context->entity);
+}
+
+static void check_systems_record_commands(WorldStorage storage) {
+    JobPool *pool = job_pool_new(4);
+    World world = world_new_with_storage(storage);
+    world_set_job_pool(&world, pool);
+    world_register_component(&world, Health);
+    world_register_component(&world, Corpse);
+
+    static entity_id entities[ENTITY_COUNT];
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        entities[i] = world_create_entity(&world);
+        world_attach_component(&world, entities[i], Health, ((Health){i % 4}));
+    }
+
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Read(Health)),
+                         .fn_with_context = reap_system,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                         .flags = SYSTEM_FLAG_PARALLEL,
+                     });
+
+    world_run(&world);
+
+    u32 corpses = 0;
+    for (u32 i = 0; i < darray_length(world.generations); i++) {
+        entity_id e = entity_make(i, world.generations[i]);
+        Corpse *corpse = world_get_component(&world, e, Corpse);
+        if (corpse == NULL) {
+            continue;
+        }
+        assert_null(world_get_component(&world, e, Health));
+        assert_int_equal(corpse->owner % 4, 0);
+        assert_false(world_is_valid_entity(&world, entities[corpse->owner]));
+        corpses++;
+    }
+    assert_int_equal(corpses, ENTITY_COUNT / 4);
+
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        assert_int_equal(world_is_valid_entity(&world, entities[i]), i % 4 != 0);
+    }
+
+    // the second tick finds no dead entities left
+    world_run(&world);
+    u32 alive = 0;
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        alive += world_is_valid_entity(&world, entities[i]);
+    }
+    assert_int_equal(alive, ENTITY_COUNT - ENTITY_COUNT / 4);
+
+    world_destroy(&world);
+    job_pool_destroy(pool);
+}
+
+static void test_systems_record_commands(void **state) {
+    (void)state;
+    check_systems_record_commands(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_systems_record_commands_archetype(void **state) {
+    (void)state;
+    check_systems_record_commands(WORLD_STORAGE_ARCHETYPE);
+}
+
+// heals every entity through an attach command
+static void heal_system(SystemContext *context, void **components) {
+    const Health *health = components[0];
+    ecs_command_attach(context->commands, context->entity, Health, ((Health){health->health + 1}));
+}
+
+static void test_flush_scratch_is_reused(void **state) {
+    (void)state;
+    World world = world_new();
+    world_register_component(&world, Health);
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        world_attach_component(&world, world_create_entity(&world), Health, ((Health){0}));
+    }
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Read(Health)),
+                         .fn_with_context = heal_system,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+
+    world_run(&world);
+    world_run(&world);
+    u64 capacities[FRAME_ALLOCATOR_BUFFER_COUNT];
+    for (u32 i = 0; i < FRAME_ALLOCATOR_BUFFER_COUNT; i++) {
+        capacities[i] = arena_capacity(&world.frame_allocator.arenas[i]);
+        assert_true(capacities[i] > 0);
+    }
+
+    // every tick's schedule and flush fit in the memory of the ticks before
+    for (u32 tick = 0; tick < 8; tick++) {
+        world_run(&world);
+    }
+    for (u32 i = 0; i < FRAME_ALLOCATOR_BUFFER_COUNT; i++) {
+        assert_int_equal(arena_capacity(&world.frame_allocator.arenas[i]), capacities[i]);
+    }
+    assert_int_equal(world_get_component(&world, entity_make(0, world.generations[0]), Health)->health, 10);
+
+    world_destroy(&world);
+}
+
+#define FOREIGN_JOBS 64
+
+typedef struct {
+    World *world;
+    EcsCommandBuffer *buffer;
+} BufferLookup;
+
+static void look_up_buffer(void *data) {
+    BufferLookup *lookup = data;
+    lookup->buffer = world_command_buffer(lookup->world);
+    // long enough for the other workers to steal the remaining jobs
+    usleep(1000);
+}
+
+static void test_foreign_threads_get_first_buffer(void **state) {
+    (void)state;
+    JobPool *world_pool = job_pool_new(2);
+    JobPool *other_pool = job_pool_new(8);
+    World world = world_new();
+    world_set_job_pool(&world, world_pool);
+
+    // workers of a larger pool have indices past the world's buffers
+    static BufferLookup lookups[FOREIGN_JOBS];
+    JobCounter counter = {0};
+    for (u32 i = 0; i < FOREIGN_JOBS; i++) {
+        lookups[i] = (BufferLookup){.world = &world, .buffer = NULL};
+        job_pool_submit(other_pool, (Job){.fn = look_up_buffer, .data = &lookups[i], .counter = &counter});
+    }
+    job_pool_wait(other_pool, &counter);
+
+    for (u32 i = 0; i < FOREIGN_JOBS; i++) {
+        assert_ptr_equal(lookups[i].buffer, &world.command_buffers[0]);
+    }
+
+    world_destroy(&world);
+    job_pool_destroy(other_pool);
+    job_pool_destroy(world_pool);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_apply_command_buffer),
+        cmocka_unit_test(test_apply_command_buffer_archetype),
+        cmocka_unit_test(test_flush_mixed_keys),
+        cmocka_unit_test(test_flush_mixed_keys_sparse_set),
+        cmocka_unit_test(test_systems_record_commands),
+        cmocka_unit_test(test_systems_record_commands_archetype),
+        cmocka_unit_test(test_flush_scratch_is_reused),
+        cmocka_unit_test(test_foreign_threads_get_first_buffer),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
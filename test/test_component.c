@@ -4,6 +4,7 @@
 #include <setjmp.h> // IWYU pragma: keep
 #include <stdarg.h>
 #include <stddef.h>
+#include <string.h>
 
 #include <cmocka.h>
 
@@ -41,10 +42,293 @@ static void test_detach_component(void **state) {
     world_destroy(&world);
 }
 
+typedef struct {
+    int armor;
+} Armor;
+
+static void test_component_ids_shared_between_worlds(void **state) {
+    (void)state;
+    World a = world_new();
+    World b = world_new_with_storage(WORLD_STORAGE_ARCHETYPE);
+
+    ComponentId health_a = world_register_component(&a, Health);
+    ComponentId armor_a = world_register_component(&a, Armor);
+    ComponentId armor_b = world_register_component(&b, Armor);
+    ComponentId health_b = world_register_component(&b, Health);
+
+    assert_int_equal(health_a, health_b);
+    assert_int_equal(armor_a, armor_b);
+    assert_int_not_equal(health_a, armor_a);
+    assert_int_equal(component_id(Health), health_a);
+    assert_int_equal(world_register_component(&a, Health), health_a);
+
+    assert_int_equal(world_find_component(&b, "Armor"), armor_b);
+    assert_int_equal(world_find_component(&b, "Missing"), COMPONENT_ID_INVALID);
+
+    entity_id e = world_create_entity(&b);
+    Armor armor = {12};
+    _world_attach_component(&b, e, "Armor", &armor);
+    Armor *got = world_get_component(&b, e, Armor);
+    assert_non_null(got);
+    assert_int_equal(got->armor, 12);
+
+    world_destroy(&a);
+    world_destroy(&b);
+}
+
+// spans several sparse set pages
+#define STRESS_ENTITY_COUNT 10000
+
+static void check_component_store_stays_dense(ComponentStoreBackend backend) {
+    World world = world_new();
+    ComponentId health_id = world_register_component_with_backend(&world, Health, backend);
+
+    static entity_id entities[STRESS_ENTITY_COUNT];
+    for (int i = 0; i < STRESS_ENTITY_COUNT; i++) {
+        entities[i] = world_create_entity(&world);
+        world_attach_component(&world, entities[i], Health, ((Health){i}));
+    }
+
+    for (int i = 0; i < STRESS_ENTITY_COUNT; i += 3) {
+        world_detach_component(&world, entities[i], Health);
+    }
+
+    const ComponentStore *store = &world.component_stores[health_id];
+    assert_int_equal(store->component_count, STRESS_ENTITY_COUNT - (STRESS_ENTITY_COUNT + 2) / 3);
+
+    for (u32 i = 0; i < store->component_count; i++) {
+        const Health *dense = component_store_at(store, i);
+        assert_int_equal(entity_get_index(entities[dense->health]), store->entities[i]);
+    }
+
+    for (int i = 0; i < STRESS_ENTITY_COUNT; i++) {
+        Health *got = world_get_component(&world, entities[i], Health);
+        if (i % 3 == 0) {
+            assert_null(got);
+        } else {
+            assert_non_null(got);
+            assert_int_equal(got->health, i);
+        }
+    }
+
+    world_destroy(&world);
+}
+
+static void test_component_store_stays_dense(void **state) {
+    (void)state;
+    check_component_store_stays_dense(COMPONENT_STORE_BTREE);
+}
+
+static void test_sparse_set_stays_dense(void **state) {
+    (void)state;
+    check_component_store_stays_dense(COMPONENT_STORE_SPARSE_SET);
+}
+
+static void test_sparse_set_reattach(void **state) {
+    (void)state;
+    World world = world_new();
+    world_register_component_with_backend(&world, Health, COMPONENT_STORE_SPARSE_SET);
+
+    entity_id e = world_create_entity(&world);
+    assert_null(world_get_component(&world, e, Health));
+
+    world_attach_component(&world, e, Health, ((Health){1}));
+    world_attach_component(&world, e, Health, ((Health){2}));
+    assert_int_equal(world.component_stores[component_id(Health)].component_count, 1);
+
+    world_detach_component(&world, e, Health);
+    world_detach_component(&world, e, Health);
+    assert_null(world_get_component(&world, e, Health));
+
+    world_attach_component(&world, e, Health, ((Health){3}));
+    Health *got = world_get_component(&world, e, Health);
+    assert_non_null(got);
+    assert_int_equal(got->health, 3);
+
+    world_destroy(&world);
+}
+
+static void check_component_store_cursor(ComponentStoreBackend backend) {
+    ComponentStore store = component_store_new_with_backend("Health", sizeof(Health), backend);
+
+    ComponentStoreIter iter = component_store_iter_begin(&store);
+    assert_false(component_store_iter_next(&iter, NULL, NULL));
+
+    // insert out of order, then punch holes so the leaf chain gets merged
+    for (int i = STRESS_ENTITY_COUNT - 1; i >= 0; i--) {
+        Health h = {i};
+        component_store_insert(&store, (entity_index)i * 2, &h);
+    }
+    for (int i = 0; i < STRESS_ENTITY_COUNT; i += 3) {
+        component_store_remove(&store, (entity_index)i * 2);
+    }
+
+    u32 count = 0;
+    entity_index previous = 0;
+    entity_index key;
+    void *component;
+    iter = component_store_iter_begin(&store);
+    while (component_store_iter_next(&iter, &key, &component)) {
+        if (count > 0) {
+            assert_true(key > previous);
+        }
+        assert_int_equal(((Health *)component)->health * 2, key);
+        assert_int_not_equal((key / 2) % 3, 0);
+        previous = key;
+        count++;
+    }
+    assert_int_equal(count, store.component_count);
+
+    // [1000, 1999] holds the even keys 1000..1998 except multiples of 6
+    count = 0;
+    iter = component_store_iter_range(&store, 1000, 1999);
+    while (component_store_iter_next(&iter, &key, NULL)) {
+        assert_true(key >= 1000 && key <= 1999);
+        count++;
+    }
+    assert_int_equal(count, 500 - 167);
+
+    iter = component_store_iter_range(&store, 6, 6);
+    assert_false(component_store_iter_next(&iter, NULL, NULL));
+
+    iter = component_store_iter_range(&store, 8, 8);
+    assert_true(component_store_iter_next(&iter, &key, NULL));
+    assert_int_equal(key, 8);
+    assert_false(component_store_iter_next(&iter, NULL, NULL));
+
+    iter = component_store_iter_range(&store, 10, 2);
+    assert_false(component_store_iter_next(&iter, NULL, NULL));
+
+    component_store_destroy(&store);
+}
+
+static void test_component_store_cursor(void **state) {
+    (void)state;
+    check_component_store_cursor(COMPONENT_STORE_BTREE);
+}
+
+static void test_sparse_set_cursor(void **state) {
+    (void)state;
+    check_component_store_cursor(COMPONENT_STORE_SPARSE_SET);
+}
+
+static void test_component_store_orders(void **state) {
+    (void)state;
+    static const u32 orders[] = {4, 5, 7, 16, 64};
+    static b8 present[STRESS_ENTITY_COUNT];
+
+    for (u32 o = 0; o < sizeof(orders) / sizeof(orders[0]); o++) {
+        ComponentStore store = component_store_new("Health", sizeof(Health));
+        component_store_set_order(&store, orders[o]);
+        memset(present, 0, sizeof(present));
+
+        // insert and remove in a scrambled order so every split, merge and
+        // redistribution path runs
+        u32 seed = 12345;
+        for (u32 i = 0; i < 4 * STRESS_ENTITY_COUNT; i++) {
+            seed = seed * 1103515245u + 12345u;
+            entity_index key = (seed >> 8) % STRESS_ENTITY_COUNT;
+            if (present[key] && i % 3 != 0) {
+                component_store_remove(&store, key);
+                present[key] = false;
+            } else {
+                Health h = {(int)key};
+                component_store_insert(&store, key, &h);
+                present[key] = true;
+            }
+        }
+
+        u32 count = 0;
+        for (entity_index key = 0; key < STRESS_ENTITY_COUNT; key++) {
+            Health *got = component_store_find(&store, key);
+            if (present[key]) {
+                assert_non_null(got);
+                assert_int_equal(got->health, key);
+                count++;
+            } else {
+                assert_null(got);
+            }
+        }
+        assert_int_equal(count, store.component_count);
+
+        entity_index key;
+        u32 visited = 0;
+        ComponentStoreIter iter = component_store_iter_begin(&store);
+        while (component_store_iter_next(&iter, &key, NULL)) {
+            assert_true(present[key]);
+            visited++;
+        }
+        assert_int_equal(visited, count);
+
+        for (entity_index k = 0; k < STRESS_ENTITY_COUNT; k++) {
+            component_store_remove(&store, k);
+        }
+        assert_int_equal(store.component_count, 0);
+        assert_null(store.root);
+
+        component_store_destroy(&store);
+    }
+}
+
+static void check_component_store_insert_batch(ComponentStoreBackend backend, u32 order) {
+    static Health values[STRESS_ENTITY_COUNT];
+    for (int i = 0; i < STRESS_ENTITY_COUNT; i++) {
+        values[i].health = i;
+    }
+
+    ComponentStore store = component_store_new_with_backend("Health", sizeof(Health), backend);
+    component_store_set_order(&store, order);
+
+    // appended behind existing keys, then a batch that lands in front of them
+    Health h = {-1};
+    component_store_insert(&store, 0, &h);
+    component_store_insert_batch(&store, 4000, STRESS_ENTITY_COUNT - 4000, values + 4000);
+    component_store_insert_batch(&store, 1, 3999, values + 1);
+    assert_int_equal(store.component_count, STRESS_ENTITY_COUNT);
+
+    for (entity_index key = 1; key < STRESS_ENTITY_COUNT; key++) {
+        Health *got = component_store_find(&store, key);
+        assert_non_null(got);
+        assert_int_equal(got->health, key);
+    }
+
+    entity_index key;
+    entity_index expected = 0;
+    ComponentStoreIter iter = component_store_iter_begin(&store);
+    while (component_store_iter_next(&iter, &key, NULL)) {
+        assert_int_equal(key, expected);
+        expected++;
+    }
+    assert_int_equal(expected, STRESS_ENTITY_COUNT);
+
+    for (key = 0; key < STRESS_ENTITY_COUNT; key += 2) {
+        component_store_remove(&store, key);
+    }
+    assert_null(component_store_find(&store, 0));
+    assert_int_equal(((Health *)component_store_find(&store, 4001))->health, 4001);
+
+    component_store_destroy(&store);
+}
+
+static void test_component_store_insert_batch(void **state) {
+    (void)state;
+    check_component_store_insert_batch(COMPONENT_STORE_BTREE, 4);
+    check_component_store_insert_batch(COMPONENT_STORE_BTREE, 32);
+    check_component_store_insert_batch(COMPONENT_STORE_SPARSE_SET, 32);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_component_attach_and_retrieve),
         cmocka_unit_test(test_detach_component),
+        cmocka_unit_test(test_component_ids_shared_between_worlds),
+        cmocka_unit_test(test_component_store_stays_dense),
+        cmocka_unit_test(test_sparse_set_stays_dense),
+        cmocka_unit_test(test_sparse_set_reattach),
+        cmocka_unit_test(test_component_store_cursor),
+        cmocka_unit_test(test_sparse_set_cursor),
+        cmocka_unit_test(test_component_store_orders),
+        cmocka_unit_test(test_component_store_insert_batch),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -95,6 +95,105 @@ static void test_darray_append(void **state) {
     darray_destroy(array_2);
 }
 
+static void test_darray_reserve(void **state) {
+    (void)state;
+
+    darray(u32) da = darray_new(u32);
+    darray_reserve(da, 1000);
+    assert_int_equal(darray_capacity(da), 1000);
+    assert_int_equal(darray_length(da), 0);
+
+    // pushes within the reserved capacity do not move the array
+    u32 *first = da;
+    for (u32 i = 0; i < 1000; i++) {
+        darray_push(da, i);
+    }
+    assert_ptr_equal(da, first);
+
+    // reserving less than the capacity is a no-op
+    darray_reserve(da, 10);
+    assert_int_equal(darray_capacity(da), 1000);
+    for (u32 i = 0; i < 1000; i++) {
+        assert_int_equal(da[i], i);
+    }
+    darray_destroy(da);
+}
+
+static void test_darray_resize_uninit(void **state) {
+    (void)state;
+
+    darray(u64) da = darray_new(u64);
+    darray_push(da, 7);
+    darray_resize_uninit(da, 100);
+    assert_int_equal(darray_length(da), 100);
+    assert_true(darray_capacity(da) >= 100);
+    assert_int_equal(da[0], 7);
+    for (u64 i = 1; i < 100; i++) {
+        da[i] = i;
+    }
+
+    darray_resize_uninit(da, 3);
+    assert_int_equal(darray_length(da), 3);
+    assert_int_equal(da[2], 2);
+    darray_destroy(da);
+}
+
+typedef struct {
+    u32 a, b, c;
+} Triple;
+
+static void test_darray_push_n(void **state) {
+    (void)state;
+
+    // one array per fill path
+    darray(u8) bytes = darray_new(u8);
+    darray_push(bytes, 1);
+    darray_push_n(bytes, 0xAB, 300);
+    assert_int_equal(darray_length(bytes), 301);
+    assert_int_equal(bytes[0], 1);
+    assert_int_equal(bytes[300], 0xAB);
+
+    darray(u32) words = darray_new(u32);
+    darray_push_n(words, 0xDEADBEEF, 33);
+    darray(u64) longs = darray_new(u64);
+    darray_push_n(longs, 0x0123456789ABCDEFull, 33);
+    darray(Triple) triples = darray_new(Triple);
+    darray_push_n(triples, ((Triple){1, 2, 3}), 33);
+    for (u32 i = 0; i < 33; i++) {
+        assert_int_equal(words[i], 0xDEADBEEF);
+        assert_int_equal(longs[i], 0x0123456789ABCDEFull);
+        assert_int_equal(triples[i].c, 3);
+    }
+
+    darray_push_n(words, 0, 0);
+    assert_int_equal(darray_length(words), 33);
+
+    darray_destroy(bytes);
+    darray_destroy(words);
+    darray_destroy(longs);
+    darray_destroy(triples);
+}
+
+static void test_darray_extend_from(void **state) {
+    (void)state;
+
+    u32 values[100];
+    for (u32 i = 0; i < 100; i++) {
+        values[i] = i * 3;
+    }
+
+    darray(u32) da = darray_new(u32);
+    darray_push(da, 42);
+    darray_extend_from(da, values, 100);
+    darray_extend_from(da, values, 0);
+    assert_int_equal(darray_length(da), 101);
+    assert_int_equal(da[0], 42);
+    for (u32 i = 0; i < 100; i++) {
+        assert_int_equal(da[i + 1], i * 3);
+    }
+    darray_destroy(da);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_darray_push),
@@ -103,6 +202,10 @@ int main(void) {
         cmocka_unit_test(test_darray_remove_at),
         cmocka_unit_test(test_darray_remove_at_sorted),
         cmocka_unit_test(test_darray_append),
+        cmocka_unit_test(test_darray_reserve),
+        cmocka_unit_test(test_darray_resize_uninit),
+        cmocka_unit_test(test_darray_push_n),
+        cmocka_unit_test(test_darray_extend_from),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -24,10 +24,122 @@ static void test_entity_destruction(void **state) {
     world_destroy(&world);
 }
 
+typedef struct {
+    int health;
+} Health;
+
+static void test_stale_handle_rejected(void **state) {
+    (void)state;
+    World world = world_new();
+    world_register_component(&world, Health);
+
+    entity_id old = world_create_entity(&world);
+    world_attach_component(&world, old, Health, ((Health){10}));
+    world_destroy_entity(&world, old);
+
+    entity_id reused = world_create_entity(&world);
+    assert_int_equal(entity_get_index(reused), entity_get_index(old));
+    assert_int_not_equal(reused, old);
+    assert_true(world_is_valid_entity(&world, reused));
+    assert_false(world_is_valid_entity(&world, old));
+
+    world_attach_component(&world, old, Health, ((Health){20}));
+    assert_null(world_get_component(&world, reused, Health));
+    assert_null(world_get_component(&world, old, Health));
+
+    // destroying through the stale handle must not touch the new entity
+    world_attach_component(&world, reused, Health, ((Health){30}));
+    world_destroy_entity(&world, old);
+    assert_true(world_is_valid_entity(&world, reused));
+    Health *health = world_get_component(&world, reused, Health);
+    assert_non_null(health);
+    assert_int_equal(health->health, 30);
+
+    world_destroy(&world);
+}
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+#define BATCH_COUNT 5000
+
+static void check_spawn_batch(World *world) {
+    world_register_component(world, Health);
+    world_register_component(world, Position);
+
+    // a destroyed entity leaves a free slot the batch must not reuse
+    entity_id before = world_create_entity(world);
+    world_attach_component(world, before, Health, ((Health){-1}));
+    world_destroy_entity(world, world_create_entity(world));
+
+    static Health healths[BATCH_COUNT];
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        healths[i].health = i;
+    }
+    ComponentId ids[] = {component_id(Position), component_id(Health)};
+    const void *values[] = {NULL, healths};
+
+    EntityRange range = world_spawn_batch(world, BATCH_COUNT, 2, ids, values);
+    assert_int_equal(range.count, BATCH_COUNT);
+    assert_int_equal(range.first, 2);
+
+    for (u32 i = 0; i < range.count; i++) {
+        entity_id e = entity_range_get(range, i);
+        assert_true(world_is_valid_entity(world, e));
+
+        Health *health = world_get_component(world, e, Health);
+        Position *position = world_get_component(world, e, Position);
+        assert_non_null(health);
+        assert_non_null(position);
+        assert_int_equal(health->health, i);
+        assert_float_equal(position->y, 0, F32_EPSILON);
+    }
+
+    // batch spawned entities behave like any other
+    entity_id e = entity_range_get(range, 10);
+    world_detach_component(world, e, Health);
+    assert_null(world_get_component(world, e, Health));
+    world_destroy_entity(world, entity_range_get(range, 0));
+    assert_false(world_is_valid_entity(world, entity_range_get(range, 0)));
+    Health *second_health = world_get_component(world, entity_range_get(range, 1), Health);
+    assert_non_null(second_health);
+    assert_int_equal(second_health->health, 1);
+
+    Health *first = world_get_component(world, before, Health);
+    assert_non_null(first);
+    assert_int_equal(first->health, -1);
+
+    // a second batch lands behind the first one
+    EntityRange second = world_spawn_batch(world, 100, 1, ids + 1, NULL);
+    assert_int_equal(second.first, range.first + range.count);
+    Health *zeroed = world_get_component(world, entity_range_get(second, 99), Health);
+    assert_non_null(zeroed);
+    assert_int_equal(zeroed->health, 0);
+    assert_null(world_get_component(world, entity_range_get(second, 99), Position));
+}
+
+static void test_spawn_batch(void **state) {
+    (void)state;
+    World world = world_new();
+    check_spawn_batch(&world);
+    world_destroy(&world);
+}
+
+static void test_spawn_batch_archetype(void **state) {
+    (void)state;
+    World world = world_new_with_storage(WORLD_STORAGE_ARCHETYPE);
+    check_spawn_batch(&world);
+    world_destroy(&world);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_entity_creation),
         cmocka_unit_test(test_entity_destruction),
+        cmocka_unit_test(test_stale_handle_rejected),
+        cmocka_unit_test(test_spawn_batch),
+        cmocka_unit_test(test_spawn_batch_archetype),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,204 @@
+#include "containers/hashtable.h"
+#include "core/defines.h"
+
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <cmocka.h>
+
+static void test_insert_and_get(void **state) {
+    (void)state;
+    HashTable table = hashtable_new(sizeof(u64), sizeof(u32));
+    for (u64 key = 0; key < 1000; key++) {
+        u32 value = (u32)key * 3;
+        hashtable_insert(&table, &key, &value);
+    }
+    assert_int_equal(hashtable_count(&table), 1000);
+
+    for (u64 key = 0; key < 1000; key++) {
+        u32 *value = hashtable_get(&table, &key);
+        assert_non_null(value);
+        assert_int_equal(*value, key * 3);
+    }
+    u64 missing = 1000;
+    assert_null(hashtable_get(&table, &missing));
+
+    // inserting again overwrites
+    u64 key = 7;
+    u32 value = 99;
+    hashtable_insert(&table, &key, &value);
+    assert_int_equal(hashtable_count(&table), 1000);
+    assert_int_equal(*(u32 *)hashtable_get(&table, &key), 99);
+
+    hashtable_destroy(&table);
+}
+
+static u64 colliding_hash(const void *key, u64 key_size) {
+    (void)key;
+    (void)key_size;
+    return 42;
+}
+
+static b8 u32_equal(const void *a, const void *b, u64 key_size) {
+    (void)key_size;
+    return *(const u32 *)a == *(const u32 *)b;
+}
+
+// Every key has the same hash, so they all share one probe sequence
+static void test_collisions(void **state) {
+    (void)state;
+    HashTable table = hashtable_new_with(sizeof(u32), sizeof(u32), colliding_hash, u32_equal);
+    for (u32 key = 0; key < 100; key++) {
+        hashtable_insert(&table, &key, &key);
+    }
+    for (u32 key = 0; key < 100; key += 2) {
+        assert_true(hashtable_remove(&table, &key));
+    }
+
+    for (u32 key = 0; key < 100; key++) {
+        u32 *value = hashtable_get(&table, &key);
+        if (key % 2 == 0) {
+            assert_null(value);
+        } else {
+            assert_non_null(value);
+            assert_int_equal(*value, key);
+        }
+    }
+    hashtable_destroy(&table);
+}
+
+static void test_remove(void **state) {
+    (void)state;
+    HashTable table = hashtable_new(sizeof(u64), sizeof(u64));
+    u64 key = 5;
+    assert_false(hashtable_remove(&table, &key));
+    hashtable_insert(&table, &key, &key);
+    assert_true(hashtable_remove(&table, &key));
+    assert_false(hashtable_remove(&table, &key));
+    assert_int_equal(hashtable_count(&table), 0);
+
+    // churn through far more keys than slots, tombstones must not fill the
+    // table or make it grow without bound
+    for (u64 round = 0; round < 100; round++) {
+        for (u64 i = 0; i < 100; i++) {
+            u64 k = round * 100 + i;
+            hashtable_insert(&table, &k, &k);
+        }
+        for (u64 i = 0; i < 100; i++) {
+            u64 k = round * 100 + i;
+            assert_int_equal(*(u64 *)hashtable_get(&table, &k), k);
+            assert_true(hashtable_remove(&table, &k));
+        }
+    }
+    assert_int_equal(hashtable_count(&table), 0);
+    assert_true(table.capacity <= 256);
+
+    hashtable_destroy(&table);
+}
+
+static void test_growth_keeps_entries(void **state) {
+    (void)state;
+    HashTable table = hashtable_new(sizeof(u64), sizeof(u64));
+    const u64 count = 100000;
+    for (u64 i = 0; i < count; i++) {
+        u64 key = i * 0x9E3779B97F4A7C15ull;
+        u64 value = i;
+        hashtable_insert(&table, &key, &value);
+    }
+    assert_int_equal(hashtable_count(&table), count);
+    assert_true(table.count <= table.capacity * HASHTABLE_MAX_LOAD_NUMERATOR / HASHTABLE_MAX_LOAD_DENOMINATOR);
+
+    for (u64 i = 0; i < count; i++) {
+        u64 key = i * 0x9E3779B97F4A7C15ull;
+        assert_int_equal(*(u64 *)hashtable_get(&table, &key), i);
+    }
+    hashtable_destroy(&table);
+}
+
+static void test_reserve_and_clear(void **state) {
+    (void)state;
+    HashTable table = hashtable_new(sizeof(u64), sizeof(u64));
+    hashtable_reserve(&table, 1000);
+    u32 capacity = table.capacity;
+    void *first = NULL;
+    for (u64 key = 0; key < 1000; key++) {
+        void *value = hashtable_insert(&table, &key, NULL);
+        if (key == 0) {
+            first = value;
+        }
+    }
+    // nothing moved
+    assert_int_equal(table.capacity, capacity);
+    u64 zero = 0;
+    assert_ptr_equal(hashtable_get(&table, &zero), first);
+    assert_int_equal(*(u64 *)first, 0);
+
+    hashtable_clear(&table);
+    assert_int_equal(hashtable_count(&table), 0);
+    assert_null(hashtable_get(&table, &zero));
+    hashtable_destroy(&table);
+}
+
+static void test_iteration(void **state) {
+    (void)state;
+    HashTable table = hashtable_new(sizeof(u64), sizeof(u64));
+    for (u64 key = 0; key < 500; key++) {
+        u64 value = key + 1;
+        hashtable_insert(&table, &key, &value);
+    }
+    for (u64 key = 0; key < 500; key += 5) {
+        hashtable_remove(&table, &key);
+    }
+
+    u64 key_sum = 0;
+    u32 visited = 0;
+    u32 iterator = 0;
+    void *key;
+    void *value;
+    while (hashtable_next(&table, &iterator, &key, &value)) {
+        assert_int_equal(*(u64 *)value, *(u64 *)key + 1);
+        assert_true(*(u64 *)key % 5 != 0);
+        key_sum += *(u64 *)key;
+        visited++;
+    }
+    assert_int_equal(visited, 400);
+    assert_int_equal(key_sum, 499 * 500 / 2 - 5 * (99 * 100 / 2));
+
+    hashtable_destroy(&table);
+}
+
+static void test_string_keys(void **state) {
+    (void)state;
+    HashTable table =
+        hashtable_new_with(sizeof(const char *), sizeof(u32), hashtable_hash_string_key, hashtable_equal_string_key);
+    const char *names[] = {"position", "velocity", "health", "mass"};
+    for (u32 i = 0; i < 4; i++) {
+        hashtable_insert(&table, &names[i], &i);
+    }
+
+    // looked up by content, not by pointer
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%s", "health");
+    const char *key = buffer;
+    assert_int_equal(*(u32 *)hashtable_get(&table, &key), 2);
+    assert_true(hash_string("health") == hash_string(buffer));
+    assert_true(hash_string("health") != hash_string("healti"));
+
+    hashtable_destroy(&table);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_insert_and_get),
+        cmocka_unit_test(test_collisions),
+        cmocka_unit_test(test_remove),
+        cmocka_unit_test(test_growth_keeps_entries),
+        cmocka_unit_test(test_reserve_and_clear),
+        cmocka_unit_test(test_iteration),
+        cmocka_unit_test(test_string_keys),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
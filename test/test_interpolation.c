@@ -0,0 +1,261 @@
+#include "core/defines.h"
+#include "ecs/entity.h"
+#include "ecs/interpolation.h"
+#include "ecs/query.h"
+#include "ecs/system.h"
+#include "ecs/transform.h"
+#include "ecs/world.h"
+
+#include <math.h>
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <cmocka.h>
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+// odd, so the SIMD kernels also take their scalar tail
+#define ENTITY_COUNT 1003
+
+static World make_world(WorldStorage storage, entity_id *entities) {
+    World world = world_new_with_storage(storage);
+    world_set_component_flags(&world, world_register_component(&world, Position), COMPONENT_FLAG_INTERPOLATE);
+    world_set_component_flags(&world, world_register_component(&world, LocalTransform), COMPONENT_FLAG_INTERPOLATE);
+    interpolation_enable(&world, 1.0);
+    interpolation_add_quaternion(&world, component_id(LocalTransform), offsetof(LocalTransform, rotation));
+
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        entities[i] = world_create_entity(&world);
+        world_attach_component(&world, entities[i], Position, ((Position){0}));
+        world_attach_component(&world, entities[i], LocalTransform, local_transform_identity());
+    }
+    return world;
+}
+
+static Position recorded_position(u32 entity, u32 sample) {
+    return (Position){(f32)entity + 10.0f * (f32)sample, -(f32)sample, (f32)(entity * sample % 17)};
+}
+
+// Rotations about changing axes, with large steps, steps past 180 degrees
+// where the shorter arc goes the other way, and steps too small for slerp
+static versors recorded_rotation(u32 entity, u32 sample) {
+    f32 step = entity % 3 == 0 ? 1e-6f : (f32)(entity % 50) * 0.15f;
+    vec3s axis = {{sinf((f32)entity), cosf((f32)entity), 0.0f}};
+    return quatv(step * (f32)sample + (f32)entity * 0.01f, axis);
+}
+
+static void record(World *world, const entity_id *entities, u32 sample) {
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        *world_get_component(world, entities[i], Position) = recorded_position(i, sample);
+        LocalTransform *transform = world_get_component(world, entities[i], LocalTransform);
+        transform->translation = (vec3s){{(f32)sample, (f32)i, 0.0f}};
+        transform->rotation = recorded_rotation(i, sample);
+    }
+    interpolation_push(world, sample);
+}
+
+static void reference_slerp(f64 out[4], versors a, versors b, f64 t) {
+    f64 dot = (f64)a.x * b.x + (f64)a.y * b.y + (f64)a.z * b.z + (f64)a.w * b.w;
+    f64 sign = dot < 0 ? -1 : 1;
+    dot = fmin(dot * sign, 1.0);
+    f64 theta = acos(dot);
+    f64 wa = 1 - t;
+    f64 wb = t;
+    if (sin(theta) > 1e-5) {
+        wa = sin(wa * theta) / sin(theta);
+        wb = sin(wb * theta) / sin(theta);
+    }
+    wb *= sign;
+    f64 length = 0;
+    for (u32 i = 0; i < 4; i++) {
+        out[i] = wa * a.raw[i] + wb * b.raw[i];
+        length += out[i] * out[i];
+    }
+    for (u32 i = 0; i < 4; i++) {
+        out[i] /= sqrt(length);
+    }
+}
+
+static void assert_blended(const World *world, const entity_id *entities, u32 from, u32 to, f32 t) {
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        Position a = recorded_position(i, from);
+        Position b = recorded_position(i, to);
+        const Position *p = world_get_component(world, entities[i], Position);
+        assert_float_equal(p->x, a.x + (b.x - a.x) * t, 1e-3);
+        assert_float_equal(p->y, a.y + (b.y - a.y) * t, 1e-3);
+        assert_float_equal(p->z, a.z + (b.z - a.z) * t, 1e-3);
+
+        const LocalTransform *transform = world_get_component(world, entities[i], LocalTransform);
+        assert_float_equal(transform->translation.x, (f32)from + (f32)(to - from) * t, 1e-4);
+        assert_float_equal(transform->translation.y, (f32)i, 1e-4);
+        assert_float_equal(transform->scale.x, 1.0f, 1e-6);
+
+        f64 q[4];
+        reference_slerp(q, recorded_rotation(i, from), recorded_rotation(i, to), t);
+        for (u32 k = 0; k < 4; k++) {
+            assert_float_equal(transform->rotation.raw[k], q[k], 1e-4);
+        }
+    }
+}
+
+static void check_blend(WorldStorage storage) {
+    entity_id entities[ENTITY_COUNT];
+    World world = make_world(storage, entities);
+    for (u32 sample = 0; sample < 4; sample++) {
+        record(&world, entities, sample);
+    }
+
+    // render time is one behind
+    const f32 times[] = {3.25f, 2.5f, 1.0f, 3.999f};
+    for (u32 i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+        interpolation_set_time(&world, times[i]);
+        interpolation_apply(&world);
+        f32 render_time = times[i] - 1.0f;
+        u32 from = (u32)render_time;
+        assert_blended(&world, entities, from, from + 1, render_time - (f32)from);
+    }
+
+    world_destroy(&world);
+}
+
+static void test_blend(void **state) {
+    (void)state;
+    check_blend(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_blend_archetype(void **state) {
+    (void)state;
+    check_blend(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void test_outside_of_samples(void **state) {
+    (void)state;
+    entity_id entities[ENTITY_COUNT];
+    World world = make_world(WORLD_STORAGE_COMPONENT_STORE, entities);
+    for (u32 sample = 2; sample < 5; sample++) {
+        record(&world, entities, sample);
+    }
+
+    // before the oldest sample and after the newest, nothing is extrapolated
+    interpolation_set_time(&world, 0.0);
+    interpolation_apply(&world);
+    assert_blended(&world, entities, 2, 2, 0.0f);
+
+    interpolation_set_time(&world, 100.0);
+    interpolation_apply(&world);
+    assert_blended(&world, entities, 4, 4, 0.0f);
+
+    // pushes must move forward
+    *world_get_component(&world, entities[0], Position) = (Position){-1.0f, -1.0f, -1.0f};
+    interpolation_push(&world, 3.0);
+    interpolation_apply(&world);
+    assert_blended(&world, entities, 4, 4, 0.0f);
+
+    world_destroy(&world);
+}
+
+static void test_ring_drops_oldest(void **state) {
+    (void)state;
+    entity_id entities[ENTITY_COUNT];
+    World world = make_world(WORLD_STORAGE_COMPONENT_STORE, entities);
+    for (u32 sample = 0; sample < INTERPOLATION_SAMPLE_COUNT + 3; sample++) {
+        record(&world, entities, sample);
+    }
+
+    // sample 2 is gone, the oldest kept is 3
+    interpolation_set_time(&world, 3.5);
+    interpolation_apply(&world);
+    assert_blended(&world, entities, 3, 3, 0.0f);
+
+    interpolation_set_time(&world, 5.5);
+    interpolation_apply(&world);
+    assert_blended(&world, entities, 4, 5, 0.5f);
+
+    world_destroy(&world);
+}
+
+static void test_new_and_reused_entities(void **state) {
+    (void)state;
+    entity_id entities[ENTITY_COUNT];
+    World world = make_world(WORLD_STORAGE_COMPONENT_STORE, entities);
+    record(&world, entities, 0);
+
+    world_destroy_entity(&world, entities[5]);
+    entity_id reused = world_create_entity(&world);
+    assert_int_equal(entity_get_index(reused), entity_get_index(entities[5]));
+    world_attach_component(&world, reused, Position, ((Position){0}));
+    world_attach_component(&world, reused, LocalTransform, local_transform_identity());
+    entities[5] = reused;
+
+    entity_id fresh = world_create_entity(&world);
+    world_attach_component(&world, fresh, Position, ((Position){7.0f, 8.0f, 9.0f}));
+    record(&world, entities, 1);
+
+    // entities that were not in the older sample snap to the newer one
+    interpolation_set_time(&world, 1.75);
+    interpolation_apply(&world);
+    assert_float_equal(world_get_component(&world, fresh, Position)->x, 7.0f, 1e-6);
+    assert_float_equal(world_get_component(&world, entities[5], Position)->x, recorded_position(5, 1).x, 1e-6);
+    Position a = recorded_position(6, 0);
+    Position b = recorded_position(6, 1);
+    assert_float_equal(world_get_component(&world, entities[6], Position)->x, a.x + (b.x - a.x) * 0.75f, 1e-4);
+
+    // an entity destroyed since the newer sample is not touched
+    world_destroy_entity(&world, fresh);
+    interpolation_apply(&world);
+    assert_false(world_is_valid_entity(&world, fresh));
+
+    world_destroy(&world);
+}
+
+static u32 changed_count;
+
+static void count_changed(void **components) {
+    (void)components;
+    changed_count++;
+}
+
+static void test_world_run_applies(void **state) {
+    (void)state;
+    entity_id entities[ENTITY_COUNT];
+    World world = make_world(WORLD_STORAGE_ARCHETYPE, entities);
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Changed(Position)),
+                         .fn = count_changed,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+    world_run(&world);
+
+    record(&world, entities, 0);
+    record(&world, entities, 1);
+    interpolation_set_time(&world, 1.5);
+    changed_count = 0;
+    world_run(&world);
+
+    assert_blended(&world, entities, 0, 1, 0.5f);
+    assert_int_equal(changed_count, ENTITY_COUNT);
+
+    // the same render time writes the same values, none count as changed
+    changed_count = 0;
+    world_run(&world);
+    assert_int_equal(changed_count, 0);
+
+    world_destroy(&world);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_blend),
+        cmocka_unit_test(test_blend_archetype),
+        cmocka_unit_test(test_outside_of_samples),
+        cmocka_unit_test(test_ring_drops_oldest),
+        cmocka_unit_test(test_new_and_reused_entities),
+        cmocka_unit_test(test_world_run_applies),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -1,4 +1,5 @@
 #include "assets/parsers/json_parser.h"
+#include "core/allocator/arena.h"
 
 #include <setjmp.h> // IWYU pragma: keep
 #include <stdarg.h>
@@ -119,6 +120,27 @@ static void test_json_array(void **state) {
     json_destroy(&result);
 }
 
+static void test_json_arena(void **state) {
+    (void)state;
+
+    Arena arena = arena_new(4096);
+    JsonElement result = {0};
+    const char *document = "{\"names\": [\"a\", \"bc\"], \"count\": 2}";
+    assert_true(json_parse_with_allocator(document, arena_allocator(&arena), &result));
+
+    assert_int_equal(JSON_OBJECT, result.type);
+    assert_true(darray_length(result.object) == 2);
+    assert_string_equal(result.object[0].key, "names");
+    assert_string_equal(result.object[1].key, "count");
+    assert_true(darray_length(result.object[0].value.array) == 2);
+    assert_true(darray_length(result.object[0].value.array[1].string) == 2);
+    assert_ptr_equal(darray_allocator(result.object[0].value.array), arena_allocator(&arena));
+    assert_true(arena_used(&arena) > 0);
+
+    // the whole document goes at once
+    arena_destroy(&arena);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_json_null),
@@ -130,6 +152,7 @@ int main(void) {
         cmocka_unit_test(test_json_negative_exponential),
         cmocka_unit_test(test_json_object),
         cmocka_unit_test(test_json_array),
+        cmocka_unit_test(test_json_arena),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,105 @@
+#include "containers/darray.h"
+#include "core/allocator/allocator.h"
+#include "core/allocator/memory_tracker.h"
+#include "core/defines.h"
+#include "ecs/world.h"
+
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <cmocka.h>
+
+typedef struct {
+    f32 x, y, z;
+} Position;
+
+static void test_tracking_allocator(void **state) {
+    (void)state;
+    Allocator *allocator = memory_tracker_allocator(MEMORY_TAG_UNKNOWN);
+    MemoryStats before = memory_tracker_stats(MEMORY_TAG_UNKNOWN);
+
+    void *small = allocator_allocate(allocator, 8, 8);
+    void *large = allocator_allocate(allocator, 1000, 16);
+    large = allocator_reallocate(allocator, large, 1000, 3000, 16);
+    MemoryStats stats = memory_tracker_stats(MEMORY_TAG_UNKNOWN);
+    assert_int_equal(stats.current_bytes - before.current_bytes, 3008);
+    assert_int_equal(stats.peak_bytes, before.current_bytes + 3008);
+    assert_int_equal(stats.allocations - before.allocations, 2);
+    assert_int_equal(stats.reallocations - before.reallocations, 1);
+
+    allocator_free(allocator, large, 3000);
+    allocator_free(allocator, small, 8);
+    stats = memory_tracker_stats(MEMORY_TAG_UNKNOWN);
+    assert_int_equal(stats.current_bytes, before.current_bytes);
+    // the peak stays where it was
+    assert_int_equal(stats.peak_bytes, before.current_bytes + 3008);
+    assert_int_equal(stats.frees - before.frees, 2);
+}
+
+static void test_histogram(void **state) {
+    (void)state;
+    MemoryStats before = memory_tracker_stats(MEMORY_TAG_NET);
+    memory_tracker_record_allocate(MEMORY_TAG_NET, 15);
+    memory_tracker_record_allocate(MEMORY_TAG_NET, 16);
+    memory_tracker_record_allocate(MEMORY_TAG_NET, 31);
+    memory_tracker_record_allocate(MEMORY_TAG_NET, 1024);
+    memory_tracker_record_allocate(MEMORY_TAG_NET, 1ull << 40);
+
+    MemoryStats stats = memory_tracker_stats(MEMORY_TAG_NET);
+    assert_int_equal(stats.size_histogram[0] - before.size_histogram[0], 1);
+    assert_int_equal(stats.size_histogram[1] - before.size_histogram[1], 2);
+    assert_int_equal(stats.size_histogram[7] - before.size_histogram[7], 1);
+    assert_int_equal(stats.size_histogram[MEMORY_HISTOGRAM_BUCKETS - 1] -
+                         before.size_histogram[MEMORY_HISTOGRAM_BUCKETS - 1],
+                     1);
+
+    memory_tracker_record_free(MEMORY_TAG_NET, 15 + 16 + 31 + 1024 + (1ull << 40));
+    assert_int_equal(memory_tracker_stats(MEMORY_TAG_NET).current_bytes, before.current_bytes);
+}
+
+static void test_tagged_darray_and_world(void **state) {
+    (void)state;
+    Allocator *allocator = memory_tracker_allocator(MEMORY_TAG_ECS);
+    MemoryStats before = memory_tracker_stats(MEMORY_TAG_ECS);
+
+    darray(u32) numbers = darray_new_with(u32, allocator);
+    for (u32 i = 0; i < 100; i++) {
+        darray_push(numbers, i);
+    }
+    World world = world_new_with_allocator(WORLD_STORAGE_COMPONENT_STORE, allocator);
+    world_register_component(&world, Position);
+    for (u32 i = 0; i < 1000; i++) {
+        entity_id entity = world_create_entity(&world);
+        world_attach_component(&world, entity, Position, ((Position){(f32)i, 0.0f, 0.0f}));
+    }
+    assert_true(memory_tracker_stats(MEMORY_TAG_ECS).current_bytes - before.current_bytes > 1000 * sizeof(Position));
+
+    // everything taken through the tag comes back to it
+    world_destroy(&world);
+    darray_destroy(numbers);
+    MemoryStats stats = memory_tracker_stats(MEMORY_TAG_ECS);
+    assert_int_equal(stats.current_bytes, before.current_bytes);
+    assert_true(stats.frees > before.frees);
+}
+
+static void test_memory_tag_allocator(void **state) {
+    (void)state;
+    if (SE_MEMORY_TRACKING && memory_tracker_enabled()) {
+        assert_ptr_equal(memory_tag_allocator(MEMORY_TAG_JSON), memory_tracker_allocator(MEMORY_TAG_JSON));
+    } else {
+        assert_null(memory_tag_allocator(MEMORY_TAG_JSON));
+    }
+    assert_string_equal(memory_tag_name(MEMORY_TAG_TEXTURE), "texture");
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_tracking_allocator),
+        cmocka_unit_test(test_histogram),
+        cmocka_unit_test(test_tagged_darray_and_world),
+        cmocka_unit_test(test_memory_tag_allocator),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,157 @@
+#include "containers/mpmc_queue.h"
+#include "core/defines.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmocka.h>
+
+#define STRESS_THREADS 4
+#define STRESS_ITEMS_PER_PRODUCER 100000
+
+typedef struct {
+    u32 producer;
+    u32 sequence;
+} Item;
+
+typedef struct {
+    MpmcQueue *queue;
+    u32 index;
+    atomic u32 *consumed;
+    u64 sum;
+    b8 in_order;
+} StressThread;
+
+static void test_push_pop(void **state) {
+    (void)state;
+    MpmcQueue queue = mpmc_queue_new(5, sizeof(u64));
+    assert_int_equal(mpmc_queue_capacity(&queue), 8);
+
+    u64 value;
+    assert_false(mpmc_queue_try_pop(&queue, &value));
+    for (u64 i = 0; i < 8; i++) {
+        assert_true(mpmc_queue_try_push(&queue, &i));
+    }
+    u64 extra = 8;
+    assert_false(mpmc_queue_try_push(&queue, &extra));
+
+    // wraps around several times, first in first out
+    for (u64 i = 8; i < 100; i++) {
+        assert_true(mpmc_queue_try_pop(&queue, &value));
+        assert_int_equal(value, i - 8);
+        assert_true(mpmc_queue_try_push(&queue, &i));
+    }
+    for (u64 i = 92; i < 100; i++) {
+        assert_true(mpmc_queue_try_pop(&queue, &value));
+        assert_int_equal(value, i);
+    }
+    assert_false(mpmc_queue_try_pop(&queue, &value));
+
+    mpmc_queue_destroy(&queue);
+}
+
+static void test_odd_element_size(void **state) {
+    (void)state;
+    typedef struct {
+        u8 bytes[13];
+    } Odd;
+    MpmcQueue queue = mpmc_queue_new(4, sizeof(Odd));
+    for (u8 i = 0; i < 4; i++) {
+        Odd odd;
+        for (u8 j = 0; j < 13; j++) {
+            odd.bytes[j] = (u8)(i * 13 + j);
+        }
+        assert_true(mpmc_queue_try_push(&queue, &odd));
+    }
+    for (u8 i = 0; i < 4; i++) {
+        Odd odd;
+        assert_true(mpmc_queue_try_pop(&queue, &odd));
+        for (u8 j = 0; j < 13; j++) {
+            assert_int_equal(odd.bytes[j], i * 13 + j);
+        }
+    }
+    mpmc_queue_destroy(&queue);
+}
+
+static void *produce(void *data) {
+    StressThread *thread = data;
+    for (u32 i = 0; i < STRESS_ITEMS_PER_PRODUCER; i++) {
+        Item item = {thread->index, i};
+        while (!mpmc_queue_try_push(thread->queue, &item)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *consume(void *data) {
+    StressThread *thread = data;
+    u32 last[STRESS_THREADS];
+    for (u32 i = 0; i < STRESS_THREADS; i++) {
+        last[i] = UINT32_MAX;
+    }
+    while (atomic_load(thread->consumed) < STRESS_THREADS * STRESS_ITEMS_PER_PRODUCER) {
+        Item item;
+        if (!mpmc_queue_try_pop(thread->queue, &item)) {
+            sched_yield();
+            continue;
+        }
+        atomic_fetch_add(thread->consumed, 1);
+        // one producer's items reach every consumer in the order they were
+        // pushed
+        if (last[item.producer] != UINT32_MAX && item.sequence <= last[item.producer]) {
+            thread->in_order = false;
+        }
+        last[item.producer] = item.sequence;
+        thread->sum += item.sequence;
+    }
+    return NULL;
+}
+
+static void test_stress(void **state) {
+    (void)state;
+    MpmcQueue queue = mpmc_queue_new(64, sizeof(Item));
+    atomic u32 consumed = 0;
+
+    StressThread producers[STRESS_THREADS];
+    StressThread consumers[STRESS_THREADS];
+    pthread_t threads[2 * STRESS_THREADS];
+    for (u32 i = 0; i < STRESS_THREADS; i++) {
+        producers[i] = (StressThread){.queue = &queue, .index = i};
+        consumers[i] = (StressThread){.queue = &queue, .index = i, .consumed = &consumed, .in_order = true};
+        pthread_create(&threads[i], NULL, produce, &producers[i]);
+        pthread_create(&threads[STRESS_THREADS + i], NULL, consume, &consumers[i]);
+    }
+    for (u32 i = 0; i < 2 * STRESS_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // every item arrived exactly once
+    u64 sum = 0;
+    for (u32 i = 0; i < STRESS_THREADS; i++) {
+        assert_true(consumers[i].in_order);
+        sum += consumers[i].sum;
+    }
+    u64 expected = (u64)STRESS_THREADS * STRESS_ITEMS_PER_PRODUCER * (STRESS_ITEMS_PER_PRODUCER - 1) / 2;
+    assert_int_equal(sum, expected);
+    assert_int_equal(consumed, STRESS_THREADS * STRESS_ITEMS_PER_PRODUCER);
+    Item item;
+    assert_false(mpmc_queue_try_pop(&queue, &item));
+
+    mpmc_queue_destroy(&queue);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_push_pop),
+        cmocka_unit_test(test_odd_element_size),
+        cmocka_unit_test(test_stress),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,521 @@
+#include "core/defines.h"
+#include "ecs/entity.h"
+#include "ecs/interpolation.h"
+#include "ecs/query.h"
+#include "ecs/system.h"
+#include "ecs/transform.h"
+#include "ecs/world.h"
+#include "net/replication.h"
+
+#include <math.h>
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <cmocka.h>
+
+typedef struct {
+    int x, y, z;
+} Position;
+
+typedef struct {
+    int dx, dy, dz;
+} Velocity;
+
+// registered on both ends but not replicated
+typedef struct {
+    int value;
+} Secret;
+
+#define ENTITY_COUNT 2000
+
+typedef struct {
+    World server_world;
+    World client_world;
+    ReplicationServer *server;
+    ReplicationClient *client;
+    entity_id entities[ENTITY_COUNT];
+} Fixture;
+
+// too large for the stack
+static Fixture fixture_storage;
+
+static void register_components(World *world) {
+    world_set_component_flags(world, world_register_component(world, Position), COMPONENT_FLAG_REPLICATED);
+    world_set_component_flags(world, world_register_component(world, Velocity), COMPONENT_FLAG_REPLICATED);
+    world_register_component(world, Secret);
+}
+
+static void fixture_init(Fixture *fixture, WorldStorage storage, u32 bytes_per_update) {
+    fixture->server_world = world_new_with_storage(storage);
+    fixture->client_world = world_new_with_storage(storage);
+    register_components(&fixture->server_world);
+    register_components(&fixture->client_world);
+
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        entity_id e = world_create_entity(&fixture->server_world);
+        fixture->entities[i] = e;
+        world_attach_component(&fixture->server_world, e, Position, ((Position){i, 2 * i, 3 * i}));
+        if (i % 2 == 0) {
+            world_attach_component(&fixture->server_world, e, Velocity, ((Velocity){1, -1, i}));
+        }
+        world_attach_component(&fixture->server_world, e, Secret, ((Secret){i}));
+    }
+
+    fixture->server = replication_server_new(&fixture->server_world,
+                                             (ReplicationServerConfig){.bytes_per_update = bytes_per_update});
+    assert_non_null(fixture->server);
+    fixture->client =
+        replication_client_new(&fixture->client_world, net_address_loopback(replication_server_port(fixture->server)));
+    assert_non_null(fixture->client);
+}
+
+static void fixture_destroy(Fixture *fixture) {
+    replication_client_destroy(fixture->client);
+    replication_server_destroy(fixture->server);
+    world_destroy(&fixture->client_world);
+    world_destroy(&fixture->server_world);
+}
+
+// Runs both ends until the client shows the server world as it is now
+static void sync(Fixture *fixture) {
+    replication_server_update(fixture->server);
+    u32 target = replication_server_sequence(fixture->server);
+    for (int i = 0; i < 1000; i++) {
+        replication_client_update(fixture->client);
+        if (replication_client_sequence(fixture->client) >= target) {
+            return;
+        }
+        replication_server_update(fixture->server);
+    }
+    fail_msg("client did not catch up");
+}
+
+static void assert_replicated(const Fixture *fixture) {
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        entity_id e = fixture->entities[i];
+        entity_id local = replication_client_local_entity(fixture->client, e);
+        if (!world_is_valid_entity(&fixture->server_world, e)) {
+            assert_true(local == ENTITY_INVALID);
+            continue;
+        }
+
+        assert_true(world_is_valid_entity(&fixture->client_world, local));
+        const Position *p = world_get_component(&fixture->server_world, e, Position);
+        const Position *q = world_get_component(&fixture->client_world, local, Position);
+        assert_non_null(q);
+        assert_memory_equal(p, q, sizeof(Position));
+
+        const Velocity *v = world_get_component(&fixture->server_world, e, Velocity);
+        const Velocity *w = world_get_component(&fixture->client_world, local, Velocity);
+        if (v != NULL) {
+            assert_non_null(w);
+            assert_memory_equal(v, w, sizeof(Velocity));
+        } else {
+            assert_null(w);
+        }
+
+        assert_null(world_get_component(&fixture->client_world, local, Secret));
+    }
+}
+
+static void check_initial_state(WorldStorage storage) {
+    Fixture *fixture = &fixture_storage;
+    fixture_init(fixture, storage, 0);
+
+    sync(fixture);
+    assert_int_equal(replication_server_client_count(fixture->server), 1);
+    assert_replicated(fixture);
+
+    fixture_destroy(fixture);
+}
+
+static void test_initial_state(void **state) {
+    (void)state;
+    check_initial_state(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_initial_state_archetype(void **state) {
+    (void)state;
+    check_initial_state(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void check_changes(WorldStorage storage) {
+    Fixture *fixture = &fixture_storage;
+    fixture_init(fixture, storage, 0);
+    World *world = &fixture->server_world;
+    sync(fixture);
+
+    for (int i = 0; i < ENTITY_COUNT; i += 7) {
+        world_get_component(world, fixture->entities[i], Position)->y += 1000;
+    }
+    for (int i = 1; i < ENTITY_COUNT; i += 10) {
+        world_destroy_entity(world, fixture->entities[i]);
+    }
+    for (int i = 0; i < ENTITY_COUNT; i += 8) {
+        world_detach_component(world, fixture->entities[i], Velocity);
+    }
+    for (int i = 3; i < ENTITY_COUNT; i += 10) {
+        world_attach_component(world, fixture->entities[i], Velocity, ((Velocity){7, 8, 9}));
+    }
+    sync(fixture);
+    assert_replicated(fixture);
+
+    // the destroyed slots are reused by entities the client has not seen
+    for (int i = 1; i < ENTITY_COUNT; i += 10) {
+        entity_id e = world_create_entity(world);
+        world_attach_component(world, e, Position, ((Position){-i, -i, -i}));
+        fixture->entities[i] = e;
+    }
+    sync(fixture);
+    assert_replicated(fixture);
+
+    fixture_destroy(fixture);
+}
+
+static void test_changes(void **state) {
+    (void)state;
+    check_changes(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_changes_archetype(void **state) {
+    (void)state;
+    check_changes(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void test_delta_size(void **state) {
+    (void)state;
+    Fixture *fixture = &fixture_storage;
+    fixture_init(fixture, WORLD_STORAGE_COMPONENT_STORE, 0);
+    sync(fixture);
+    u32 full_bytes = (u32)replication_server_stats(fixture->server).bytes_sent;
+
+    // nothing changed: one packet with an empty entry list
+    sync(fixture);
+    assert_true(replication_server_stats(fixture->server).update_bytes < 32);
+
+    world_get_component(&fixture->server_world, fixture->entities[100], Position)->x = 12345;
+    sync(fixture);
+    assert_true(replication_server_stats(fixture->server).update_bytes < 48);
+    assert_true(full_bytes > ENTITY_COUNT * sizeof(Position));
+    assert_replicated(fixture);
+
+    fixture_destroy(fixture);
+}
+
+static void test_bandwidth_limit(void **state) {
+    (void)state;
+    Fixture *fixture = &fixture_storage;
+    fixture_init(fixture, WORLD_STORAGE_COMPONENT_STORE, 4096);
+
+    // the entities are spread over several updates
+    replication_client_update(fixture->client);
+    u32 updates = 0;
+    do {
+        replication_server_update(fixture->server);
+        assert_true(replication_server_stats(fixture->server).update_bytes <= 4096);
+        replication_client_update(fixture->client);
+        updates++;
+    } while (replication_server_stats(fixture->server).deferred_entities != 0);
+    assert_true(updates > 4);
+
+    sync(fixture);
+    assert_replicated(fixture);
+
+    fixture_destroy(fixture);
+}
+
+static void test_snapshots_in_flight(void **state) {
+    (void)state;
+    Fixture *fixture = &fixture_storage;
+    fixture_init(fixture, WORLD_STORAGE_COMPONENT_STORE, 4000);
+
+    // the server sends twice between client updates, so every snapshot is
+    // sent while the one before it is still unacknowledged
+    replication_client_update(fixture->client);
+    for (int update = 0; update < 1000 && darray_length(fixture->client_world.generations) < ENTITY_COUNT; update++) {
+        replication_server_update(fixture->server);
+        replication_server_update(fixture->server);
+        replication_client_update(fixture->client);
+
+        // nothing is destroyed on the server, so a later snapshot must not
+        // destroy what an earlier one created
+        for (u32 i = 0; i < darray_length(fixture->client_world.generations); i++) {
+            assert_int_equal(fixture->client_world.generations[i], 0);
+        }
+    }
+
+    sync(fixture);
+    assert_replicated(fixture);
+
+    fixture_destroy(fixture);
+}
+
+static u32 simulate_count;
+static u32 render_count;
+
+static void simulate(void **components) {
+    ((Position *)components[0])->x++;
+    simulate_count++;
+}
+
+static void render(void **components) {
+    (void)components;
+    render_count++;
+}
+
+static void add_systems(World *world) {
+    world_add_system(world,
+                     (SystemInfo){
+                         .query = query_new(Write(Position)),
+                         .fn = simulate,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                         .flags = SYSTEM_FLAG_NETWORKED,
+                     });
+    world_add_system(world,
+                     (SystemInfo){
+                         .query = query_new(Read(Position)),
+                         .fn = render,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+}
+
+static void test_networked_systems(void **state) {
+    (void)state;
+    Fixture *fixture = &fixture_storage;
+    fixture_init(fixture, WORLD_STORAGE_COMPONENT_STORE, 0);
+    add_systems(&fixture->server_world);
+    add_systems(&fixture->client_world);
+    assert_true(fixture->client_world.is_replica);
+
+    world_run(&fixture->server_world);
+    assert_int_equal(simulate_count, ENTITY_COUNT);
+    assert_int_equal(render_count, ENTITY_COUNT);
+
+    simulate_count = 0;
+    render_count = 0;
+    sync(fixture);
+    world_run(&fixture->client_world);
+    assert_int_equal(simulate_count, 0);
+    assert_int_equal(render_count, ENTITY_COUNT);
+    assert_replicated(fixture);
+
+    fixture_destroy(fixture);
+}
+
+#define LINE_LENGTH 200
+
+// Entities on the x axis at x = i, replicated with their LocalTransform
+typedef struct {
+    World server_world;
+    World client_world;
+    ReplicationServer *server;
+    ReplicationClient *client;
+    NetAddress client_address;
+    entity_id entities[LINE_LENGTH];
+} LineFixture;
+
+static LineFixture line_storage;
+
+static void line_init(LineFixture *fixture, ReplicationServerConfig config) {
+    fixture->server_world = world_new();
+    fixture->client_world = world_new();
+    transform_enable(&fixture->server_world);
+    transform_enable(&fixture->client_world);
+    world_set_component_flags(&fixture->server_world, component_id(LocalTransform), COMPONENT_FLAG_REPLICATED);
+    world_set_component_flags(&fixture->client_world, component_id(LocalTransform), COMPONENT_FLAG_REPLICATED);
+
+    for (u32 i = 0; i < LINE_LENGTH; i++) {
+        entity_id e = world_create_entity(&fixture->server_world);
+        LocalTransform transform = local_transform_identity();
+        transform.translation.x = (f32)i;
+        world_attach_component(&fixture->server_world, e, LocalTransform, transform);
+        world_attach_component(&fixture->server_world, e, GlobalTransform, ((GlobalTransform){mat4_identity()}));
+        fixture->entities[i] = e;
+    }
+    world_run(&fixture->server_world);
+
+    fixture->server = replication_server_new(&fixture->server_world, config);
+    assert_non_null(fixture->server);
+    fixture->client =
+        replication_client_new(&fixture->client_world, net_address_loopback(replication_server_port(fixture->server)));
+    assert_non_null(fixture->client);
+    fixture->client_address = net_address_loopback(replication_client_port(fixture->client));
+}
+
+static void line_destroy(LineFixture *fixture) {
+    replication_client_destroy(fixture->client);
+    replication_server_destroy(fixture->server);
+    world_destroy(&fixture->client_world);
+    world_destroy(&fixture->server_world);
+}
+
+static void line_sync(LineFixture *fixture) {
+    replication_server_update(fixture->server);
+    u32 target = replication_server_sequence(fixture->server);
+    for (int i = 0; i < 1000; i++) {
+        replication_client_update(fixture->client);
+        if (replication_client_sequence(fixture->client) >= target) {
+            return;
+        }
+        replication_server_update(fixture->server);
+    }
+    fail_msg("client did not catch up");
+}
+
+// The client holds exactly the entities within `radius` of `focus`
+static void assert_relevant(const LineFixture *fixture, f32 focus, f32 radius) {
+    for (u32 i = 0; i < LINE_LENGTH; i++) {
+        entity_id e = fixture->entities[i];
+        entity_id local = replication_client_local_entity(fixture->client, e);
+        if (!world_is_valid_entity(&fixture->server_world, e)) {
+            assert_true(local == ENTITY_INVALID);
+            continue;
+        }
+
+        const LocalTransform *transform = world_get_component(&fixture->server_world, e, LocalTransform);
+        if (fabsf(transform->translation.x - focus) > radius) {
+            assert_true(local == ENTITY_INVALID);
+            continue;
+        }
+
+        const LocalTransform *replicated = world_get_component(&fixture->client_world, local, LocalTransform);
+        assert_non_null(replicated);
+        assert_memory_equal(transform, replicated, sizeof(LocalTransform));
+    }
+}
+
+static void test_relevance(void **state) {
+    (void)state;
+    LineFixture *fixture = &line_storage;
+    line_init(fixture, (ReplicationServerConfig){.relevance_radius = 10.5f, .cell_size = 4.0f});
+
+    // clients see around the origin until their focus is set
+    line_sync(fixture);
+    assert_relevant(fixture, 0.0f, 10.5f);
+    assert_true(replication_server_set_focus(fixture->server, fixture->client_address, (vec3s){{50.0f, 0.0f, 0.0f}}));
+    assert_false(replication_server_set_focus(fixture->server, net_address_loopback(1), vec3_zero()));
+    line_sync(fixture);
+    assert_relevant(fixture, 50.0f, 10.5f);
+
+    // entities leave and enter the range as they move
+    World *world = &fixture->server_world;
+    world_get_component(world, fixture->entities[45], LocalTransform)->translation.x = 150.0f;
+    world_get_component(world, fixture->entities[120], LocalTransform)->translation.x = 55.5f;
+    world_mark_changed(world, fixture->entities[45], LocalTransform);
+    world_mark_changed(world, fixture->entities[120], LocalTransform);
+    world_run(world);
+    line_sync(fixture);
+    assert_relevant(fixture, 50.0f, 10.5f);
+
+    // and as the focus moves
+    replication_server_set_focus(fixture->server, fixture->client_address, (vec3s){{148.0f, 0.0f, 0.0f}});
+    line_sync(fixture);
+    assert_relevant(fixture, 148.0f, 10.5f);
+
+    // destroyed entities are removed
+    world_destroy_entity(world, fixture->entities[150]);
+    line_sync(fixture);
+    assert_relevant(fixture, 148.0f, 10.5f);
+
+    line_destroy(fixture);
+}
+
+static void test_nearest_first(void **state) {
+    (void)state;
+    LineFixture *fixture = &line_storage;
+    line_init(fixture, (ReplicationServerConfig){.relevance_radius = 1000.0f, .bytes_per_update = 1024});
+
+    replication_client_update(fixture->client);
+    replication_server_update(fixture->server);
+    replication_client_update(fixture->client);
+
+    // the budget was spent on the entities nearest to the focus
+    u32 received = 0;
+    while (received < LINE_LENGTH &&
+           replication_client_local_entity(fixture->client, fixture->entities[received]) != ENTITY_INVALID) {
+        received++;
+    }
+    assert_true(received > 0 && received < LINE_LENGTH);
+    for (u32 i = received; i < LINE_LENGTH; i++) {
+        assert_true(replication_client_local_entity(fixture->client, fixture->entities[i]) == ENTITY_INVALID);
+    }
+
+    // far entities are not starved
+    while (replication_server_stats(fixture->server).deferred_entities != 0) {
+        replication_server_update(fixture->server);
+        replication_client_update(fixture->client);
+    }
+    line_sync(fixture);
+    assert_relevant(fixture, 0.0f, 1000.0f);
+
+    line_destroy(fixture);
+}
+
+typedef struct {
+    f32 angle;
+} Heading;
+
+static World make_heading_world(void) {
+    World world = world_new();
+    world_set_component_flags(&world,
+                              world_register_component(&world, Heading),
+                              COMPONENT_FLAG_REPLICATED | COMPONENT_FLAG_INTERPOLATE);
+    return world;
+}
+
+static void test_interpolated_components(void **state) {
+    (void)state;
+    World server_world = make_heading_world();
+    World client_world = make_heading_world();
+    interpolation_enable(&client_world, 1.0);
+
+    entity_id e = world_create_entity(&server_world);
+    world_attach_component(&server_world, e, Heading, ((Heading){0.0f}));
+    ReplicationServer *server = replication_server_new(&server_world, (ReplicationServerConfig){0});
+    ReplicationClient *client =
+        replication_client_new(&client_world, net_address_loopback(replication_server_port(server)));
+
+    u32 sequences[2];
+    for (u32 i = 0; i < 2; i++) {
+        world_get_component(&server_world, e, Heading)->angle = 10.0f * (f32)i;
+        replication_server_update(server);
+        u32 target = replication_server_sequence(server);
+        replication_client_update(client);
+        while (replication_client_sequence(client) < target) {
+            replication_server_update(server);
+            replication_client_update(client);
+        }
+        sequences[i] = replication_client_sequence(client);
+    }
+
+    // every applied snapshot was pushed, render time falls between the two
+    f64 between = sequences[0] + (sequences[1] - sequences[0]) * 0.25;
+    interpolation_set_time(&client_world, between + 1.0);
+    world_run(&client_world);
+    entity_id local = replication_client_local_entity(client, e);
+    assert_float_equal(world_get_component(&client_world, local, Heading)->angle, 2.5f, 1e-4);
+
+    replication_client_destroy(client);
+    replication_server_destroy(server);
+    world_destroy(&client_world);
+    world_destroy(&server_world);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_initial_state),
+        cmocka_unit_test(test_initial_state_archetype),
+        cmocka_unit_test(test_changes),
+        cmocka_unit_test(test_changes_archetype),
+        cmocka_unit_test(test_delta_size),
+        cmocka_unit_test(test_bandwidth_limit),
+        cmocka_unit_test(test_snapshots_in_flight),
+        cmocka_unit_test(test_networked_systems),
+        cmocka_unit_test(test_relevance),
+        cmocka_unit_test(test_nearest_first),
+        cmocka_unit_test(test_interpolated_components),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,239 @@
+#include "core/defines.h"
+#include "ecs/entity.h"
+#include "ecs/query.h"
+#include "ecs/snapshot.h"
+#include "ecs/system.h"
+#include "ecs/world.h"
+
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <cmocka.h>
+
+typedef struct {
+    int pos;
+} Position;
+
+typedef struct {
+    int vel;
+} Velocity;
+
+#define ENTITY_COUNT 1000
+
+static u32 changed_count;
+
+static void count_changed(void **components) {
+    (void)components;
+    changed_count++;
+}
+
+static World make_world(WorldStorage storage, entity_id *entities) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        entities[i] = world_create_entity(&world);
+        world_attach_component(&world, entities[i], Position, ((Position){i}));
+        if (i % 2 == 0) {
+            world_attach_component(&world, entities[i], Velocity, ((Velocity){-i}));
+        }
+    }
+    return world;
+}
+
+static void assert_initial_state(const World *world, const entity_id *entities) {
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        assert_true(world_is_valid_entity(world, entities[i]));
+        assert_int_equal(world_get_component(world, entities[i], Position)->pos, i);
+        const Velocity *v = world_get_component(world, entities[i], Velocity);
+        if (i % 2 == 0) {
+            assert_non_null(v);
+            assert_int_equal(v->vel, -i);
+        } else {
+            assert_null(v);
+        }
+    }
+}
+
+static void check_restore(WorldStorage storage) {
+    static entity_id entities[ENTITY_COUNT];
+    World world = make_world(storage, entities);
+
+    WorldSnapshot snapshot = {0};
+    world_snapshot_capture(&world, NULL, &snapshot);
+    assert_false(world_snapshot_is_delta(&snapshot));
+
+    // values, structure and entity slots all change
+    for (int i = 0; i < ENTITY_COUNT; i += 3) {
+        world_get_component(&world, entities[i], Position)->pos = -1;
+    }
+    for (int i = 0; i < ENTITY_COUNT; i += 7) {
+        world_destroy_entity(&world, entities[i]);
+    }
+    for (int i = 1; i < ENTITY_COUNT; i += 4) {
+        world_attach_component(&world, entities[i], Velocity, ((Velocity){100}));
+    }
+    entity_id created = world_create_entity(&world);
+    world_attach_component(&world, created, Position, ((Position){7}));
+
+    world_snapshot_restore(&world, &snapshot, NULL);
+
+    assert_initial_state(&world, entities);
+    assert_false(world_is_valid_entity(&world, created));
+
+    // no slot was free when the snapshot was taken
+    entity_id next = world_create_entity(&world);
+    assert_int_equal(entity_get_index(next), ENTITY_COUNT);
+    assert_null(world_get_component(&world, next, Position));
+
+    world_snapshot_destroy(&snapshot);
+    world_destroy(&world);
+}
+
+static void test_restore(void **state) {
+    (void)state;
+    check_restore(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_restore_archetype(void **state) {
+    (void)state;
+    check_restore(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void check_delta(WorldStorage storage) {
+    static entity_id entities[ENTITY_COUNT];
+    World world = make_world(storage, entities);
+
+    WorldSnapshot base = {0};
+    world_snapshot_capture(&world, NULL, &base);
+
+    // nothing changed, the delta is only headers
+    WorldSnapshot delta = {0};
+    world_snapshot_capture(&world, &base, &delta);
+    assert_true(world_snapshot_is_delta(&delta));
+    assert_true(delta.size < ENTITY_COUNT * sizeof(Position));
+
+    for (int i = 0; i < ENTITY_COUNT; i += 2) {
+        world_get_component(&world, entities[i], Velocity)->vel = 1;
+    }
+    world_snapshot_capture(&world, &base, &delta);
+    assert_true(delta.size < base.size);
+
+    // back to the base, then forward to the delta
+    world_snapshot_restore(&world, &base, NULL);
+    assert_initial_state(&world, entities);
+
+    world_snapshot_restore(&world, &delta, &base);
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        assert_int_equal(world_get_component(&world, entities[i], Position)->pos, i);
+        if (i % 2 == 0) {
+            assert_int_equal(world_get_component(&world, entities[i], Velocity)->vel, 1);
+        }
+    }
+
+    world_snapshot_destroy(&delta);
+    world_snapshot_destroy(&base);
+    world_destroy(&world);
+}
+
+static void test_delta(void **state) {
+    (void)state;
+    check_delta(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_delta_archetype(void **state) {
+    (void)state;
+    check_delta(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void check_restore_into_new_world(WorldStorage storage) {
+    static entity_id entities[ENTITY_COUNT];
+    World world = make_world(storage, entities);
+
+    WorldSnapshot snapshot = {0};
+    world_snapshot_capture(&world, NULL, &snapshot);
+    world_destroy(&world);
+
+    // archetypes are created in a different order than in the captured world
+    World loaded = world_new_with_storage(storage);
+    world_register_component(&loaded, Position);
+    world_register_component(&loaded, Velocity);
+    entity_id other = world_create_entity(&loaded);
+    world_attach_component(&loaded, other, Velocity, ((Velocity){0}));
+    world_attach_component(&loaded, other, Position, ((Position){0}));
+
+    world_snapshot_restore(&loaded, &snapshot, NULL);
+    assert_initial_state(&loaded, entities);
+
+    world_snapshot_destroy(&snapshot);
+    world_destroy(&loaded);
+}
+
+static void test_restore_into_new_world(void **state) {
+    (void)state;
+    check_restore_into_new_world(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_restore_into_new_world_archetype(void **state) {
+    (void)state;
+    check_restore_into_new_world(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void check_restore_marks_changed(WorldStorage storage) {
+    static entity_id entities[ENTITY_COUNT];
+    World world = make_world(storage, entities);
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Changed(Velocity)),
+                         .fn = count_changed,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+    world_run(&world);
+
+    WorldSnapshot snapshot = {0};
+    world_snapshot_capture(&world, NULL, &snapshot);
+
+    // restoring what is already there changes nothing
+    world_snapshot_restore(&world, &snapshot, NULL);
+    changed_count = 0;
+    world_run(&world);
+    assert_int_equal(changed_count, 0);
+
+    world_get_component(&world, entities[0], Velocity)->vel = 5;
+    world_snapshot_restore(&world, &snapshot, NULL);
+    assert_int_equal(world_get_component(&world, entities[0], Velocity)->vel, 0);
+
+    changed_count = 0;
+    world_run(&world);
+    assert_true(changed_count > 0);
+
+    world_snapshot_destroy(&snapshot);
+    world_destroy(&world);
+}
+
+static void test_restore_marks_changed(void **state) {
+    (void)state;
+    check_restore_marks_changed(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_restore_marks_changed_archetype(void **state) {
+    (void)state;
+    check_restore_marks_changed(WORLD_STORAGE_ARCHETYPE);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_restore),
+        cmocka_unit_test(test_restore_archetype),
+        cmocka_unit_test(test_delta),
+        cmocka_unit_test(test_delta_archetype),
+        cmocka_unit_test(test_restore_into_new_world),
+        cmocka_unit_test(test_restore_into_new_world_archetype),
+        cmocka_unit_test(test_restore_marks_changed),
+        cmocka_unit_test(test_restore_marks_changed_archetype),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
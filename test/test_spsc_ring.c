@@ -0,0 +1,157 @@
+#include "containers/spsc_ring.h"
+#include "core/defines.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <cmocka.h>
+
+#define STRESS_ELEMENTS 1000000
+#define STRESS_MESSAGES 200000
+#define MAX_MESSAGE_SIZE 200
+
+static void test_push_pop(void **state) {
+    (void)state;
+    SpscRing ring = spsc_ring_new(3, sizeof(u32));
+    assert_int_equal(spsc_ring_capacity(&ring), 4);
+
+    u32 value;
+    assert_false(spsc_ring_try_pop(&ring, &value));
+    for (u32 i = 0; i < 4; i++) {
+        assert_true(spsc_ring_try_push(&ring, &i));
+    }
+    value = 4;
+    assert_false(spsc_ring_try_push(&ring, &value));
+
+    for (u32 i = 4; i < 50; i++) {
+        u32 popped;
+        assert_true(spsc_ring_try_pop(&ring, &popped));
+        assert_int_equal(popped, i - 4);
+        assert_true(spsc_ring_try_push(&ring, &i));
+    }
+    for (u32 i = 46; i < 50; i++) {
+        assert_true(spsc_ring_try_pop(&ring, &value));
+        assert_int_equal(value, i);
+    }
+    assert_false(spsc_ring_try_pop(&ring, &value));
+
+    spsc_ring_destroy(&ring);
+}
+
+static void test_messages(void **state) {
+    (void)state;
+    SpscRing ring = spsc_ring_new_bytes(32);
+    char out[32];
+    u32 size;
+    assert_false(spsc_ring_try_read(&ring, out, sizeof(out), &size));
+    assert_int_equal(size, 0);
+
+    // 4 + 10 bytes each, the third wraps around the end of the buffer
+    assert_true(spsc_ring_try_write(&ring, "0123456789", 10));
+    assert_true(spsc_ring_try_write(&ring, "abcdefghij", 10));
+    assert_false(spsc_ring_try_write(&ring, "ABCDEFGHIJ", 10));
+    assert_true(spsc_ring_try_read(&ring, out, sizeof(out), &size));
+    assert_int_equal(size, 10);
+    assert_memory_equal(out, "0123456789", 10);
+    assert_true(spsc_ring_try_write(&ring, "ABCDEFGHIJ", 10));
+
+    // too large for the buffer, stays in the ring until read with room
+    assert_false(spsc_ring_try_read(&ring, out, 4, &size));
+    assert_int_equal(size, 10);
+    assert_true(spsc_ring_try_read(&ring, out, sizeof(out), &size));
+    assert_memory_equal(out, "abcdefghij", 10);
+    assert_true(spsc_ring_try_read(&ring, out, sizeof(out), &size));
+    assert_memory_equal(out, "ABCDEFGHIJ", 10);
+
+    assert_true(spsc_ring_try_write(&ring, "", 0));
+    assert_true(spsc_ring_try_read(&ring, out, sizeof(out), &size));
+    assert_int_equal(size, 0);
+    assert_false(spsc_ring_try_read(&ring, out, sizeof(out), &size));
+
+    spsc_ring_destroy(&ring);
+}
+
+static void *produce_elements(void *data) {
+    SpscRing *ring = data;
+    for (u64 i = 0; i < STRESS_ELEMENTS; i++) {
+        while (!spsc_ring_try_push(ring, &i)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_stress_elements(void **state) {
+    (void)state;
+    SpscRing ring = spsc_ring_new(256, sizeof(u64));
+    pthread_t producer;
+    pthread_create(&producer, NULL, produce_elements, &ring);
+
+    b8 in_order = true;
+    for (u64 i = 0; i < STRESS_ELEMENTS; i++) {
+        u64 value;
+        while (!spsc_ring_try_pop(&ring, &value)) {
+            sched_yield();
+        }
+        in_order &= value == i;
+    }
+    pthread_join(producer, NULL);
+    assert_true(in_order);
+
+    spsc_ring_destroy(&ring);
+}
+
+static u32 message_size(u32 i) { return (i * 7919) % MAX_MESSAGE_SIZE; }
+
+static void *produce_messages(void *data) {
+    SpscRing *ring = data;
+    u8 message[MAX_MESSAGE_SIZE];
+    for (u32 i = 0; i < STRESS_MESSAGES; i++) {
+        u32 size = message_size(i);
+        for (u32 j = 0; j < size; j++) {
+            message[j] = (u8)(i + j);
+        }
+        while (!spsc_ring_try_write(ring, message, size)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_stress_messages(void **state) {
+    (void)state;
+    SpscRing ring = spsc_ring_new_bytes(1024);
+    pthread_t producer;
+    pthread_create(&producer, NULL, produce_messages, &ring);
+
+    b8 intact = true;
+    u8 message[MAX_MESSAGE_SIZE];
+    for (u32 i = 0; i < STRESS_MESSAGES; i++) {
+        u32 size;
+        while (!spsc_ring_try_read(&ring, message, sizeof(message), &size)) {
+            sched_yield();
+        }
+        intact &= size == message_size(i);
+        for (u32 j = 0; j < size; j++) {
+            intact &= message[j] == (u8)(i + j);
+        }
+    }
+    pthread_join(producer, NULL);
+    assert_true(intact);
+
+    spsc_ring_destroy(&ring);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_push_pop),
+        cmocka_unit_test(test_messages),
+        cmocka_unit_test(test_stress_elements),
+        cmocka_unit_test(test_stress_messages),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
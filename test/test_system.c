@@ -1,4 +1,5 @@
 #include "core/defines.h"
+#include "core/job_pool.h"
 #include "ecs/entity.h"
 #include "ecs/query.h"
 #include "ecs/system.h"
@@ -63,12 +64,310 @@ static void test_manual_tick_system_execution(void **state) {
     world_destroy(&world);
 }
 
+static void run_update_system_every_tick(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+
+    entity_id moving = world_create_entity(&world);
+    entity_id still = world_create_entity(&world);
+
+    world_attach_component(&world, moving, Position, ((Position){3}));
+    world_attach_component(&world, moving, Velocity, ((Velocity){2}));
+    world_attach_component(&world, still, Position, ((Position){7}));
+
+    SystemInfo move_system_info = {
+        .query = query_new(Position, Velocity),
+        .fn = move_system,
+        .schedule = SYSTEM_SCHEDULE_UPDATE,
+    };
+
+    world_add_system(&world, move_system_info);
+
+    for (u32 i = 0; i < 3; i++) {
+        world_run(&world);
+    }
+
+    Position *moved = world_get_component(&world, moving, Position);
+    Position *unmoved = world_get_component(&world, still, Position);
+    assert_int_equal(moved->pos, 9);
+    assert_int_equal(unmoved->pos, 7);
+
+    world_destroy(&world);
+}
+
+static void test_update_system_runs_every_tick(void **state) {
+    (void)state;
+    run_update_system_every_tick(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_update_system_runs_every_tick_archetype(void **state) {
+    (void)state;
+    run_update_system_every_tick(WORLD_STORAGE_ARCHETYPE);
+}
+
+#define PARALLEL_ENTITY_COUNT 50000
+
+static void accelerate_system(void **components) {
+    Velocity *v = components[0];
+    v->vel += 1;
+}
+
+static void move_after_accelerate_system(void **components) {
+    Position *p = components[0];
+    const Velocity *v = components[1];
+    p->pos += v->vel;
+}
+
+static void test_query_access_terms(void **state) {
+    (void)state;
+    Query query = query_new(Write(Position), Read(Velocity), Position);
+
+    assert_int_equal(query.count, 3);
+    assert_string_equal(query.names[0], "Position");
+    assert_string_equal(query.names[1], "Velocity");
+    assert_int_equal(query.sizes[1], sizeof(Velocity));
+    assert_int_equal(query.access[0], QUERY_ACCESS_WRITE);
+    assert_int_equal(query.access[1], QUERY_ACCESS_READ);
+    assert_int_equal(query.access[2], QUERY_ACCESS_WRITE);
+
+    query_destroy(&query);
+}
+
+typedef struct {
+    int value;
+} Tag;
+
+static u32 visited_count;
+
+static void count_visited(void **components) {
+    (void)components;
+    visited_count++;
+}
+
+static void test_query_cache_follows_archetypes(void **state) {
+    (void)state;
+    World world = world_new_with_storage(WORLD_STORAGE_ARCHETYPE);
+
+    // added before its components are registered, resolved by registration
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Read(Position), Read(Velocity)),
+                         .fn = count_visited,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Write(Velocity)),
+                         .fn = accelerate_system,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+    assert_false(world.query_caches[0].resolved);
+
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+    world_register_component(&world, Tag);
+    assert_true(world.query_caches[0].resolved);
+
+    // the second system writes a component the first one reads
+    assert_int_equal(darray_length(world.query_caches[0].dependencies), 0);
+    assert_int_equal(darray_length(world.query_caches[1].dependencies), 1);
+    assert_int_equal(world.query_caches[1].dependencies[0], 0);
+
+    entity_id a = world_create_entity(&world);
+    world_attach_component(&world, a, Position, ((Position){0}));
+    assert_int_equal(darray_length(world.query_caches[0].archetypes), 0);
+
+    world_attach_component(&world, a, Velocity, ((Velocity){0}));
+    entity_id b = world_create_entity(&world);
+    world_attach_component(&world, b, Velocity, ((Velocity){0}));
+    world_attach_component(&world, b, Tag, ((Tag){0}));
+    world_attach_component(&world, b, Position, ((Position){0}));
+
+    // {Position, Velocity} and {Position, Velocity, Tag}
+    assert_int_equal(darray_length(world.query_caches[0].archetypes), 2);
+    // plus {Velocity} and {Velocity, Tag}
+    assert_int_equal(darray_length(world.query_caches[1].archetypes), 4);
+
+    visited_count = 0;
+    world_run(&world);
+    world_run(&world);
+    assert_int_equal(visited_count, 4);
+    assert_int_equal(world_get_component(&world, b, Velocity)->vel, 2);
+    assert_int_equal(darray_length(world.query_caches[0].archetypes), 2);
+
+    world_destroy(&world);
+}
+
+static void test_query_filter_terms(void **state) {
+    (void)state;
+    Query query = query_new(With(Tag), Without(Velocity), Optional(Position));
+
+    assert_int_equal(query.filters[0], QUERY_FILTER_WITH);
+    assert_int_equal(query.filters[1], QUERY_FILTER_WITHOUT);
+    assert_int_equal(query.filters[2], QUERY_FILTER_OPTIONAL);
+    assert_int_equal(query.access[2], QUERY_ACCESS_WRITE);
+    assert_true(component_mask_has(&query.mask, component_id(Tag)));
+    assert_false(component_mask_has(&query.mask, component_id(Position)));
+    assert_false(component_mask_has(&query.mask, component_id(Velocity)));
+    assert_true(component_mask_has(&query.excluded, component_id(Velocity)));
+
+    query_destroy(&query);
+}
+
+static u32 tagged_count;
+static u32 joined_count;
+
+static void move_untagged_system(void **components) {
+    Position *p = components[0];
+    assert_null(components[1]);
+    const Velocity *v = components[2];
+    p->pos = v != NULL ? p->pos + v->vel : -1;
+}
+
+static void count_tagged_system(void **components) {
+    assert_non_null(components[0]);
+    assert_null(components[1]);
+    tagged_count++;
+}
+
+static void count_joined_system(void **components) {
+    assert_non_null(components[0]);
+    assert_non_null(components[1]);
+    joined_count++;
+}
+
+static void run_filter_terms(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+    world_register_component(&world, Tag);
+
+    entity_id moving = world_create_entity(&world);
+    entity_id tagged_moving = world_create_entity(&world);
+    entity_id still = world_create_entity(&world);
+    entity_id tagged_still = world_create_entity(&world);
+    world_attach_component(&world, moving, Position, ((Position){1}));
+    world_attach_component(&world, moving, Velocity, ((Velocity){2}));
+    world_attach_component(&world, tagged_moving, Position, ((Position){1}));
+    world_attach_component(&world, tagged_moving, Velocity, ((Velocity){2}));
+    world_attach_component(&world, tagged_moving, Tag, ((Tag){0}));
+    world_attach_component(&world, still, Position, ((Position){1}));
+    world_attach_component(&world, tagged_still, Position, ((Position){1}));
+    world_attach_component(&world, tagged_still, Tag, ((Tag){0}));
+
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Write(Position), Without(Tag), Optional(Velocity)),
+                         .fn = move_untagged_system,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Read(Position), With(Tag)),
+                         .fn = count_tagged_system,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+    // driven from the smaller Velocity store in component store worlds
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Read(Position), Read(Velocity)),
+                         .fn = count_joined_system,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                     });
+
+    tagged_count = 0;
+    joined_count = 0;
+    world_run(&world);
+
+    assert_int_equal(tagged_count, 2);
+    assert_int_equal(joined_count, 2);
+    assert_int_equal(world_get_component(&world, moving, Position)->pos, 3);
+    assert_int_equal(world_get_component(&world, tagged_moving, Position)->pos, 1);
+    assert_int_equal(world_get_component(&world, still, Position)->pos, -1);
+    assert_int_equal(world_get_component(&world, tagged_still, Position)->pos, 1);
+
+    world_destroy(&world);
+}
+
+static void test_filter_terms(void **state) {
+    (void)state;
+    run_filter_terms(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_filter_terms_archetype(void **state) {
+    (void)state;
+    run_filter_terms(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void run_parallel_systems(WorldStorage storage) {
+    JobPool *pool = job_pool_new(4);
+    World world = world_new_with_storage(storage);
+    world_set_job_pool(&world, pool);
+
+    world_register_component(&world, Position);
+    world_register_component(&world, Velocity);
+
+    static entity_id entities[PARALLEL_ENTITY_COUNT];
+    for (int i = 0; i < PARALLEL_ENTITY_COUNT; i++) {
+        entities[i] = world_create_entity(&world);
+        world_attach_component(&world, entities[i], Position, ((Position){0}));
+        world_attach_component(&world, entities[i], Velocity, ((Velocity){i}));
+    }
+
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Write(Velocity)),
+                         .fn = accelerate_system,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                         .flags = SYSTEM_FLAG_PARALLEL,
+                     });
+    world_add_system(&world,
+                     (SystemInfo){
+                         .query = query_new(Write(Position), Read(Velocity)),
+                         .fn = move_after_accelerate_system,
+                         .schedule = SYSTEM_SCHEDULE_UPDATE,
+                         .flags = SYSTEM_FLAG_PARALLEL,
+                     });
+
+    world_run(&world);
+    world_run(&world);
+
+    for (int i = 0; i < PARALLEL_ENTITY_COUNT; i++) {
+        Position *p = world_get_component(&world, entities[i], Position);
+        Velocity *v = world_get_component(&world, entities[i], Velocity);
+        assert_int_equal(v->vel, i + 2);
+        assert_int_equal(p->pos, 2 * i + 3);
+    }
+
+    world_destroy(&world);
+    job_pool_destroy(pool);
+}
+
+static void test_parallel_systems_respect_conflicts(void **state) {
+    (void)state;
+    run_parallel_systems(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_parallel_systems_respect_conflicts_archetype(void **state) {
+    (void)state;
+    run_parallel_systems(WORLD_STORAGE_ARCHETYPE);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_manual_tick_system_execution),
+        cmocka_unit_test(test_update_system_runs_every_tick),
+        cmocka_unit_test(test_update_system_runs_every_tick_archetype),
+        cmocka_unit_test(test_query_access_terms),
+        cmocka_unit_test(test_query_cache_follows_archetypes),
+        cmocka_unit_test(test_query_filter_terms),
+        cmocka_unit_test(test_filter_terms),
+        cmocka_unit_test(test_filter_terms_archetype),
+        cmocka_unit_test(test_parallel_systems_respect_conflicts),
+        cmocka_unit_test(test_parallel_systems_respect_conflicts_archetype),
     };
 
-    UNUSED(tests);
-
-    // return cmocka_run_group_tests(tests, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,381 @@
+#include "core/defines.h"
+#include "ecs/component_id.h"
+#include "ecs/entity.h"
+#include "ecs/transform.h"
+#include "ecs/world.h"
+
+#include <setjmp.h> // IWYU pragma: keep
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <cmocka.h>
+
+#define EPSILON 1e-5
+// enough nodes for transform_propagate to split the roots into several jobs
+#define FOREST_ROOTS 400
+#define FOREST_DEPTH 3
+#define FOREST_FANOUT 4
+
+typedef struct {
+    int health;
+} Health;
+
+static entity_id spawn(World *world, LocalTransform local) {
+    entity_id entity = world_create_entity(world);
+    world_attach_component(world, entity, LocalTransform, local);
+    world_attach_component(world, entity, GlobalTransform, ((GlobalTransform){mat4_identity()}));
+    return entity;
+}
+
+static LocalTransform translated(f32 x, f32 y, f32 z) {
+    LocalTransform local = local_transform_identity();
+    local.translation = (vec3s){{x, y, z}};
+    return local;
+}
+
+static void assert_translation(const World *world, entity_id entity, f32 x, f32 y, f32 z) {
+    const GlobalTransform *global = world_get_component(world, entity, GlobalTransform);
+    assert_float_equal(global->matrix.raw[3][0], x, EPSILON);
+    assert_float_equal(global->matrix.raw[3][1], y, EPSILON);
+    assert_float_equal(global->matrix.raw[3][2], z, EPSILON);
+}
+
+static u32 global_tick(const World *world, entity_id entity) {
+    return *world_get_changed_tick_by_id(world, entity, component_id(GlobalTransform));
+}
+
+static void check_nested_transforms(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    transform_enable(&world);
+
+    // quarter turn around z, then twice the size
+    LocalTransform root_local = translated(1, 0, 0);
+    root_local.rotation = quatv(GLM_PI_2f, (vec3s){{0, 0, 1}});
+    root_local.scale = (vec3s){{2, 2, 2}};
+
+    entity_id root = spawn(&world, root_local);
+    entity_id child = spawn(&world, translated(1, 0, 0));
+    entity_id grandchild = spawn(&world, translated(0, 1, 0));
+    transform_set_parent(&world, child, root);
+    transform_set_parent(&world, grandchild, child);
+
+    world_run(&world);
+
+    assert_translation(&world, root, 1, 0, 0);
+    // (1, 0, 0) scaled to (2, 0, 0), rotated to (0, 2, 0)
+    assert_translation(&world, child, 1, 2, 0);
+    // (0, 1, 0) scaled to (0, 2, 0), rotated to (-2, 0, 0)
+    assert_translation(&world, grandchild, -1, 2, 0);
+
+    // the grandchild's x axis is the root's, rotated and scaled
+    const GlobalTransform *global = world_get_component(&world, grandchild, GlobalTransform);
+    assert_float_equal(global->matrix.raw[0][0], 0, EPSILON);
+    assert_float_equal(global->matrix.raw[0][1], 2, EPSILON);
+
+    world_get_component(&world, root, LocalTransform)->translation = (vec3s){{0, 0, 5}};
+    world_mark_changed(&world, root, LocalTransform);
+    world_run(&world);
+
+    assert_translation(&world, child, 0, 2, 5);
+    assert_translation(&world, grandchild, -2, 2, 5);
+
+    world_destroy(&world);
+}
+
+static void test_nested_transforms(void **state) {
+    (void)state;
+    check_nested_transforms(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_nested_transforms_archetype(void **state) {
+    (void)state;
+    check_nested_transforms(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void check_only_dirty_subtrees(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    transform_enable(&world);
+
+    entity_id a = spawn(&world, translated(1, 0, 0));
+    entity_id a_child = spawn(&world, translated(1, 0, 0));
+    entity_id b = spawn(&world, translated(0, 1, 0));
+    entity_id b_child = spawn(&world, translated(0, 1, 0));
+    entity_id b_leaf = spawn(&world, translated(0, 1, 0));
+    transform_set_parent(&world, a_child, a);
+    transform_set_parent(&world, b_child, b);
+    transform_set_parent(&world, b_leaf, b_child);
+
+    world_run(&world);
+    u32 first = global_tick(&world, a);
+    assert_int_equal(global_tick(&world, b_leaf), first);
+
+    // nothing changed, nothing is written
+    world_run(&world);
+    assert_int_equal(global_tick(&world, a), first);
+    assert_int_equal(global_tick(&world, b_leaf), first);
+
+    // a change in the middle of b's tree reaches below it only
+    world_get_component(&world, b_child, LocalTransform)->translation.x = 3;
+    world_mark_changed(&world, b_child, LocalTransform);
+    world_run(&world);
+
+    assert_int_equal(global_tick(&world, a), first);
+    assert_int_equal(global_tick(&world, a_child), first);
+    assert_int_equal(global_tick(&world, b), first);
+    assert_int_not_equal(global_tick(&world, b_child), first);
+    assert_int_equal(global_tick(&world, b_leaf), global_tick(&world, b_child));
+    assert_translation(&world, b_leaf, 3, 3, 0);
+
+    world_destroy(&world);
+}
+
+static void test_only_dirty_subtrees(void **state) {
+    (void)state;
+    check_only_dirty_subtrees(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_only_dirty_subtrees_archetype(void **state) {
+    (void)state;
+    check_only_dirty_subtrees(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void check_reparenting(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    transform_enable(&world);
+
+    entity_id a = spawn(&world, translated(10, 0, 0));
+    entity_id b = spawn(&world, translated(0, 10, 0));
+    entity_id first = spawn(&world, translated(1, 0, 0));
+    entity_id second = spawn(&world, translated(2, 0, 0));
+    entity_id third = spawn(&world, translated(3, 0, 0));
+    transform_set_parent(&world, first, a);
+    transform_set_parent(&world, second, a);
+    transform_set_parent(&world, third, a);
+    assert_int_equal(world_get_component(&world, a, Children)->count, 3);
+
+    world_run(&world);
+    assert_translation(&world, second, 12, 0, 0);
+
+    // taking one out of the middle of the sibling list keeps the others linked
+    transform_set_parent(&world, second, b);
+    world_run(&world);
+
+    assert_translation(&world, first, 11, 0, 0);
+    assert_translation(&world, second, 2, 10, 0);
+    assert_translation(&world, third, 13, 0, 0);
+    assert_int_equal(world_get_component(&world, a, Children)->count, 2);
+    assert_int_equal(world_get_component(&world, b, Children)->count, 1);
+    assert_true(world_get_component(&world, second, Parent)->entity == b);
+
+    transform_remove_parent(&world, second);
+    world_run(&world);
+
+    assert_translation(&world, second, 2, 0, 0);
+    assert_null(world_get_component(&world, second, Parent));
+    assert_null(world_get_component(&world, b, Children));
+
+    world_destroy(&world);
+}
+
+static void test_reparenting(void **state) {
+    (void)state;
+    check_reparenting(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_reparenting_archetype(void **state) {
+    (void)state;
+    check_reparenting(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void check_destroy_recursive(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    transform_enable(&world);
+
+    entity_id root = spawn(&world, translated(1, 0, 0));
+    entity_id kept = spawn(&world, translated(1, 0, 0));
+    entity_id doomed = spawn(&world, translated(1, 0, 0));
+    entity_id doomed_child = spawn(&world, translated(1, 0, 0));
+    entity_id doomed_leaf = spawn(&world, translated(1, 0, 0));
+    transform_set_parent(&world, kept, root);
+    transform_set_parent(&world, doomed, root);
+    transform_set_parent(&world, doomed_child, doomed);
+    transform_set_parent(&world, doomed_leaf, doomed_child);
+    world_run(&world);
+
+    transform_destroy_recursive(&world, doomed);
+
+    assert_false(world_is_valid_entity(&world, doomed));
+    assert_false(world_is_valid_entity(&world, doomed_child));
+    assert_false(world_is_valid_entity(&world, doomed_leaf));
+    assert_true(world_is_valid_entity(&world, kept));
+
+    const Children *children = world_get_component(&world, root, Children);
+    assert_int_equal(children->count, 1);
+    assert_true(children->first == kept);
+    assert_true(world_get_component(&world, kept, Parent)->previous_sibling == ENTITY_INVALID);
+
+    world_get_component(&world, root, LocalTransform)->translation.x = 5;
+    world_mark_changed(&world, root, LocalTransform);
+    world_run(&world);
+    assert_translation(&world, kept, 6, 0, 0);
+
+    world_destroy(&world);
+}
+
+static void test_destroy_recursive(void **state) {
+    (void)state;
+    check_destroy_recursive(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_destroy_recursive_archetype(void **state) {
+    (void)state;
+    check_destroy_recursive(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void check_destroy_unlinks(WorldStorage storage) {
+    World world = world_new_with_storage(storage);
+    transform_enable(&world);
+
+    entity_id root = spawn(&world, translated(1, 0, 0));
+    entity_id first = spawn(&world, translated(1, 0, 0));
+    entity_id middle = spawn(&world, translated(1, 0, 0));
+    entity_id last = spawn(&world, translated(1, 0, 0));
+    entity_id orphan = spawn(&world, translated(1, 0, 0));
+    transform_set_parent(&world, first, root);
+    transform_set_parent(&world, middle, root);
+    transform_set_parent(&world, last, root);
+    transform_set_parent(&world, orphan, middle);
+    world_run(&world);
+
+    world_destroy_entity(&world, middle);
+
+    const Children *children = world_get_component(&world, root, Children);
+    assert_int_equal(children->count, 2);
+    u32 count = 0;
+    for (entity_id child = children->first; child != ENTITY_INVALID;
+         child = world_get_component(&world, child, Parent)->next_sibling) {
+        assert_true(child == first || child == last);
+        count++;
+    }
+    assert_int_equal(count, 2);
+
+    // the destroyed entity's child becomes a root of its own
+    assert_null(world_get_component(&world, orphan, Parent));
+    world_run(&world);
+    assert_translation(&world, orphan, 1, 0, 0);
+    assert_translation(&world, last, 2, 0, 0);
+
+    world_destroy(&world);
+}
+
+static void test_destroy_unlinks(void **state) {
+    (void)state;
+    check_destroy_unlinks(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_destroy_unlinks_archetype(void **state) {
+    (void)state;
+    check_destroy_unlinks(WORLD_STORAGE_ARCHETYPE);
+}
+
+static void test_unrelated_changes_keep_hierarchy(void **state) {
+    (void)state;
+    World world = world_new();
+    world_register_component(&world, Health);
+    transform_enable(&world);
+
+    entity_id root = spawn(&world, translated(1, 0, 0));
+    entity_id child = spawn(&world, translated(1, 0, 0));
+    transform_set_parent(&world, child, root);
+    world_run(&world);
+
+    u32 local_version = world.components[component_id(LocalTransform)].structure_version;
+    u32 parent_version = world.components[component_id(Parent)].structure_version;
+
+    world_attach_component(&world, child, Health, ((Health){10}));
+    entity_id other = world_create_entity(&world);
+    world_attach_component(&world, other, Health, ((Health){5}));
+    world_destroy_entity(&world, other);
+    world_detach_component(&world, child, Health);
+
+    // nothing the hierarchy is built from moved
+    assert_int_equal(world.components[component_id(LocalTransform)].structure_version, local_version);
+    assert_int_equal(world.components[component_id(Parent)].structure_version, parent_version);
+
+    world_get_component(&world, root, LocalTransform)->translation.x = 3;
+    world_mark_changed(&world, root, LocalTransform);
+    world_run(&world);
+    assert_translation(&world, child, 4, 0, 0);
+
+    world_destroy(&world);
+}
+
+static void spawn_subtree(World *world, entity_id parent, u32 depth) {
+    if (depth == FOREST_DEPTH) {
+        return;
+    }
+    for (u32 i = 0; i < FOREST_FANOUT; i++) {
+        entity_id child = spawn(world, translated(1, (f32)i, 0));
+        transform_set_parent(world, child, parent);
+        spawn_subtree(world, child, depth + 1);
+    }
+}
+
+static void check_parallel_propagation(WorldStorage storage) {
+    JobPool *pool = job_pool_new(4);
+    World world = world_new_with_storage(storage);
+    world_set_job_pool(&world, pool);
+    transform_enable(&world);
+
+    static entity_id roots[FOREST_ROOTS];
+    for (u32 r = 0; r < FOREST_ROOTS; r++) {
+        roots[r] = spawn(&world, translated(0, 0, (f32)r));
+        spawn_subtree(&world, roots[r], 0);
+    }
+
+    world_run(&world);
+
+    // every leaf sits FOREST_DEPTH along x, in its root's z plane
+    for (u32 r = 0; r < FOREST_ROOTS; r++) {
+        entity_id node = roots[r];
+        for (u32 depth = 0; depth < FOREST_DEPTH; depth++) {
+            node = world_get_component(&world, node, Children)->first;
+        }
+        const GlobalTransform *global = world_get_component(&world, node, GlobalTransform);
+        assert_float_equal(global->matrix.raw[3][0], FOREST_DEPTH, EPSILON);
+        assert_float_equal(global->matrix.raw[3][2], r, EPSILON);
+    }
+
+    world_destroy(&world);
+    job_pool_destroy(pool);
+}
+
+static void test_parallel_propagation(void **state) {
+    (void)state;
+    check_parallel_propagation(WORLD_STORAGE_COMPONENT_STORE);
+}
+
+static void test_parallel_propagation_archetype(void **state) {
+    (void)state;
+    check_parallel_propagation(WORLD_STORAGE_ARCHETYPE);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_nested_transforms),
+        cmocka_unit_test(test_nested_transforms_archetype),
+        cmocka_unit_test(test_only_dirty_subtrees),
+        cmocka_unit_test(test_only_dirty_subtrees_archetype),
+        cmocka_unit_test(test_reparenting),
+        cmocka_unit_test(test_reparenting_archetype),
+        cmocka_unit_test(test_destroy_recursive),
+        cmocka_unit_test(test_destroy_recursive_archetype),
+        cmocka_unit_test(test_destroy_unlinks),
+        cmocka_unit_test(test_destroy_unlinks_archetype),
+        cmocka_unit_test(test_unrelated_changes_keep_hierarchy),
+        cmocka_unit_test(test_parallel_propagation),
+        cmocka_unit_test(test_parallel_propagation_archetype),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}